@@ -52,5 +52,6 @@
 #include <gs-remote-icon.h>
 #include <gs-rewrite-resources.h>
 #include <gs-silo-wrapper.h>
+#include <gs-startup-timeline.h>
 #include <gs-utils.h>
 #include <gs-worker-thread.h>
@@ -25,5 +25,16 @@ gint		 gs_app_compare_priority	(GsApp		*app1,
 						 GsApp		*app2);
 void		 gs_app_set_icons_state		(GsApp		*app,
 						 GsAppIconsState icons_state);
+GsPluginRefineRequireFlags
+		 gs_app_get_refined_require_flags
+						(GsApp		*app,
+						 GsPluginRefineFlags job_flags,
+						 guint		 generation);
+void		 gs_app_add_refined_require_flags
+						(GsApp		*app,
+						 GsPluginRefineRequireFlags require_flags,
+						 GsPluginRefineFlags job_flags,
+						 guint		 generation);
+guint		 gs_app_get_n_alive		(void);
 
 G_END_DECLS
@@ -114,6 +114,7 @@ struct _GsAppQuery
 
 	GsPluginRefineFlags refine_flags;
 	GsPluginRefineRequireFlags refine_require_flags;
+	GsPluginRefineRequireFlags ranking_refine_require_flags;
 	guint max_results;
 	GsAppListFilterFlags dedupe_flags;
 
@@ -156,6 +157,7 @@ G_DEFINE_TYPE (GsAppQuery, gs_app_query, G_TYPE_OBJECT)
 typedef enum {
 	PROP_REFINE_FLAGS = 1,
 	PROP_REFINE_REQUIRE_FLAGS,
+	PROP_RANKING_REFINE_REQUIRE_FLAGS,
 	PROP_MAX_RESULTS,
 	PROP_DEDUPE_FLAGS,
 	PROP_SORT_FUNC,
@@ -247,6 +249,9 @@ gs_app_query_get_property (GObject    *object,
 	case PROP_REFINE_REQUIRE_FLAGS:
 		g_value_set_flags (value, self->refine_require_flags);
 		break;
+	case PROP_RANKING_REFINE_REQUIRE_FLAGS:
+		g_value_set_flags (value, self->ranking_refine_require_flags);
+		break;
 	case PROP_MAX_RESULTS:
 		g_value_set_uint (value, self->max_results);
 		break;
@@ -350,6 +355,11 @@ gs_app_query_set_property (GObject      *object,
 		g_assert (self->refine_require_flags == 0);
 		self->refine_require_flags = g_value_get_flags (value);
 		break;
+	case PROP_RANKING_REFINE_REQUIRE_FLAGS:
+		/* Construct only. */
+		g_assert (self->ranking_refine_require_flags == 0);
+		self->ranking_refine_require_flags = g_value_get_flags (value);
+		break;
 	case PROP_MAX_RESULTS:
 		/* Construct only. */
 		g_assert (self->max_results == 0);
@@ -582,6 +592,30 @@ gs_app_query_class_init (GsAppQueryClass *klass)
 				    G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
 				    G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
 
+	/**
+	 * GsAppQuery:ranking-refine-require-flags:
+	 *
+	 * Flags to specify what data the filter, dedupe and sort functions
+	 * need on the returned apps.
+	 *
+	 * If this is set along with #GsAppQuery:max-results, the results are
+	 * refined in two phases: first with only these flags, before being
+	 * filtered, deduplicated, sorted and truncated; and then with the rest
+	 * of #GsAppQuery:refine-require-flags, on the truncated results only.
+	 * This avoids refining data for results which are then thrown away.
+	 *
+	 * If this is %GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE, all the results are
+	 * refined with #GsAppQuery:refine-require-flags before being filtered.
+	 *
+	 * Since: 51
+	 */
+	props[PROP_RANKING_REFINE_REQUIRE_FLAGS] =
+		g_param_spec_flags ("ranking-refine-require-flags", "Ranking Refine Require Flags",
+				    "Flags to specify what data the filter, dedupe and sort functions need on the returned apps.",
+				    GS_TYPE_PLUGIN_REFINE_REQUIRE_FLAGS, GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE,
+				    G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+				    G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
+
 	/**
 	 * GsAppQuery:max-results:
 	 *
@@ -1144,6 +1178,24 @@ gs_app_query_get_refine_require_flags (GsAppQuery *self)
 	return self->refine_require_flags;
 }
 
+/**
+ * gs_app_query_get_ranking_refine_require_flags:
+ * @self: a #GsAppQuery
+ *
+ * Get the value of #GsAppQuery:ranking-refine-require-flags.
+ *
+ * Returns: the refine require flags needed to filter, dedupe and sort the
+ *   results, or %GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE to refine in one phase
+ * Since: 51
+ */
+GsPluginRefineRequireFlags
+gs_app_query_get_ranking_refine_require_flags (GsAppQuery *self)
+{
+	g_return_val_if_fail (GS_IS_APP_QUERY (self), GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
+
+	return self->ranking_refine_require_flags;
+}
+
 /**
  * gs_app_query_get_max_results:
  * @self: a #GsAppQuery
@@ -1234,6 +1286,7 @@ gs_app_query_get_filter_func (GsAppQuery *self,
  * These are the properties which determine the query results, rather than ones
  * which control refining the results (#GsAppQuery:refine-flags,
  * #GsAppQuery:refine-require-flags,
+ * #GsAppQuery:ranking-refine-require-flags,
  * #GsAppQuery:max-results, #GsAppQuery:dedupe-flags, #GsAppQuery:sort-func and
  * its user data, #GsAppQuery:filter-func and its user data,
  * #GsAppQuery:license-type).
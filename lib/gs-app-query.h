@@ -131,6 +131,8 @@ GsAppQuery	*gs_app_query_new	(const gchar *first_property_name,
 
 GsPluginRefineFlags	 gs_app_query_get_refine_flags	(GsAppQuery *self);
 GsPluginRefineRequireFlags	 gs_app_query_get_refine_require_flags	(GsAppQuery *self);
+GsPluginRefineRequireFlags	 gs_app_query_get_ranking_refine_require_flags
+								(GsAppQuery *self);
 guint			 gs_app_query_get_max_results	(GsAppQuery *self);
 GsAppListFilterFlags	 gs_app_query_get_dedupe_flags	(GsAppQuery *self);
 GsAppListSortFunc	 gs_app_query_get_sort_func	(GsAppQuery *self,
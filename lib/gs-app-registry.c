@@ -0,0 +1,416 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-app-registry
+ * @short_description: A loader-wide registry of live #GsApp instances
+ *
+ * #GsAppRegistry maps unique IDs to the #GsApp instance currently in use for
+ * that component, holding only weak references. It is shared by all plugins
+ * of a #GsPluginLoader, so that when the overview, category, search and
+ * details jobs produce the same component they get back the same, already
+ * refined, #GsApp rather than a fresh one which needs refining again.
+ *
+ * Apps get into the registry in two ways:
+ *
+ *  - gs_plugin_cache_add() registers every app a plugin caches. On a miss,
+ *    the per-plugin cache (gs_plugin_cache_lookup()) consults the registry,
+ *    but only hands back apps the looking-up plugin created itself, as apps
+ *    created by other plugins may lack metadata it relies on.
+ *  - gs_plugin_loader_share_apps() passes the results of the list-apps jobs
+ *    (used by the overview, category and search pages) through
+ *    gs_app_registry_share(), which swaps each app for the live instance
+ *    already registered for its unique ID and registers the others. Only
+ *    instances with the same management plugin are swapped.
+ *
+ * So sharing is limited to apps with an identical unique ID and management
+ * plugin; different plugins’ apps for the same component are never merged.
+ *
+ * As only weak references are held, an app disappears from the registry once
+ * nothing else is using it. An app whose unique ID changes after it was
+ * registered (for example when its branch or origin is refined) is no longer
+ * returned for its old unique ID; it has to be registered again under the new
+ * one.
+ *
+ * Wildcard apps are never registered, as they do not identify a single
+ * component.
+ *
+ * #GsAppRegistry is safe to use from any thread.
+ *
+ * Since: 51
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib-object.h>
+#include <appstream.h>
+
+#include "gs-app-registry.h"
+#include "gs-plugin.h"
+
+struct _GsAppRegistry
+{
+	GObject			 parent;
+
+	GMutex			 mutex;
+	GHashTable		*apps;  /* (mutex mutex) (owned) (element-type utf8 GWeakRef) */
+	guint			 n_adds_since_prune;  /* (mutex mutex) */
+	guint			 n_hits;  /* (atomic) */
+};
+
+G_DEFINE_TYPE (GsAppRegistry, gs_app_registry, G_TYPE_OBJECT)
+
+static void
+weak_ref_free (GWeakRef *weak_ref)
+{
+	g_weak_ref_clear (weak_ref);
+	g_free (weak_ref);
+}
+
+static void
+gs_app_registry_finalize (GObject *object)
+{
+	GsAppRegistry *self = GS_APP_REGISTRY (object);
+
+	g_hash_table_unref (self->apps);
+	g_mutex_clear (&self->mutex);
+
+	G_OBJECT_CLASS (gs_app_registry_parent_class)->finalize (object);
+}
+
+static void
+gs_app_registry_class_init (GsAppRegistryClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gs_app_registry_finalize;
+}
+
+static void
+gs_app_registry_init (GsAppRegistry *self)
+{
+	g_mutex_init (&self->mutex);
+	self->apps = g_hash_table_new_full ((GHashFunc) as_utils_data_id_hash,
+					    (GEqualFunc) as_utils_data_id_equal,
+					    g_free,
+					    (GDestroyNotify) weak_ref_free);
+}
+
+/**
+ * gs_app_registry_new:
+ *
+ * Create a new, empty #GsAppRegistry.
+ *
+ * Returns: (transfer full): a new #GsAppRegistry
+ * Since: 51
+ */
+GsAppRegistry *
+gs_app_registry_new (void)
+{
+	return g_object_new (GS_TYPE_APP_REGISTRY, NULL);
+}
+
+/* Whether @app is still registrable under @unique_id, which it was registered
+ * with. Its unique ID changes if, for example, its branch or origin is set
+ * after it was registered. */
+static gboolean
+app_has_unique_id (GsApp       *app,
+                   const gchar *unique_id)
+{
+	return g_strcmp0 (gs_app_get_unique_id (app), unique_id) == 0;
+}
+
+/* mutex must be held */
+static void
+gs_app_registry_prune_unlocked (GsAppRegistry *self)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init (&iter, self->apps);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		g_autoptr(GsApp) app = g_weak_ref_get (value);
+		if (app == NULL || !app_has_unique_id (app, key))
+			g_hash_table_iter_remove (&iter);
+	}
+
+	self->n_adds_since_prune = 0;
+}
+
+/* mutex must be held */
+static void
+gs_app_registry_add_unlocked (GsAppRegistry *self,
+                              GsApp         *app,
+                              const gchar   *unique_id)
+{
+	GWeakRef *weak_ref;
+	const gchar *registered_id;
+
+	if (g_hash_table_lookup_extended (self->apps, unique_id,
+					  (gpointer *) &registered_id, (gpointer *) &weak_ref)) {
+		g_autoptr(GsApp) existing = g_weak_ref_get (weak_ref);
+		if (existing != NULL && app_has_unique_id (existing, registered_id))
+			return;
+
+		/* replace the entry, so that it is keyed by the new app’s ID */
+		g_hash_table_remove (self->apps, unique_id);
+	}
+
+	weak_ref = g_new0 (GWeakRef, 1);
+	g_weak_ref_init (weak_ref, app);
+	g_hash_table_insert (self->apps, g_strdup (unique_id), weak_ref);
+
+	/* dead entries are only dropped lazily, so sweep them every so often
+	 * to stop the table growing without bound */
+	if (++self->n_adds_since_prune > g_hash_table_size (self->apps) / 2)
+		gs_app_registry_prune_unlocked (self);
+}
+
+/**
+ * gs_app_registry_add:
+ * @self: a #GsAppRegistry
+ * @app: a #GsApp
+ *
+ * Register @app as the instance to share for its unique ID.
+ *
+ * If another live instance is already registered for the same unique ID, it
+ * is kept and @app is ignored. Wildcard apps and apps without a unique ID are
+ * ignored.
+ *
+ * Since: 51
+ */
+void
+gs_app_registry_add (GsAppRegistry *self,
+                     GsApp         *app)
+{
+	const gchar *unique_id;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_APP_REGISTRY (self));
+	g_return_if_fail (GS_IS_APP (app));
+
+	if (gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD))
+		return;
+	unique_id = gs_app_get_unique_id (app);
+	if (unique_id == NULL)
+		return;
+
+	locker = g_mutex_locker_new (&self->mutex);
+	gs_app_registry_add_unlocked (self, app, unique_id);
+}
+
+/**
+ * gs_app_registry_lookup:
+ * @self: a #GsAppRegistry
+ * @unique_id: a unique ID
+ *
+ * Look up the live #GsApp registered for @unique_id. Entries are matched with
+ * as_utils_data_id_equal(), where wildcard parts match anything, but only an
+ * app whose unique ID is exactly @unique_id is returned.
+ *
+ * Returns: (transfer full) (nullable): the #GsApp, or %NULL if none is
+ *   registered or it has since been finalized
+ * Since: 51
+ */
+GsApp *
+gs_app_registry_lookup (GsAppRegistry *self,
+                        const gchar   *unique_id)
+{
+	GWeakRef *weak_ref;
+	const gchar *registered_id;
+	GsApp *app;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (GS_IS_APP_REGISTRY (self), NULL);
+	g_return_val_if_fail (unique_id != NULL, NULL);
+
+	locker = g_mutex_locker_new (&self->mutex);
+
+	if (!g_hash_table_lookup_extended (self->apps, unique_id,
+					   (gpointer *) &registered_id, (gpointer *) &weak_ref))
+		return NULL;
+
+	app = g_weak_ref_get (weak_ref);
+	if (app == NULL || !app_has_unique_id (app, registered_id)) {
+		g_hash_table_remove (self->apps, unique_id);
+		g_clear_object (&app);
+		return NULL;
+	}
+
+	/* the table matches wildcard parts of unique IDs, but an app is only
+	 * shared for exactly its own unique ID */
+	if (!app_has_unique_id (app, unique_id)) {
+		g_clear_object (&app);
+		return NULL;
+	}
+
+	g_atomic_int_inc (&self->n_hits);
+
+	return app;
+}
+
+/**
+ * gs_app_registry_share:
+ * @self: a #GsAppRegistry
+ * @app: a #GsApp
+ *
+ * Get the instance to use for @app: the live instance already registered for
+ * exactly the unique ID of @app, if it has the same management plugin, or otherwise
+ * @app itself, which is then registered if no other live instance is.
+ *
+ * Wildcard apps and apps without a unique ID are returned unchanged and are
+ * not registered.
+ *
+ * Returns: (transfer full): the shared #GsApp, or a new reference to @app
+ * Since: 51
+ */
+GsApp *
+gs_app_registry_share (GsAppRegistry *self,
+                       GsApp         *app)
+{
+	GWeakRef *weak_ref;
+	const gchar *unique_id;
+	const gchar *registered_id;
+	g_autoptr(GsApp) existing = NULL;
+	g_autoptr(GsPlugin) management_plugin = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (GS_IS_APP_REGISTRY (self), NULL);
+	g_return_val_if_fail (GS_IS_APP (app), NULL);
+
+	if (gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD))
+		return g_object_ref (app);
+	unique_id = gs_app_get_unique_id (app);
+	if (unique_id == NULL)
+		return g_object_ref (app);
+
+	locker = g_mutex_locker_new (&self->mutex);
+
+	if (g_hash_table_lookup_extended (self->apps, unique_id,
+					  (gpointer *) &registered_id, (gpointer *) &weak_ref)) {
+		existing = g_weak_ref_get (weak_ref);
+		if (existing != NULL && !app_has_unique_id (existing, registered_id))
+			g_clear_object (&existing);
+	}
+
+	if (existing == app)
+		return g_steal_pointer (&existing);
+
+	if (existing != NULL) {
+		management_plugin = gs_app_dup_management_plugin (app);
+		if (!app_has_unique_id (existing, unique_id) ||
+		    !gs_app_has_management_plugin (existing, management_plugin))
+			return g_object_ref (app);
+
+		g_atomic_int_inc (&self->n_hits);
+		return g_steal_pointer (&existing);
+	}
+
+	gs_app_registry_add_unlocked (self, app, unique_id);
+
+	return g_object_ref (app);
+}
+
+/**
+ * gs_app_registry_remove:
+ * @self: a #GsAppRegistry
+ * @app: a #GsApp
+ *
+ * Unregister @app, if it is the instance registered for its current unique ID.
+ * If its unique ID has changed since it was registered, the entry under the
+ * old unique ID is dropped when it is next looked up.
+ *
+ * Since: 51
+ */
+void
+gs_app_registry_remove (GsAppRegistry *self,
+                        GsApp         *app)
+{
+	GWeakRef *weak_ref;
+	const gchar *unique_id;
+	g_autoptr(GsApp) existing = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_APP_REGISTRY (self));
+	g_return_if_fail (GS_IS_APP (app));
+
+	unique_id = gs_app_get_unique_id (app);
+	if (unique_id == NULL)
+		return;
+
+	locker = g_mutex_locker_new (&self->mutex);
+
+	weak_ref = g_hash_table_lookup (self->apps, unique_id);
+	if (weak_ref == NULL)
+		return;
+
+	existing = g_weak_ref_get (weak_ref);
+	if (existing == NULL || existing == app)
+		g_hash_table_remove (self->apps, unique_id);
+}
+
+/**
+ * gs_app_registry_invalidate:
+ * @self: a #GsAppRegistry
+ *
+ * Forget all registered apps. Subsequent lookups will miss until apps are
+ * registered again.
+ *
+ * Since: 51
+ */
+void
+gs_app_registry_invalidate (GsAppRegistry *self)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_APP_REGISTRY (self));
+
+	locker = g_mutex_locker_new (&self->mutex);
+	g_hash_table_remove_all (self->apps);
+	self->n_adds_since_prune = 0;
+}
+
+/**
+ * gs_app_registry_get_size:
+ * @self: a #GsAppRegistry
+ *
+ * Get the number of registered apps which are still alive.
+ *
+ * Returns: number of live registered apps
+ * Since: 51
+ */
+guint
+gs_app_registry_get_size (GsAppRegistry *self)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (GS_IS_APP_REGISTRY (self), 0);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	gs_app_registry_prune_unlocked (self);
+
+	return g_hash_table_size (self->apps);
+}
+
+/**
+ * gs_app_registry_get_n_hits:
+ * @self: a #GsAppRegistry
+ *
+ * Get the number of lookups which returned an existing instance.
+ *
+ * Returns: number of successful lookups
+ * Since: 51
+ */
+guint
+gs_app_registry_get_n_hits (GsAppRegistry *self)
+{
+	g_return_val_if_fail (GS_IS_APP_REGISTRY (self), 0);
+
+	return (guint) g_atomic_int_get (&self->n_hits);
+}
@@ -0,0 +1,36 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "gs-app.h"
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_APP_REGISTRY (gs_app_registry_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsAppRegistry, gs_app_registry, GS, APP_REGISTRY, GObject)
+
+GsAppRegistry	*gs_app_registry_new		(void);
+
+void		 gs_app_registry_add		(GsAppRegistry	*self,
+						 GsApp		*app);
+GsApp		*gs_app_registry_lookup		(GsAppRegistry	*self,
+						 const gchar	*unique_id);
+GsApp		*gs_app_registry_share		(GsAppRegistry	*self,
+						 GsApp		*app);
+void		 gs_app_registry_remove		(GsAppRegistry	*self,
+						 GsApp		*app);
+void		 gs_app_registry_invalidate	(GsAppRegistry	*self);
+guint		 gs_app_registry_get_size	(GsAppRegistry	*self);
+guint		 gs_app_registry_get_n_hits	(GsAppRegistry	*self);
+
+G_END_DECLS
@@ -68,12 +68,13 @@
 #include "gs-os-release.h"
 #include "gs-plugin.h"
 #include "gs-plugin-private.h"
+#include "gs-profiler.h"
 #include "gs-remote-icon.h"
 #include "gs-utils.h"
 
 typedef struct
 {
-	GMutex			 mutex;
+	GRWLock			 rw_lock;  /* readers for getters which return owned data, writers for setters */
 	gchar			*id;
 	gchar			*unique_id;
 	gboolean		 unique_id_valid;
@@ -165,6 +166,9 @@ typedef struct
 	gboolean		 key_color_for_dark_set;
 	GdkRGBA			 key_color_for_dark;
 	gboolean		 mok_key_pending;
+	GsPluginRefineRequireFlags refined_require_flags;  /* which data the plugins have already refined */
+	guint			 refined_generation;  /* loader refine generation @refined_require_flags is valid for */
+	GsPluginRefineFlags	 refined_job_flags;  /* job flags of the refines which set @refined_require_flags */
 } GsAppPrivate;
 
 typedef enum {
@@ -212,6 +216,16 @@ static GParamSpec *obj_props[PROP_MOK_KEY_PENDING + 1] = { NULL, };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GsApp, gs_app, G_TYPE_OBJECT)
 
+/* Number of #GsApp instances alive, sampled as a sysprof counter to spot
+ * leaks and heavy churn. */
+static gint n_apps_alive = 0;  /* (atomic) */
+
+static void
+update_apps_alive_counter (gint n_apps)
+{
+	GS_PROFILER_SET_COUNTER (GS_PROFILER_COUNTER_APPS_ALIVE, n_apps);
+}
+
 static gboolean
 _g_set_strv (gchar ***strv_ptr, gchar **new_strv)
 {
@@ -377,7 +391,7 @@ _as_component_quirk_flag_to_string (GsAppQuirk quirk)
 	}
 }
 
-/* mutex must be held */
+/* writer lock must be held */
 static const gchar *
 gs_app_get_unique_id_unlocked (GsApp *app)
 {
@@ -546,7 +560,7 @@ gs_app_to_string_append (GsApp *app, GString *str)
 	GList *keys;
 	const gchar *tmp;
 	guint i;
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_autoptr(GsPlugin) management_plugin = NULL;
 	GsSizeType size_download_dependencies_type, size_installed_dependencies_type;
 	guint64 size_download_dependencies_bytes, size_installed_dependencies_bytes;
@@ -556,7 +570,7 @@ gs_app_to_string_append (GsApp *app, GString *str)
 
 	klass = GS_APP_GET_CLASS (app);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	g_string_append_printf (str, " [%p]\n", app);
 	gs_app_kv_lpad (str, "kind", as_component_kind_to_string (priv->kind));
@@ -879,9 +893,9 @@ void
 gs_app_set_id (GsApp *app, const gchar *id)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	if (g_set_str (&priv->id, id))
 		priv->unique_id_valid = FALSE;
 }
@@ -1105,7 +1119,7 @@ gs_app_set_state_recover (GsApp *app)
 	gs_app_queue_notify (app, obj_props[PROP_SHOW_REVIEWS]);
 }
 
-/* mutex must be held */
+/* writer lock must be held */
 static gboolean
 gs_app_set_state_internal (GsApp *app, GsAppState state)
 {
@@ -1122,6 +1136,9 @@ gs_app_set_state_internal (GsApp *app, GsAppState state)
 
 	priv->state = state;
 
+	/* installing or removing an app changes most of its refined data */
+	priv->refined_require_flags = GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE;
+
 	if (state == GS_APP_STATE_UNKNOWN ||
 	    state == GS_APP_STATE_AVAILABLE_LOCAL ||
 	    state == GS_APP_STATE_AVAILABLE)
@@ -1165,9 +1182,9 @@ void
 gs_app_set_progress (GsApp *app, guint percentage)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	if (priv->progress == percentage)
 		return;
 	if (percentage != GS_APP_PROGRESS_UNKNOWN && percentage > 100) {
@@ -1194,9 +1211,9 @@ void
 gs_app_set_allow_cancel (GsApp *app, gboolean allow_cancel)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	if (priv->allow_cancel == allow_cancel)
 		return;
 	priv->allow_cancel = allow_cancel;
@@ -1231,10 +1248,10 @@ void
 gs_app_set_state (GsApp *app, GsAppState state)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	gs_app_set_state_internal (app, state);
 }
@@ -1279,11 +1296,11 @@ gs_app_set_kind (GsApp *app, AsComponentKind kind)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	gboolean state_change_ok = FALSE;
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* same */
 	if (priv->kind == kind)
@@ -1353,9 +1370,20 @@ const gchar *
 gs_app_get_unique_id (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+
+	/* fast path: the unique ID is only rebuilt after one of the fields it
+	 * is made from has changed, so most calls only need a reader lock */
+	g_rw_lock_reader_lock (&priv->rw_lock);
+	if (priv->id == NULL || (priv->unique_id != NULL && priv->unique_id_valid)) {
+		const gchar *unique_id = (priv->id != NULL) ? priv->unique_id : NULL;
+		g_rw_lock_reader_unlock (&priv->rw_lock);
+		return unique_id;
+	}
+	g_rw_lock_reader_unlock (&priv->rw_lock);
+
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	return gs_app_get_unique_id_unlocked (app);
 }
 
@@ -1373,10 +1401,10 @@ void
 gs_app_set_unique_id (GsApp *app, const gchar *unique_id)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* check for sanity */
 	if (!as_utils_data_id_valid (unique_id))
@@ -1419,10 +1447,10 @@ void
 gs_app_set_name (GsApp *app, GsAppQuality quality, const gchar *name)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* only save this if the data is sufficiently high quality */
 	if (quality < priv->name_quality)
@@ -1464,9 +1492,9 @@ void
 gs_app_set_renamed_from (GsApp *app, const gchar *renamed_from)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_set_str (&priv->renamed_from, renamed_from);
 }
 
@@ -1501,9 +1529,9 @@ void
 gs_app_set_branch (GsApp *app, const gchar *branch)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	if (g_set_str (&priv->branch, branch))
 		priv->unique_id_valid = FALSE;
 }
@@ -1544,12 +1572,12 @@ gs_app_add_source (GsApp *app, const gchar *source)
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	const gchar *tmp;
 	guint i;
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (source != NULL);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* check source doesn't already exist */
 	for (i = 0; i < priv->sources->len; i++) {
@@ -1595,9 +1623,9 @@ void
 gs_app_set_sources (GsApp *app, GPtrArray *sources)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	_g_set_ptr_array (&priv->sources, sources);
 }
 
@@ -1656,9 +1684,9 @@ void
 gs_app_clear_source_ids (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_ptr_array_set_size (priv->source_ids, 0);
 }
 
@@ -1676,9 +1704,9 @@ void
 gs_app_set_source_ids (GsApp *app, GPtrArray *source_ids)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	_g_set_ptr_array (&priv->source_ids, source_ids);
 }
 
@@ -1761,9 +1789,9 @@ void
 gs_app_set_project_group (GsApp *app, const gchar *project_group)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_set_str (&priv->project_group, project_group);
 }
 
@@ -1780,9 +1808,9 @@ void
 gs_app_set_developer_name (GsApp *app, const gchar *developer_name)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_set_str (&priv->developer_name, developer_name);
 }
 
@@ -1853,7 +1881,7 @@ gs_app_get_icon_for_size (GsApp       *app,
                           const gchar *fallback_icon_name)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 	g_return_val_if_fail (size > 0, NULL);
@@ -1862,7 +1890,7 @@ gs_app_get_icon_for_size (GsApp       *app,
 	g_debug ("Looking for icon for %s, at size %u×%u, with fallback %s",
 		 gs_app_get_id (app), size, scale, fallback_icon_name);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 
 	/* See if there’s an icon of the right size, or the first one which is too
 	 * big which could be scaled down. Note that the icons array may be
@@ -1909,7 +1937,7 @@ gs_app_get_icon_for_size (GsApp       *app,
 		}
 	}
 
-	g_clear_pointer (&locker, g_mutex_locker_free);
+	g_clear_pointer (&locker, g_rw_lock_reader_locker_free);
 
 	if (scale > 1) {
 		g_debug ("Retrying at scale 1");
@@ -1959,12 +1987,12 @@ GPtrArray *
 gs_app_dup_icons (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	GPtrArray *copy;
 
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 
 	if (priv->icons == NULL || priv->icons->len == 0)
 		return NULL;
@@ -1991,11 +2019,11 @@ gboolean
 gs_app_has_icons (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 
 	g_return_val_if_fail (GS_IS_APP (app), FALSE);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 
 	return priv->icons != NULL && priv->icons->len > 0;
 }
@@ -2034,11 +2062,11 @@ void
 gs_app_add_icon (GsApp *app, GIcon *icon)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (G_IS_ICON (icon));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (priv->icons == NULL) {
 		priv->icons = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -2076,9 +2104,9 @@ void
 gs_app_remove_all_icons (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (priv->icons != NULL)
 		g_ptr_array_set_size (priv->icons, 0);
@@ -2116,9 +2144,9 @@ void
 gs_app_set_agreement (GsApp *app, const gchar *agreement)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_set_str (&priv->agreement, agreement);
 }
 
@@ -2155,9 +2183,9 @@ void
 gs_app_set_local_file (GsApp *app, GFile *local_file)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_set_object (&priv->local_file, local_file);
 }
 
@@ -2175,9 +2203,9 @@ AsContentRating *
 gs_app_dup_content_rating (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 	return (priv->content_rating != NULL) ? g_object_ref (priv->content_rating) : NULL;
 }
 
@@ -2194,9 +2222,9 @@ void
 gs_app_set_content_rating (GsApp *app, AsContentRating *content_rating)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	if (g_set_object (&priv->content_rating, content_rating))
 		gs_app_queue_notify (app, obj_props[PROP_CONTENT_RATING]);
 }
@@ -2232,11 +2260,11 @@ void
 gs_app_set_runtime (GsApp *app, GsApp *runtime)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (GS_IS_APP (runtime));
 	g_return_if_fail (app != runtime);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_set_object (&priv->runtime, runtime);
 
 	/* The runtime adds to the main app’s sizes. */
@@ -2257,9 +2285,9 @@ void
 gs_app_set_action_screenshot (GsApp *app, AsScreenshot *action_screenshot)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_set_object (&priv->action_screenshot, action_screenshot);
 }
 
@@ -2423,10 +2451,10 @@ void
 gs_app_set_version (GsApp *app, const gchar *version)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (g_set_str (&priv->version, version)) {
 		gs_app_ui_versions_invalidate (app);
@@ -2466,10 +2494,10 @@ void
 gs_app_set_summary (GsApp *app, GsAppQuality quality, const gchar *summary)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* only save this if the data is sufficiently high quality */
 	if (quality < priv->summary_quality)
@@ -2511,10 +2539,10 @@ void
 gs_app_set_description (GsApp *app, GsAppQuality quality, const gchar *description)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* only save this if the data is sufficiently high quality */
 	if (quality < priv->description_quality)
@@ -2538,9 +2566,9 @@ const gchar *
 gs_app_get_url (GsApp *app, AsUrlKind kind)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 
 	if (priv->urls == NULL)
 		return NULL;
@@ -2562,12 +2590,12 @@ void
 gs_app_set_url (GsApp *app, AsUrlKind kind, const gchar *url)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	gboolean changed;
 
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (priv->urls == NULL)
 		priv->urls = g_hash_table_new_full (g_direct_hash, g_direct_equal,
@@ -2600,9 +2628,9 @@ const gchar *
 gs_app_get_url_missing (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 	return priv->url_missing;
 }
 
@@ -2620,9 +2648,9 @@ void
 gs_app_set_url_missing (GsApp *app, const gchar *url)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (g_strcmp0 (priv->url_missing, url) == 0)
 		return;
@@ -2646,9 +2674,9 @@ const gchar *
 gs_app_get_launchable (GsApp *app, AsLaunchableKind kind)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 	return g_hash_table_lookup (priv->launchables,
 				    as_launchable_kind_to_string (kind));
 }
@@ -2669,9 +2697,9 @@ gs_app_set_launchable (GsApp *app, AsLaunchableKind kind, const gchar *launchabl
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	gpointer current_value = NULL;
 	const gchar *key;
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	key = as_launchable_kind_to_string (kind);
 	if (g_hash_table_lookup_extended (priv->launchables, key, NULL, &current_value)) {
 		if (g_strcmp0 ((const gchar *) current_value, launchable) != 0)
@@ -2734,11 +2762,11 @@ void
 gs_app_set_license (GsApp *app, GsAppQuality quality, const gchar *license)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* only save this if the data is sufficiently high quality */
 	if (quality <= priv->license_quality)
@@ -2784,9 +2812,9 @@ void
 gs_app_set_summary_missing (GsApp *app, const gchar *summary_missing)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_set_str (&priv->summary_missing, summary_missing);
 }
 
@@ -2875,9 +2903,9 @@ void
 gs_app_set_menu_path (GsApp *app, gchar **menu_path)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	_g_set_strv (&priv->menu_path, menu_path);
 }
 
@@ -2914,10 +2942,10 @@ void
 gs_app_set_origin (GsApp *app, const gchar *origin)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* same */
 	if (g_strcmp0 (origin, priv->origin) == 0)
@@ -2970,10 +2998,10 @@ void
 gs_app_set_origin_appstream (GsApp *app, const gchar *origin_appstream)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* same */
 	if (g_strcmp0 (origin_appstream, priv->origin_appstream) == 0)
@@ -3020,14 +3048,14 @@ void
 gs_app_set_origin_hostname (GsApp *app, const gchar *origin_hostname)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_autoptr(GUri) uri = NULL;
 	guint i;
 	const gchar *prefixes[] = { "download.", "mirrors.", NULL };
 
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* same */
 	if (g_strcmp0 (origin_hostname, priv->origin_hostname) == 0)
@@ -3066,12 +3094,12 @@ void
 gs_app_add_screenshot (GsApp *app, AsScreenshot *screenshot)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (AS_IS_SCREENSHOT (screenshot));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_ptr_array_add (priv->screenshots, g_object_ref (screenshot));
 }
 
@@ -3157,9 +3185,9 @@ void
 gs_app_set_update_version (GsApp *app, const gchar *update_version)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	gs_app_set_update_version_internal (app, update_version);
 	gs_app_queue_notify (app, obj_props[PROP_VERSION]);
 }
@@ -3198,9 +3226,9 @@ gs_app_set_update_details_markup (GsApp *app,
 				  const gchar *markup)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	priv->update_details_set = TRUE;
 	g_set_str (&priv->update_details_markup, markup);
 }
@@ -3222,9 +3250,9 @@ gs_app_set_update_details_text (GsApp *app,
 				const gchar *text)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	priv->update_details_set = TRUE;
 	if (text == NULL) {
 		g_set_str (&priv->update_details_markup, NULL);
@@ -3250,9 +3278,9 @@ gboolean
 gs_app_get_update_details_set (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), FALSE);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 	return priv->update_details_set;
 }
 
@@ -3353,13 +3381,13 @@ gs_app_set_management_plugin (GsApp    *app,
                               GsPlugin *management_plugin)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_autoptr(GsPlugin) old_plugin = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (management_plugin == NULL || GS_IS_PLUGIN (management_plugin));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* plugins cannot adopt wildcard packages */
 	if (gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD)) {
@@ -3506,14 +3534,14 @@ gs_app_set_review_ratings (GsApp              *app,
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail ((review_ratings == NULL) == (review_ratings_length == 0));
 	g_return_if_fail (review_ratings_length == 0 ||
 			  review_ratings_length == G_N_ELEMENTS (priv->review_ratings));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (review_ratings != NULL) {
 		for (size_t i = 0; i < G_N_ELEMENTS (priv->review_ratings); i++)
@@ -3557,11 +3585,11 @@ GPtrArray *
 gs_app_get_reviews (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* Ensure the array is sorted. It’s more efficient to do this here than
 	 * inserting in sorted order in gs_app_add_review() because inserting
@@ -3587,10 +3615,10 @@ void
 gs_app_add_review (GsApp *app, AsReview *review)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (AS_IS_REVIEW (review));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_ptr_array_add (priv->reviews, g_object_ref (review));
 	priv->reviews_sorted = FALSE;
 }
@@ -3608,9 +3636,9 @@ void
 gs_app_remove_review (GsApp *app, AsReview *review)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	g_ptr_array_remove (priv->reviews, review);
 }
 
@@ -3673,13 +3701,13 @@ gs_app_add_provided_item (GsApp *app, AsProvidedKind kind, const gchar *item)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	AsProvided *prov;
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (item != NULL);
 	g_return_if_fail (kind != AS_PROVIDED_KIND_UNKNOWN && kind < AS_PROVIDED_KIND_LAST);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	prov = gs_app_get_provided_for_kind (app, kind);
 	if (prov == NULL) {
 		prov = as_provided_new ();
@@ -4244,12 +4272,12 @@ void
 gs_app_set_metadata_variant (GsApp *app, const gchar *key, GVariant *value)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	GVariant *found;
 
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* if no value, then remove the key */
 	if (value == NULL) {
@@ -4293,9 +4321,9 @@ GsAppList *
 gs_app_dup_addons (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 	return (priv->addons != NULL) ? g_object_ref (priv->addons) : NULL;
 }
 
@@ -4313,7 +4341,7 @@ gs_app_add_addons (GsApp     *app,
                    GsAppList *addons)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_autoptr(GsAppList) new_addons = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
@@ -4322,7 +4350,7 @@ gs_app_add_addons (GsApp     *app,
 	if (gs_app_list_length (addons) == 0)
 		return;
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (priv->addons != NULL)
 		new_addons = gs_app_list_copy (priv->addons);
@@ -4346,10 +4374,10 @@ void
 gs_app_remove_addon (GsApp *app, GsApp *addon)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (GS_IS_APP (addon));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (priv->addons != NULL)
 		gs_app_list_remove (priv->addons, addon);
@@ -4387,12 +4415,12 @@ gs_app_add_related (GsApp *app, GsApp *app2)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	GsAppPrivate *priv2 = gs_app_get_instance_private (app2);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (GS_IS_APP (app2));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* if the app is updatable-live and any related app is not then
 	 * degrade to the offline state */
@@ -4440,10 +4468,10 @@ void
 gs_app_add_history (GsApp *app, GsApp *app2)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (GS_IS_APP (app2));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	gs_app_list_add (priv->history, app2);
 }
 
@@ -4625,10 +4653,10 @@ void
 gs_app_set_categories (GsApp *app, GPtrArray *categories)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (categories != NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	_g_set_ptr_array (&priv->categories, categories);
 }
 
@@ -4645,10 +4673,10 @@ void
 gs_app_add_category (GsApp *app, const gchar *category)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (category != NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	if (gs_app_has_category (app, category))
 		return;
 	g_ptr_array_add (priv->categories, g_strdup (category));
@@ -4671,11 +4699,11 @@ gs_app_remove_category (GsApp *app, const gchar *category)
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	const gchar *tmp;
 	guint i;
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (GS_IS_APP (app), FALSE);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	for (i = 0; i < priv->categories->len; i++) {
 		tmp = g_ptr_array_index (priv->categories, i);
@@ -4838,10 +4866,10 @@ void
 gs_app_set_key_colors (GsApp *app, GArray *key_colors)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (key_colors != NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	priv->user_key_colors = FALSE;
 	if (_g_set_array (&priv->key_colors, key_colors))
 		gs_app_queue_notify (app, obj_props[PROP_KEY_COLORS]);
@@ -5194,14 +5222,14 @@ void
 gs_app_add_quirk (GsApp *app, GsAppQuirk quirk)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
 	/* same */
 	if ((priv->quirk & quirk) > 0)
 		return;
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	priv->quirk |= quirk;
 
 	gs_app_queue_notify (app, obj_props[PROP_QUIRK]);
@@ -5222,14 +5250,14 @@ void
 gs_app_remove_quirk (GsApp *app, GsAppQuirk quirk)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
 	/* same */
 	if ((priv->quirk & quirk) == 0)
 		return;
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	priv->quirk &= ~quirk;
 
 	gs_app_queue_notify (app, obj_props[PROP_QUIRK]);
@@ -5295,6 +5323,24 @@ gs_app_set_priority (GsApp *app, guint priority)
 	priv->priority = priority;
 }
 
+/**
+ * gs_app_get_n_alive:
+ *
+ * Get the number of #GsApp instances currently alive in the process. This is
+ * meant for tracking memory use in the tests.
+ *
+ * This can be called from any thread.
+ *
+ * Returns: number of #GsApp instances
+ *
+ * Since: 51
+ **/
+guint
+gs_app_get_n_alive (void)
+{
+	return (guint) g_atomic_int_get (&n_apps_alive);
+}
+
 /**
  * gs_app_get_priority:
  * @app: a #GsApp
@@ -5343,11 +5389,11 @@ gs_app_get_cancellable (GsApp *app)
 {
 	g_autoptr(GCancellable) cancellable = NULL;
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (priv->cancellable == NULL || g_cancellable_is_cancelled (priv->cancellable)) {
 		cancellable = g_cancellable_new ();
@@ -5659,7 +5705,9 @@ gs_app_finalize (GObject *object)
 	GsApp *app = GS_APP (object);
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 
-	g_mutex_clear (&priv->mutex);
+	update_apps_alive_counter (g_atomic_int_add (&n_apps_alive, -1) - 1);
+
+	g_rw_lock_clear (&priv->rw_lock);
 	g_free (priv->id);
 	g_free (priv->unique_id);
 	g_free (priv->branch);
@@ -6202,7 +6250,9 @@ gs_app_init (GsApp *app)
 	priv->size_installed_type = GS_SIZE_TYPE_UNKNOWN;
 	priv->size_cache_data_type = GS_SIZE_TYPE_UNKNOWN;
 	priv->size_user_data_type = GS_SIZE_TYPE_UNKNOWN;
-	g_mutex_init (&priv->mutex);
+	g_rw_lock_init (&priv->rw_lock);
+
+	update_apps_alive_counter (g_atomic_int_add (&n_apps_alive, 1) + 1);
 }
 
 /**
@@ -6317,7 +6367,7 @@ gs_app_dup_origin_ui (GsApp *app,
 		      gboolean with_packaging_format)
 {
 	GsAppPrivate *priv;
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_autoptr(GsOsRelease) os_release = NULL;
 	const gchar *origin_str = NULL;
 
@@ -6335,7 +6385,7 @@ gs_app_dup_origin_ui (GsApp *app,
 	}
 
 	priv = gs_app_get_instance_private (app);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 
 	if (!origin_str) {
 		origin_str = priv->origin_ui;
@@ -6382,12 +6432,12 @@ gs_app_set_origin_ui (GsApp *app,
 		      const gchar *origin_ui)
 {
 	GsAppPrivate *priv;
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 
 	priv = gs_app_get_instance_private (app);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (origin_ui && !*origin_ui)
 		origin_ui = NULL;
@@ -6527,9 +6577,9 @@ GsAppPermissions *
 gs_app_dup_permissions (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 	return priv->permissions ? g_object_ref (priv->permissions) : NULL;
 }
 
@@ -6550,11 +6600,11 @@ gs_app_set_permissions (GsApp *app,
 			GsAppPermissions *permissions)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (permissions == NULL || gs_app_permissions_is_sealed (permissions));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	if (priv->permissions == permissions)
 		return;
 	g_clear_object (&priv->permissions);
@@ -6581,9 +6631,9 @@ GsAppPermissions *
 gs_app_dup_update_permissions (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 	return priv->update_permissions ? g_object_ref (priv->update_permissions) : NULL;
 }
 
@@ -6605,10 +6655,10 @@ gs_app_set_update_permissions (GsApp *app,
 			       GsAppPermissions *update_permissions)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (update_permissions == NULL || gs_app_permissions_is_sealed (update_permissions));
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	if (priv->update_permissions != update_permissions) {
 		g_clear_object (&priv->update_permissions);
 		if (update_permissions != NULL)
@@ -6632,10 +6682,10 @@ GPtrArray *
 gs_app_get_version_history (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 	if (priv->version_history == NULL)
 		return NULL;
 	return g_ptr_array_ref (priv->version_history);
@@ -6655,13 +6705,13 @@ void
 gs_app_set_version_history (GsApp *app, GPtrArray *version_history)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
 	if (version_history != NULL && version_history->len == 0)
 		version_history = NULL;
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 	_g_set_ptr_array (&priv->version_history, version_history);
 }
 
@@ -6685,14 +6735,14 @@ gs_app_ensure_icons_downloaded (GsApp *app,
 				GCancellable *cancellable)
 {
 	GsAppPrivate *priv;
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	GPtrArray *icons;
 	guint i;
 
 	g_return_if_fail (GS_IS_APP (app));
 
 	priv = gs_app_get_instance_private (app);
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	/* process all icons */
 	icons = priv->icons;
@@ -6735,11 +6785,11 @@ GPtrArray *
 gs_app_get_relations (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
 	return (priv->relations != NULL) ? g_ptr_array_ref (priv->relations) : NULL;
 }
 
@@ -6758,12 +6808,12 @@ gs_app_add_relation (GsApp      *app,
                      AsRelation *relation)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (AS_IS_RELATION (relation));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (priv->relations == NULL)
 		priv->relations = g_ptr_array_new_with_free_func (g_object_unref);
@@ -6788,12 +6838,12 @@ gs_app_set_relations (GsApp     *app,
                       GPtrArray *relations)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_autoptr(GPtrArray) old_relations = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (relations == NULL && priv->relations == NULL)
 		return;
@@ -6840,11 +6890,11 @@ gs_app_set_has_translations (GsApp    *app,
                              gboolean  has_translations)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (priv->has_translations == has_translations)
 		return;
@@ -6919,11 +6969,11 @@ gs_app_set_icons_state (GsApp           *app,
                         GsAppIconsState  icons_state)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (priv->icons_state == icons_state)
 		return;
@@ -7000,11 +7050,11 @@ gs_app_set_mok_key_pending (GsApp    *app,
 {
 	#ifdef ENABLE_DKMS
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
 
 	if (priv->mok_key_pending == mok_key_pending)
 		return;
@@ -7015,3 +7065,79 @@ gs_app_set_mok_key_pending (GsApp    *app,
 	g_return_if_fail (GS_IS_APP (app));
 	#endif
 }
+
+/**
+ * gs_app_get_refined_require_flags:
+ * @app: a #GsApp
+ * @job_flags: the #GsPluginRefineFlags of the refine which is about to run,
+ *   masked to those which change what a refine produces
+ * @generation: the current refine generation of the plugin loader
+ *
+ * Gets which #GsPluginRefineRequireFlags have already been satisfied for @app
+ * by a completed refine, as recorded by gs_app_add_refined_require_flags().
+ *
+ * Flags recorded for an older @generation, for different @job_flags, or
+ * before the last state change of @app, are not returned.
+ *
+ * Returns: the satisfied flags, or %GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE
+ *
+ * Since: 51
+ */
+GsPluginRefineRequireFlags
+gs_app_get_refined_require_flags (GsApp               *app,
+                                  GsPluginRefineFlags  job_flags,
+                                  guint                generation)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
+
+	g_return_val_if_fail (GS_IS_APP (app), GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
+
+	locker = g_rw_lock_reader_locker_new (&priv->rw_lock);
+
+	if (priv->refined_generation != generation ||
+	    priv->refined_job_flags != job_flags)
+		return GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE;
+
+	return priv->refined_require_flags;
+}
+
+/**
+ * gs_app_add_refined_require_flags:
+ * @app: a #GsApp
+ * @require_flags: the flags which a refine has just satisfied
+ * @job_flags: the #GsPluginRefineFlags of that refine, masked to those which
+ *   change what a refine produces
+ * @generation: the refine generation of the plugin loader when that refine
+ *   was started
+ *
+ * Records that all plugins have refined @app with @require_flags, so that
+ * later refines with the same @job_flags can skip that work.
+ *
+ * If @generation or @job_flags differ from the ones previously recorded, the
+ * previously recorded flags are forgotten.
+ *
+ * Since: 51
+ */
+void
+gs_app_add_refined_require_flags (GsApp                      *app,
+                                  GsPluginRefineRequireFlags  require_flags,
+                                  GsPluginRefineFlags         job_flags,
+                                  guint                       generation)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_APP (app));
+
+	locker = g_rw_lock_writer_locker_new (&priv->rw_lock);
+
+	if (priv->refined_generation != generation ||
+	    priv->refined_job_flags != job_flags) {
+		priv->refined_generation = generation;
+		priv->refined_job_flags = job_flags;
+		priv->refined_require_flags = GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE;
+	}
+
+	priv->refined_require_flags |= require_flags;
+}
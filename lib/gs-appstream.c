@@ -14,6 +14,8 @@
 #include <gnome-software.h>
 #include <locale.h>
 #include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "gs-external-appstream-utils.h"
 #include "gs-appstream.h"
@@ -80,6 +82,63 @@ node_set_to_next (XbNode **node)
 	*node = g_steal_pointer (&next_node);
 }
 
+/* Returns the first child of @node called @element, if any. This is the
+ * equivalent of xb_node_query_first (node, element, NULL), without compiling
+ * and running an XPath query, which matters when it’s done for every refined
+ * component. */
+static XbNode *
+node_get_child_by_element (XbNode      *node,
+                           const gchar *element)
+{
+	for (g_autoptr(XbNode) n = xb_node_get_child (node); n != NULL; node_set_to_next (&n)) {
+		if (g_strcmp0 (xb_node_get_element (n), element) == 0)
+			return g_steal_pointer (&n);
+	}
+
+	return NULL;
+}
+
+/* Returns the text of the first child of @node called @element, the
+ * equivalent of xb_node_query_text (node, element, NULL). */
+static const gchar *
+node_get_child_text (XbNode      *node,
+                     const gchar *element)
+{
+	g_autoptr(XbNode) n = node_get_child_by_element (node, element);
+
+	return (n != NULL) ? xb_node_get_text (n) : NULL;
+}
+
+/* Returns the text of `info/@name` in @node, the equivalent of
+ * xb_node_query_text (node, "info/name", NULL). The silo info is added to the
+ * `components` node, and sometimes to a component itself. */
+static const gchar *
+node_get_info_text (XbNode      *node,
+                    const gchar *name)
+{
+	g_autoptr(XbNode) info = NULL;
+
+	if (node == NULL)
+		return NULL;
+
+	info = node_get_child_by_element (node, "info");
+	if (info == NULL)
+		return NULL;
+
+	return node_get_child_text (info, name);
+}
+
+/* Like node_get_info_text(), but for the parent of @component, the equivalent
+ * of xb_node_query_text (component, "../info/name", NULL). */
+static const gchar *
+component_get_parent_info_text (XbNode      *component,
+                                const gchar *name)
+{
+	g_autoptr(XbNode) components = xb_node_get_parent (component);
+
+	return node_get_info_text (components, name);
+}
+
 /* Returns escaped text */
 static gchar *
 gs_appstream_format_description_text (XbNode *node)
@@ -322,7 +381,7 @@ gs_appstream_build_icon_prefix (XbNode *component)
 		return NULL;
 
 	/* set explicitly */
-	tmp = xb_node_query_text (components, "info/icon-prefix", NULL);
+	tmp = node_get_info_text (components, "icon-prefix");
 	if (tmp != NULL)
 		return g_strdup (tmp);
 
@@ -332,7 +391,7 @@ gs_appstream_build_icon_prefix (XbNode *component)
 		return NULL;
 
 	/* no metadata */
-	tmp = xb_node_query_text (components, "info/filename", NULL);
+	tmp = node_get_info_text (components, "filename");
 	if (tmp == NULL)
 		return NULL;
 
@@ -489,13 +548,22 @@ gs_appstream_refine_add_addons (GsPlugin *plugin,
 static guint64
 component_get_release_timestamp (XbNode *component)
 {
+	g_autoptr(XbNode) releases = NULL;
+	g_autoptr(XbNode) release = NULL;
 	guint64 timestamp;
 	const gchar *date_str;
 
+	/* the newest release comes first */
+	releases = node_get_child_by_element (component, "releases");
+	if (releases != NULL)
+		release = node_get_child_by_element (releases, "release");
+	if (release == NULL)
+		return G_MAXUINT64;
+
 	/* Spec says to prefer `timestamp` over `date` if both are provided:
 	 * https://www.freedesktop.org/software/appstream/docs/chap-Metadata.html#tag-releases */
-	timestamp = xb_node_query_attr_as_uint (component, "releases/release", "timestamp", NULL);
-	date_str = xb_node_query_attr (component, "releases/release", "date", NULL);
+	timestamp = xb_node_get_attr_as_uint (release, "timestamp");
+	date_str = xb_node_get_attr (release, "date");
 
 	if (timestamp != G_MAXUINT64) {
 		return timestamp;
@@ -528,25 +596,24 @@ gs_appstream_is_recent_release (XbNode *component)
 static gboolean
 gs_appstream_copy_metadata (GsApp *app, XbNode *component, GError **error)
 {
-	g_autoptr(GError) error_local = NULL;
-	g_autoptr(GPtrArray) values = NULL;
-
-	/* get all components */
-	values = xb_node_query (component, "custom/value", 0, &error_local);
-	if (values == NULL) {
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return TRUE;
-		g_propagate_error (error, g_steal_pointer (&error_local));
-		return FALSE;
-	}
-	for (guint i = 0; i < values->len; i++) {
-		XbNode *value = g_ptr_array_index (values, i);
-		const gchar *key = xb_node_get_attr (value, "key");
-		if (key == NULL)
-			continue;
-		if (gs_app_get_metadata_item (app, key) != NULL)
+	/* all the custom/value nodes */
+	for (g_autoptr(XbNode) custom = xb_node_get_child (component); custom != NULL; node_set_to_next (&custom)) {
+		if (g_strcmp0 (xb_node_get_element (custom), "custom") != 0)
 			continue;
-		gs_app_set_metadata (app, key, xb_node_get_text (value));
+
+		for (g_autoptr(XbNode) value = xb_node_get_child (custom); value != NULL; node_set_to_next (&value)) {
+			const gchar *key;
+
+			if (g_strcmp0 (xb_node_get_element (value), "value") != 0)
+				continue;
+
+			key = xb_node_get_attr (value, "key");
+			if (key == NULL)
+				continue;
+			if (gs_app_get_metadata_item (app, key) != NULL)
+				continue;
+			gs_app_set_metadata (app, key, xb_node_get_text (value));
+		}
 	}
 	return TRUE;
 }
@@ -722,48 +789,66 @@ typedef enum {
 	ELEMENT_KIND_URL
 } ElementKind;
 
-/* This is not for speed, but to not accidentally have checked for the element name twice in the block */
+typedef struct {
+	const gchar *name;
+	ElementKind kind;
+} ElementKindEntry;
+
+/* Element names of the children of a <component>, which have to stay sorted
+ * by name for gs_appstream_get_element_kind(). */
+static const ElementKindEntry element_kinds[] = {
+	{ "branding", ELEMENT_KIND_BRANDING },
+	{ "bundle", ELEMENT_KIND_BUNDLE },
+	{ "categories", ELEMENT_KIND_CATEGORIES },
+	{ "content_rating", ELEMENT_KIND_CONTENT_RATING },
+	{ "custom", ELEMENT_KIND_CUSTOM },
+	{ "description", ELEMENT_KIND_DESCRIPTION },
+	{ "developer", ELEMENT_KIND_DEVELOPER },
+	{ "developer_name", ELEMENT_KIND_DEVELOPER_NAME },
+	{ "icon", ELEMENT_KIND_ICON },
+	{ "id", ELEMENT_KIND_ID },
+	{ "info", ELEMENT_KIND_INFO },
+	{ "keywords", ELEMENT_KIND_KEYWORDS },
+	{ "kudos", ELEMENT_KIND_KUDOS },
+	{ "languages", ELEMENT_KIND_LANGUAGES },
+	{ "launchable", ELEMENT_KIND_LAUNCHABLE },
+	{ "metadata_license", ELEMENT_KIND_METADATA_LICENSE },
+	{ "name", ELEMENT_KIND_NAME },
+	{ "pkgname", ELEMENT_KIND_PKGNAME },
+	{ "project_group", ELEMENT_KIND_PROJECT_GROUP },
+	{ "project_license", ELEMENT_KIND_PROJECT_LICENSE },
+	{ "provides", ELEMENT_KIND_PROVIDES },
+	{ "recommends", ELEMENT_KIND_RECOMMENDS },
+	{ "releases", ELEMENT_KIND_RELEASES },
+	{ "requires", ELEMENT_KIND_REQUIRES },
+	{ "screenshots", ELEMENT_KIND_SCREENSHOTS },
+	{ "summary", ELEMENT_KIND_SUMMARY },
+	{ "supports", ELEMENT_KIND_SUPPORTS },
+	{ "url", ELEMENT_KIND_URL }
+};
+
+static gint
+element_kind_entry_cmp_cb (gconstpointer key,
+                           gconstpointer entry)
+{
+	return strcmp (key, ((const ElementKindEntry *) entry)->name);
+}
+
+/* Besides not accidentally checking for the same element twice in the
+ * refine loop, this is a binary search rather than a comparison against
+ * every name, as it is run for every child of every refined component. */
 static ElementKind
 gs_appstream_get_element_kind (const gchar *element_name)
 {
-	struct {
-		const gchar *name;
-		ElementKind kind;
-	} kinds[] = {
-		{ "branding", ELEMENT_KIND_BRANDING },
-		{ "bundle", ELEMENT_KIND_BUNDLE },
-		{ "categories", ELEMENT_KIND_CATEGORIES },
-		{ "content_rating", ELEMENT_KIND_CONTENT_RATING },
-		{ "custom", ELEMENT_KIND_CUSTOM },
-		{ "description", ELEMENT_KIND_DESCRIPTION },
-		{ "developer", ELEMENT_KIND_DEVELOPER },
-		{ "developer_name", ELEMENT_KIND_DEVELOPER_NAME },
-		{ "icon", ELEMENT_KIND_ICON },
-		{ "id", ELEMENT_KIND_ID },
-		{ "info", ELEMENT_KIND_INFO },
-		{ "keywords", ELEMENT_KIND_KEYWORDS },
-		{ "kudos", ELEMENT_KIND_KUDOS },
-		{ "languages", ELEMENT_KIND_LANGUAGES },
-		{ "launchable", ELEMENT_KIND_LAUNCHABLE },
-		{ "metadata_license", ELEMENT_KIND_METADATA_LICENSE },
-		{ "name", ELEMENT_KIND_NAME },
-		{ "pkgname", ELEMENT_KIND_PKGNAME },
-		{ "project_group", ELEMENT_KIND_PROJECT_GROUP },
-		{ "project_license", ELEMENT_KIND_PROJECT_LICENSE },
-		{ "provides", ELEMENT_KIND_PROVIDES },
-		{ "recommends", ELEMENT_KIND_RECOMMENDS },
-		{ "releases", ELEMENT_KIND_RELEASES },
-		{ "requires", ELEMENT_KIND_REQUIRES },
-		{ "screenshots", ELEMENT_KIND_SCREENSHOTS },
-		{ "summary", ELEMENT_KIND_SUMMARY },
-		{ "supports", ELEMENT_KIND_SUPPORTS },
-		{ "url", ELEMENT_KIND_URL }
-	};
-	for (guint i = 0; i < G_N_ELEMENTS (kinds); i++) {
-		if (g_strcmp0 (element_name, kinds[i].name) == 0)
-			return kinds[i].kind;
-	}
-	return ELEMENT_KIND_UNKNOWN;
+	const ElementKindEntry *entry;
+
+	if (element_name == NULL)
+		return ELEMENT_KIND_UNKNOWN;
+
+	entry = bsearch (element_name, element_kinds, G_N_ELEMENTS (element_kinds),
+			 sizeof (element_kinds[0]), element_kind_entry_cmp_cb);
+
+	return (entry != NULL) ? entry->kind : ELEMENT_KIND_UNKNOWN;
 }
 
 gboolean
@@ -1279,6 +1364,7 @@ gs_appstream_refine_app (GsPlugin *plugin,
 				g_autoptr(GPtrArray) version_history = NULL; /* (element-type AsRelease) */
 				g_autoptr(GHashTable) installed = NULL;
 				g_autoptr(GPtrArray) updates_list = NULL;
+				g_autoptr(GPtrArray) updates_descs = NULL;  /* (element-type utf8); formatted descriptions of updates_list */
 				g_autoptr(XbNode) rels_child = NULL;
 				g_autoptr(XbNode) rels_next = NULL;
 				AsUrgencyKind urgency_best = AS_URGENCY_KIND_UNKNOWN;
@@ -1291,6 +1377,7 @@ gs_appstream_refine_app (GsPlugin *plugin,
 
 					installed = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_object_unref);
 					updates_list = g_ptr_array_new_with_free_func (g_object_unref);
+					updates_descs = g_ptr_array_new_with_free_func (g_free);
 
 					/* find out which releases are already installed */
 					xpath = g_strdup_printf ("component/id[text()='%s']/../releases/*[@version]",
@@ -1329,8 +1416,6 @@ gs_appstream_refine_app (GsPlugin *plugin,
 					if (version == NULL)
 						continue;
 
-					description = gs_appstream_format_release_text (rels_child);
-
 					if (version_history != NULL) {
 						g_autoptr(AsRelease) release = NULL;
 						guint64 timestamp;
@@ -1339,6 +1424,8 @@ gs_appstream_refine_app (GsPlugin *plugin,
 						timestamp = xb_node_get_attr_as_uint (rels_child, "timestamp");
 						date_str = xb_node_get_attr (rels_child, "date");
 
+						description = gs_appstream_format_release_text (rels_child);
+
 						release = as_release_new ();
 						as_release_set_version (release, version);
 						if (timestamp != G_MAXUINT64)
@@ -1368,9 +1455,15 @@ gs_appstream_refine_app (GsPlugin *plugin,
 						if (urgency_tmp > urgency_best)
 							urgency_best = urgency_tmp;
 
+						/* only format the releases which are used */
+						if (description == NULL)
+							description = gs_appstream_format_release_text (rels_child);
+
 						/* add updates with a description */
-						if (description != NULL && *description != '\0')
+						if (description != NULL && *description != '\0') {
 							g_ptr_array_add (updates_list, g_object_ref (rels_child));
+							g_ptr_array_add (updates_descs, g_steal_pointer (&description));
+						}
 					}
 				}
 
@@ -1384,10 +1477,7 @@ gs_appstream_refine_app (GsPlugin *plugin,
 
 					/* no prefix on each release */
 					if (updates_list->len == 1) {
-						XbNode *release = g_ptr_array_index (updates_list, 0);
-						g_autofree gchar *desc = NULL;
-						desc = gs_appstream_format_release_text (release);
-						gs_app_set_update_details_markup (app, desc);
+						gs_app_set_update_details_markup (app, g_ptr_array_index (updates_descs, 0));
 
 					/* get the descriptions with a version prefix */
 					} else if (updates_list->len > 1) {
@@ -1396,18 +1486,15 @@ gs_appstream_refine_app (GsPlugin *plugin,
 						for (guint j = 0; j < updates_list->len; j++) {
 							XbNode *release = g_ptr_array_index (updates_list, j);
 							const gchar *release_version = xb_node_get_attr (release, "version");
-							g_autofree gchar *desc = NULL;
 
 							/* use the first release description, then skip the currently installed version and all below it */
 							if (i != 0 && version != NULL && gs_utils_compare_versions (version, release_version) >= 0)
 								continue;
 
-							desc = gs_appstream_format_release_text (release);
-
 							g_string_append_printf (update_desc,
 										"Version %s:\n%s\n\n",
-										xb_node_get_attr (release, "version"),
-										desc);
+										release_version,
+										(const gchar *) g_ptr_array_index (updates_descs, j));
 						}
 
 						/* remove trailing newlines */
@@ -1529,7 +1616,7 @@ gs_appstream_refine_app (GsPlugin *plugin,
 			if (*appstream_source_file != '\0')
 				gs_app_set_metadata (app, "appstream::source-file", appstream_source_file);
 		} else {
-			tmp = xb_node_query_text (component, "../info/filename", NULL);
+			tmp = component_get_parent_info_text (component, "filename");
 			if (tmp != NULL)
 				gs_app_set_metadata (app, "appstream::source-file", tmp);
 		}
@@ -1543,7 +1630,7 @@ gs_appstream_refine_app (GsPlugin *plugin,
 			if (default_scope != AS_COMPONENT_SCOPE_UNKNOWN)
 				gs_app_set_scope (app, default_scope);
 		} else {
-			tmp = xb_node_query_text (component, "../info/scope", NULL);
+			tmp = component_get_parent_info_text (component, "scope");
 			if (tmp != NULL)
 				gs_app_set_scope (app, as_component_scope_from_string (tmp));
 		}
@@ -1645,15 +1732,15 @@ gs_appstream_read_silo_info_from_component (XbNode *component,
 	if (out_silo_filename != NULL) {
 		*out_silo_filename = NULL;
 
-		tmp = xb_node_query_text (component, "info/filename", NULL);
+		tmp = node_get_info_text (component, "filename");
 		if (tmp == NULL)
-			tmp = xb_node_query_text (component, "../info/filename", NULL);
+			tmp = component_get_parent_info_text (component, "filename");
 		if (tmp != NULL)
 			*out_silo_filename = g_strdup (tmp);
 	}
 
 	if (out_scope) {
-		tmp = xb_node_query_text (component, "../info/scope", NULL);
+		tmp = component_get_parent_info_text (component, "scope");
 		if (tmp != NULL)
 			*out_scope = as_component_scope_from_string (tmp);
 		else
@@ -1773,7 +1860,12 @@ gs_appstream_do_search (GsPlugin *plugin,
 
 	for (guint i = 0; i < components->len; i++) {
 		XbNode *component = g_ptr_array_index (components, i);
-		guint16 match_value = gs_appstream_silo_search_component (array, component, values);
+		guint16 match_value;
+
+		if (gs_utils_cancellation_checkpoint (cancellable, i, error))
+			return FALSE;
+
+		match_value = gs_appstream_silo_search_component (array, component, values);
 		if (match_value != 0) {
 			g_autoptr(GsApp) app = gs_appstream_create_app (plugin, silo, component, silo_filename ? silo_filename : "", default_scope, error);
 			if (app == NULL)
@@ -1810,9 +1902,6 @@ gs_appstream_do_search (GsPlugin *plugin,
 				}
 			}
 		}
-
-		if (g_cancellable_set_error_if_cancelled (cancellable, error))
-			return FALSE;
 	}
 	g_debug ("search took %fms", g_timer_elapsed (timer, NULL) * 1000);
 	return TRUE;
@@ -1947,7 +2036,7 @@ gs_appstream_add_category_apps (GsPlugin *plugin,
 		for (guint i = 0; i < components->len; i++) {
 			XbNode *component = g_ptr_array_index (components, i);
 			g_autoptr(GsApp) app = NULL;
-			const gchar *id = xb_node_query_text (component, "id", NULL);
+			const gchar *id = node_get_child_text (component, "id");
 			if (id == NULL)
 				continue;
 			app = gs_app_new (id);
@@ -2091,7 +2180,12 @@ gs_appstream_add_popular (XbSilo *silo,
 	for (guint i = 0; i < array->len; i++) {
 		g_autoptr(GsApp) app = NULL;
 		XbNode *component = g_ptr_array_index (array, i);
-		const gchar *component_id = xb_node_query_text (component, "id", NULL);
+		const gchar *component_id;
+
+		if (gs_utils_cancellation_checkpoint (cancellable, i, error))
+			return FALSE;
+
+		component_id = node_get_child_text (component, "id");
 		if (component_id == NULL)
 			continue;
 		app = gs_app_new (component_id);
@@ -2242,7 +2336,7 @@ gs_appstream_add_featured_with_query (XbSilo *silo,
 	for (guint i = 0; i < array->len; i++) {
 		g_autoptr(GsApp) app = NULL;
 		XbNode *component = g_ptr_array_index (array, i);
-		const gchar *component_id = xb_node_query_text (component, "id", NULL);
+		const gchar *component_id = node_get_child_text (component, "id");
 		if (component_id == NULL)
 			continue;
 		app = gs_app_new (component_id);
@@ -11,7 +11,11 @@
 
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
 #include <locale.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
 #include "gnome-software-private.h"
 
@@ -23,6 +27,11 @@ typedef struct {
 	guint		 max_results;
 	gboolean	 interactive;
 	gboolean	 only_freely_licensed;
+
+	/* only set with --benchmark */
+	gint		 n_warmup;
+	GArray		*benchmark_samples;	/* (owned) (nullable) (element-type gint64) */
+	struct rusage	 benchmark_usage;	/* at the start of the first sample */
 } GsCmdSelf;
 
 static void
@@ -139,6 +148,8 @@ gs_cmd_refine_require_flag_from_string (const gchar *flag, GError **error)
 		return GS_PLUGIN_REFINE_REQUIRE_FLAGS_DEVELOPER_NAME;
 	if (g_strcmp0 (flag, "kudos") == 0)
 		return GS_PLUGIN_REFINE_REQUIRE_FLAGS_KUDOS;
+	if (g_strcmp0 (flag, "content-rating") == 0)
+		return GS_PLUGIN_REFINE_REQUIRE_FLAGS_CONTENT_RATING;
 	g_set_error (error,
 		     GS_PLUGIN_ERROR,
 		     GS_PLUGIN_ERROR_NOT_SUPPORTED,
@@ -262,11 +273,168 @@ gs_cmd_self_free (GsCmdSelf *self)
 {
 	if (self->plugin_loader != NULL)
 		g_object_unref (self->plugin_loader);
+	g_clear_pointer (&self->benchmark_samples, g_array_unref);
 	g_free (self);
 }
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GsCmdSelf, gs_cmd_self_free)
 
+/* Commands which can be run with --benchmark.
+ *
+ * `refine` creates a new app for each iteration, as refining the same
+ * instance again is skipped once it has been refined.
+ *
+ * The commands which list apps can’t do that: most plugins return the
+ * instances they have cached, which are shared between jobs and keep what
+ * has been refined on them. So after the warm-up iterations, they measure
+ * looking apps up with warm caches, and the refine which follows is mostly
+ * skipped. Use `--warmup=0 --repeat=1` to time a cold run. */
+static const gchar * const benchmark_commands[] = {
+	"search", "installed", "refine", "popular", "featured", "get-categories", NULL
+};
+
+/* returns the time to pass to gs_cmd_benchmark_end() */
+static gint64
+gs_cmd_benchmark_begin (GsCmdSelf *self, gint iteration)
+{
+	if (self->benchmark_samples != NULL && iteration == self->n_warmup)
+		getrusage (RUSAGE_SELF, &self->benchmark_usage);
+	return g_get_monotonic_time ();
+}
+
+static void
+gs_cmd_benchmark_end (GsCmdSelf *self, gint iteration, gint64 begin_time_usec)
+{
+	gint64 elapsed_usec = g_get_monotonic_time () - begin_time_usec;
+
+	/* warm-up iterations fill the caches and are not counted */
+	if (self->benchmark_samples == NULL || iteration < self->n_warmup)
+		return;
+	g_array_append_val (self->benchmark_samples, elapsed_usec);
+}
+
+static gint
+benchmark_sample_cmp_cb (gconstpointer a, gconstpointer b)
+{
+	gint64 sample_a = *((const gint64 *) a);
+	gint64 sample_b = *((const gint64 *) b);
+
+	if (sample_a != sample_b)
+		return (sample_a < sample_b) ? -1 : 1;
+	return 0;
+}
+
+/* nearest-rank percentile of a sorted, non-empty array */
+static gint64
+gs_cmd_benchmark_percentile (GArray *sorted, guint percentile)
+{
+	guint rank = (sorted->len * percentile + 99) / 100;
+
+	return g_array_index (sorted, gint64, MAX (rank, 1) - 1);
+}
+
+static gint64
+timeval_to_usec (const struct timeval *tv)
+{
+	return (gint64) tv->tv_sec * G_USEC_PER_SEC + tv->tv_usec;
+}
+
+/* current resident set size in kB, or -1 if unknown */
+static gint64
+gs_cmd_get_rss_kb (void)
+{
+	g_autofree gchar *statm = NULL;
+	guint64 size_pages, rss_pages;
+
+	if (!g_file_get_contents ("/proc/self/statm", &statm, NULL, NULL) ||
+	    sscanf (statm, "%" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT, &size_pages, &rss_pages) != 2)
+		return -1;
+
+	return (gint64) (rss_pages * sysconf (_SC_PAGESIZE) / 1024);
+}
+
+static void
+json_builder_add_msec_member (JsonBuilder *builder, const gchar *name, gint64 usec)
+{
+	json_builder_set_member_name (builder, name);
+	json_builder_add_double_value (builder, (gdouble) usec / G_TIME_SPAN_MILLISECOND);
+}
+
+static void
+gs_cmd_show_benchmark (GsCmdSelf *self, gint argc, gchar **argv)
+{
+	struct rusage usage;
+	g_autoptr(GArray) sorted = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) json_generator = json_generator_new ();
+	g_autoptr(JsonNode) json_root = NULL;
+	g_autofree gchar *data = NULL;
+	gint64 total_usec = 0;
+	gint64 rss_kb;
+
+	getrusage (RUSAGE_SELF, &usage);
+	rss_kb = gs_cmd_get_rss_kb ();
+
+	sorted = g_array_copy (self->benchmark_samples);
+	g_array_sort (sorted, benchmark_sample_cmp_cb);
+	for (guint i = 0; i < sorted->len; i++)
+		total_usec += g_array_index (sorted, gint64, i);
+
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "command");
+	json_builder_add_string_value (builder, argv[1]);
+	json_builder_set_member_name (builder, "arguments");
+	json_builder_begin_array (builder);
+	for (gint i = 2; i < argc; i++)
+		json_builder_add_string_value (builder, argv[i]);
+	json_builder_end_array (builder);
+	json_builder_set_member_name (builder, "warmup");
+	json_builder_add_int_value (builder, self->n_warmup);
+	json_builder_set_member_name (builder, "iterations");
+	json_builder_add_int_value (builder, sorted->len);
+
+	json_builder_set_member_name (builder, "time_ms");
+	json_builder_begin_object (builder);
+	if (sorted->len > 0) {
+		json_builder_add_msec_member (builder, "min", g_array_index (sorted, gint64, 0));
+		json_builder_add_msec_member (builder, "median", gs_cmd_benchmark_percentile (sorted, 50));
+		json_builder_add_msec_member (builder, "p95", gs_cmd_benchmark_percentile (sorted, 95));
+		json_builder_add_msec_member (builder, "max", g_array_index (sorted, gint64, sorted->len - 1));
+		json_builder_add_msec_member (builder, "mean", total_usec / sorted->len);
+	}
+	json_builder_end_object (builder);
+
+	json_builder_set_member_name (builder, "samples_ms");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < self->benchmark_samples->len; i++)
+		json_builder_add_double_value (builder, (gdouble) g_array_index (self->benchmark_samples, gint64, i) / G_TIME_SPAN_MILLISECOND);
+	json_builder_end_array (builder);
+
+	/* CPU time over the counted iterations only */
+	if (sorted->len > 0) {
+		json_builder_add_msec_member (builder, "cpu_user_ms",
+					      timeval_to_usec (&usage.ru_utime) -
+					      timeval_to_usec (&self->benchmark_usage.ru_utime));
+		json_builder_add_msec_member (builder, "cpu_system_ms",
+					      timeval_to_usec (&usage.ru_stime) -
+					      timeval_to_usec (&self->benchmark_usage.ru_stime));
+	}
+
+	if (rss_kb >= 0) {
+		json_builder_set_member_name (builder, "rss_kb");
+		json_builder_add_int_value (builder, rss_kb);
+	}
+	json_builder_set_member_name (builder, "max_rss_kb");
+	json_builder_add_int_value (builder, usage.ru_maxrss);
+	json_builder_end_object (builder);
+
+	json_root = json_builder_get_root (builder);
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	g_print ("%s\n", data);
+}
+
 static gint
 app_sort_kind_cb (GsApp *app1, GsApp *app2, gpointer user_data)
 {
@@ -284,10 +452,13 @@ main (int argc, char **argv)
 	gboolean prefer_local = FALSE;
 	gboolean ret;
 	gboolean show_results = FALSE;
+	gboolean show_latency_stats = FALSE;
+	gboolean benchmark = FALSE;
 	gboolean verbose = FALSE;
 	gint i;
 	guint64 cache_age_secs = 0;
-	gint repeat = 1;
+	gint repeat = -1;
+	gint n_iterations;
 	g_auto(GStrv) plugin_blocklist = NULL;
 	g_auto(GStrv) plugin_allowlist = NULL;
 	g_autoptr(GError) error = NULL;
@@ -305,6 +476,10 @@ main (int argc, char **argv)
 		  "Set any refine flags required for the action", NULL },
 		{ "repeat", '\0', 0, G_OPTION_ARG_INT, &repeat,
 		  "Repeat the action this number of times", NULL },
+		{ "benchmark", '\0', 0, G_OPTION_ARG_NONE, &benchmark,
+		  "Time the action and print statistics as JSON", NULL },
+		{ "warmup", '\0', 0, G_OPTION_ARG_INT, &self->n_warmup,
+		  "Run the action this number of times before timing it", "N" },
 		{ "cache-age", '\0', 0, G_OPTION_ARG_INT64, &cache_age_secs,
 		  "Use this maximum cache age in seconds", NULL },
 		{ "max-results", '\0', 0, G_OPTION_ARG_INT, &self->max_results,
@@ -317,6 +492,8 @@ main (int argc, char **argv)
 		  "Only load specific plugins", NULL },
 		{ "verbose", '\0', 0, G_OPTION_ARG_NONE, &verbose,
 		  "Show verbose debugging information", NULL },
+		{ "latency-stats", '\0', 0, G_OPTION_ARG_NONE, &show_latency_stats,
+		  "Show how long each plugin took for each action", NULL },
 		{ "interactive", 'i', 0, G_OPTION_ARG_NONE, &self->interactive,
 		  "Allow interactive authentication", NULL },
 		{ "only-freely-licensed", '\0', 0, G_OPTION_ARG_NONE, &self->only_freely_licensed,
@@ -332,6 +509,7 @@ main (int argc, char **argv)
 
 	gtk_init ();
 
+	self->n_warmup = -1;
 	context = g_option_context_new (NULL);
 	g_option_context_set_summary (context, "GNOME Software Test Program");
 	g_option_context_add_main_entries (context, options, NULL);
@@ -342,6 +520,26 @@ main (int argc, char **argv)
 	}
 	gs_debug_set_verbose (debug, verbose);
 
+	/* benchmark mode runs the action a few times first, to fill caches */
+	if (benchmark) {
+		if (argc < 2 || !g_strv_contains (benchmark_commands, argv[1])) {
+			g_autofree gchar *commands = g_strjoinv ("', '", (gchar **) benchmark_commands);
+			g_print ("Only '%s' can be benchmarked\n", commands);
+			return EXIT_FAILURE;
+		}
+		if (repeat < 0)
+			repeat = 10;
+		if (self->n_warmup < 0)
+			self->n_warmup = 3;
+	} else {
+		self->n_warmup = 0;
+	}
+	if (repeat < 1)
+		repeat = 1;
+	if (benchmark)
+		self->benchmark_samples = g_array_sized_new (FALSE, FALSE, sizeof (gint64), repeat);
+	n_iterations = self->n_warmup + repeat;
+
 	/* prefer local sources */
 	if (prefer_local)
 		g_setenv ("GNOME_SOFTWARE_PREFER_LOCAL", "true", TRUE);
@@ -392,7 +590,8 @@ main (int argc, char **argv)
 
 	/* do action */
 	if (argc == 2 && g_strcmp0 (argv[1], "installed") == 0) {
-		for (i = 0; i < repeat; i++) {
+		for (i = 0; i < n_iterations; i++) {
+			gint64 begin_time_usec;
 			g_autoptr(GsAppQuery) query = NULL;
 			g_autoptr(GsPluginJob) plugin_job = NULL;
 			GsAppList *list;
@@ -405,16 +604,19 @@ main (int argc, char **argv)
 						  NULL);
 
 			plugin_job = gs_plugin_job_list_apps_new (query, get_list_apps_flags (self));
+			begin_time_usec = gs_cmd_benchmark_begin (self, i);
 			ret = gs_plugin_loader_job_process (self->plugin_loader, plugin_job, NULL, &error);
+			gs_cmd_benchmark_end (self, i, begin_time_usec);
 			if (!ret)
 				break;
 
 			list = gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (plugin_job));
-			if (show_results && i == repeat - 1 && list != NULL)
+			if (show_results && i == n_iterations - 1 && list != NULL)
 				gs_cmd_show_results_apps (list);
 		}
 	} else if (argc == 3 && g_strcmp0 (argv[1], "search") == 0) {
-		for (i = 0; i < repeat; i++) {
+		for (i = 0; i < n_iterations; i++) {
+			gint64 begin_time_usec;
 			g_autoptr(GsAppQuery) query = NULL;
 			g_autoptr(GsPluginJob) plugin_job = NULL;
 			const gchar *keywords[2] = { argv[2], NULL };
@@ -429,12 +631,14 @@ main (int argc, char **argv)
 						  NULL);
 
 			plugin_job = gs_plugin_job_list_apps_new (query, get_list_apps_flags (self));
+			begin_time_usec = gs_cmd_benchmark_begin (self, i);
 			ret = gs_plugin_loader_job_process (self->plugin_loader, plugin_job, NULL, &error);
+			gs_cmd_benchmark_end (self, i, begin_time_usec);
 			if (!ret)
 				break;
 
 			list = gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (plugin_job));
-			if (show_results && i == repeat - 1 && list != NULL)
+			if (show_results && i == n_iterations - 1 && list != NULL)
 				gs_cmd_show_results_apps (list);
 		}
 	} else if (argc == 3 && g_strcmp0 (argv[1], "get-alternates") == 0) {
@@ -482,20 +686,26 @@ main (int argc, char **argv)
 			gs_cmd_show_results_apps (list);
 		}
 	} else if (argc == 3 && g_strcmp0 (argv[1], "refine") == 0) {
-		app = gs_app_new (argv[2]);
-		for (i = 0; i < repeat; i++) {
+		for (i = 0; i < n_iterations; i++) {
+			gint64 begin_time_usec;
 			g_autoptr(GsPluginJob) plugin_job = NULL;
+
+			/* a new app each time, so it is actually refined */
+			g_clear_object (&app);
+			app = gs_app_new (argv[2]);
 			plugin_job = gs_plugin_job_refine_new_for_app (app,
 								       self->interactive ? GS_PLUGIN_REFINE_FLAGS_INTERACTIVE :
 								       GS_PLUGIN_REFINE_FLAGS_NONE,
 								       self->require_flags);
+			begin_time_usec = gs_cmd_benchmark_begin (self, i);
 			ret = gs_plugin_loader_job_process (self->plugin_loader, plugin_job,
 							    NULL, &error);
+			gs_cmd_benchmark_end (self, i, begin_time_usec);
 			if (!ret)
 				break;
 		}
 
-		if (show_results) {
+		if (show_results && app != NULL) {
 			g_autoptr(GsAppList) list = gs_app_list_new ();
 			gs_app_list_add (list, app);
 			gs_cmd_show_results_apps (list);
@@ -600,7 +810,8 @@ main (int argc, char **argv)
 		if (show_results && list != NULL)
 			gs_cmd_show_results_apps (list);
 	} else if (argc == 2 && g_strcmp0 (argv[1], "popular") == 0) {
-		for (i = 0; i < repeat; i++) {
+		for (i = 0; i < n_iterations; i++) {
+			gint64 begin_time_usec;
 			g_autoptr(GsPluginJob) plugin_job = NULL;
 			g_autoptr(GsAppQuery) query = NULL;
 			GsAppList *list;
@@ -613,17 +824,20 @@ main (int argc, char **argv)
 						  NULL);
 
 			plugin_job = gs_plugin_job_list_apps_new (query, get_list_apps_flags (self));
+			begin_time_usec = gs_cmd_benchmark_begin (self, i);
 			ret = gs_plugin_loader_job_process (self->plugin_loader, plugin_job,
 							    NULL, &error);
+			gs_cmd_benchmark_end (self, i, begin_time_usec);
 			if (!ret)
 				break;
 
 			list = gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (plugin_job));
-			if (show_results && i == repeat - 1 && list != NULL)
+			if (show_results && i == n_iterations - 1 && list != NULL)
 				gs_cmd_show_results_apps (list);
 		}
 	} else if (argc == 2 && g_strcmp0 (argv[1], "featured") == 0) {
-		for (i = 0; i < repeat; i++) {
+		for (i = 0; i < n_iterations; i++) {
+			gint64 begin_time_usec;
 			g_autoptr(GsPluginJob) plugin_job = NULL;
 			g_autoptr(GsAppQuery) query = NULL;
 			GsAppList *list;
@@ -635,13 +849,15 @@ main (int argc, char **argv)
 						  NULL);
 
 			plugin_job = gs_plugin_job_list_apps_new (query, get_list_apps_flags (self));
+			begin_time_usec = gs_cmd_benchmark_begin (self, i);
 			ret = gs_plugin_loader_job_process (self->plugin_loader, plugin_job,
 							    NULL, &error);
+			gs_cmd_benchmark_end (self, i, begin_time_usec);
 			if (!ret)
 				break;
 
 			list = gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (plugin_job));
-			if (show_results && i == repeat - 1 && list != NULL)
+			if (show_results && i == n_iterations - 1 && list != NULL)
 				gs_cmd_show_results_apps (list);
 		}
 	} else if (argc == 3 && g_strcmp0 (argv[1], "deployment-featured") == 0) {
@@ -699,7 +915,8 @@ main (int argc, char **argv)
 				gs_cmd_show_results_apps (list);
 		}
 	} else if (argc == 2 && g_strcmp0 (argv[1], "get-categories") == 0) {
-		for (i = 0; i < repeat; i++) {
+		for (i = 0; i < n_iterations; i++) {
+			gint64 begin_time_usec;
 			g_autoptr(GsPluginJob) plugin_job = NULL;
 			GPtrArray *categories;
 			GsPluginRefineCategoriesFlags flags = GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE;
@@ -708,14 +925,15 @@ main (int argc, char **argv)
 				flags |= GS_PLUGIN_REFINE_CATEGORIES_FLAGS_INTERACTIVE;
 
 			plugin_job = gs_plugin_job_list_categories_new (flags);
-			if (!gs_plugin_loader_job_process (self->plugin_loader, plugin_job, NULL, &error)) {
-				ret = FALSE;
+			begin_time_usec = gs_cmd_benchmark_begin (self, i);
+			ret = gs_plugin_loader_job_process (self->plugin_loader, plugin_job, NULL, &error);
+			gs_cmd_benchmark_end (self, i, begin_time_usec);
+			if (!ret)
 				break;
-			}
 
 			categories = gs_plugin_job_list_categories_get_result_list (GS_PLUGIN_JOB_LIST_CATEGORIES (plugin_job));
 
-			if (show_results && i == repeat - 1 && categories != NULL)
+			if (show_results && i == n_iterations - 1 && categories != NULL)
 				gs_cmd_show_results_categories (categories);
 		}
 	} else if (argc == 3 && g_strcmp0 (argv[1], "get-category-apps") == 0) {
@@ -789,6 +1007,16 @@ main (int argc, char **argv)
 				     "'install', 'remove', "
 				     "'sources', 'refresh', 'launch' or 'search'");
 	}
+
+	if (ret && self->benchmark_samples != NULL)
+		gs_cmd_show_benchmark (self, argc, argv);
+
+	/* including the initial refresh */
+	if (show_latency_stats) {
+		g_autofree gchar *latency_stats = gs_plugin_loader_latency_stats_to_string (self->plugin_loader);
+		g_print ("%s", latency_stats);
+	}
+
 	if (!ret) {
 		g_print ("Failed: %s\n", error->message);
 		return EXIT_FAILURE;
@@ -26,6 +26,7 @@
 #include <libsoup/soup.h>
 
 #include "gs-download-utils.h"
+#include "gs-profiler.h"
 #include "gs-utils.h"
 
 G_DEFINE_QUARK (gs-download-error-quark, gs_download_error)
@@ -65,6 +66,88 @@ date_time_from_rfc7231 (const gchar *rfc7231_str)
 	return soup_date_time_new_from_http_string (rfc7231_str);
 }
 
+/* Download throughput across all downloads, averaged over windows of
+ * THROUGHPUT_WINDOW_USEC and sampled as a sysprof counter. A window starts
+ * when data arrives, so time spent idle or stalled is not averaged in, and the
+ * counter drops back to zero when the last download finishes. */
+#define THROUGHPUT_WINDOW_USEC G_USEC_PER_SEC
+
+G_LOCK_DEFINE_STATIC (throughput);
+static guint throughput_n_downloads = 0;  /* (lock throughput) */
+static gint64 throughput_window_start_usec = 0;  /* (lock throughput) */
+static gint64 throughput_last_read_usec = 0;  /* (lock throughput) */
+static gsize throughput_window_bytes = 0;  /* (lock throughput) */
+
+static void
+throughput_download_started (void)
+{
+	G_LOCK (throughput);
+	throughput_n_downloads++;
+	G_UNLOCK (throughput);
+}
+
+static void
+throughput_download_finished (void)
+{
+	gboolean idle;
+
+	G_LOCK (throughput);
+
+	g_assert (throughput_n_downloads > 0);
+	throughput_n_downloads--;
+	idle = (throughput_n_downloads == 0);
+
+	if (idle) {
+		throughput_window_start_usec = 0;
+		throughput_window_bytes = 0;
+	}
+
+	G_UNLOCK (throughput);
+
+	if (idle)
+		GS_PROFILER_SET_COUNTER (GS_PROFILER_COUNTER_DOWNLOAD_THROUGHPUT, 0);
+}
+
+static void
+update_throughput_counter (gsize n_bytes)
+{
+	gint64 now_usec = g_get_monotonic_time ();
+	gint64 elapsed_usec;
+	gint64 bytes_per_second;
+	gboolean stalled;
+
+	G_LOCK (throughput);
+
+	/* Start a new window if this is the first data since being idle, or if
+	 * nothing has arrived for a whole window. */
+	stalled = (throughput_window_start_usec != 0 &&
+		   now_usec - throughput_last_read_usec >= THROUGHPUT_WINDOW_USEC);
+	if (throughput_window_start_usec == 0 || stalled) {
+		throughput_window_start_usec = now_usec;
+		throughput_window_bytes = 0;
+	}
+
+	throughput_last_read_usec = now_usec;
+	throughput_window_bytes += n_bytes;
+	elapsed_usec = now_usec - throughput_window_start_usec;
+
+	if (elapsed_usec < THROUGHPUT_WINDOW_USEC) {
+		G_UNLOCK (throughput);
+
+		if (stalled)
+			GS_PROFILER_SET_COUNTER (GS_PROFILER_COUNTER_DOWNLOAD_THROUGHPUT, 0);
+		return;
+	}
+
+	bytes_per_second = (gint64) throughput_window_bytes * G_USEC_PER_SEC / elapsed_usec;
+	throughput_window_start_usec = now_usec;
+	throughput_window_bytes = 0;
+
+	G_UNLOCK (throughput);
+
+	GS_PROFILER_SET_COUNTER (GS_PROFILER_COUNTER_DOWNLOAD_THROUGHPUT, bytes_per_second);
+}
+
 typedef struct {
 	/* Input data. */
 	gchar *uri;  /* (not nullable) (owned) */
@@ -86,6 +169,7 @@ typedef struct {
 	gsize total_written_bytes;
 	gsize expected_stream_size_bytes;
 	GBytes *currently_unwritten_chunk;  /* (nullable) (owned) */
+	gboolean counted_for_throughput;
 
 	/* Output data. */
 	gchar *new_etag;  /* (nullable) (owned) */
@@ -203,6 +287,9 @@ gs_download_stream_async (SoupSession                *soup_session,
 
 	g_task_set_task_data (task, g_steal_pointer (&data_owned), (GDestroyNotify) download_data_free);
 
+	data->counted_for_throughput = TRUE;
+	throughput_download_started ();
+
 	/* local */
 	if (g_str_has_prefix (uri, "file://")) {
 		g_autoptr(GFile) local_file = g_file_new_for_path (uri + strlen ("file://"));
@@ -374,6 +461,7 @@ read_bytes_cb (GObject      *source_object,
 	data->total_read_bytes += g_bytes_get_size (bytes);
 	data->expected_stream_size_bytes = MAX (data->expected_stream_size_bytes, data->total_read_bytes);
 	download_progress (task);
+	update_throughput_counter (g_bytes_get_size (bytes));
 
 	/* Write the downloaded data. */
 	if (g_bytes_get_size (bytes) > 0) {
@@ -455,6 +543,11 @@ finish_download (GTask  *task,
 		download_progress (task);
 	}
 
+	if (data->counted_for_throughput) {
+		data->counted_for_throughput = FALSE;
+		throughput_download_finished ();
+	}
+
 	/* Record the error from the operation, if set. */
 	g_assert (data->error == NULL);
 	data->error = g_steal_pointer (&error);
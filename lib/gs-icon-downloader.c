@@ -27,6 +27,7 @@
 #include "gs-icon-downloader.h"
 
 #include "gs-app-private.h"
+#include "gs-profiler.h"
 #include "gs-remote-icon.h"
 #include "gs-worker-thread.h"
 
@@ -40,6 +41,7 @@ struct _GsIconDownloader
 
 	GsWorkerThread	*worker; /* (owned) */
 	GCancellable	*cancellable; /* (owned) */
+	gint		 n_pending; /* (atomic); apps queued or being downloaded */
 };
 
 G_DEFINE_FINAL_TYPE (GsIconDownloader, gs_icon_downloader, G_TYPE_OBJECT)
@@ -215,6 +217,12 @@ gs_icon_downloader_update_priority (GsIconDownloader *self,
 	gs_worker_thread_update_cpu_priority (self->worker, system_bus_connection, priority);
 }
 
+static void
+update_pending_counter (gint n_pending)
+{
+	GS_PROFILER_SET_COUNTER (GS_PROFILER_COUNTER_ICONS_PENDING, n_pending);
+}
+
 static void download_remote_icons_of_the_app_cb (GTask        *task,
                                                  gpointer      source_object,
                                                  gpointer      task_data,
@@ -266,6 +274,8 @@ gs_icon_downloader_queue_app (GsIconDownloader *self,
 	g_task_set_task_data (task, g_object_ref (app), g_object_unref);
 	g_task_set_source_tag (task, gs_icon_downloader_queue_app);
 
+	update_pending_counter (g_atomic_int_add (&self->n_pending, 1) + 1);
+
 	gs_worker_thread_queue (self->worker, interactive ? G_PRIORITY_DEFAULT : G_PRIORITY_LOW,
 				download_remote_icons_of_the_app_cb, g_steal_pointer (&task));
 }
@@ -355,10 +365,13 @@ app_remote_icons_download_finished (GObject      *source_object,
                                     GAsyncResult *result,
                                     gpointer      user_data)
 {
+	GsIconDownloader *self = GS_ICON_DOWNLOADER (source_object);
 	g_autoptr(GError) error = NULL;
 
 	g_assert (g_task_is_valid (result, source_object));
 
+	update_pending_counter (g_atomic_int_add (&self->n_pending, -1) - 1);
+
 	if (!g_task_propagate_boolean (G_TASK (result), &error) &&
 	    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 		g_warning ("Failed to download icons of one app: %s", error->message);
@@ -38,6 +38,7 @@
 #include "gs-enums.h"
 #include "gs-plugin-job.h"
 #include "gs-plugin-job-private.h"
+#include "gs-profiler.h"
 #include "gs-plugin-job-install-apps.h"
 #include "gs-plugin-job-uninstall-apps.h"
 #include "gs-plugin-job-update-apps.h"
@@ -69,6 +70,7 @@ typedef struct {
 	guint watch_id;
 
 	gchar *match_app_unique_id;  /* (nullable) */
+	gchar *match_app_index_key;  /* (nullable); see dup_unique_id_index_key() */
 	GType match_job_type;
 
 	GsJobManagerJobCallback added_handler;
@@ -115,6 +117,7 @@ watch_data_unref (WatchData *data)
 		}
 
 		g_free (data->match_app_unique_id);
+		g_free (data->match_app_index_key);
 		g_main_context_unref (data->callback_context);
 		g_free (data);
 	}
@@ -143,9 +146,11 @@ watch_free_data_cb (gpointer user_data)
 	return G_SOURCE_REMOVE;
 }
 
-static gboolean
-job_contains_app_by_unique_id (GsPluginJob *job,
-                               const gchar *app_unique_id)
+/* Get the apps which @job is acting on, either as a list or a single app. */
+static void
+job_get_apps (GsPluginJob  *job,
+              GsAppList   **apps_out,
+              GsApp       **app_out)
 {
 	GsAppList *apps = NULL;
 	GsApp *app = NULL;
@@ -169,16 +174,107 @@ job_contains_app_by_unique_id (GsPluginJob *job,
 	else if (GS_IS_PLUGIN_JOB_LAUNCH (job))
 		app = gs_plugin_job_launch_get_app (GS_PLUGIN_JOB_LAUNCH (job));
 
+	*apps_out = apps;
+	*app_out = app;
+}
+
+static gboolean
+job_contains_app_by_unique_id (GsPluginJob *job,
+                               const gchar *app_unique_id)
+{
+	GsAppList *apps = NULL;
+	GsApp *app = NULL;
+
+	job_get_apps (job, &apps, &app);
+
 	return ((apps != NULL && gs_app_list_lookup (apps, app_unique_id) != NULL) ||
-		(app != NULL && g_strcmp0 (gs_app_get_unique_id (app), app_unique_id) == 0));
+		(app != NULL && gs_app_get_unique_id (app) != NULL && app_unique_id != NULL &&
+		 as_utils_data_id_equal (gs_app_get_unique_id (app), app_unique_id)));
+}
+
+/* Get the key to index @unique_id by: its component ID. Unique IDs are
+ * matched with as_utils_data_id_equal(), where any part can be a wildcard, so
+ * they can’t be looked up by the whole string; but two unique IDs can only
+ * match if their component IDs are equal, unless one of them is a wildcard.
+ *
+ * Returns %NULL if the component ID is a wildcard, or @unique_id is not a
+ * valid unique ID, in which case whatever has it can’t be indexed. */
+static gchar *
+dup_unique_id_index_key (const gchar *unique_id)
+{
+	g_auto(GStrv) parts = NULL;
+
+	if (unique_id == NULL)
+		return NULL;
+
+	parts = g_strsplit (unique_id, "/", -1);
+	if (g_strv_length (parts) != 5 || g_str_equal (parts[3], "*"))
+		return NULL;
+
+	return g_steal_pointer (&parts[3]);
+}
+
+/* Get the set of index keys (see dup_unique_id_index_key()) of the apps which
+ * @job is acting on, to index the job by. The jobs found through the index
+ * still have to be checked with job_contains_app_by_unique_id().
+ *
+ * Returns %NULL if the apps can change while the job is running, as they do
+ * for a refine which resolves wildcards, or if one of them has a wildcard
+ * component ID; such jobs are not indexed and are checked with
+ * job_contains_app_by_unique_id() every time instead. */
+static GHashTable *
+job_dup_app_index_keys (GsPluginJob *job)
+{
+	GsAppList *apps = NULL;
+	GsApp *app = NULL;
+	g_autoptr(GHashTable) index_keys = NULL;
+
+	if (GS_IS_PLUGIN_JOB_REFINE (job))
+		return NULL;
+
+	job_get_apps (job, &apps, &app);
+
+	index_keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (guint i = 0; apps != NULL && i < gs_app_list_length (apps); i++) {
+		const gchar *unique_id = gs_app_get_unique_id (gs_app_list_index (apps, i));
+		gchar *key;
+
+		if (unique_id == NULL)
+			continue;
+
+		key = dup_unique_id_index_key (unique_id);
+		if (key == NULL)
+			return NULL;
+
+		g_hash_table_add (index_keys, key);
+	}
+
+	if (app != NULL && gs_app_get_unique_id (app) != NULL) {
+		gchar *key = dup_unique_id_index_key (gs_app_get_unique_id (app));
+
+		if (key == NULL)
+			return NULL;
+
+		g_hash_table_add (index_keys, key);
+	}
+
+	return g_steal_pointer (&index_keys);
+}
+
+static gboolean
+watch_data_matches_job_type (const WatchData *data,
+                             GsPluginJob     *job)
+{
+	return (data->match_job_type == G_TYPE_INVALID ||
+		data->match_job_type == G_OBJECT_TYPE (job));
 }
 
 static gboolean
 watch_data_matches (const WatchData *data,
                     GsPluginJob     *job)
 {
-	if (data->match_job_type != G_TYPE_INVALID &&
-	    data->match_job_type != G_OBJECT_TYPE (job))
+	if (!watch_data_matches_job_type (data, job))
 		return FALSE;
 
 	if (data->match_app_unique_id != NULL &&
@@ -196,13 +292,15 @@ watch_data_matches (const WatchData *data,
  *
  * This structure is immutable after creation, so is inherently thread-safe.
  */
+typedef enum {
+	WATCH_CALL_ADDED,
+	WATCH_CALL_REMOVED,
+} WatchCallType;
+
 typedef struct {
 	GsJobManager *job_manager;  /* (owned) (not nullable) */
 	WatchData *watch_data;  /* (owned) (not nullable) */
-	enum {
-		WATCH_CALL_ADDED,
-		WATCH_CALL_REMOVED,
-	} call_type;
+	WatchCallType call_type;
 	GsPluginJob *job;  /* (owned) (not nullable) */
 } WatchCallHandlerData;
 
@@ -250,15 +348,164 @@ struct _GsJobManager
 
 	GPtrArray *jobs;  /* (owned) (element-type GsPluginJob) (not nullable), protected by @mutex */
 
+	/* Indexes of @jobs, so rows and tiles can look up the jobs for their
+	 * app without going through all the jobs. They are keyed by component
+	 * ID (see dup_unique_id_index_key()), and the jobs in them are owned
+	 * by @jobs. All protected by @mutex. */
+	GHashTable *job_index_keys;  /* (owned) (element-type GsPluginJob GHashTable<utf8>) (not nullable); values are %NULL for unindexed jobs */
+	GHashTable *jobs_by_app;  /* (owned) (element-type utf8 GPtrArray<GsPluginJob>) (not nullable) */
+	GPtrArray *unindexed_jobs;  /* (owned) (element-type GsPluginJob) (not nullable) */
+
 	GPtrArray *watches;  /* (owned) (element-type WatchData) (not nullable), protected by @mutex */
 	guint next_watch_id;  /* protected by @mutex */
 
+	/* Indexes of @watches by the component ID of the app they match, like
+	 * @jobs_by_app; watches which match any app, or an app which can’t be
+	 * indexed, are in @watches_any_app. The watches in them are owned by
+	 * @watches. Protected by @mutex. */
+	GHashTable *watches_by_app;  /* (owned) (element-type utf8 GPtrArray<WatchData>) (not nullable) */
+	GPtrArray *watches_any_app;  /* (owned) (element-type WatchData) (not nullable) */
+
 	GCond shutdown_cond;
 	gboolean shut_down; /* set to TRUE when being shut down */
 };
 
 G_DEFINE_TYPE (GsJobManager, gs_job_manager, G_TYPE_OBJECT)
 
+static void
+index_keys_free (GHashTable *index_keys)
+{
+	if (index_keys != NULL)
+		g_hash_table_unref (index_keys);
+}
+
+/* Add @value to the array for @key in @index, which maps strings to unowned
+ * pointers. */
+static void
+index_add (GHashTable  *index,
+           const gchar *key,
+           gpointer     value)
+{
+	GPtrArray *array = g_hash_table_lookup (index, key);
+
+	if (array == NULL) {
+		array = g_ptr_array_new ();
+		g_hash_table_insert (index, g_strdup (key), array);
+	}
+
+	g_ptr_array_add (array, value);
+}
+
+static void
+index_remove (GHashTable  *index,
+              const gchar *key,
+              gpointer     value)
+{
+	GPtrArray *array = g_hash_table_lookup (index, key);
+
+	if (array == NULL)
+		return;
+
+	g_ptr_array_remove_fast (array, value);
+	if (array->len == 0)
+		g_hash_table_remove (index, key);
+}
+
+/* self->mutex must be held */
+static void
+queue_watch_call (GsJobManager  *self,
+                  WatchData     *data,
+                  GsPluginJob   *job,
+                  WatchCallType  call_type)
+{
+	g_autoptr(WatchCallHandlerData) idle_data = NULL;
+	g_autoptr(GSource) idle_source = NULL;
+
+	if ((call_type == WATCH_CALL_ADDED && data->added_handler == NULL) ||
+	    (call_type == WATCH_CALL_REMOVED && data->removed_handler == NULL))
+		return;
+
+	idle_data = g_new0 (WatchCallHandlerData, 1);
+	idle_data->job_manager = g_object_ref (self);
+	idle_data->watch_data = watch_data_ref (data);
+	idle_data->call_type = call_type;
+	idle_data->job = g_object_ref (job);
+
+	idle_source = g_idle_source_new ();
+	g_source_set_priority (idle_source, G_PRIORITY_DEFAULT);
+	g_source_set_callback (idle_source,
+			       watch_call_handler_cb,
+			       g_steal_pointer (&idle_data),
+			       (GDestroyNotify) watch_call_handler_data_free);
+	g_source_set_static_name (idle_source, G_STRFUNC);
+	g_source_attach (idle_source, data->callback_context);
+}
+
+/* Queue calls to the watches which match @job. @index_keys is the set of keys
+ * @job is indexed by, or %NULL if it’s not indexed, in which case all the
+ * watches have to be checked against it.
+ *
+ * self->mutex must be held */
+static void
+dispatch_watches (GsJobManager  *self,
+                  GsPluginJob   *job,
+                  GHashTable    *index_keys,
+                  WatchCallType  call_type)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	if (index_keys == NULL) {
+		for (guint i = 0; i < self->watches->len; i++) {
+			WatchData *data = g_ptr_array_index (self->watches, i);
+
+			if (watch_data_matches (data, job))
+				queue_watch_call (self, data, job, call_type);
+		}
+
+		return;
+	}
+
+	for (guint i = 0; i < self->watches_any_app->len; i++) {
+		WatchData *data = g_ptr_array_index (self->watches_any_app, i);
+
+		if (watch_data_matches (data, job))
+			queue_watch_call (self, data, job, call_type);
+	}
+
+	/* Go through whichever is smaller: the apps of the job, or the apps
+	 * being watched. The index only narrows down the watches by component
+	 * ID, so they still have to be matched against the job’s apps. */
+	if (g_hash_table_size (index_keys) <= g_hash_table_size (self->watches_by_app)) {
+		g_hash_table_iter_init (&iter, index_keys);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			GPtrArray *watches = g_hash_table_lookup (self->watches_by_app, key);
+
+			for (guint i = 0; watches != NULL && i < watches->len; i++) {
+				WatchData *data = g_ptr_array_index (watches, i);
+
+				if (watch_data_matches (data, job))
+					queue_watch_call (self, data, job, call_type);
+			}
+		}
+	} else {
+		g_hash_table_iter_init (&iter, self->watches_by_app);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			GPtrArray *watches = value;
+
+			if (!g_hash_table_contains (index_keys, key))
+				continue;
+
+			for (guint i = 0; i < watches->len; i++) {
+				WatchData *data = g_ptr_array_index (watches, i);
+
+				if (watch_data_matches (data, job))
+					queue_watch_call (self, data, job, call_type);
+			}
+		}
+	}
+}
+
 static void
 gs_job_manager_dispose (GObject *object)
 {
@@ -278,7 +525,12 @@ gs_job_manager_finalize (GObject *object)
 {
 	GsJobManager *self = GS_JOB_MANAGER (object);
 
+	g_clear_pointer (&self->job_index_keys, g_hash_table_unref);
+	g_clear_pointer (&self->jobs_by_app, g_hash_table_unref);
+	g_clear_pointer (&self->unindexed_jobs, g_ptr_array_unref);
 	g_clear_pointer (&self->jobs, g_ptr_array_unref);
+	g_clear_pointer (&self->watches_by_app, g_hash_table_unref);
+	g_clear_pointer (&self->watches_any_app, g_ptr_array_unref);
 	g_clear_pointer (&self->watches, g_ptr_array_unref);
 	g_cond_clear (&self->shutdown_cond);
 	g_mutex_clear (&self->mutex);
@@ -301,7 +553,12 @@ gs_job_manager_init (GsJobManager *self)
 	g_mutex_init (&self->mutex);
 	g_cond_init (&self->shutdown_cond);
 	self->jobs = g_ptr_array_new_with_free_func (g_object_unref);
+	self->job_index_keys = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) index_keys_free);
+	self->jobs_by_app = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+	self->unindexed_jobs = g_ptr_array_new ();
 	self->watches = g_ptr_array_new_with_free_func ((GDestroyNotify) watch_data_unref);
+	self->watches_by_app = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+	self->watches_any_app = g_ptr_array_new ();
 	self->next_watch_id = 1;
 }
 
@@ -328,6 +585,13 @@ job_completed_cb (GsPluginJob *job,
 	gs_job_manager_remove_job (self, job);
 }
 
+/* self->mutex must be held */
+static void
+update_jobs_counter (GsJobManager *self)
+{
+	GS_PROFILER_SET_COUNTER (GS_PROFILER_COUNTER_JOBS_IN_FLIGHT, self->jobs->len);
+}
+
 /**
  * gs_job_manager_add_job:
  * @self: a #GsJobManager
@@ -346,44 +610,40 @@ gs_job_manager_add_job (GsJobManager *self,
                         GsPluginJob  *job)
 {
 	g_autoptr(GMutexLocker) locker = NULL;
+	GHashTable *index_keys;
 
 	g_return_val_if_fail (GS_IS_JOB_MANAGER (self), FALSE);
 	g_return_val_if_fail (GS_IS_PLUGIN_JOB (job), FALSE);
 
 	locker = g_mutex_locker_new (&self->mutex);
 
-	if (g_ptr_array_find (self->jobs, job, NULL))
+	if (g_hash_table_contains (self->job_index_keys, job))
 		return FALSE;
 
 	g_ptr_array_add (self->jobs, g_object_ref (job));
 	g_signal_connect (job, "completed", G_CALLBACK (job_completed_cb), self);
 
-	/* Dispatch watches for this job. */
-	for (guint i = 0; i < self->watches->len; i++) {
-		WatchData *data = g_ptr_array_index (self->watches, i);
-
-		if (data->added_handler != NULL &&
-		    watch_data_matches (data, job)) {
-			g_autoptr(WatchCallHandlerData) idle_data = NULL;
-			g_autoptr(GSource) idle_source = NULL;
+	/* Index the job by its apps. */
+	index_keys = job_dup_app_index_keys (job);
 
-			idle_data = g_new0 (WatchCallHandlerData, 1);
-			idle_data->job_manager = g_object_ref (self);
-			idle_data->watch_data = watch_data_ref (data);
-			idle_data->call_type = WATCH_CALL_ADDED;
-			idle_data->job = g_object_ref (job);
+	if (index_keys != NULL) {
+		GHashTableIter iter;
+		gpointer key;
 
-			idle_source = g_idle_source_new ();
-			g_source_set_priority (idle_source, G_PRIORITY_DEFAULT);
-			g_source_set_callback (idle_source,
-					       watch_call_handler_cb,
-					       g_steal_pointer (&idle_data),
-					       (GDestroyNotify) watch_call_handler_data_free);
-			g_source_set_static_name (idle_source, G_STRFUNC);
-			g_source_attach (idle_source, data->callback_context);
-		}
+		g_hash_table_iter_init (&iter, index_keys);
+		while (g_hash_table_iter_next (&iter, &key, NULL))
+			index_add (self->jobs_by_app, key, job);
+	} else {
+		g_ptr_array_add (self->unindexed_jobs, job);
 	}
 
+	g_hash_table_insert (self->job_index_keys, job, index_keys);
+
+	update_jobs_counter (self);
+
+	/* Dispatch watches for this job. */
+	dispatch_watches (self, job, index_keys, WATCH_CALL_ADDED);
+
 	if (self->shut_down) {
 		g_debug ("Adding job '%s' while being shut down", G_OBJECT_TYPE_NAME (job));
 		g_cond_broadcast (&self->shutdown_cond);
@@ -410,41 +670,39 @@ gs_job_manager_remove_job (GsJobManager *self,
                            GsPluginJob  *job)
 {
 	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GsPluginJob) job_owned = NULL;
+	GHashTable *index_keys = NULL;
 
 	g_return_val_if_fail (GS_IS_JOB_MANAGER (self), FALSE);
 	g_return_val_if_fail (GS_IS_PLUGIN_JOB (job), FALSE);
 
 	locker = g_mutex_locker_new (&self->mutex);
 
-	if (!g_ptr_array_remove_fast (self->jobs, job))
+	if (!g_hash_table_lookup_extended (self->job_index_keys, job, NULL, (gpointer *) &index_keys))
 		return FALSE;
 
-	/* Dispatch watches for this job. */
-	for (guint i = 0; i < self->watches->len; i++) {
-		WatchData *data = g_ptr_array_index (self->watches, i);
+	/* Keep @job alive until it’s out of all the indexes. */
+	job_owned = g_object_ref (job);
 
-		if (data->removed_handler != NULL &&
-		    watch_data_matches (data, job)) {
-			g_autoptr(WatchCallHandlerData) idle_data = NULL;
-			g_autoptr(GSource) idle_source = NULL;
+	/* Dispatch watches for this job. */
+	dispatch_watches (self, job, index_keys, WATCH_CALL_REMOVED);
 
-			idle_data = g_new0 (WatchCallHandlerData, 1);
-			idle_data->job_manager = g_object_ref (self);
-			idle_data->watch_data = watch_data_ref (data);
-			idle_data->call_type = WATCH_CALL_REMOVED;
-			idle_data->job = g_object_ref (job);
+	if (index_keys != NULL) {
+		GHashTableIter iter;
+		gpointer key;
 
-			idle_source = g_idle_source_new ();
-			g_source_set_priority (idle_source, G_PRIORITY_DEFAULT);
-			g_source_set_callback (idle_source,
-					       watch_call_handler_cb,
-					       g_steal_pointer (&idle_data),
-					       (GDestroyNotify) watch_call_handler_data_free);
-			g_source_set_static_name (idle_source, G_STRFUNC);
-			g_source_attach (idle_source, data->callback_context);
-		}
+		g_hash_table_iter_init (&iter, index_keys);
+		while (g_hash_table_iter_next (&iter, &key, NULL))
+			index_remove (self->jobs_by_app, key, job);
+	} else {
+		g_ptr_array_remove_fast (self->unindexed_jobs, job);
 	}
 
+	g_hash_table_remove (self->job_index_keys, job);
+	g_ptr_array_remove_fast (self->jobs, job);
+
+	update_jobs_counter (self);
+
 	g_signal_handlers_disconnect_by_func (job, job_completed_cb, self);
 
 	if (self->shut_down && self->jobs->len == 0)
@@ -467,6 +725,9 @@ job_contains_app (GsPluginJob *job,
  *
  * Find the jobs which are ongoing for the given @app.
  *
+ * Apps are matched by unique ID with as_utils_data_id_equal(), so wildcard
+ * parts of either unique ID match anything.
+ *
  * Returns: (element-type GsPluginJob) (transfer container): zero or more
  *   ongoing jobs
  * Since: 44
@@ -477,6 +738,8 @@ gs_job_manager_get_pending_jobs_for_app (GsJobManager *self,
 {
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_autoptr(GPtrArray) jobs_for_app = NULL;
+	g_autofree gchar *index_key = NULL;
+	GPtrArray *candidate_jobs;
 
 	g_return_val_if_fail (GS_IS_JOB_MANAGER (self), NULL);
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
@@ -485,8 +748,19 @@ gs_job_manager_get_pending_jobs_for_app (GsJobManager *self,
 
 	jobs_for_app = g_ptr_array_new_with_free_func (g_object_unref);
 
-	for (gsize i = 0; i < self->jobs->len; i++) {
-		GsPluginJob *job = g_ptr_array_index (self->jobs, i);
+	/* If @app can’t be looked up in the index, it could match any job */
+	index_key = dup_unique_id_index_key (gs_app_get_unique_id (app));
+	candidate_jobs = (index_key != NULL) ? g_hash_table_lookup (self->jobs_by_app, index_key) : self->jobs;
+
+	for (guint i = 0; candidate_jobs != NULL && i < candidate_jobs->len; i++) {
+		GsPluginJob *job = g_ptr_array_index (candidate_jobs, i);
+
+		if (job_contains_app (job, app))
+			g_ptr_array_add (jobs_for_app, g_object_ref (job));
+	}
+
+	for (guint i = 0; index_key != NULL && i < self->unindexed_jobs->len; i++) {
+		GsPluginJob *job = g_ptr_array_index (self->unindexed_jobs, i);
 
 		if (job_contains_app (job, app))
 			g_ptr_array_add (jobs_for_app, g_object_ref (job));
@@ -514,6 +788,8 @@ gs_job_manager_app_has_pending_job_type (GsJobManager *self,
                                          GType         pending_job_type)
 {
 	g_autoptr(GMutexLocker) locker = NULL;
+	g_autofree gchar *index_key = NULL;
+	GPtrArray *candidate_jobs;
 
 	g_return_val_if_fail (GS_IS_JOB_MANAGER (self), FALSE);
 	g_return_val_if_fail (GS_IS_APP (app), FALSE);
@@ -521,8 +797,20 @@ gs_job_manager_app_has_pending_job_type (GsJobManager *self,
 
 	locker = g_mutex_locker_new (&self->mutex);
 
-	for (gsize i = 0; i < self->jobs->len; i++) {
-		GsPluginJob *job = g_ptr_array_index (self->jobs, i);
+	/* If @app can’t be looked up in the index, it could match any job */
+	index_key = dup_unique_id_index_key (gs_app_get_unique_id (app));
+	candidate_jobs = (index_key != NULL) ? g_hash_table_lookup (self->jobs_by_app, index_key) : self->jobs;
+
+	for (guint i = 0; candidate_jobs != NULL && i < candidate_jobs->len; i++) {
+		GsPluginJob *job = g_ptr_array_index (candidate_jobs, i);
+
+		if (g_type_is_a (G_OBJECT_TYPE (job), pending_job_type) &&
+		    job_contains_app (job, app))
+			return TRUE;
+	}
+
+	for (guint i = 0; index_key != NULL && i < self->unindexed_jobs->len; i++) {
+		GsPluginJob *job = g_ptr_array_index (self->unindexed_jobs, i);
 
 		if (g_type_is_a (G_OBJECT_TYPE (job), pending_job_type) &&
 		    job_contains_app (job, app))
@@ -594,6 +882,7 @@ gs_job_manager_add_watch (GsJobManager            *self,
 	data->ref_count = 1;
 	data->watch_id = watch_id;
 	data->match_app_unique_id = (match_app != NULL) ? g_strdup (gs_app_get_unique_id (match_app)) : NULL;
+	data->match_app_index_key = dup_unique_id_index_key (data->match_app_unique_id);
 	data->match_job_type = match_job_type;
 	data->added_handler = added_handler;
 	data->removed_handler = removed_handler;
@@ -601,6 +890,11 @@ gs_job_manager_add_watch (GsJobManager            *self,
 	data->user_data_free_func = user_data_free_func;
 	data->callback_context = g_main_context_ref_thread_default ();
 
+	if (data->match_app_index_key != NULL)
+		index_add (self->watches_by_app, data->match_app_index_key, data);
+	else
+		g_ptr_array_add (self->watches_any_app, data);
+
 	g_ptr_array_add (self->watches, g_steal_pointer (&data));
 
 	g_assert (watch_id != 0);
@@ -630,9 +924,14 @@ gs_job_manager_remove_watch (GsJobManager *self,
 	locker = g_mutex_locker_new (&self->mutex);
 
 	for (guint i = 0; i < self->watches->len; i++) {
-		const WatchData *data = g_ptr_array_index (self->watches, i);
+		WatchData *data = g_ptr_array_index (self->watches, i);
 
 		if (data->watch_id == watch_id) {
+			if (data->match_app_index_key != NULL)
+				index_remove (self->watches_by_app, data->match_app_index_key, data);
+			else
+				g_ptr_array_remove_fast (self->watches_any_app, data);
+
 			g_ptr_array_remove_index_fast (self->watches, i);
 			return;
 		}
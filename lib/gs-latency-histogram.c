@@ -0,0 +1,180 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-latency-histogram
+ * @short_description: A fixed-size histogram of operation latencies
+ *
+ * #GsLatencyHistogram counts durations into logarithmically sized buckets,
+ * four per doubling, from 10µs up to a few minutes. That keeps it a fixed,
+ * small size however many durations are added, at the cost of percentiles
+ * only being accurate to within about 20%. The maximum is tracked exactly.
+ *
+ * It is not thread safe; callers must provide their own locking.
+ *
+ * Since: 51
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include "gs-latency-histogram.h"
+
+/* bucket 0 is everything below BASE_USEC; bucket i > 0 is
+ * [BASE_USEC × 2^((i - 1) / 4), BASE_USEC × 2^(i / 4)), with the last one
+ * also taking everything above (about 280s) */
+#define BASE_USEC		10
+#define BUCKETS_PER_DOUBLING	4
+#define N_BUCKETS		100
+
+struct _GsLatencyHistogram
+{
+	guint64		 count;
+	gint64		 max_usec;
+	guint64		 buckets[N_BUCKETS];
+};
+
+/**
+ * gs_latency_histogram_new:
+ *
+ * Create a new, empty #GsLatencyHistogram.
+ *
+ * Returns: (transfer full): a new #GsLatencyHistogram
+ * Since: 51
+ */
+GsLatencyHistogram *
+gs_latency_histogram_new (void)
+{
+	return g_new0 (GsLatencyHistogram, 1);
+}
+
+/**
+ * gs_latency_histogram_free:
+ * @self: (transfer full): a #GsLatencyHistogram
+ *
+ * Free a #GsLatencyHistogram.
+ *
+ * Since: 51
+ */
+void
+gs_latency_histogram_free (GsLatencyHistogram *self)
+{
+	g_free (self);
+}
+
+static guint
+bucket_for_duration (gint64 duration_usec)
+{
+	guint bucket;
+
+	if (duration_usec < BASE_USEC)
+		return 0;
+
+	bucket = (guint) (log2 ((gdouble) duration_usec / BASE_USEC) * BUCKETS_PER_DOUBLING) + 1;
+
+	return MIN (bucket, N_BUCKETS - 1);
+}
+
+static gint64
+bucket_upper_bound (guint bucket)
+{
+	return (gint64) ceil (BASE_USEC * exp2 ((gdouble) bucket / BUCKETS_PER_DOUBLING));
+}
+
+/**
+ * gs_latency_histogram_add:
+ * @self: a #GsLatencyHistogram
+ * @duration_usec: how long the operation took, in microseconds
+ *
+ * Count a duration in the histogram. Negative durations count as zero.
+ *
+ * Since: 51
+ */
+void
+gs_latency_histogram_add (GsLatencyHistogram *self,
+                          gint64              duration_usec)
+{
+	g_return_if_fail (self != NULL);
+
+	duration_usec = MAX (duration_usec, 0);
+
+	self->buckets[bucket_for_duration (duration_usec)]++;
+	self->count++;
+	self->max_usec = MAX (self->max_usec, duration_usec);
+}
+
+/**
+ * gs_latency_histogram_get_count:
+ * @self: a #GsLatencyHistogram
+ *
+ * Get the number of durations added to the histogram.
+ *
+ * Returns: number of durations
+ * Since: 51
+ */
+guint64
+gs_latency_histogram_get_count (GsLatencyHistogram *self)
+{
+	g_return_val_if_fail (self != NULL, 0);
+
+	return self->count;
+}
+
+/**
+ * gs_latency_histogram_get_max:
+ * @self: a #GsLatencyHistogram
+ *
+ * Get the longest duration added to the histogram.
+ *
+ * Returns: longest duration in microseconds, or 0 if it is empty
+ * Since: 51
+ */
+gint64
+gs_latency_histogram_get_max (GsLatencyHistogram *self)
+{
+	g_return_val_if_fail (self != NULL, 0);
+
+	return self->max_usec;
+}
+
+/**
+ * gs_latency_histogram_get_percentile:
+ * @self: a #GsLatencyHistogram
+ * @percentile: percentile to get, from 0 to 100
+ *
+ * Get an upper bound for the duration which @percentile percent of the
+ * durations added to the histogram were no longer than. This is the upper
+ * bound of the bucket it falls in, but never more than the maximum.
+ *
+ * Returns: the percentile in microseconds, or 0 if it is empty
+ * Since: 51
+ */
+gint64
+gs_latency_histogram_get_percentile (GsLatencyHistogram *self,
+                                     guint               percentile)
+{
+	guint64 rank, n_seen = 0;
+
+	g_return_val_if_fail (self != NULL, 0);
+	g_return_val_if_fail (percentile <= 100, 0);
+
+	if (self->count == 0)
+		return 0;
+
+	/* the rank of the duration wanted, counting from 1 */
+	rank = MAX ((self->count * percentile + 99) / 100, 1);
+
+	for (guint i = 0; i < N_BUCKETS; i++) {
+		n_seen += self->buckets[i];
+		if (n_seen >= rank)
+			return MIN (bucket_upper_bound (i), self->max_usec);
+	}
+
+	g_assert_not_reached ();
+}
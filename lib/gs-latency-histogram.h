@@ -0,0 +1,29 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GsLatencyHistogram GsLatencyHistogram;
+
+GsLatencyHistogram	*gs_latency_histogram_new		(void);
+void			 gs_latency_histogram_free		(GsLatencyHistogram	*self);
+
+void			 gs_latency_histogram_add		(GsLatencyHistogram	*self,
+								 gint64			 duration_usec);
+guint64			 gs_latency_histogram_get_count		(GsLatencyHistogram	*self);
+gint64			 gs_latency_histogram_get_max		(GsLatencyHistogram	*self);
+gint64			 gs_latency_histogram_get_percentile	(GsLatencyHistogram	*self,
+								 guint			 percentile);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GsLatencyHistogram, gs_latency_histogram_free)
+
+G_END_DECLS
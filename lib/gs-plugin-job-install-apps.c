@@ -69,6 +69,7 @@
 #include "gs-enums.h"
 #include "gs-plugin-job-private.h"
 #include "gs-plugin-job-install-apps.h"
+#include "gs-plugin-private.h"
 #include "gs-plugin-types.h"
 #include "gs-profiler.h"
 #include "gs-utils.h"
@@ -88,6 +89,7 @@ struct _GsPluginJobInstallApps
 	GSource *progress_source;  /* (owned) (nullable) */
 	guint last_reported_progress;
 
+	gint64 plugins_begin_time_usec;
 #ifdef HAVE_SYSPROF
 	gint64 begin_time_nsec;
 #endif
@@ -254,6 +256,7 @@ gs_plugin_job_install_apps_run_async (GsPluginJob         *job,
 	self->n_pending_ops = 1;
 	plugins = gs_plugin_loader_get_plugins (plugin_loader);
 
+	self->plugins_begin_time_usec = g_get_monotonic_time ();
 #ifdef HAVE_SYSPROF
 	self->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
 #endif
@@ -399,6 +402,7 @@ plugin_install_apps_cb (GObject      *source_object,
 	 * should report them directly by calling event_callback().
 	 * #GsPluginJobInstallApps cannot do this as it doesn’t know which errors
 	 * are interesting to the user and which are useless. */
+	gs_plugin_add_latency (plugin, "install-apps", g_get_monotonic_time () - self->plugins_begin_time_usec);
 	if (!plugin_class->install_apps_finish (plugin, result, &local_error) &&
 	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED) &&
 	    !g_error_matches (local_error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED)) {
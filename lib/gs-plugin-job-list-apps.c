@@ -20,6 +20,32 @@
  * results will be refined using the given set of refine flags. See
  * #GsPluginJobRefine.
  *
+ * If the query sets #GsAppQuery:ranking-refine-require-flags and
+ * #GsAppQuery:max-results, the results are refined in two phases: first with
+ * just the data needed to filter, dedupe and sort them, and then, once they
+ * have been truncated to #GsAppQuery:max-results, with the rest of the data.
+ *
+ * If %GS_PLUGIN_LIST_APPS_FLAGS_STREAM_RESULTS is set, the results from each
+ * plugin are also filtered, deduplicated, sorted, truncated and refined on
+ * their own as soon as that plugin returns them, and then emitted with
+ * #GsPluginJobListApps::partial-results. This lets callers show something
+ * before the slowest plugin has finished. The final results are still
+ * computed from the results of all the plugins once they have all returned,
+ * and will usually be in a different order than the partial results, so
+ * callers should replace what they have shown with them.
+ *
+ * Streaming is not free: it runs a refine job for each plugin which returns
+ * results, and the final results are then refined again as a whole. The final
+ * refine skips the apps which were already refined for the same flags (see
+ * #GsPluginJobRefine), so plugins are only asked about the apps which were not
+ * in any partial result, but it still has to check every app, and apps which
+ * were deduplicated in favour of a different instance are refined again.
+ *
+ * If a plugin timeout is set with gs_plugin_job_set_plugin_timeout(), any
+ * plugin which has not returned its results by then is cancelled and the
+ * results from the other plugins are returned without it. The same timeout is
+ * applied to each plugin when refining the results.
+ *
  * This class is a wrapper around #GsPluginClass.list_apps_async,
  * calling it for all loaded plugins, with #GsPluginJobRefine used to refine
  * them.
@@ -61,10 +87,12 @@ struct _GsPluginJobListApps
 	GsAppList *merged_list;  /* (owned) (nullable) */
 	GError *saved_error;  /* (owned) (nullable) */
 	guint n_pending_ops;
+	GHashTable *plugin_deadlines;  /* (owned) (nullable) (element-type GsPlugin GsPluginJobDeadline) */
 
 	/* Results. */
 	GsAppList *result_list;  /* (owned) (nullable) */
 
+	gint64 plugins_begin_time_usec;
 #ifdef HAVE_SYSPROF
 	gint64 begin_time_nsec;
 #endif
@@ -79,6 +107,12 @@ typedef enum {
 
 static GParamSpec *props[PROP_FLAGS + 1] = { NULL, };
 
+typedef enum {
+	SIGNAL_PARTIAL_RESULTS,
+} GsPluginJobListAppsSignal;
+
+static guint signals[SIGNAL_PARTIAL_RESULTS + 1] = { 0, };
+
 static void
 gs_plugin_job_list_apps_dispose (GObject *object)
 {
@@ -90,6 +124,7 @@ gs_plugin_job_list_apps_dispose (GObject *object)
 
 	g_clear_object (&self->result_list);
 	g_clear_object (&self->query);
+	g_clear_pointer (&self->plugin_deadlines, g_hash_table_unref);
 
 	G_OBJECT_CLASS (gs_plugin_job_list_apps_parent_class)->dispose (object);
 }
@@ -242,19 +277,64 @@ app_filter_qt_for_gtk_and_compatible (GsApp    *app,
 	return gs_plugin_loader_app_is_compatible (plugin_loader, app);
 }
 
+/* State for turning a list of apps from the plugins into results: refining,
+ * filtering, deduplicating, sorting and truncating it. This is done once for
+ * the final results, and once for each partial result if streaming. */
+typedef struct {
+	GTask *task;  /* (owned) */
+	gboolean is_partial;
+	GsPluginRefineRequireFlags deferred_require_flags;  /* to refine the truncated results with, if refining in two phases */
+} ProcessData;
+
+static void
+process_data_free (ProcessData *data)
+{
+	g_clear_object (&data->task);
+	g_free (data);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ProcessData, process_data_free)
+
+typedef struct {
+	GTask *task;  /* (owned) */
+	GsPlugin *plugin;  /* (owned) */
+} PluginDeadlineData;
+
+static void
+plugin_deadline_data_free (PluginDeadlineData *deadline_data)
+{
+	g_object_unref (deadline_data->task);
+	g_object_unref (deadline_data->plugin);
+	g_free (deadline_data);
+}
+
 static void plugin_event_cb (GsPlugin      *plugin,
                              GsPluginEvent *event,
                              void          *user_data);
 static void plugin_list_apps_cb (GObject      *source_object,
                                  GAsyncResult *result,
                                  gpointer      user_data);
+static gboolean plugin_deadline_expired_cb (gpointer user_data);
 static void finish_op (GTask  *task,
                        GError *error);
+static void process_list (GTask     *task,
+                          GsAppList *list,
+                          gboolean   is_partial);
 static void refine_cb (GObject      *source_object,
                        GAsyncResult *result,
                        gpointer      user_data);
-static void finish_task (GTask     *task,
-                         GsAppList *merged_list);
+static void finish_processing (ProcessData *data,
+                               GsAppList   *list);
+static void deferred_refine_cb (GObject      *source_object,
+                                GAsyncResult *result,
+                                gpointer      user_data);
+static void finish_process_data (ProcessData *data,
+                                 GsAppList   *list,
+                                 GError      *error);
+static void emit_partial_results (GTask     *task,
+                                  GsAppList *list);
+static void return_results (GTask     *task,
+                            GsAppList *merged_list);
 
 static void
 gs_plugin_job_list_apps_run_async (GsPluginJob         *job,
@@ -267,6 +347,7 @@ gs_plugin_job_list_apps_run_async (GsPluginJob         *job,
 	g_autoptr(GTask) task = NULL;
 	GPtrArray *plugins;  /* (element-type GsPlugin) */
 	gboolean anything_ran = FALSE;
+	guint timeout_ms = gs_plugin_job_get_plugin_timeout (job);
 	g_autoptr(GError) local_error = NULL;
 
 	task = g_task_new (job, cancellable, callback, user_data);
@@ -278,7 +359,11 @@ gs_plugin_job_list_apps_run_async (GsPluginJob         *job,
 	self->n_pending_ops = 1;
 	self->merged_list = gs_app_list_new ();
 	plugins = gs_plugin_loader_get_plugins (plugin_loader);
+	if (timeout_ms > 0)
+		self->plugin_deadlines = g_hash_table_new_full (NULL, NULL, NULL,
+								(GDestroyNotify) gs_plugin_job_deadline_free);
 
+	self->plugins_begin_time_usec = g_get_monotonic_time ();
 #ifdef HAVE_SYSPROF
 	self->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
 #endif
@@ -299,9 +384,26 @@ gs_plugin_job_list_apps_run_async (GsPluginJob         *job,
 		if (g_cancellable_set_error_if_cancelled (cancellable, &local_error))
 			break;
 
-		/* run the plugin */
+		/* run the plugin, giving up on it if it takes too long */
 		self->n_pending_ops++;
-		plugin_class->list_apps_async (plugin, self->query, self->flags, plugin_event_cb, task, cancellable, plugin_list_apps_cb, g_object_ref (task));
+		if (timeout_ms > 0) {
+			PluginDeadlineData *deadline_data = g_new0 (PluginDeadlineData, 1);
+			GsPluginJobDeadline *deadline;
+
+			deadline_data->task = g_object_ref (task);
+			deadline_data->plugin = g_object_ref (plugin);
+			deadline = gs_plugin_job_deadline_new (timeout_ms, cancellable,
+							       plugin_deadline_expired_cb,
+							       deadline_data,
+							       (GDestroyNotify) plugin_deadline_data_free);
+			g_hash_table_insert (self->plugin_deadlines, plugin, deadline);
+
+			plugin_class->list_apps_async (plugin, self->query, self->flags, plugin_event_cb, task,
+						       gs_plugin_job_deadline_get_cancellable (deadline),
+						       plugin_list_apps_cb, g_object_ref (task));
+		} else {
+			plugin_class->list_apps_async (plugin, self->query, self->flags, plugin_event_cb, task, cancellable, plugin_list_apps_cb, g_object_ref (task));
+		}
 	}
 
 	if (!anything_ran) {
@@ -336,8 +438,21 @@ plugin_list_apps_cb (GObject      *source_object,
 	GsPluginJobListApps *self = g_task_get_source_object (task);
 	g_autoptr(GsAppList) plugin_apps = NULL;
 	g_autoptr(GError) local_error = NULL;
+	GsPluginJobDeadline *deadline;
 
 	plugin_apps = plugin_class->list_apps_finish (plugin, result, &local_error);
+	gs_plugin_add_latency (plugin, "list-apps", g_get_monotonic_time () - self->plugins_begin_time_usec);
+
+	/* The job has already carried on without this plugin. */
+	deadline = (self->plugin_deadlines != NULL) ? g_hash_table_lookup (self->plugin_deadlines, plugin) : NULL;
+	if (deadline != NULL && gs_plugin_job_deadline_has_expired (deadline)) {
+		g_debug ("plugin '%s' finished listing apps after its deadline",
+			 gs_plugin_get_name (plugin));
+		return;
+	}
+
+	if (deadline != NULL)
+		g_hash_table_remove (self->plugin_deadlines, plugin);
 
 	if (plugin_apps != NULL)
 		gs_app_list_add_list (self->merged_list, plugin_apps);
@@ -359,21 +474,52 @@ plugin_list_apps_cb (GObject      *source_object,
 						    gs_plugin_get_name (plugin)),
 				   NULL);
 
+	/* Stream these results now, unless this is the last pending plugin,
+	 * in which case the final results are about to be processed anyway. */
+	if ((self->flags & GS_PLUGIN_LIST_APPS_FLAGS_STREAM_RESULTS) != 0 &&
+	    local_error == NULL &&
+	    self->n_pending_ops > 1 &&
+	    plugin_apps != NULL &&
+	    gs_app_list_length (plugin_apps) > 0) {
+		g_debug ("streaming %u results from plugin '%s'",
+			 gs_app_list_length (plugin_apps),
+			 gs_plugin_get_name (plugin));
+		self->n_pending_ops++;
+		process_list (task, plugin_apps, TRUE);
+	}
+
 	finish_op (task, g_steal_pointer (&local_error));
 }
 
+static gboolean
+plugin_deadline_expired_cb (gpointer user_data)
+{
+	PluginDeadlineData *deadline_data = user_data;
+	GsPluginJobListApps *self = g_task_get_source_object (deadline_data->task);
+
+	g_debug ("plugin '%s' took longer than %ums to list apps; carrying on without it",
+		 gs_plugin_get_name (deadline_data->plugin),
+		 gs_plugin_job_get_plugin_timeout (GS_PLUGIN_JOB (self)));
+
+	GS_PROFILER_ADD_MARK_TAKE (PluginJobListApps,
+				   self->begin_time_nsec,
+				   g_strdup_printf ("%s:%s:timeout",
+						    G_OBJECT_TYPE_NAME (self),
+						    gs_plugin_get_name (deadline_data->plugin)),
+				   NULL);
+
+	finish_op (deadline_data->task, NULL);
+
+	return G_SOURCE_REMOVE;
+}
+
 /* @error is (transfer full) if non-%NULL */
 static void
 finish_op (GTask  *task,
            GError *error)
 {
 	GsPluginJobListApps *self = g_task_get_source_object (task);
-	GCancellable *cancellable = g_task_get_cancellable (task);
-	GsPluginLoader *plugin_loader = g_task_get_task_data (task);
 	g_autoptr(GsAppList) merged_list = NULL;
-	GsPluginRefineFlags refine_flags = GS_PLUGIN_REFINE_FLAGS_NONE;
-	GsPluginRefineRequireFlags require_flags = GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE;
-	GsAppQueryLicenseType license_type = GS_APP_QUERY_LICENSE_ANY;
 	g_autoptr(GError) error_owned = g_steal_pointer (&error);
 
 	if (error_owned != NULL && self->saved_error == NULL)
@@ -396,11 +542,44 @@ finish_op (GTask  *task,
 		return;
 	}
 
+	process_list (task, merged_list, FALSE);
+}
+
+static void
+process_list (GTask     *task,
+              GsAppList *list,
+              gboolean   is_partial)
+{
+	GsPluginJobListApps *self = g_task_get_source_object (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	GsPluginLoader *plugin_loader = g_task_get_task_data (task);
+	g_autoptr(ProcessData) data = NULL;
+	GsPluginRefineFlags refine_flags = GS_PLUGIN_REFINE_FLAGS_NONE;
+	GsPluginRefineRequireFlags require_flags = GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE;
+	GsPluginRefineRequireFlags ranking_require_flags = GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE;
+	GsAppQueryLicenseType license_type = GS_APP_QUERY_LICENSE_ANY;
+	GsAppQueryDeveloperVerifiedType developer_verified_type = GS_APP_QUERY_DEVELOPER_VERIFIED_ANY;
+	GsAppListFilterFlags dedupe_flags = GS_APP_LIST_FILTER_FLAG_NONE;
+	guint max_results = 0;
+
+	data = g_new0 (ProcessData, 1);
+	data->task = g_object_ref (task);
+	data->is_partial = is_partial;
+
+	/* reuse the instances other jobs already returned, so that what was
+	 * refined on them is not refined again */
+	if (list != NULL)
+		gs_plugin_loader_share_apps (plugin_loader, list);
+
 	/* run refine() on each one if required */
 	if (self->query != NULL) {
 		refine_flags = gs_app_query_get_refine_flags (self->query);
 		require_flags = gs_app_query_get_refine_require_flags (self->query);
+		ranking_require_flags = gs_app_query_get_ranking_refine_require_flags (self->query);
 		license_type = gs_app_query_get_license_type (self->query);
+		developer_verified_type = gs_app_query_get_developer_verified_type (self->query);
+		dedupe_flags = gs_app_query_get_dedupe_flags (self->query);
+		max_results = gs_app_query_get_max_results (self->query);
 	}
 
 	if (!(require_flags & GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE) &&
@@ -418,21 +597,47 @@ finish_op (GTask  *task,
 	 * actually part of the refine job. */
 	require_flags &= ~GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON_CONTENT;
 
-	if (merged_list != NULL &&
-	    gs_app_list_length (merged_list) > 0 &&
+	/* If only some of the results are going to be returned, only refine
+	 * what’s needed to pick them for now, and refine the rest of the data
+	 * on the chosen ones later. */
+	if (ranking_require_flags != GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE &&
+	    max_results > 0 &&
+	    list != NULL &&
+	    gs_app_list_length (list) > max_results) {
+		GsPluginRefineRequireFlags phase_one_flags = ranking_require_flags | GS_PLUGIN_REFINE_REQUIRE_FLAGS_ID;
+
+		/* and what the built-in filters need */
+		if (license_type != GS_APP_QUERY_LICENSE_ANY)
+			phase_one_flags |= GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE;
+		if (developer_verified_type != GS_APP_QUERY_DEVELOPER_VERIFIED_ANY)
+			phase_one_flags |= GS_PLUGIN_REFINE_REQUIRE_FLAGS_DEVELOPER_NAME;
+		if (dedupe_flags & GS_APP_LIST_FILTER_FLAG_KEY_VERSION)
+			phase_one_flags |= GS_PLUGIN_REFINE_REQUIRE_FLAGS_VERSION;
+
+		if ((require_flags & ~phase_one_flags) != 0) {
+			g_debug ("refining %u results for ranking before truncating to %u",
+				 gs_app_list_length (list), max_results);
+			data->deferred_require_flags = require_flags;
+			require_flags = phase_one_flags;
+		}
+	}
+
+	if (list != NULL &&
+	    gs_app_list_length (list) > 0 &&
 	    require_flags != GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE) {
 		g_autoptr(GsPluginJob) refine_job = NULL;
 
-		refine_job = gs_plugin_job_refine_new (merged_list,
+		refine_job = gs_plugin_job_refine_new (list,
 						       refine_flags | GS_PLUGIN_REFINE_FLAGS_DISABLE_FILTERING,
 						       require_flags);
+		gs_plugin_job_set_plugin_timeout (refine_job, gs_plugin_job_get_plugin_timeout (GS_PLUGIN_JOB (self)));
 		gs_plugin_loader_job_process_async (plugin_loader, refine_job,
 						    cancellable,
 						    refine_cb,
-						    g_object_ref (task));
+						    g_steal_pointer (&data));
 	} else {
 		g_debug ("No apps to refine");
-		finish_task (task, merged_list);
+		finish_processing (g_steal_pointer (&data), list);
 	}
 }
 
@@ -442,28 +647,28 @@ refine_cb (GObject      *source_object,
            gpointer      user_data)
 {
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
-	g_autoptr(GTask) task = G_TASK (user_data);
-	GsPluginJobListApps *self = g_task_get_source_object (task);
+	g_autoptr(ProcessData) data = user_data;
 	g_autoptr(GsPluginJobRefine) refine_job = NULL;
 	g_autoptr(GError) local_error = NULL;
 
 	if (!gs_plugin_loader_job_process_finish (plugin_loader, result, (GsPluginJob **) &refine_job, &local_error)) {
 		gs_utils_error_convert_gio (&local_error);
-		g_task_return_error (task, g_steal_pointer (&local_error));
-		g_signal_emit_by_name (G_OBJECT (self), "completed");
+		finish_process_data (g_steal_pointer (&data), NULL, g_steal_pointer (&local_error));
 		return;
 	}
 
-	finish_task (task, gs_plugin_job_refine_get_result_list (refine_job));
+	finish_processing (g_steal_pointer (&data), gs_plugin_job_refine_get_result_list (refine_job));
 }
 
+/* @data is (transfer full) */
 static void
-finish_task (GTask     *task,
-             GsAppList *merged_list)
+finish_processing (ProcessData *data,
+                   GsAppList   *merged_list)
 {
+	GTask *task = data->task;
 	GsPluginJobListApps *self = g_task_get_source_object (task);
 	GsPluginLoader *plugin_loader = g_task_get_task_data (task);
-	GsPluginRefineRequireFlags refine_require_flags = GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE;
+	GsPluginRefineFlags refine_flags = GS_PLUGIN_REFINE_FLAGS_NONE;
 	GsAppListFilterFlags dedupe_flags = GS_APP_LIST_FILTER_FLAG_NONE;
 	GsAppListSortFunc sort_func = NULL;
 	gpointer sort_func_data = NULL;
@@ -474,8 +679,6 @@ finish_task (GTask     *task,
 	GsAppListFilterFunc filter_func = NULL;
 	gpointer filter_func_data = NULL;
 	guint max_results = 0;
-	gboolean interactive = FALSE;
-	g_autofree gchar *job_debug = NULL;
 
 	if (self->query != NULL) {
 		license_type = gs_app_query_get_license_type (self->query);
@@ -531,11 +734,8 @@ finish_task (GTask     *task,
 	}
 
 	/* Truncate the results if needed. */
-	if (self->query != NULL) {
+	if (self->query != NULL)
 		max_results = gs_app_query_get_max_results (self->query);
-		refine_require_flags = gs_app_query_get_refine_require_flags (self->query);
-		interactive = (gs_app_query_get_refine_flags (self->query) & GS_PLUGIN_REFINE_FLAGS_INTERACTIVE) != 0;
-	}
 
 	if (max_results > 0 && gs_app_list_length (merged_list) > max_results) {
 		g_debug ("truncating results from %u to %u",
@@ -543,12 +743,124 @@ finish_task (GTask     *task,
 		gs_app_list_truncate (merged_list, max_results);
 	}
 
+	/* Refine the rest of the data on the results which are left. */
+	if (data->deferred_require_flags != GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE &&
+	    gs_app_list_length (merged_list) > 0) {
+		GCancellable *cancellable = g_task_get_cancellable (task);
+		g_autoptr(GsPluginJob) refine_job = NULL;
+
+		refine_flags = gs_app_query_get_refine_flags (self->query);
+		refine_job = gs_plugin_job_refine_new (merged_list,
+						       refine_flags | GS_PLUGIN_REFINE_FLAGS_DISABLE_FILTERING,
+						       data->deferred_require_flags);
+		gs_plugin_job_set_plugin_timeout (refine_job, gs_plugin_job_get_plugin_timeout (GS_PLUGIN_JOB (self)));
+		gs_plugin_loader_job_process_async (plugin_loader, refine_job,
+						    cancellable,
+						    deferred_refine_cb,
+						    data);
+		return;
+	}
+
+	finish_process_data (data, merged_list, NULL);
+}
+
+static void
+deferred_refine_cb (GObject      *source_object,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
+	ProcessData *data = user_data;
+	g_autoptr(GsPluginJobRefine) refine_job = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	if (!gs_plugin_loader_job_process_finish (plugin_loader, result, (GsPluginJob **) &refine_job, &local_error)) {
+		gs_utils_error_convert_gio (&local_error);
+		finish_process_data (data, NULL, g_steal_pointer (&local_error));
+		return;
+	}
+
+	finish_process_data (data, gs_plugin_job_refine_get_result_list (refine_job), NULL);
+}
+
+/* @data and @error are (transfer full) */
+static void
+finish_process_data (ProcessData *data_owned,
+                     GsAppList   *list,
+                     GError      *error)
+{
+	g_autoptr(ProcessData) data = data_owned;
+	g_autoptr(GError) local_error = error;
+	GTask *task = data->task;
+	GsPluginJobListApps *self = g_task_get_source_object (task);
+
+	if (data->is_partial) {
+		/* A failure to process some partial results isn’t fatal, as
+		 * the same apps will be processed again with the rest. */
+		if (local_error != NULL)
+			g_debug ("Failed to process partial results: %s", local_error->message);
+		else if (gs_app_list_length (list) > 0)
+			emit_partial_results (task, list);
+
+		finish_op (task, NULL);
+		return;
+	}
+
+	if (local_error != NULL) {
+		g_task_return_error (task, g_steal_pointer (&local_error));
+		g_signal_emit_by_name (G_OBJECT (self), "completed");
+		return;
+	}
+
+	return_results (task, list);
+}
+
+static void
+queue_icons (GTask     *task,
+             GsAppList *list)
+{
+	GsPluginJobListApps *self = g_task_get_source_object (task);
+	GsPluginLoader *plugin_loader = g_task_get_task_data (task);
+	GsPluginRefineRequireFlags refine_require_flags = GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE;
+	gboolean interactive = FALSE;
+
+	if (self->query != NULL) {
+		refine_require_flags = gs_app_query_get_refine_require_flags (self->query);
+		interactive = (gs_app_query_get_refine_flags (self->query) & GS_PLUGIN_REFINE_FLAGS_INTERACTIVE) != 0;
+	}
+
 	/* ensure icons only on the truncated list */
 	if (refine_require_flags & GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON_CONTENT) {
 		GsIconDownloader *icon_downloader = gs_plugin_loader_get_icon_downloader (plugin_loader);
 		if (icon_downloader != NULL)
-			gs_icon_downloader_queue_app_list (icon_downloader, merged_list, interactive);
+			gs_icon_downloader_queue_app_list (icon_downloader, list, interactive);
 	}
+}
+
+static void
+emit_partial_results (GTask     *task,
+                      GsAppList *list)
+{
+	GsPluginJobListApps *self = g_task_get_source_object (task);
+
+	/* don’t bother if nobody wants them any more */
+	if (g_cancellable_is_cancelled (g_task_get_cancellable (task)))
+		return;
+
+	queue_icons (task, list);
+
+	g_debug ("%s: %u partial results", G_OBJECT_TYPE_NAME (self), gs_app_list_length (list));
+	g_signal_emit (self, signals[SIGNAL_PARTIAL_RESULTS], 0, list);
+}
+
+static void
+return_results (GTask     *task,
+                GsAppList *merged_list)
+{
+	GsPluginJobListApps *self = g_task_get_source_object (task);
+	g_autofree gchar *job_debug = NULL;
+
+	queue_icons (task, merged_list);
 
 	/* show elapsed time */
 	job_debug = gs_plugin_job_to_string (GS_PLUGIN_JOB (self));
@@ -627,6 +939,31 @@ gs_plugin_job_list_apps_class_init (GsPluginJobListAppsClass *klass)
 				    G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
 
 	g_object_class_install_properties (object_class, G_N_ELEMENTS (props), props);
+
+	/**
+	 * GsPluginJobListApps::partial-results:
+	 * @list: (not nullable): the apps from one of the plugins
+	 *
+	 * Emitted during #GsPluginJob.run_async() with the results from a
+	 * plugin, once they have been refined, filtered and sorted, if
+	 * %GS_PLUGIN_LIST_APPS_FLAGS_STREAM_RESULTS is set.
+	 *
+	 * The partial results from different plugins may overlap, and will
+	 * not match the final results of the job, which are computed once all
+	 * the plugins have returned. All partial results are emitted before
+	 * the job completes.
+	 *
+	 * It’s emitted in the thread which is running the #GMainContext which
+	 * was the thread-default context when #GsPluginJob.run_async() was
+	 * called.
+	 *
+	 * Since: 51
+	 */
+	signals[SIGNAL_PARTIAL_RESULTS] =
+		g_signal_new ("partial-results",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__OBJECT,
+			      G_TYPE_NONE, 1, GS_TYPE_APP_LIST);
 }
 
 static void
@@ -676,3 +1013,23 @@ gs_plugin_job_list_apps_get_result_list (GsPluginJobListApps *self)
 
 	return self->result_list;
 }
+
+/**
+ * gs_plugin_job_list_apps_set_result_list:
+ * @self: a #GsPluginJobListApps
+ * @list: the results to set
+ *
+ * Set the results of @self without running it. This is used by the
+ * #GsPluginLoader to serve the job from the #GsStartupSnapshot.
+ *
+ * Since: 51
+ */
+void
+gs_plugin_job_list_apps_set_result_list (GsPluginJobListApps *self,
+                                         GsAppList           *list)
+{
+	g_return_if_fail (GS_IS_PLUGIN_JOB_LIST_APPS (self));
+	g_return_if_fail (GS_IS_APP_LIST (list));
+
+	g_set_object (&self->result_list, list);
+}
@@ -270,6 +270,17 @@ category_sort_cb (gconstpointer a,
 				     gs_category_get_name (category_b));
 }
 
+static void
+sort_categories (GPtrArray *category_list)
+{
+	/* sort by name */
+	g_ptr_array_sort (category_list, category_sort_cb);
+	for (guint i = 0; i < category_list->len; i++) {
+		GsCategory *category = GS_CATEGORY (g_ptr_array_index (category_list, i));
+		gs_category_sort_children (category);
+	}
+}
+
 /* @error is (transfer full) if non-%NULL */
 static void
 finish_op (GTask  *task,
@@ -300,12 +311,7 @@ finish_op (GTask  *task,
 		return;
 	}
 
-	/* sort by name */
-	g_ptr_array_sort (category_list, category_sort_cb);
-	for (guint i = 0; i < category_list->len; i++) {
-		GsCategory *category = GS_CATEGORY (g_ptr_array_index (category_list, i));
-		gs_category_sort_children (category);
-	}
+	sort_categories (category_list);
 
 	/* show elapsed time */
 	job_debug = gs_plugin_job_to_string (GS_PLUGIN_JOB (self));
@@ -411,3 +417,27 @@ gs_plugin_job_list_categories_get_result_list (GsPluginJobListCategories *self)
 
 	return self->result_list;
 }
+
+/**
+ * gs_plugin_job_list_categories_set_result_list:
+ * @self: a #GsPluginJobListCategories
+ * @category_list: (element-type GsCategory): the results to set
+ *
+ * Set the results of @self without running it. They are sorted in the same
+ * way as the results of running the job. This is used by the
+ * #GsPluginLoader to serve the job from the #GsStartupSnapshot.
+ *
+ * Since: 51
+ */
+void
+gs_plugin_job_list_categories_set_result_list (GsPluginJobListCategories *self,
+                                               GPtrArray                 *category_list)
+{
+	g_return_if_fail (GS_IS_PLUGIN_JOB_LIST_CATEGORIES (self));
+	g_return_if_fail (category_list != NULL);
+
+	sort_categories (category_list);
+
+	g_clear_pointer (&self->result_list, g_ptr_array_unref);
+	self->result_list = g_ptr_array_ref (category_list);
+}
@@ -10,11 +10,34 @@
 
 #include <glib-object.h>
 
+#include "gs-app-list.h"
 #include "gs-plugin-job.h"
+#include "gs-plugin-job-list-apps.h"
+#include "gs-plugin-job-list-categories.h"
 
 G_BEGIN_DECLS
 
 gchar			*gs_plugin_job_to_string		(GsPluginJob	*self);
 void			 gs_plugin_job_cancel			(GsPluginJob	*self);
 
+typedef struct _GsPluginJobDeadline GsPluginJobDeadline;
+
+GsPluginJobDeadline	*gs_plugin_job_deadline_new		(guint		 timeout_ms,
+								 GCancellable	*parent_cancellable,
+								 GSourceFunc	 expired_func,
+								 gpointer	 user_data,
+								 GDestroyNotify	 user_data_free_func);
+GCancellable		*gs_plugin_job_deadline_get_cancellable	(GsPluginJobDeadline *deadline);
+gboolean		 gs_plugin_job_deadline_has_expired	(GsPluginJobDeadline *deadline);
+void			 gs_plugin_job_deadline_free		(GsPluginJobDeadline *deadline);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GsPluginJobDeadline, gs_plugin_job_deadline_free)
+
+void			 gs_plugin_job_list_apps_set_result_list
+								(GsPluginJobListApps	*self,
+								 GsAppList		*list);
+void			 gs_plugin_job_list_categories_set_result_list
+								(GsPluginJobListCategories *self,
+								 GPtrArray		*category_list);
+
 G_END_DECLS
@@ -34,8 +34,8 @@
  * into the job will not be modified.
  *
  * Internally, the #GsPluginClass.refine_async() functions are called on all
- * the plugins in series, and in series with calls to
- * gs_odrs_provider_refine_async() and gs_rewrite_resources_async().
+ * the plugins, followed by calls to gs_odrs_provider_refine_async() and
+ * gs_rewrite_resources_async() once they have all finished.
  * Once all of those calls are finished,
  * zero or more recursive calls to run_refine_internal_async() are made in
  * parallel to do a similar refine process on the addons, runtime and related
@@ -46,10 +46,62 @@
  * refer to locally cached resources, rather than HTTP/HTTPS URIs for images
  * (for example).
  *
- * FIXME: Ideally, the #GsPluginClass.refine_async() calls would happen in
- * parallel, but this cannot be the case until the results of the refine_async()
- * call in one plugin don’t depend on the results of refine_async() in another.
- * This still happens with several pairs of plugins.
+ * Once a refine completes successfully, the #GsPluginRefineRequireFlags it
+ * satisfied are recorded on each app using gs_app_add_refined_require_flags(),
+ * tagged with the plugin loader’s refine generation and the job flags which
+ * affect what a refine produces (such as
+ * %GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES). Each call to
+ * run_refine_internal_async() only passes the plugins the apps which still
+ * need some of the flags, with the union of the flags they still need, and
+ * skips the plugins entirely if no app needs anything. The generation is
+ * bumped by the plugin loader whenever the
+ * underlying data may have changed (for example, on `updates-changed` or
+ * `reload`), and an app forgets its refined flags when its state changes.
+ *
+ * The record is kept on the #GsApp instance rather than in a separate table
+ * keyed by unique ID, as there is no safe way to copy refined data from one
+ * instance onto another. It carries over between jobs because
+ * gs_plugin_loader_share_apps() swaps each new instance a plugin returns for
+ * the live instance already registered with the same unique ID and
+ * management plugin, if there is one, and that instance is the one which was
+ * refined.
+ *
+ * Building on that, if all the apps in a #GsPluginJobRefine are already being
+ * refined with the same #GsPluginRefineFlags and at least the same
+ * #GsPluginRefineRequireFlags by another job, the job waits for that one to
+ * finish (see gs_plugin_loader_begin_refine()), and the refine is then
+ * skipped, rather than running all the plugins on the same apps concurrently.
+ * If the job is cancelled while waiting, it stops waiting and returns
+ * %G_IO_ERROR_CANCELLED.
+ *
+ * If #GsPluginLoader:refine-batch-window is set, refines of a single app which
+ * arrive within that window of each other with the same flags are batched
+ * together (see gs_plugin_loader_add_to_refine_batch()), so each plugin is
+ * called once with all their apps rather than once per app. The results are
+ * then returned to each #GsPluginJobRefine separately.
+ *
+ * If a plugin timeout is set with gs_plugin_job_set_plugin_timeout(), each
+ * plugin’s refine_async() call is passed its own child #GCancellable from a
+ * #GsPluginJobDeadline. If the call takes longer than the timeout, that
+ * cancellable is cancelled and the refine carries on without the plugin, as if
+ * it had failed. As with any failure, the apps are then not marked as refined,
+ * so the missing data is looked up again next time.
+ *
+ * The plugin may not stop straight away, so the job can return while the call
+ * is still running. Once the call does finish, if it failed (typically because
+ * it was cancelled), the apps are refined again in the background, without a
+ * timeout; if it managed to succeed anyway, they are not. This is only done if
+ * the job’s main context is still iterated after the job has returned, which
+ * is not the case with gs_plugin_loader_job_process().
+ *
+ * The results of the refine_async() call in one plugin may depend on the
+ * results of refine_async() in another, so they are not all run in parallel.
+ * Instead, a dependency graph is built from the plugin order and the data each
+ * plugin declared with gs_plugin_set_refine_dependencies(), and each plugin is
+ * started as soon as all the plugins it depends on have finished. Plugins of
+ * the same order never depend on each other. A plugin which has not declared
+ * its dependencies depends on all the plugins ordered before it, and all the
+ * plugins ordered after it depend on it, as if all plugins were run in order.
  *
  * ```
  *                                    run_async()
@@ -230,6 +282,120 @@ app_is_non_wildcard (GsApp *app, gpointer user_data)
 	return !gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD);
 }
 
+/* Data which can change without the plugin loader’s refine generation being
+ * bumped, so must always be refreshed when requested. */
+#define REFINE_UNCACHEABLE_REQUIRE_FLAGS (GS_PLUGIN_REFINE_REQUIRE_FLAGS_SIZE_DATA | \
+					  GS_PLUGIN_REFINE_REQUIRE_FLAGS_REVIEWS)
+
+/* Job flags which change what a refine produces, so refined data is only
+ * reused by refines with the same ones. */
+#define REFINE_RESULT_JOB_FLAGS (GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES | \
+				 GS_PLUGIN_REFINE_FLAGS_ALLOW_REPOSITORIES | \
+				 GS_PLUGIN_REFINE_FLAGS_DISABLE_FILTERING)
+
+/* Work out which of @require_flags still need refining for the apps in @list,
+ * and add the apps which need any of them to @out_list, if it’s non-%NULL. */
+static GsPluginRefineRequireFlags
+get_unsatisfied_require_flags (GsAppList                  *list,
+                               GsPluginRefineFlags         job_flags,
+                               GsPluginRefineRequireFlags  require_flags,
+                               guint                       generation,
+                               GsAppList                  *out_list)
+{
+	GsPluginRefineRequireFlags unsatisfied = GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE;
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		GsPluginRefineRequireFlags satisfied;
+		GsPluginRefineRequireFlags app_unsatisfied;
+
+		satisfied = gs_app_get_refined_require_flags (app, job_flags & REFINE_RESULT_JOB_FLAGS, generation);
+		satisfied &= ~REFINE_UNCACHEABLE_REQUIRE_FLAGS;
+		app_unsatisfied = require_flags & ~satisfied;
+
+		if (app_unsatisfied == 0)
+			continue;
+
+		unsatisfied |= app_unsatisfied;
+		if (out_list == NULL)
+			break;
+		gs_app_list_add (out_list, app);
+	}
+
+	return unsatisfied;
+}
+
+typedef struct {
+	GsAppList *result_list; /* (owned) */
+	GsPluginLoader *plugin_loader; /* (owned) */
+	GPtrArray *claimed_apps;  /* (owned) (element-type GsApp) apps this job is refining on behalf of others */
+	guint n_pending_waits;
+	gulong wait_cancelled_id;  /* connected to the task’s cancellable while waiting */
+	gboolean wait_cancelled;
+} RefineData;
+
+static RefineData *
+refine_data_new (GsAppList *result_list, /* (transfer none) */
+		 GsPluginLoader *plugin_loader) /* (transfer none) */
+{
+	RefineData *data;
+
+	data = g_new0 (RefineData, 1);
+	data->result_list = gs_app_list_copy (result_list);
+	data->plugin_loader = g_object_ref (plugin_loader);
+	data->claimed_apps = g_ptr_array_new_with_free_func (g_object_unref);
+
+	return data;
+}
+
+static void
+refine_data_free (gpointer ptr)
+{
+	RefineData *data = ptr;
+
+	g_assert (data->claimed_apps->len == 0);
+
+	g_clear_object (&data->result_list);
+	g_clear_object (&data->plugin_loader);
+	g_ptr_array_unref (data->claimed_apps);
+	g_free (data);
+}
+
+/* Unlike gs_app_list_lookup(), this compares instances rather than unique IDs. */
+static gboolean
+app_list_has_instance (GsAppList *list,
+                       GsApp     *app)
+{
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		if (gs_app_list_index (list, i) == app)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* The refines of single apps batched together by run_batch_cb(). */
+typedef struct {
+	GPtrArray *tasks;  /* (owned) (element-type GTask) */
+	GCancellable *cancellable;  /* (owned) */
+	GArray *cancelled_ids;  /* (owned) (element-type gulong) */
+	gint n_uncancelled;  /* (atomic) */
+	guint plugin_timeout_ms;  /* shortest of the jobs’ plugin timeouts, or 0 */
+	guint n_pending_lists;
+	GError *error;  /* (owned) (nullable) */
+} RefineBatchData;
+
+static void
+refine_batch_data_free (RefineBatchData *data)
+{
+	g_ptr_array_unref (data->tasks);
+	g_object_unref (data->cancellable);
+	g_array_unref (data->cancelled_ids);
+	g_clear_error (&data->error);
+	g_free (data);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RefineBatchData, refine_batch_data_free)
+
 static void plugin_event_cb (GsPlugin      *plugin,
                              GsPluginEvent *event,
                              void          *user_data);
@@ -253,21 +419,37 @@ static gboolean run_refine_internal_finish (GsPluginJobRefine  *self,
                                             GAsyncResult       *result,
                                             GError            **error);
 
+typedef enum {
+	PLUGIN_STATE_WAITING,
+	PLUGIN_STATE_RUNNING,
+	PLUGIN_STATE_DONE,
+} PluginState;
+
 typedef struct {
 	/* Input data. */
 	GsPluginLoader *plugin_loader;  /* (not nullable) (owned) */
 	GsAppList *list;  /* (not nullable) (owned) */
+	GsAppList *plugin_list;  /* (not nullable) (owned) apps from @list which still need some of @require_flags; may be @list */
 	GsPluginRefineFlags job_flags;
 	GsPluginRefineRequireFlags require_flags;
+	GsPluginRefineRequireFlags plugin_require_flags;  /* subset of @require_flags not yet refined for the apps in @plugin_list */
+	guint refine_generation;
+	RefineBatchData *batch;  /* (nullable) (unowned); set when refining a batch, which outlives this */
+	guint plugin_timeout_ms;
 
 	/* In-progress data. */
+	gboolean incomplete;  /* set if a sub-operation failed */
 	guint n_pending_ops;
 	guint n_pending_recursions;
-	guint next_plugin_index;
-	guint next_plugin_order;
+	GPtrArray *plugins;  /* (owned) (nullable) (element-type GsPlugin) plugins to call refine_async() on */
+	gboolean *plugin_depends;  /* (owned) (nullable) (array) plugins->len × plugins->len; [i * len + j] is set if plugin i waits for plugin j */
+	PluginState *plugin_states;  /* (owned) (nullable) (array length=plugins->len) */
+	GsPluginJobDeadline **plugin_deadlines;  /* (owned) (nullable) (array length=plugins->len) (element-type GsPluginJobDeadline) entries are NULL if there’s no timeout */
+	gboolean post_plugin_ops_started;
+	gint64 *plugin_begin_times_usec;  /* (owned) (nullable) (array length=plugins->len) */
 
 #ifdef HAVE_SYSPROF
-	gint64 plugin_begin_time_nsec;
+	gint64 *plugin_begin_times_nsec;  /* (owned) (nullable) (array length=plugins->len) */
 #endif
 
 	/* Output data. */
@@ -279,6 +461,17 @@ refine_internal_data_free (RefineInternalData *data)
 {
 	g_clear_object (&data->plugin_loader);
 	g_clear_object (&data->list);
+	g_clear_object (&data->plugin_list);
+	for (guint i = 0; data->plugin_deadlines != NULL && i < data->plugins->len; i++)
+		g_clear_pointer (&data->plugin_deadlines[i], gs_plugin_job_deadline_free);
+	g_free (data->plugin_deadlines);
+	g_clear_pointer (&data->plugins, g_ptr_array_unref);
+	g_free (data->plugin_depends);
+	g_free (data->plugin_states);
+	g_free (data->plugin_begin_times_usec);
+#ifdef HAVE_SYSPROF
+	g_free (data->plugin_begin_times_nsec);
+#endif
 
 	g_assert (data->n_pending_ops == 0);
 	g_assert (data->n_pending_recursions == 0);
@@ -292,21 +485,160 @@ refine_internal_data_free (RefineInternalData *data)
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (RefineInternalData, refine_internal_data_free)
 
+/* Whether @plugin has to wait for @other to finish refining before starting. */
+static gboolean
+plugin_refine_depends_on (GsPlugin *plugin,
+                          GsPlugin *other)
+{
+	GsPluginRefineRequireFlags reads, provides, other_reads, other_provides;
+
+	/* plugins of the same order have never waited for each other */
+	if (gs_plugin_get_order (other) >= gs_plugin_get_order (plugin))
+		return FALSE;
+
+	/* without a declaration, keep the order */
+	if (!gs_plugin_get_refine_dependencies (plugin, &reads, &provides) ||
+	    !gs_plugin_get_refine_dependencies (other, &other_reads, &other_provides))
+		return TRUE;
+
+	return ((reads & other_provides) != 0 ||
+		(provides & other_reads) != 0 ||
+		(provides & other_provides) != 0);
+}
+
+/* Work out which plugins to run, and which of them have to wait for which
+ * others. */
+static void
+build_plugin_graph (RefineInternalData *data)
+{
+	GPtrArray *plugins = gs_plugin_loader_get_plugins (data->plugin_loader);
+	guint n_plugins;
+
+	data->plugins = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (guint i = 0; i < plugins->len; i++) {
+		GsPlugin *plugin = g_ptr_array_index (plugins, i);
+		GsPluginClass *plugin_class = GS_PLUGIN_GET_CLASS (plugin);
+
+		if (!gs_plugin_get_enabled (plugin))
+			continue;
+		if (plugin_class->refine_async == NULL)
+			continue;
+
+		g_ptr_array_add (data->plugins, g_object_ref (plugin));
+	}
+
+	n_plugins = data->plugins->len;
+	data->plugin_depends = g_new0 (gboolean, n_plugins * n_plugins);
+	data->plugin_states = g_new0 (PluginState, n_plugins);
+	data->plugin_deadlines = g_new0 (GsPluginJobDeadline *, n_plugins);
+	data->plugin_begin_times_usec = g_new0 (gint64, n_plugins);
+#ifdef HAVE_SYSPROF
+	data->plugin_begin_times_nsec = g_new0 (gint64, n_plugins);
+#endif
+
+	for (guint i = 0; i < n_plugins; i++) {
+		for (guint j = 0; j < n_plugins; j++) {
+			data->plugin_depends[i * n_plugins + j] =
+				plugin_refine_depends_on (g_ptr_array_index (data->plugins, i),
+							  g_ptr_array_index (data->plugins, j));
+		}
+	}
+}
+
+typedef struct {
+	GTask *task;  /* (owned) */
+	guint plugin_index;
+} PluginDeadlineData;
+
+static void
+plugin_deadline_data_free (PluginDeadlineData *deadline_data)
+{
+	g_object_unref (deadline_data->task);
+	g_free (deadline_data);
+}
+
+static gboolean plugin_deadline_expired_cb (gpointer user_data);
+
+/* Start refining with every plugin which is waiting and whose dependencies
+ * have all finished. */
+static gboolean
+start_ready_plugins (GTask   *task,
+                     GError **error)
+{
+	GsPluginJobRefine *self = g_task_get_source_object (task);
+	RefineInternalData *data = g_task_get_task_data (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	guint n_plugins = data->plugins->len;
+	guint timeout_ms = data->plugin_timeout_ms;
+
+	for (guint i = 0; i < n_plugins; i++) {
+		GsPlugin *plugin = g_ptr_array_index (data->plugins, i);
+		GsPluginClass *plugin_class = GS_PLUGIN_GET_CLASS (plugin);
+		gboolean ready = TRUE;
+
+		if (data->plugin_states[i] != PLUGIN_STATE_WAITING)
+			continue;
+
+		for (guint j = 0; j < n_plugins && ready; j++) {
+			if (data->plugin_depends[i * n_plugins + j] &&
+			    data->plugin_states[j] != PLUGIN_STATE_DONE)
+				ready = FALSE;
+		}
+
+		if (!ready)
+			continue;
+
+		/* Handle cancellation */
+		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+			return FALSE;
+
+		data->plugin_states[i] = PLUGIN_STATE_RUNNING;
+		data->plugin_begin_times_usec[i] = g_get_monotonic_time ();
+#ifdef HAVE_SYSPROF
+		data->plugin_begin_times_nsec[i] = SYSPROF_CAPTURE_CURRENT_TIME;
+#endif
+
+		/* don’t let the plugin hold up the refine for longer than allowed */
+		if (timeout_ms > 0) {
+			PluginDeadlineData *deadline_data = g_new0 (PluginDeadlineData, 1);
+			deadline_data->task = g_object_ref (task);
+			deadline_data->plugin_index = i;
+
+			data->plugin_deadlines[i] = gs_plugin_job_deadline_new (timeout_ms, cancellable,
+										plugin_deadline_expired_cb,
+										deadline_data,
+										(GDestroyNotify) plugin_deadline_data_free);
+		}
+
+		/* run the batched plugin symbol */
+		data->n_pending_ops++;
+		plugin_class->refine_async (plugin, data->plugin_list, data->job_flags,
+					    data->plugin_require_flags,
+					    plugin_event_cb, task,
+					    (data->plugin_deadlines[i] != NULL) ?
+						gs_plugin_job_deadline_get_cancellable (data->plugin_deadlines[i]) :
+						cancellable,
+					    plugin_refine_cb, g_object_ref (task));
+	}
+
+	return TRUE;
+}
+
 static void
 run_refine_internal_async (GsPluginJobRefine          *self,
                            GsPluginLoader             *plugin_loader,
                            GsAppList                  *list,
                            GsPluginRefineFlags         job_flags,
                            GsPluginRefineRequireFlags  require_flags,
+                           RefineBatchData            *batch,
                            GCancellable               *cancellable,
                            GAsyncReadyCallback         callback,
                            gpointer                    user_data)
 {
-	GPtrArray *plugins;  /* (element-type GsPlugin) */
 	g_autoptr(GTask) task = NULL;
 	RefineInternalData *data;
 	g_autoptr(RefineInternalData) data_owned = NULL;
-	gboolean anything_ran = FALSE;
 	g_autoptr(GError) local_error = NULL;
 
 	task = g_task_new (self, cancellable, callback, user_data);
@@ -317,68 +649,59 @@ run_refine_internal_async (GsPluginJobRefine          *self,
 	data->list = g_object_ref (list);
 	data->job_flags = job_flags;
 	data->require_flags = require_flags;
-#ifdef HAVE_SYSPROF
-	data->plugin_begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	data->refine_generation = gs_plugin_loader_get_refine_generation (plugin_loader);
+	data->batch = batch;
+	data->plugin_timeout_ms = (batch != NULL) ? batch->plugin_timeout_ms :
+				  gs_plugin_job_get_plugin_timeout (GS_PLUGIN_JOB (self));
+	data->plugin_list = gs_app_list_new ();
+	data->plugin_require_flags = get_unsatisfied_require_flags (list, job_flags, require_flags,
+								    data->refine_generation,
+								    data->plugin_list);
+
+	/* refine the list itself if every app needs it (or nothing specific is
+	 * required), to save copying the apps added to it by the plugins when
+	 * resolving wildcards */
+	if (require_flags == 0 ||
+	    gs_app_list_length (data->plugin_list) == gs_app_list_length (list))
+		g_set_object (&data->plugin_list, list);
 	g_task_set_task_data (task, g_steal_pointer (&data_owned), (GDestroyNotify) refine_internal_data_free);
 
 	/* try to adopt each app with a plugin */
-	gs_plugin_loader_run_adopt (plugin_loader, list);
+	if (!gs_plugin_loader_run_adopt_full (plugin_loader, list, cancellable, &local_error)) {
+		g_task_return_error (task, g_steal_pointer (&local_error));
+		return;
+	}
 
 	data->n_pending_ops = 0;
-	data->next_plugin_order = 0;
 
-	/* run each plugin
-	 *
-	 * FIXME: For now, we have to run these vfuncs sequentially rather than
-	 * all in parallel. This is because there are still dependencies between
-	 * some of the plugins, where the code to refine an app in one plugin
-	 * depends on the results of refining it in another plugin first.
-	 *
-	 * Eventually, the plugins should all be changed/removed so that they
-	 * can operate independently. At that point, this code can be reverted
-	 * so that the refine_async() vfuncs are called in parallel. */
-	plugins = gs_plugin_loader_get_plugins (plugin_loader);
-
-	for (guint i = 0; i < plugins->len; i++) {
-		GsPlugin *plugin = g_ptr_array_index (plugins, i);
-		GsPluginClass *plugin_class = GS_PLUGIN_GET_CLASS (plugin);
-
-		if (gs_plugin_get_order (plugin) > data->next_plugin_order) {
-			if (!anything_ran)
-				data->next_plugin_order = gs_plugin_get_order (plugin);
-			else
-				return;
-		}
-
-		if (!gs_plugin_get_enabled (plugin))
-			continue;
-		if (plugin_class->refine_async == NULL)
-			continue;
-
-		/* at least one plugin supports this vfunc */
-		anything_ran = TRUE;
-
-		/* Handle cancellation */
-		if (g_cancellable_set_error_if_cancelled (cancellable, &local_error))
-			break;
-
-		/* FIXME: The next refine_async() call is made in
-		 * finish_refine_internal_op(). */
-		data->next_plugin_index = i + 1;
-
-		/* run the batched plugin symbol */
+	/* Everything has already been refined for all the apps, so skip the
+	 * plugins, ODRS and resource rewriting, and go straight to the
+	 * recursive refines (which do their own checks). Otherwise, only the
+	 * apps in @plugin_list are passed to them. */
+	if (require_flags != 0 && data->plugin_require_flags == 0) {
+		g_autofree gchar *require_flags_str = gs_plugin_refine_require_flags_to_string (require_flags);
+		g_debug ("skipping refine of %u apps, already refined with %s",
+			 gs_app_list_length (list), require_flags_str);
+		data->post_plugin_ops_started = TRUE;
 		data->n_pending_ops++;
-		plugin_class->refine_async (plugin, list, job_flags, require_flags,
-					    plugin_event_cb, task,
-					    cancellable, plugin_refine_cb, g_object_ref (task));
+		finish_refine_internal_op (task, NULL);
+		return;
+	} else if (data->plugin_list != list) {
+		g_debug ("skipping refine of %u of %u apps, already refined",
+			 gs_app_list_length (list) - gs_app_list_length (data->plugin_list),
+			 gs_app_list_length (list));
 	}
 
-	if (!anything_ran) {
+	/* run each plugin, as soon as the plugins it depends on are done */
+	build_plugin_graph (data);
+
+	if (data->plugins->len == 0) {
 		g_set_error_literal (&local_error,
 				     GS_PLUGIN_ERROR,
 				     GS_PLUGIN_ERROR_NOT_SUPPORTED,
 				     "no plugin could handle refining apps");
+	} else {
+		start_ready_plugins (task, &local_error);
 	}
 
 	data->n_pending_ops++;
@@ -391,9 +714,50 @@ plugin_event_cb (GsPlugin      *plugin,
                  void          *user_data)
 {
 	GTask *task = G_TASK (user_data);
+	RefineInternalData *data = g_task_get_task_data (task);
 	GsPluginJob *plugin_job = g_task_get_source_object (task);
+	GsApp *app = gs_plugin_event_get_app (event);
+	gboolean emitted = FALSE;
 
-	gs_plugin_job_emit_event (plugin_job, plugin, event);
+	if (data->batch == NULL) {
+		gs_plugin_job_emit_event (plugin_job, plugin, event);
+		return;
+	}
+
+	/* Send events about an app to the batched jobs which are refining it;
+	 * anything else (such as an event about a related app) could have
+	 * come from any of them, so goes to all of them. */
+	for (guint i = 0; app != NULL && i < data->batch->tasks->len; i++) {
+		GTask *batch_task = g_ptr_array_index (data->batch->tasks, i);
+		RefineData *refine_data = g_task_get_task_data (batch_task);
+
+		if (app_list_has_instance (refine_data->result_list, app)) {
+			gs_plugin_job_emit_event (g_task_get_source_object (batch_task), plugin, event);
+			emitted = TRUE;
+		}
+	}
+
+	for (guint i = 0; !emitted && i < data->batch->tasks->len; i++) {
+		GTask *batch_task = g_ptr_array_index (data->batch->tasks, i);
+		gs_plugin_job_emit_event (g_task_get_source_object (batch_task), plugin, event);
+	}
+}
+
+/* Refine the apps a plugin timed out on again, in the background and without
+ * a timeout, so they get their data eventually. The caller is notified
+ * through the #GsApp properties changing. */
+static void
+retry_timed_out_refine (RefineInternalData *data)
+{
+	g_autoptr(GsPluginJob) retry_job = NULL;
+
+	g_debug ("refining %u apps again after a plugin timed out",
+		 gs_app_list_length (data->plugin_list));
+	retry_job = gs_plugin_job_refine_new (data->plugin_list,
+					      data->job_flags & ~GS_PLUGIN_REFINE_FLAGS_INTERACTIVE,
+					      data->plugin_require_flags);
+	gs_plugin_loader_job_process_async (data->plugin_loader, retry_job,
+					    NULL, NULL, NULL);
 }
 
 static void
@@ -405,13 +769,39 @@ plugin_refine_cb (GObject      *source_object,
 	g_autoptr(GTask) task = g_steal_pointer (&user_data);
 	GsPluginClass *plugin_class = GS_PLUGIN_GET_CLASS (plugin);
 	g_autoptr(GError) local_error = NULL;
+	g_autoptr(GError) start_error = NULL;
+	RefineInternalData *data = g_task_get_task_data (task);
+	guint plugin_index;
 #ifdef HAVE_SYSPROF
 	GsPluginJobRefine *self = g_task_get_source_object (task);
-	RefineInternalData *data = g_task_get_task_data (task);
 #endif
 
+	if (!g_ptr_array_find (data->plugins, plugin, &plugin_index))
+		g_assert_not_reached ();
+
+	gs_plugin_add_latency (plugin, "refine", g_get_monotonic_time () - data->plugin_begin_times_usec[plugin_index]);
+
+	/* The refine has already carried on without this plugin, and its call
+	 * was cancelled. Now that it has finished, refine the apps again if it
+	 * didn’t manage to; doing so any earlier would run the plugin on the
+	 * same apps twice at once. */
+	if (data->plugin_deadlines[plugin_index] != NULL &&
+	    gs_plugin_job_deadline_has_expired (data->plugin_deadlines[plugin_index])) {
+		if (plugin_class->refine_finish (plugin, result, &local_error)) {
+			g_debug ("plugin '%s' finished refining apps after its deadline",
+				 gs_plugin_get_name (plugin));
+		} else {
+			g_debug ("plugin '%s' stopped refining apps after its deadline: %s",
+				 gs_plugin_get_name (plugin), local_error->message);
+			retry_timed_out_refine (data);
+		}
+		return;
+	}
+
+	g_clear_pointer (&data->plugin_deadlines[plugin_index], gs_plugin_job_deadline_free);
+
 	GS_PROFILER_ADD_MARK_TAKE (PluginJobRefine,
-				   data->plugin_begin_time_nsec,
+				   data->plugin_begin_times_nsec[plugin_index],
 				   g_strdup_printf ("%s:%s",
 						    G_OBJECT_TYPE_NAME (self),
 						    gs_plugin_get_name (plugin)),
@@ -424,9 +814,55 @@ plugin_refine_cb (GObject      *source_object,
 			 gs_plugin_get_name (plugin),
 			 local_error->message);
 		g_clear_error (&local_error);
+		data->incomplete = TRUE;
 	}
 
-	finish_refine_internal_op (task, NULL);
+	/* start any plugins which were waiting for this one */
+	data->plugin_states[plugin_index] = PLUGIN_STATE_DONE;
+	if (data->error == NULL)
+		start_ready_plugins (task, &start_error);
+
+	finish_refine_internal_op (task, g_steal_pointer (&start_error));
+}
+
+/* Called once the plugin’s deadline has passed, after its cancellable has
+ * been cancelled. */
+static gboolean
+plugin_deadline_expired_cb (gpointer user_data)
+{
+	PluginDeadlineData *deadline_data = user_data;
+	GTask *task = deadline_data->task;
+	RefineInternalData *data = g_task_get_task_data (task);
+	GsPlugin *plugin = g_ptr_array_index (data->plugins, deadline_data->plugin_index);
+	GsPluginJob *self = g_task_get_source_object (task);
+	g_autoptr(GError) start_error = NULL;
+
+	g_assert (data->plugin_states[deadline_data->plugin_index] == PLUGIN_STATE_RUNNING);
+
+	g_debug ("plugin '%s' took longer than %ums to refine %u apps; carrying on without it",
+		 gs_plugin_get_name (plugin),
+		 data->plugin_timeout_ms,
+		 gs_app_list_length (data->list));
+
+	GS_PROFILER_ADD_MARK_TAKE (PluginJobRefine,
+				   data->plugin_begin_times_nsec[deadline_data->plugin_index],
+				   g_strdup_printf ("%s:%s:timeout",
+						    G_OBJECT_TYPE_NAME (self),
+						    gs_plugin_get_name (plugin)),
+				   NULL);
+
+	/* treat it as a failure, so the apps aren’t marked as refined;
+	 * plugin_refine_cb() refines them again once the call has finished */
+	data->incomplete = TRUE;
+
+	/* start any plugins which were waiting for this one */
+	data->plugin_states[deadline_data->plugin_index] = PLUGIN_STATE_DONE;
+	if (data->error == NULL)
+		start_ready_plugins (task, &start_error);
+
+	finish_refine_internal_op (task, g_steal_pointer (&start_error));
+
+	return G_SOURCE_REMOVE;
 }
 
 static void
@@ -436,6 +872,7 @@ odrs_provider_refine_cb (GObject      *source_object,
 {
 	GsOdrsProvider *odrs_provider = GS_ODRS_PROVIDER (source_object);
 	g_autoptr(GTask) task = g_steal_pointer (&user_data);
+	RefineInternalData *data = g_task_get_task_data (task);
 	g_autoptr(GError) local_error = NULL;
 
 	if (!gs_odrs_provider_refine_finish (odrs_provider, result, &local_error) &&
@@ -444,6 +881,7 @@ odrs_provider_refine_cb (GObject      *source_object,
 		g_debug ("ODRS provider failed to refine apps: %s",
 			 local_error->message);
 		g_clear_error (&local_error);
+		data->incomplete = TRUE;
 	}
 	finish_refine_internal_op (task, g_steal_pointer (&local_error));
 }
@@ -454,6 +892,7 @@ rewrite_resources_cb (GObject      *source_object,
                       gpointer      user_data)
 {
 	g_autoptr(GTask) task = g_steal_pointer (&user_data);
+	RefineInternalData *data = g_task_get_task_data (task);
 	g_autoptr(GError) local_error = NULL;
 
 	if (!gs_rewrite_resources_finish (result, &local_error) &&
@@ -462,6 +901,7 @@ rewrite_resources_cb (GObject      *source_object,
 		g_debug ("Rewriting resources failed when refine apps: %s",
 			 local_error->message);
 		g_clear_error (&local_error);
+		data->incomplete = TRUE;
 	}
 	finish_refine_internal_op (task, g_steal_pointer (&local_error));
 }
@@ -479,9 +919,9 @@ finish_refine_internal_op (GTask  *task,
 	GsAppList *list = data->list;
 	GsPluginRefineFlags job_flags = data->job_flags;
 	GsPluginRefineRequireFlags require_flags = data->require_flags;
+	GsPluginRefineRequireFlags plugin_require_flags = data->plugin_require_flags;
 	GsOdrsProvider *odrs_provider;
-	GPtrArray *plugins;  /* (element-type GsPlugin) */
-	gboolean anything_ran = FALSE;
+	g_autoptr(GError) local_error = NULL;
 
 	if (data->error == NULL && error_owned != NULL) {
 		data->error = g_steal_pointer (&error_owned);
@@ -492,75 +932,35 @@ finish_refine_internal_op (GTask  *task,
 	g_assert (data->n_pending_ops > 0);
 	data->n_pending_ops--;
 
-#ifdef HAVE_SYSPROF
-	data->plugin_begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
-
 	if (data->n_pending_ops > 0)
 		return;
 
-	/* We reach this line after all plugins of a certain order ran, and now
-	 * we need to run the next set of plugins. */
-	data->next_plugin_order++;
-
-	plugins = gs_plugin_loader_get_plugins (plugin_loader);
-
-	for (guint i = data->next_plugin_index; i < plugins->len; i++) {
-		GsPlugin *plugin = g_ptr_array_index (plugins, i);
-		GsPluginClass *plugin_class = GS_PLUGIN_GET_CLASS (plugin);
-
-		if (gs_plugin_get_order (plugin) > data->next_plugin_order) {
-			if (!anything_ran)
-				data->next_plugin_order = gs_plugin_get_order (plugin);
-			else
-				return;
-		}
-
-		if (!gs_plugin_get_enabled (plugin))
-			continue;
-		if (plugin_class->refine_async == NULL)
-			continue;
-		if (gs_plugin_get_order (plugin) < data->next_plugin_order)
-			continue;
-
-		/* at least one plugin supports this vfunc */
-		anything_ran = TRUE;
-
-		/* FIXME: The next refine_async() call is made in
-		 * finish_refine_internal_op(). */
-		data->next_plugin_index = i + 1;
-
-		/* run the batched plugin symbol */
-		data->n_pending_ops++;
-		plugin_class->refine_async (plugin, list, job_flags, require_flags,
-					    plugin_event_cb, task,
-					    cancellable, plugin_refine_cb, g_object_ref (task));
-	}
-
-	if (data->next_plugin_index == plugins->len) {
+	/* We reach this line after all the plugins have finished (or, on
+	 * error, after the ones which were started have finished). */
+	if (!data->post_plugin_ops_started && data->error == NULL) {
 		GsOdrsProviderRefineFlags odrs_refine_flags = 0;
 
 		/* Avoid the ODRS and rewrite refines being run multiple times. */
-		data->next_plugin_index++;
+		data->post_plugin_ops_started = TRUE;
 
 		/* Add ODRS data if needed */
 		odrs_provider = gs_plugin_loader_get_odrs_provider (plugin_loader);
 
-		if ((require_flags & GS_PLUGIN_REFINE_REQUIRE_FLAGS_REVIEWS) != 0)
+		if ((plugin_require_flags & GS_PLUGIN_REFINE_REQUIRE_FLAGS_REVIEWS) != 0)
 			odrs_refine_flags |= GS_ODRS_PROVIDER_REFINE_FLAGS_GET_REVIEWS;
-		if ((require_flags & (GS_PLUGIN_REFINE_REQUIRE_FLAGS_REVIEW_RATINGS |
-				      GS_PLUGIN_REFINE_REQUIRE_FLAGS_RATING)) != 0)
+		if ((plugin_require_flags & (GS_PLUGIN_REFINE_REQUIRE_FLAGS_REVIEW_RATINGS |
+					     GS_PLUGIN_REFINE_REQUIRE_FLAGS_RATING)) != 0)
 			odrs_refine_flags |= GS_ODRS_PROVIDER_REFINE_FLAGS_GET_RATINGS;
 
 		if (odrs_provider != NULL && odrs_refine_flags != 0) {
 			data->n_pending_ops++;
-			gs_odrs_provider_refine_async (odrs_provider, list, odrs_refine_flags,
+			gs_odrs_provider_refine_async (odrs_provider, data->plugin_list, odrs_refine_flags,
 						       cancellable, odrs_provider_refine_cb, g_object_ref (task));
 		}
 
 		/* Rewrite app CSS if needed. */
 		data->n_pending_ops++;
-		gs_rewrite_resources_async (list, cancellable, rewrite_resources_cb, g_object_ref (task));
+		gs_rewrite_resources_async (data->plugin_list, cancellable, rewrite_resources_cb, g_object_ref (task));
 	}
 
 	if (data->n_pending_ops > 0)
@@ -576,12 +976,33 @@ finish_refine_internal_op (GTask  *task,
 		return;
 	}
 
+	/* the plugins may have resolved wildcards in @plugin_list into new
+	 * apps, which belong in the results too */
+	if (data->plugin_list != list)
+		gs_app_list_add_list (list, data->plugin_list);
+
 	/* filter any wildcard apps left in the list */
 	gs_app_list_filter (list, app_is_non_wildcard, NULL);
+	if (data->plugin_list != list)
+		gs_app_list_filter (data->plugin_list, app_is_non_wildcard, NULL);
 
 	/* try to adopt each app with a plugin also after refine, in case
 	   the plugins expect properties set by the refine itself */
-	gs_plugin_loader_run_adopt (plugin_loader, list);
+	if (!gs_plugin_loader_run_adopt_full (plugin_loader, list, cancellable, &local_error)) {
+		g_task_return_error (task, g_steal_pointer (&local_error));
+		return;
+	}
+
+	/* remember what has been refined, so it can be skipped next time;
+	 * a cancelled or partly failed refine may not have set everything */
+	if (!data->incomplete && !g_cancellable_is_cancelled (cancellable)) {
+		for (guint i = 0; i < gs_app_list_length (data->plugin_list); i++) {
+			GsApp *app = gs_app_list_index (data->plugin_list, i);
+			gs_app_add_refined_require_flags (app, plugin_require_flags,
+							  job_flags & REFINE_RESULT_JOB_FLAGS,
+							  data->refine_generation);
+		}
+	}
 
 	/* Now run several recursive calls to run_refine_internal_async() in
 	 * parallel, to refine related components. */
@@ -613,7 +1034,7 @@ finish_refine_internal_op (GTask  *task,
 			data->n_pending_recursions++;
 			run_refine_internal_async (self, plugin_loader,
 						   addons_list, job_flags, addons_flags,
-						   cancellable, recursive_internal_refine_cb,
+						   data->batch, cancellable, recursive_internal_refine_cb,
 						   g_object_ref (task));
 		}
 	}
@@ -637,7 +1058,7 @@ finish_refine_internal_op (GTask  *task,
 			data->n_pending_recursions++;
 			run_refine_internal_async (self, plugin_loader,
 						   runtimes_list, job_flags, runtimes_flags,
-						   cancellable, recursive_internal_refine_cb,
+						   data->batch, cancellable, recursive_internal_refine_cb,
 						   g_object_ref (task));
 		}
 	}
@@ -665,7 +1086,7 @@ finish_refine_internal_op (GTask  *task,
 			data->n_pending_recursions++;
 			run_refine_internal_async (self, plugin_loader,
 						   related_list, job_flags, related_flags,
-						   cancellable, recursive_internal_refine_cb,
+						   data->batch, cancellable, recursive_internal_refine_cb,
 						   g_object_ref (task));
 		}
 	}
@@ -728,39 +1149,18 @@ run_refine_internal_finish (GsPluginJobRefine  *self,
 	return g_task_propagate_boolean (G_TASK (result), error);
 }
 
-typedef struct {
-	GsAppList *result_list; /* (owned) */
-	GsPluginLoader *plugin_loader; /* (owned) */
-} RefineData;
-
-static RefineData *
-refine_data_new (GsAppList *result_list, /* (transfer none) */
-		 GsPluginLoader *plugin_loader) /* (transfer none) */
-{
-	RefineData *data;
-
-	data = g_new0 (RefineData, 1);
-	data->result_list = gs_app_list_copy (result_list);
-	data->plugin_loader = g_object_ref (plugin_loader);
-
-	return data;
-}
-
-static void
-refine_data_free (gpointer ptr)
-{
-	RefineData *data = ptr;
-
-	g_clear_object (&data->result_list);
-	g_clear_object (&data->plugin_loader);
-	g_free (data);
-}
-
 static void run_cb (GObject      *source_object,
                     GAsyncResult *result,
                     gpointer      user_data);
 static void finish_run (GTask     *task,
                         GsAppList *result_list);
+static void complete_run (GTask  *task,
+                          GError *error);
+static gboolean coalesced_refine_done_cb (gpointer user_data);
+static void coalesced_refine_cancelled_cb (GCancellable *cancellable,
+                                           gpointer      user_data);
+static void start_run (GTask *task);
+static void run_batch_cb (GPtrArray *tasks);
 
 static void
 gs_plugin_job_refine_run_async (GsPluginJob         *job,
@@ -794,10 +1194,305 @@ gs_plugin_job_refine_run_async (GsPluginJob         *job,
 	self->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
 #endif
 
+	/* If the same apps are already being refined by another job, wait for
+	 * that to finish rather than calling all the plugins again; the
+	 * refine will then be skipped as the apps have already been refined.
+	 * This can’t work for data which is always refreshed. All the job flags
+	 * affect the result: an interactive refine may succeed where a
+	 * non-interactive one fails, for example. */
+	if ((self->require_flags & REFINE_UNCACHEABLE_REQUIRE_FLAGS) == 0) {
+		refine_data->n_pending_waits = gs_plugin_loader_begin_refine (plugin_loader,
+									      refine_data->result_list,
+									      self->job_flags,
+									      self->require_flags,
+									      coalesced_refine_done_cb,
+									      task,
+									      refine_data->claimed_apps);
+		if (refine_data->n_pending_waits > 0) {
+			g_debug ("waiting for %u pending refines of the same apps",
+				 refine_data->n_pending_waits);
+
+			/* this calls coalesced_refine_cancelled_cb() straight
+			 * away if already cancelled, which is fine as it only
+			 * queues a callback */
+			if (cancellable != NULL)
+				refine_data->wait_cancelled_id = g_cancellable_connect (cancellable,
+											G_CALLBACK (coalesced_refine_cancelled_cb),
+											g_object_ref (task),
+											g_object_unref);
+			g_steal_pointer (&task);
+			return;
+		}
+	}
+
+	start_run (g_steal_pointer (&task));
+}
+
+/* @task is (transfer full) */
+static void
+finish_waiting (GTask *task)
+{
+	GsPluginJobRefine *self = g_task_get_source_object (task);
+	RefineData *refine_data = g_task_get_task_data (task);
+
+	g_assert (refine_data->n_pending_waits == 0);
+
+	/* the handler holds a ref on @task, so this can’t drop the last one */
+	g_cancellable_disconnect (g_task_get_cancellable (task), refine_data->wait_cancelled_id);
+	refine_data->wait_cancelled_id = 0;
+
+	if (refine_data->wait_cancelled) {
+		g_autoptr(GTask) task_owned = task;
+
+		g_signal_emit_by_name (G_OBJECT (self), "completed");
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+					 "Cancelled while waiting for another refine of the same apps");
+		return;
+	}
+
+	start_run (task);
+}
+
+static gboolean
+coalesced_refine_done_cb (gpointer user_data)
+{
+	GTask *task = G_TASK (user_data);
+	RefineData *refine_data = g_task_get_task_data (task);
+
+	g_assert (refine_data->n_pending_waits > 0);
+	refine_data->n_pending_waits--;
+
+	if (refine_data->n_pending_waits == 0)
+		finish_waiting (task);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Runs in the task’s main context, so can’t race with
+ * coalesced_refine_done_cb(). */
+static gboolean
+coalesced_refine_cancelled_idle_cb (gpointer user_data)
+{
+	GTask *task = G_TASK (user_data);
+	RefineData *refine_data = g_task_get_task_data (task);
+	guint n_removed;
+
+	/* already finished waiting */
+	if (refine_data->n_pending_waits == 0 || refine_data->wait_cancelled)
+		return G_SOURCE_REMOVE;
+
+	refine_data->wait_cancelled = TRUE;
+
+	/* callbacks for refines which have already finished are still queued,
+	 * and will finish the wait when the last of them runs */
+	n_removed = gs_plugin_loader_cancel_refine_wait (refine_data->plugin_loader,
+							 coalesced_refine_done_cb, task);
+	g_assert (n_removed <= refine_data->n_pending_waits);
+	refine_data->n_pending_waits -= n_removed;
+
+	if (refine_data->n_pending_waits == 0)
+		finish_waiting (task);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* May be called in any thread. This always defers to an idle callback, even
+ * in the task’s own thread, as the handler is disconnected from there and
+ * g_cancellable_disconnect() deadlocks if called from within the handler. */
+static void
+coalesced_refine_cancelled_cb (GCancellable *cancellable,
+                               gpointer      user_data)
+{
+	GTask *task = G_TASK (user_data);
+	g_autoptr(GSource) idle_source = g_idle_source_new ();
+
+	g_source_set_callback (idle_source, coalesced_refine_cancelled_idle_cb,
+			       g_object_ref (task), g_object_unref);
+	g_source_set_static_name (idle_source, G_STRFUNC);
+	g_source_attach (idle_source, g_task_get_context (task));
+}
+
+/* @task is (transfer full) */
+static void
+start_run (GTask *task)
+{
+	GsPluginJobRefine *self = g_task_get_source_object (task);
+	RefineData *refine_data = g_task_get_task_data (task);
+	GsAppList *list = refine_data->result_list;
+
+	/* Single-app refines tend to come in bursts (from the tiles on a page,
+	 * for example), so give others a moment to arrive and refine them all
+	 * at once. Wildcards can’t be batched, as they are replaced in the list,
+	 * and there’s no point in delaying a refine which will be skipped. */
+	if (gs_app_list_length (list) == 1 &&
+	    !gs_app_has_quirk (gs_app_list_index (list, 0), GS_APP_QUIRK_IS_WILDCARD) &&
+	    get_unsatisfied_require_flags (list, self->job_flags, self->require_flags,
+					   gs_plugin_loader_get_refine_generation (refine_data->plugin_loader),
+					   NULL) != 0) {
+		g_autofree gchar *batch_key = g_strdup_printf ("%x:%x",
+							       (guint) self->job_flags,
+							       (guint) self->require_flags);
+
+		if (gs_plugin_loader_add_to_refine_batch (refine_data->plugin_loader, batch_key,
+							  task, run_batch_cb)) {
+			g_object_unref (task);
+			return;
+		}
+	}
+
 	/* Start refining the apps. */
-	run_refine_internal_async (self, plugin_loader, refine_data->result_list,
-				   self->job_flags, self->require_flags, cancellable,
-				   run_cb, g_steal_pointer (&task));
+	run_refine_internal_async (self, refine_data->plugin_loader, refine_data->result_list,
+				   self->job_flags, self->require_flags, NULL,
+				   g_task_get_cancellable (task),
+				   run_cb, task);
+}
+
+static void
+batch_member_cancelled_cb (GCancellable *cancellable,
+                           gpointer      user_data)
+{
+	RefineBatchData *data = user_data;
+
+	/* only give up on the batch once nobody is waiting for it any more */
+	if (g_atomic_int_dec_and_test (&data->n_uncancelled))
+		g_cancellable_cancel (data->cancellable);
+}
+
+static void run_batch_done_cb (GObject      *source_object,
+                               GAsyncResult *result,
+                               gpointer      user_data);
+
+/* Called by the plugin loader once the batching window has passed, with the
+ * tasks of all the refines which arrived in it, which all have the same
+ * flags. */
+static void
+run_batch_cb (GPtrArray *tasks)
+{
+	GTask *first_task = g_ptr_array_index (tasks, 0);
+	GsPluginJobRefine *self = g_task_get_source_object (first_task);
+	RefineData *first_refine_data = g_task_get_task_data (first_task);
+	RefineBatchData *data;
+	g_autoptr(GPtrArray) lists = NULL;
+
+	/* nothing else arrived in time, so run it on its own */
+	if (tasks->len == 1) {
+		run_refine_internal_async (self, first_refine_data->plugin_loader,
+					   first_refine_data->result_list,
+					   self->job_flags, self->require_flags, NULL,
+					   g_task_get_cancellable (first_task),
+					   run_cb, g_object_ref (first_task));
+		return;
+	}
+
+	data = g_new0 (RefineBatchData, 1);
+	data->tasks = g_ptr_array_ref (tasks);
+	data->cancellable = g_cancellable_new ();
+	data->cancelled_ids = g_array_sized_new (FALSE, TRUE, sizeof (gulong), tasks->len);
+	data->n_uncancelled = tasks->len;
+
+	/* The jobs may hold different instances of apps with the same unique
+	 * ID, and a #GsAppList only holds one of them, so spread the apps over
+	 * as many lists as needed to keep every instance. Typically there is
+	 * only one. */
+	lists = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (guint i = 0; i < tasks->len; i++) {
+		GTask *task = g_ptr_array_index (tasks, i);
+		GsPluginJob *plugin_job = g_task_get_source_object (task);
+		RefineData *refine_data = g_task_get_task_data (task);
+		GCancellable *cancellable = g_task_get_cancellable (task);
+		guint plugin_timeout_ms = gs_plugin_job_get_plugin_timeout (plugin_job);
+		gulong cancelled_id = 0;
+
+		for (guint j = 0; j < gs_app_list_length (refine_data->result_list); j++) {
+			GsApp *app = gs_app_list_index (refine_data->result_list, j);
+			const gchar *unique_id = gs_app_get_unique_id (app);
+			GsAppList *list = NULL;
+
+			for (guint k = 0; list == NULL && k < lists->len; k++) {
+				GsAppList *candidate = g_ptr_array_index (lists, k);
+				GsApp *existing = (unique_id != NULL) ? gs_app_list_lookup (candidate, unique_id) : NULL;
+
+				if (existing == NULL || existing == app)
+					list = candidate;
+			}
+
+			if (list == NULL) {
+				list = gs_app_list_new ();
+				g_ptr_array_add (lists, list);
+			}
+
+			gs_app_list_add (list, app);
+		}
+
+		/* the batch can’t wait for longer than any of its jobs would */
+		if (plugin_timeout_ms != 0 &&
+		    (data->plugin_timeout_ms == 0 || plugin_timeout_ms < data->plugin_timeout_ms))
+			data->plugin_timeout_ms = plugin_timeout_ms;
+
+		if (cancellable != NULL)
+			cancelled_id = g_cancellable_connect (cancellable,
+							      G_CALLBACK (batch_member_cancelled_cb),
+							      data, NULL);
+		g_array_append_val (data->cancelled_ids, cancelled_id);
+	}
+
+	g_debug ("refining %u lists of apps for %u batched refines",
+		 lists->len, tasks->len);
+
+	/* The internal refines are tied to the first job, but only use it to
+	 * look up the plugin loader state; events are sent to the jobs they
+	 * concern by plugin_event_cb(), and the results are returned to each of
+	 * the jobs in run_batch_done_cb() once all the lists are refined. */
+	data->n_pending_lists = lists->len;
+
+	for (guint i = 0; i < lists->len; i++) {
+		run_refine_internal_async (self, first_refine_data->plugin_loader,
+					   g_ptr_array_index (lists, i),
+					   self->job_flags, self->require_flags, data,
+					   data->cancellable,
+					   run_batch_done_cb, data);
+	}
+}
+
+static void
+run_batch_done_cb (GObject      *source_object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+	GsPluginJobRefine *self = GS_PLUGIN_JOB_REFINE (source_object);
+	g_autoptr(RefineBatchData) data = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	run_refine_internal_finish (self, result, &local_error);
+
+	/* keep the first error, and wait for the other lists */
+	data = user_data;
+	if (local_error != NULL && data->error == NULL)
+		data->error = g_steal_pointer (&local_error);
+
+	g_assert (data->n_pending_lists > 0);
+	data->n_pending_lists--;
+
+	if (data->n_pending_lists > 0) {
+		g_steal_pointer (&data);
+		return;
+	}
+
+	for (guint i = 0; i < data->tasks->len; i++) {
+		GTask *task = g_ptr_array_index (data->tasks, i);
+		gulong cancelled_id = g_array_index (data->cancelled_ids, gulong, i);
+
+		if (cancelled_id != 0)
+			g_cancellable_disconnect (g_task_get_cancellable (task), cancelled_id);
+	}
+
+	for (guint i = 0; i < data->tasks->len; i++) {
+		GTask *task = g_ptr_array_index (data->tasks, i);
+
+		complete_run (g_object_ref (task),
+			      (data->error != NULL) ? g_error_copy (data->error) : NULL);
+	}
 }
 
 static void
@@ -806,12 +1501,28 @@ run_cb (GObject      *source_object,
         gpointer      user_data)
 {
 	GsPluginJobRefine *self = GS_PLUGIN_JOB_REFINE (source_object);
-	g_autoptr(GTask) task = g_steal_pointer (&user_data);
+	g_autoptr(GError) local_error = NULL;
+
+	run_refine_internal_finish (self, result, &local_error);
+	complete_run (G_TASK (user_data), g_steal_pointer (&local_error));
+}
+
+/* @task and @error are (transfer full) */
+static void
+complete_run (GTask  *task,
+              GError *error)
+{
+	GsPluginJobRefine *self = g_task_get_source_object (task);
+	g_autoptr(GTask) task_owned = task;
+	g_autoptr(GError) local_error = error;
 	RefineData *refine_data = g_task_get_task_data (task);
 	GsAppList *result_list = refine_data->result_list;
-	g_autoptr(GError) local_error = NULL;
 
-	if (run_refine_internal_finish (self, result, &local_error)) {
+	/* let any jobs waiting for these apps carry on */
+	gs_plugin_loader_end_refine (refine_data->plugin_loader, refine_data->claimed_apps);
+	g_ptr_array_set_size (refine_data->claimed_apps, 0);
+
+	if (local_error == NULL) {
 		/* remove any addons that have the same source as the parent app */
 		for (guint i = 0; i < gs_app_list_length (result_list); i++) {
 			g_autoptr(GPtrArray) to_remove = g_ptr_array_new ();
@@ -49,6 +49,7 @@
 #include "gs-external-appstream-utils.h"
 #include "gs-plugin-job-private.h"
 #include "gs-plugin-job-refresh-metadata.h"
+#include "gs-plugin-private.h"
 #include "gs-plugin-types.h"
 #include "gs-profiler.h"
 #include "gs-odrs-provider.h"
@@ -83,6 +84,7 @@ struct _GsPluginJobRefreshMetadata
 	GSource *progress_source;  /* (owned) (nullable) */
 	guint last_reported_progress;
 
+	gint64 plugins_begin_time_usec;
 #ifdef HAVE_SYSPROF
 	gint64 begin_time_nsec;
 #endif
@@ -255,6 +257,7 @@ gs_plugin_job_refresh_metadata_run_async (GsPluginJob         *job,
 	}
 #endif
 
+	self->plugins_begin_time_usec = g_get_monotonic_time ();
 #ifdef HAVE_SYSPROF
 	self->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
 #endif
@@ -442,6 +445,7 @@ plugin_refresh_metadata_cb (GObject      *source_object,
 
 	if (!plugin_class->refresh_metadata_finish (plugin, result, &local_error))
 		g_debug ("Failed to refresh plugin '%s': %s", gs_plugin_get_name (plugin), local_error->message);
+	gs_plugin_add_latency (plugin, "refresh-metadata", g_get_monotonic_time () - self->plugins_begin_time_usec);
 
 	/* Update progress reporting. */
 	self->plugins_progress.n_plugins_complete++;
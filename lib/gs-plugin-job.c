@@ -19,6 +19,7 @@ typedef struct
 {
 	gint64			 time_created;
 	GCancellable		*cancellable; /* (nullable) (owned) */
+	guint			 plugin_timeout_ms;
 } GsPluginJobPrivate;
 
 typedef enum {
@@ -235,3 +236,224 @@ gs_plugin_job_emit_event (GsPluginJob   *self,
 
 	g_signal_emit (self, signals[SIGNAL_EVENT], 0, plugin, event);
 }
+
+/**
+ * gs_plugin_job_get_plugin_timeout:
+ * @self: a #GsPluginJob
+ *
+ * Get the time each plugin has to complete its part of the job, as set with
+ * gs_plugin_job_set_plugin_timeout().
+ *
+ * Returns: the timeout, in milliseconds, or zero if there is none
+ * Since: 51
+ */
+guint
+gs_plugin_job_get_plugin_timeout (GsPluginJob *self)
+{
+	GsPluginJobPrivate *priv = gs_plugin_job_get_instance_private (self);
+
+	g_return_val_if_fail (GS_IS_PLUGIN_JOB (self), 0);
+
+	return priv->plugin_timeout_ms;
+}
+
+/**
+ * gs_plugin_job_set_plugin_timeout:
+ * @self: a #GsPluginJob
+ * @timeout_ms: timeout in milliseconds, or zero to wait for as long as it
+ *   takes
+ *
+ * Set the time each plugin has to complete its part of the job.
+ *
+ * If a plugin takes longer than this, its part of the job is cancelled and
+ * the job carries on with the results from the other plugins, rather than
+ * waiting for it. This stops one hung plugin from holding up the whole job.
+ *
+ * It is up to each job whether it supports this; currently
+ * #GsPluginJobRefine and #GsPluginJobListApps do. It must be set before the
+ * job is run.
+ *
+ * Since: 51
+ */
+void
+gs_plugin_job_set_plugin_timeout (GsPluginJob *self,
+                                  guint        timeout_ms)
+{
+	GsPluginJobPrivate *priv = gs_plugin_job_get_instance_private (self);
+
+	g_return_if_fail (GS_IS_PLUGIN_JOB (self));
+
+	priv->plugin_timeout_ms = timeout_ms;
+}
+
+struct _GsPluginJobDeadline {
+	GCancellable *cancellable;  /* (owned) (not nullable) */
+	GCancellable *parent_cancellable;  /* (owned) (nullable) */
+	gulong cancelled_id;
+	GSource *timeout_source;  /* (owned) (nullable) */
+	gboolean expired;
+
+	GSourceFunc expired_func;
+	gpointer user_data;
+	GDestroyNotify user_data_free_func;
+};
+
+static void
+deadline_parent_cancelled_cb (GCancellable *parent_cancellable,
+                              gpointer      user_data)
+{
+	GCancellable *cancellable = G_CANCELLABLE (user_data);
+
+	g_cancellable_cancel (cancellable);
+}
+
+static gboolean
+deadline_timeout_cb (gpointer user_data)
+{
+	GsPluginJobDeadline *deadline = user_data;
+
+	deadline->expired = TRUE;
+	g_clear_pointer (&deadline->timeout_source, g_source_unref);
+	g_cancellable_cancel (deadline->cancellable);
+
+	deadline->expired_func (deadline->user_data);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+deadline_timeout_notify_cb (gpointer user_data)
+{
+	GsPluginJobDeadline *deadline = user_data;
+
+	if (deadline->user_data_free_func != NULL)
+		deadline->user_data_free_func (g_steal_pointer (&deadline->user_data));
+}
+
+/**
+ * gs_plugin_job_deadline_new:
+ * @timeout_ms: time to allow, in milliseconds
+ * @parent_cancellable: (nullable): cancellable for the whole job
+ * @expired_func: function to call if the deadline expires; its return value
+ *   is ignored
+ * @user_data: data to pass to @expired_func
+ * @user_data_free_func: (nullable): function to free @user_data with once
+ *   the deadline has expired or been freed
+ *
+ * Start a deadline for one plugin’s part of a job.
+ *
+ * The plugin should be passed the #GCancellable from
+ * gs_plugin_job_deadline_get_cancellable(), which is cancelled when either
+ * @parent_cancellable is cancelled or @timeout_ms passes. In the latter case
+ * @expired_func is then called in the thread-default main context, and
+ * gs_plugin_job_deadline_has_expired() will return %TRUE, so that the job can
+ * ignore the result the plugin eventually returns.
+ *
+ * Returns: (transfer full): a new deadline
+ * Since: 51
+ */
+GsPluginJobDeadline *
+gs_plugin_job_deadline_new (guint           timeout_ms,
+                            GCancellable   *parent_cancellable,
+                            GSourceFunc     expired_func,
+                            gpointer        user_data,
+                            GDestroyNotify  user_data_free_func)
+{
+	GsPluginJobDeadline *deadline;
+	g_autoptr(GMainContext) context = NULL;
+
+	g_return_val_if_fail (timeout_ms > 0, NULL);
+	g_return_val_if_fail (parent_cancellable == NULL || G_IS_CANCELLABLE (parent_cancellable), NULL);
+	g_return_val_if_fail (expired_func != NULL, NULL);
+
+	deadline = g_new0 (GsPluginJobDeadline, 1);
+	deadline->cancellable = g_cancellable_new ();
+	deadline->expired_func = expired_func;
+	deadline->user_data = user_data;
+	deadline->user_data_free_func = user_data_free_func;
+
+	if (parent_cancellable != NULL) {
+		deadline->parent_cancellable = g_object_ref (parent_cancellable);
+		deadline->cancelled_id = g_cancellable_connect (parent_cancellable,
+								G_CALLBACK (deadline_parent_cancelled_cb),
+								g_object_ref (deadline->cancellable),
+								g_object_unref);
+	}
+
+	context = g_main_context_ref_thread_default ();
+	deadline->timeout_source = g_timeout_source_new (timeout_ms);
+	g_source_set_name (deadline->timeout_source, "[gnome-software] plugin deadline");
+	g_source_set_callback (deadline->timeout_source, deadline_timeout_cb,
+			       deadline, deadline_timeout_notify_cb);
+	g_source_attach (deadline->timeout_source, context);
+
+	return deadline;
+}
+
+/**
+ * gs_plugin_job_deadline_get_cancellable:
+ * @deadline: a #GsPluginJobDeadline
+ *
+ * Get the cancellable to pass to the plugin.
+ *
+ * Returns: (transfer none): a #GCancellable
+ * Since: 51
+ */
+GCancellable *
+gs_plugin_job_deadline_get_cancellable (GsPluginJobDeadline *deadline)
+{
+	g_return_val_if_fail (deadline != NULL, NULL);
+
+	return deadline->cancellable;
+}
+
+/**
+ * gs_plugin_job_deadline_has_expired:
+ * @deadline: a #GsPluginJobDeadline
+ *
+ * Check whether the deadline expired before the plugin finished.
+ *
+ * Returns: %TRUE if the deadline expired
+ * Since: 51
+ */
+gboolean
+gs_plugin_job_deadline_has_expired (GsPluginJobDeadline *deadline)
+{
+	g_return_val_if_fail (deadline != NULL, FALSE);
+
+	return deadline->expired;
+}
+
+/**
+ * gs_plugin_job_deadline_free:
+ * @deadline: (transfer full): a #GsPluginJobDeadline
+ *
+ * Stop and free the deadline. If it has not expired yet, the expiry function
+ * will not be called.
+ *
+ * This must be called in the same thread-default main context as
+ * gs_plugin_job_deadline_new() was.
+ *
+ * Since: 51
+ */
+void
+gs_plugin_job_deadline_free (GsPluginJobDeadline *deadline)
+{
+	g_return_if_fail (deadline != NULL);
+
+	if (deadline->timeout_source != NULL) {
+		g_source_destroy (deadline->timeout_source);
+		g_clear_pointer (&deadline->timeout_source, g_source_unref);
+	}
+
+	if (deadline->parent_cancellable != NULL)
+		g_cancellable_disconnect (deadline->parent_cancellable, deadline->cancelled_id);
+	g_clear_object (&deadline->parent_cancellable);
+	g_clear_object (&deadline->cancellable);
+
+	/* only set if the timeout source was never attached or notified */
+	if (deadline->user_data_free_func != NULL && deadline->user_data != NULL)
+		deadline->user_data_free_func (g_steal_pointer (&deadline->user_data));
+
+	g_free (deadline);
+}
@@ -47,6 +47,10 @@ gboolean	gs_plugin_job_run_finish		(GsPluginJob		*self,
 
 gboolean	 gs_plugin_job_get_interactive		(GsPluginJob	*self);
 
+guint		 gs_plugin_job_get_plugin_timeout	(GsPluginJob	*self);
+void		 gs_plugin_job_set_plugin_timeout	(GsPluginJob	*self,
+							 guint		 timeout_ms);
+
 void		 gs_plugin_job_emit_event		(GsPluginJob	*self,
 							 GsPlugin	*plugin,
 							 GsPluginEvent	*event);
@@ -22,6 +22,7 @@
 #include "gs-app-collation.h"
 #include "gs-app-private.h"
 #include "gs-app-list-private.h"
+#include "gs-app-registry.h"
 #include "gs-category-manager.h"
 #include "gs-category-private.h"
 #include "gs-external-appstream-utils.h"
@@ -34,6 +35,9 @@
 #include "gs-plugin-job-private.h"
 #include "gs-plugin-private.h"
 #include "gs-profiler.h"
+#include "gs-silo-wrapper.h"
+#include "gs-startup-snapshot.h"
+#include "gs-startup-timeline.h"
 #include "gs-utils.h"
 
 #define GS_PLUGIN_LOADER_UPDATES_CHANGED_DELAY	3	/* s */
@@ -45,6 +49,20 @@ struct _GsPluginLoader
 
 	gboolean		 setup_complete;
 	GCancellable		*setup_complete_cancellable;  /* (nullable) (owned) */
+	gint64			 setup_begin_time_usec;
+
+	GFile			*snapshot_file;  /* (nullable) (owned) */
+	GsStartupSnapshot	*snapshot;  /* (nullable) (owned) */
+	guint			 n_snapshot_jobs;
+
+	gboolean		 defer_setup;
+	GMutex			 deferred_setup_mutex;
+	GPtrArray		*deferred_plugins;  /* (owned) (mutex deferred_setup_mutex) (element-type GsPlugin) */
+	GCancellable		*deferred_setup_cancellable;  /* (owned) (nullable) (mutex deferred_setup_mutex); non-NULL while any plugin is waiting to be set up */
+	guint			 deferred_setup_id;  /* (mutex deferred_setup_mutex) */
+	gboolean		 deferred_setup_requested;  /* (mutex deferred_setup_mutex) */
+	guint			 n_deferred_pending;
+	gint64			 deferred_setup_begin_time_usec;
 
 	GPtrArray		*plugins;
 	GPtrArray		*locations;
@@ -57,11 +75,24 @@ struct _GsPluginLoader
 	GCancellable		*pending_apps_cancellable;  /* (nullable) (owned) */
 
 	gint			 active_jobs;
+	guint			 refine_generation;  /* (atomic) */
+
+	GMutex			 inflight_refines_mutex;
+	GHashTable		*inflight_refines;  /* (owned) (mutex inflight_refines_mutex) (element-type GsApp InflightRefine) */
+	guint			 n_coalesced_refines;  /* (atomic) */
+
+	GMutex			 refine_batches_mutex;
+	GHashTable		*refine_batches;  /* (owned) (mutex refine_batches_mutex) (element-type utf8 RefineBatch) */
+	guint			 refine_batch_window_ms;  /* (atomic) */
+	guint			 n_batched_refines;  /* (atomic) */
 
 	GSettings		*settings;
 
 	GMutex			 events_by_id_mutex;
 	GHashTable		*events_by_id;		/* unique-id : GsPluginEvent */
+	GHashTable		*event_rate_limits;	/* (owned) (mutex events_by_id_mutex) (element-type utf8 EventRateLimit) */
+	guint			 event_rate_limits_flush_id;	/* (mutex events_by_id_mutex) */
+	guint			 event_rate_limit_window_ms;	/* (mutex events_by_id_mutex) */
 
 	gchar			**compatible_projects;
 	guint			 scale;
@@ -80,6 +111,7 @@ struct _GsPluginLoader
 	GPowerProfileMonitor	*power_profile_monitor;  /* (owned) (nullable) */
 
 	GsJobManager		*job_manager;  /* (owned) (not nullable) */
+	GsAppRegistry		*app_registry;  /* (owned) (not nullable) */
 	GsCategoryManager	*category_manager;
 	GsOdrsProvider		*odrs_provider;  /* (owned) (nullable) */
 	SoupSession		*icon_downloader_soup_session; /* (owned) (not nullable) */
@@ -92,7 +124,47 @@ struct _GsPluginLoader
 	GPtrArray		*idle_queue;  /* (owned) (not nullable) (element-type GSource) */
 };
 
+/* A refine of an app which is in progress, and the refines waiting for it. */
+typedef struct {
+	GsPluginRefineFlags refine_flags;
+	GsPluginRefineRequireFlags require_flags;
+	GArray *waiters;  /* (owned) (element-type RefineWaiter) */
+} InflightRefine;
+
+typedef struct {
+	GMainContext *context;  /* (owned) */
+	GSourceFunc func;
+	gpointer user_data;
+} RefineWaiter;
+
+static void
+inflight_refine_free (InflightRefine *inflight)
+{
+	/* all waiters must have been woken by gs_plugin_loader_end_refine() */
+	g_assert (inflight->waiters->len == 0);
+	g_array_unref (inflight->waiters);
+	g_free (inflight);
+}
+
+/* Refines which arrived within the batching window, to be run together. */
+typedef struct {
+	GsPluginLoader *plugin_loader;  /* (owned) */
+	gchar *key;  /* (owned) */
+	GPtrArray *tasks;  /* (owned) (element-type GTask) */
+	GsPluginLoaderRefineBatchFunc func;
+} RefineBatch;
+
+static void
+refine_batch_free (RefineBatch *batch)
+{
+	g_object_unref (batch->plugin_loader);
+	g_free (batch->key);
+	g_ptr_array_unref (batch->tasks);
+	g_free (batch);
+}
+
 static void gs_plugin_loader_monitor_network (GsPluginLoader *plugin_loader);
+static void gs_plugin_loader_invalidate_refined (GsPluginLoader *plugin_loader);
 static void add_app_to_install_queue (GsPluginLoader *plugin_loader, GsApp *app);
 static gboolean remove_apps_from_install_queue (GsPluginLoader *plugin_loader, GsAppList *apps);
 
@@ -117,9 +189,10 @@ typedef enum {
 	PROP_SESSION_BUS_CONNECTION,
 	PROP_SYSTEM_BUS_CONNECTION,
 	PROP_CPU_PRIORITY,
+	PROP_REFINE_BATCH_WINDOW,
 } GsPluginLoaderProperty;
 
-static GParamSpec *obj_props[PROP_CPU_PRIORITY + 1] = { NULL, };
+static GParamSpec *obj_props[PROP_REFINE_BATCH_WINDOW + 1] = { NULL, };
 
 GsPlugin *
 gs_plugin_loader_find_plugin (GsPluginLoader *plugin_loader,
@@ -202,12 +275,60 @@ gs_plugin_loader_notify_idle_cb (gpointer user_data)
 	return keep_current_source;
 }
 
-/* Could be called in any thread. */
-void
-gs_plugin_loader_add_event (GsPluginLoader *plugin_loader, GsPluginEvent *event)
+/* Non-interactive events which are alike — from the same plugin, with the same
+ * error, for the same origin (or the same app, if there is no origin) — are
+ * only let through once per window, so that a failing remote doesn’t flood the
+ * UI with hundreds of identical events during a refresh. The ones held back
+ * are counted, and once the window is over a summary event is added in place
+ * of the first one, saying how many were suppressed. */
+#define EVENT_RATE_LIMIT_WINDOW_MS 10000
+
+typedef struct {
+	gint64 window_start_usec;
+	guint n_suppressed;
+	GsPluginEvent *first_event;  /* (owned) (not nullable) */
+} EventRateLimit;
+
+static void
+event_rate_limit_free (EventRateLimit *rate_limit)
 {
-	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&plugin_loader->events_by_id_mutex);
+	g_clear_object (&rate_limit->first_event);
+	g_free (rate_limit);
+}
+
+static gchar *
+build_event_rate_limit_key (GsPlugin      *plugin,
+                            GsPluginEvent *event)
+{
+	const GError *error = gs_plugin_event_get_error (event);
+	GsApp *app = gs_plugin_event_get_app (event);
+	GsApp *origin = gs_plugin_event_get_origin (event);
+	g_autoptr(GsPlugin) management_plugin = NULL;
+	const gchar *subject_id = NULL;
+
+	if (error == NULL)
+		return NULL;
 
+	if (plugin == NULL && app != NULL)
+		plugin = management_plugin = gs_app_dup_management_plugin (app);
+
+	/* without an origin, only repeated errors for the same app are alike */
+	if (origin != NULL)
+		subject_id = gs_app_get_unique_id (origin);
+	else if (app != NULL)
+		subject_id = gs_app_get_unique_id (app);
+
+	return g_strdup_printf ("%s:%s:%d:%s",
+				(plugin != NULL) ? gs_plugin_get_name (plugin) : "",
+				g_quark_to_string (error->domain), error->code,
+				(subject_id != NULL) ? subject_id : "");
+}
+
+/* events_by_id_mutex must be held. */
+static void
+add_event_locked (GsPluginLoader *plugin_loader,
+                  GsPluginEvent  *event)
+{
 	g_debug ("%s: Adding event %s", G_STRFUNC, gs_plugin_event_get_unique_id (event));
 
 	g_hash_table_replace (plugin_loader->events_by_id,
@@ -219,6 +340,136 @@ gs_plugin_loader_add_event (GsPluginLoader *plugin_loader, GsPluginEvent *event)
 					      NULL);
 }
 
+/* Adds an event summarising the ones suppressed in the window of @rate_limit,
+ * if there were any. It has the same app and origin as the first event of the
+ * window, so it replaces that one if it’s still there.
+ * events_by_id_mutex must be held. */
+static void
+add_event_rate_limit_summary_locked (GsPluginLoader *plugin_loader,
+                                     EventRateLimit *rate_limit)
+{
+	GsPluginEvent *first_event = rate_limit->first_event;
+	const GError *error = gs_plugin_event_get_error (first_event);
+	g_autoptr(GError) summary_error = NULL;
+	g_autoptr(GsPluginEvent) summary_event = NULL;
+
+	if (rate_limit->n_suppressed == 0)
+		return;
+
+	summary_error = g_error_new (error->domain, error->code,
+				     "%s (suppressed %u similar events)",
+				     error->message, rate_limit->n_suppressed);
+	summary_event = gs_plugin_event_new ("app", gs_plugin_event_get_app (first_event),
+					     "origin", gs_plugin_event_get_origin (first_event),
+					     "error", summary_error,
+					     NULL);
+	if (gs_plugin_event_has_flag (first_event, GS_PLUGIN_EVENT_FLAG_WARNING))
+		gs_plugin_event_add_flag (summary_event, GS_PLUGIN_EVENT_FLAG_WARNING);
+
+	add_event_locked (plugin_loader, summary_event);
+}
+
+static gboolean
+flush_event_rate_limits_cb (gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&plugin_loader->events_by_id_mutex);
+	gint64 now_usec = g_get_monotonic_time ();
+	gint64 window_usec = (gint64) plugin_loader->event_rate_limit_window_ms * 1000;
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, plugin_loader->event_rate_limits);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		EventRateLimit *rate_limit = value;
+
+		if (now_usec - rate_limit->window_start_usec < window_usec)
+			continue;
+
+		add_event_rate_limit_summary_locked (plugin_loader, rate_limit);
+		g_hash_table_iter_remove (&iter);
+	}
+
+	if (g_hash_table_size (plugin_loader->event_rate_limits) > 0)
+		return G_SOURCE_CONTINUE;
+
+	plugin_loader->event_rate_limits_flush_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+/* Returns %TRUE if @event should be dropped, because too many like it have
+ * been added recently. events_by_id_mutex must be held. */
+static gboolean
+gs_plugin_loader_rate_limit_event (GsPluginLoader *plugin_loader,
+                                   GsPlugin       *plugin,
+                                   GsPluginEvent  *event)
+{
+	g_autofree gchar *key = NULL;
+	EventRateLimit *rate_limit;
+	gint64 now_usec;
+	gint64 window_usec = (gint64) plugin_loader->event_rate_limit_window_ms * 1000;
+
+	/* the user is waiting for the outcome of what they asked for */
+	if (gs_plugin_event_has_flag (event, GS_PLUGIN_EVENT_FLAG_INTERACTIVE))
+		return FALSE;
+
+	key = build_event_rate_limit_key (plugin, event);
+	if (key == NULL)
+		return FALSE;
+
+	now_usec = g_get_monotonic_time ();
+	rate_limit = g_hash_table_lookup (plugin_loader->event_rate_limits, key);
+
+	if (rate_limit != NULL &&
+	    now_usec - rate_limit->window_start_usec < window_usec) {
+		rate_limit->n_suppressed++;
+		return TRUE;
+	}
+
+	if (rate_limit == NULL) {
+		rate_limit = g_new0 (EventRateLimit, 1);
+		g_hash_table_insert (plugin_loader->event_rate_limits, g_strdup (key), rate_limit);
+	} else {
+		add_event_rate_limit_summary_locked (plugin_loader, rate_limit);
+	}
+
+	rate_limit->window_start_usec = now_usec;
+	rate_limit->n_suppressed = 0;
+	g_set_object (&rate_limit->first_event, event);
+
+	if (plugin_loader->event_rate_limits_flush_id == 0)
+		plugin_loader->event_rate_limits_flush_id = g_timeout_add (plugin_loader->event_rate_limit_window_ms,
+									   flush_event_rate_limits_cb,
+									   plugin_loader);
+
+	return FALSE;
+}
+
+/* Could be called in any thread.
+ *
+ * @plugin is the plugin which reported @event, if known. */
+static void
+gs_plugin_loader_add_event_internal (GsPluginLoader *plugin_loader,
+                                     GsPlugin       *plugin,
+                                     GsPluginEvent  *event)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&plugin_loader->events_by_id_mutex);
+
+	if (gs_plugin_loader_rate_limit_event (plugin_loader, plugin, event)) {
+		g_debug ("%s: Suppressing event %s", G_STRFUNC, gs_plugin_event_get_unique_id (event));
+		return;
+	}
+
+	add_event_locked (plugin_loader, event);
+}
+
+/* Could be called in any thread. */
+void
+gs_plugin_loader_add_event (GsPluginLoader *plugin_loader, GsPluginEvent *event)
+{
+	gs_plugin_loader_add_event_internal (plugin_loader, NULL, event);
+}
+
 static void
 gs_plugin_loader_claim_error_internal (GsPluginLoader *plugin_loader,
 				       GsPluginJob *job,
@@ -355,9 +606,32 @@ gs_plugin_loader_claim_job_error (GsPluginLoader *plugin_loader,
  */
 void
 gs_plugin_loader_run_adopt (GsPluginLoader *plugin_loader, GsAppList *list)
+{
+	gs_plugin_loader_run_adopt_full (plugin_loader, list, NULL, NULL);
+}
+
+/**
+ * gs_plugin_loader_run_adopt_full:
+ * @plugin_loader: a #GsPluginLoader
+ * @list: list of apps to try and adopt
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Like gs_plugin_loader_run_adopt(), but stops early if @cancellable is
+ * cancelled, which matters for refines of long lists of apps.
+ *
+ * Returns: %TRUE on success, %FALSE if cancelled
+ * Since: 51
+ */
+gboolean
+gs_plugin_loader_run_adopt_full (GsPluginLoader  *plugin_loader,
+                                 GsAppList       *list,
+                                 GCancellable    *cancellable,
+                                 GError         **error)
 {
 	guint i;
 	guint j;
+	guint n_checked = 0;
 
 	/* go through each plugin in order */
 	for (i = 0; i < plugin_loader->plugins->len; i++) {
@@ -367,6 +641,9 @@ gs_plugin_loader_run_adopt (GsPluginLoader *plugin_loader, GsAppList *list)
 		for (j = 0; j < gs_app_list_length (list); j++) {
 			GsApp *app = gs_app_list_index (list, j);
 
+			if (gs_utils_cancellation_checkpoint (cancellable, n_checked++, error))
+				return FALSE;
+
 			if (gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD))
 				continue;
 			if (!gs_app_has_management_plugin (app, NULL))
@@ -391,6 +668,8 @@ gs_plugin_loader_run_adopt (GsPluginLoader *plugin_loader, GsAppList *list)
 
 		g_debug ("nothing adopted %s", gs_app_get_unique_id (app));
 	}
+
+	return TRUE;
 }
 
 static const gchar *
@@ -1014,6 +1293,31 @@ gs_plugin_loader_remove_events (GsPluginLoader *plugin_loader)
 {
 	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&plugin_loader->events_by_id_mutex);
 	g_hash_table_remove_all (plugin_loader->events_by_id);
+	g_hash_table_remove_all (plugin_loader->event_rate_limits);
+}
+
+/**
+ * gs_plugin_loader_set_event_rate_limit_window:
+ * @plugin_loader: A #GsPluginLoader
+ * @window_ms: how long alike events are rate limited for, in milliseconds
+ *
+ * Sets how long alike non-interactive events are held back for after the
+ * first one is added, before a summary of them is added. This function should
+ * only be called from the tests.
+ *
+ * Since: 51
+ **/
+void
+gs_plugin_loader_set_event_rate_limit_window (GsPluginLoader *plugin_loader,
+                                              guint           window_ms)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader));
+	g_return_if_fail (window_ms > 0);
+
+	locker = g_mutex_locker_new (&plugin_loader->events_by_id_mutex);
+	plugin_loader->event_rate_limit_window_ms = window_ms;
 }
 
 /* Could be called in any thread. */
@@ -1025,7 +1329,7 @@ gs_plugin_loader_report_event_cb (GsPlugin *plugin,
 	GsPluginJob *plugin_job = gs_plugin_event_get_job (event);
 	if (plugin_job != NULL && gs_plugin_job_get_interactive (plugin_job))
 		gs_plugin_event_add_flag (event, GS_PLUGIN_EVENT_FLAG_INTERACTIVE);
-	gs_plugin_loader_add_event (plugin_loader, event);
+	gs_plugin_loader_add_event_internal (plugin_loader, plugin, event);
 }
 
 typedef struct {
@@ -1164,6 +1468,7 @@ gs_plugin_loader_job_updates_changed_cb (GsPlugin *plugin,
 					 GsPluginLoader *plugin_loader)
 {
 	plugin_loader->updates_changed_cnt++;
+	gs_plugin_loader_invalidate_refined (plugin_loader);
 
 	/* Schedule emit of updates changed when no job is active.
 	   This helps to avoid a race condition when a plugin calls
@@ -1190,6 +1495,8 @@ static void
 gs_plugin_loader_reload_cb (GsPlugin *in_plugin,
 			    GsPluginLoader *plugin_loader)
 {
+	gs_plugin_loader_invalidate_refined (plugin_loader);
+
 	if (plugin_loader->reload_id != 0)
 		return;
 	/* Let also the plugins know that the reload had been initiated;
@@ -1217,6 +1524,8 @@ gs_plugin_loader_repository_changed_cb (GsPlugin *plugin,
 {
 	GApplication *application = g_application_get_default ();
 
+	gs_plugin_loader_invalidate_refined (plugin_loader);
+
 	/* Can be NULL when running the tests */
 	if (application) {
 		g_signal_emit_by_name (application,
@@ -1266,6 +1575,7 @@ gs_plugin_loader_open_plugin (GsPluginLoader *plugin_loader,
 	gs_plugin_set_language (plugin, plugin_loader->language);
 	gs_plugin_set_scale (plugin, gs_plugin_loader_get_scale (plugin_loader));
 	gs_plugin_set_network_monitor (plugin, plugin_loader->network_monitor);
+	gs_plugin_set_app_registry (plugin, plugin_loader->app_registry);
 
 	g_object_bind_property (plugin_loader, "cpu-priority", plugin, "cpu-priority", G_BINDING_DEFAULT);
 
@@ -1378,6 +1688,8 @@ gs_plugin_loader_clear_caches (GsPluginLoader *plugin_loader)
 		GsPlugin *plugin = g_ptr_array_index (plugin_loader->plugins, i);
 		gs_plugin_cache_invalidate (plugin);
 	}
+	gs_app_registry_invalidate (plugin_loader->app_registry);
+	gs_plugin_loader_invalidate_refined (plugin_loader);
 }
 
 static void
@@ -1423,6 +1735,14 @@ gs_plugin_loader_shutdown (GsPluginLoader *plugin_loader,
                            GCancellable   *cancellable)
 {
 	ShutdownData shutdown_data;
+	g_autoptr(GError) local_error = NULL;
+
+	/* Save the snapshot while the apps in it are still in a consistent
+	 * state. Don’t overwrite it if setup never finished, as then nothing
+	 * new has been recorded. */
+	if (plugin_loader->setup_complete &&
+	    !gs_plugin_loader_save_snapshot (plugin_loader, &local_error))
+		g_warning ("Failed to save startup snapshot: %s", local_error->message);
 
 	shutdown_data.plugin_loader = plugin_loader;
 	shutdown_data.n_pending = 1;  /* incremented until all operations have been started */
@@ -1461,6 +1781,16 @@ gs_plugin_loader_shutdown (GsPluginLoader *plugin_loader,
 	g_clear_object (&plugin_loader->setup_complete_cancellable);
 	plugin_loader->setup_complete_cancellable = g_cancellable_new ();
 	g_clear_object (&plugin_loader->icon_downloader);
+
+	/* Plugins whose setup was deferred were never set up, so there is
+	 * nothing to shut down; just release any jobs waiting for them. */
+	g_mutex_lock (&plugin_loader->deferred_setup_mutex);
+	g_clear_handle_id (&plugin_loader->deferred_setup_id, g_source_remove);
+	plugin_loader->deferred_setup_requested = FALSE;
+	g_ptr_array_set_size (plugin_loader->deferred_plugins, 0);
+	g_cancellable_cancel (plugin_loader->deferred_setup_cancellable);
+	g_clear_object (&plugin_loader->deferred_setup_cancellable);
+	g_mutex_unlock (&plugin_loader->deferred_setup_mutex);
 }
 
 static void
@@ -1530,6 +1860,7 @@ typedef struct {
 	guint n_pending;
 	gchar **allowlist;
 	gchar **blocklist;
+	gint64 plugins_begin_time_usec;
 #ifdef HAVE_SYSPROF
 	gint64 setup_begin_time_nsec;
 	gint64 plugins_begin_time_nsec;
@@ -1561,6 +1892,8 @@ static void finish_setup_install_queue_cb (GObject      *source_object,
                                            GAsyncResult *result,
                                            gpointer      user_data);
 
+static gboolean setup_deferred_plugins_cb (gpointer user_data);
+
 /* Mark the asynchronous setup operation as complete. This will notify any
  * waiting tasks by cancelling the #GCancellable. It’s safe to clear the
  * #GCancellable as each waiting task holds its own reference. */
@@ -1568,9 +1901,31 @@ static void
 notify_setup_complete (GsPluginLoader *plugin_loader)
 {
 	plugin_loader->setup_complete = TRUE;
+	gs_startup_timeline_add_span ("plugin-loader-setup", plugin_loader->setup_begin_time_usec);
+	gs_plugin_loader_invalidate_refined (plugin_loader);
 	g_cancellable_cancel (plugin_loader->setup_complete_cancellable);
 	g_clear_object (&plugin_loader->setup_complete_cancellable);
 
+	/* deferred plugins may have been asked for before they were deferred */
+	g_mutex_lock (&plugin_loader->deferred_setup_mutex);
+	if (plugin_loader->deferred_setup_requested &&
+	    plugin_loader->deferred_plugins->len > 0 &&
+	    plugin_loader->deferred_setup_id == 0)
+		plugin_loader->deferred_setup_id = g_idle_add (setup_deferred_plugins_cb, plugin_loader);
+	g_mutex_unlock (&plugin_loader->deferred_setup_mutex);
+
+	/* the results served from the snapshot may be out of date, so tell
+	 * the callers to reload them now the plugins can answer for real */
+	if (plugin_loader->n_snapshot_jobs > 0) {
+		g_debug ("setup complete after %" G_GINT64_FORMAT " ms, %u jobs were served from the startup snapshot",
+			 (g_get_monotonic_time () - plugin_loader->setup_begin_time_usec) / G_TIME_SPAN_MILLISECOND,
+			 plugin_loader->n_snapshot_jobs);
+		plugin_loader->n_snapshot_jobs = 0;
+
+		if (plugin_loader->reload_id == 0)
+			plugin_loader->reload_id = g_idle_add (gs_plugin_loader_reload_delay_cb, plugin_loader);
+	}
+
 	g_assert (plugin_loader->icon_downloader == NULL);
 	/* Currently a 160px icon is needed for #GsFeatureTile, at most.
 	   Scaling is applied inside the downloader. */
@@ -1614,6 +1969,8 @@ gs_plugin_loader_setup_async (GsPluginLoader      *plugin_loader,
 		return;
 	}
 
+	plugin_loader->setup_begin_time_usec = g_get_monotonic_time ();
+
 	/* Setup data closure. */
 	setup_data = setup_data_owned = g_new0 (SetupData, 1);
 	setup_data->allowlist = g_strdupv ((gchar **) allowlist);
@@ -1904,6 +2261,7 @@ finish_setup_get_bus (GTask *task)
 
 	/* run setup */
 	data->n_pending = 1;  /* incremented until all operations have been started */
+	data->plugins_begin_time_usec = g_get_monotonic_time ();
 #ifdef HAVE_SYSPROF
 	data->plugins_begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
 #endif
@@ -1914,7 +2272,18 @@ finish_setup_get_bus (GTask *task)
 		if (!gs_plugin_get_enabled (plugin))
 			continue;
 
-		if (GS_PLUGIN_GET_CLASS (plugin)->setup_async != NULL) {
+		if (GS_PLUGIN_GET_CLASS (plugin)->setup_async != NULL &&
+		    plugin_loader->defer_setup &&
+		    gs_plugin_get_setup_deferrable (plugin)) {
+			g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&plugin_loader->deferred_setup_mutex);
+
+			/* keep it out of all jobs until it’s been set up */
+			g_debug ("deferring setup of %s", gs_plugin_get_name (plugin));
+			gs_plugin_set_enabled (plugin, FALSE);
+			g_ptr_array_add (plugin_loader->deferred_plugins, g_object_ref (plugin));
+			if (plugin_loader->deferred_setup_cancellable == NULL)
+				plugin_loader->deferred_setup_cancellable = g_cancellable_new ();
+		} else if (GS_PLUGIN_GET_CLASS (plugin)->setup_async != NULL) {
 			data->n_pending++;
 			GS_PLUGIN_GET_CLASS (plugin)->setup_async (plugin, cancellable,
 								   plugin_setup_cb, g_object_ref (task));
@@ -1932,12 +2301,16 @@ plugin_setup_cb (GObject      *source_object,
 	GsPlugin *plugin = GS_PLUGIN (source_object);
 	g_autoptr(GTask) task = g_steal_pointer (&user_data);
 	g_autoptr(GError) local_error = NULL;
-#ifdef HAVE_SYSPROF
+	g_autofree gchar *timeline_name = NULL;
 	SetupData *data = g_task_get_task_data (task);
-#endif
 
 	g_assert (GS_PLUGIN_GET_CLASS (plugin)->setup_finish != NULL);
 
+	/* the plugins are all set up in parallel, so this is how long each
+	 * one held up setup */
+	timeline_name = g_strdup_printf ("plugin-setup:%s", gs_plugin_get_name (plugin));
+	gs_startup_timeline_add_span (timeline_name, data->plugins_begin_time_usec);
+
 	if (!GS_PLUGIN_GET_CLASS (plugin)->setup_finish (plugin, result, &local_error)) {
 		g_debug ("disabling %s as setup failed: %s",
 			 gs_plugin_get_name (plugin),
@@ -2103,6 +2476,92 @@ gs_plugin_loader_dump_state (GsPluginLoader *plugin_loader)
 		g_string_truncate (str_disabled, str_disabled->len - 2);
 	g_info ("enabled plugins: %s", str_enabled->str);
 	g_info ("disabled plugins: %s", str_disabled->str);
+	g_info ("shared apps: %u live, %u reused",
+		gs_app_registry_get_size (plugin_loader->app_registry),
+		gs_app_registry_get_n_hits (plugin_loader->app_registry));
+	g_info ("coalesced refines: %u",
+		gs_plugin_loader_get_n_coalesced_refines (plugin_loader));
+	g_info ("batched refines: %u",
+		gs_plugin_loader_get_n_batched_refines (plugin_loader));
+}
+
+/**
+ * gs_plugin_loader_get_latency_stats:
+ * @plugin_loader: a #GsPluginLoader
+ *
+ * Get the running latency statistics for each action of each plugin, as
+ * gathered by the jobs which call them. See gs_plugin_get_latency_stats().
+ *
+ * The result is an array with one `(ssttttt)` entry per plugin and action
+ * which has been called, sorted by plugin order: the plugin name, the action,
+ * the number of calls, then the 50th, 95th and 99th percentiles and the
+ * maximum of how long they took, in microseconds.
+ *
+ * Returns: (transfer floating): an `a(ssttttt)` array of statistics
+ * Since: 51
+ */
+GVariant *
+gs_plugin_loader_get_latency_stats (GsPluginLoader *plugin_loader)
+{
+	g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a(ssttttt)"));
+
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
+
+	for (guint i = 0; i < plugin_loader->plugins->len; i++) {
+		GsPlugin *plugin = g_ptr_array_index (plugin_loader->plugins, i);
+		g_autoptr(GVariant) plugin_stats = g_variant_ref_sink (gs_plugin_get_latency_stats (plugin));
+		GVariantIter iter;
+		const gchar *action;
+		guint64 count, p50, p95, p99, max;
+
+		g_variant_iter_init (&iter, plugin_stats);
+		while (g_variant_iter_next (&iter, "{&s(ttttt)}", &action, &count, &p50, &p95, &p99, &max)) {
+			g_variant_builder_add (&builder, "(ssttttt)",
+					       gs_plugin_get_name (plugin), action,
+					       count, p50, p95, p99, max);
+		}
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * gs_plugin_loader_latency_stats_to_string:
+ * @plugin_loader: a #GsPluginLoader
+ *
+ * Format the statistics from gs_plugin_loader_get_latency_stats() as a
+ * table, one plugin and action per line, with times in milliseconds.
+ *
+ * Returns: (transfer full): the formatted statistics
+ * Since: 51
+ */
+gchar *
+gs_plugin_loader_latency_stats_to_string (GsPluginLoader *plugin_loader)
+{
+	g_autoptr(GVariant) stats = NULL;
+	GString *str = g_string_new (NULL);
+	GVariantIter iter;
+	const gchar *plugin_name, *action;
+	guint64 count, p50, p95, p99, max;
+
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
+
+	stats = g_variant_ref_sink (gs_plugin_loader_get_latency_stats (plugin_loader));
+
+	g_string_append_printf (str, "%-24s %-18s %8s %10s %10s %10s %10s\n",
+				"plugin", "action", "count", "p50 (ms)", "p95 (ms)", "p99 (ms)", "max (ms)");
+
+	g_variant_iter_init (&iter, stats);
+	while (g_variant_iter_next (&iter, "(&s&sttttt)", &plugin_name, &action, &count, &p50, &p95, &p99, &max)) {
+		g_string_append_printf (str, "%-24s %-18s %8" G_GUINT64_FORMAT " %10.1f %10.1f %10.1f %10.1f\n",
+					plugin_name, action, count,
+					(gdouble) p50 / G_TIME_SPAN_MILLISECOND,
+					(gdouble) p95 / G_TIME_SPAN_MILLISECOND,
+					(gdouble) p99 / G_TIME_SPAN_MILLISECOND,
+					(gdouble) max / G_TIME_SPAN_MILLISECOND);
+	}
+
+	return g_string_free (str, FALSE);
 }
 
 static void
@@ -2133,6 +2592,9 @@ gs_plugin_loader_get_property (GObject *object, guint prop_id,
 	case PROP_CPU_PRIORITY:
 		g_value_set_int (value, gs_plugin_loader_get_cpu_priority (plugin_loader));
 		break;
+	case PROP_REFINE_BATCH_WINDOW:
+		g_value_set_uint (value, gs_plugin_loader_get_refine_batch_window (plugin_loader));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -2166,6 +2628,9 @@ gs_plugin_loader_set_property (GObject *object, guint prop_id,
 	case PROP_CPU_PRIORITY:
 		gs_plugin_loader_set_cpu_priority (plugin_loader, g_value_get_int (value));
 		break;
+	case PROP_REFINE_BATCH_WINDOW:
+		gs_plugin_loader_set_refine_batch_window (plugin_loader, g_value_get_uint (value));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -2196,6 +2661,14 @@ gs_plugin_loader_dispose (GObject *object)
 		plugin_loader->reload_id = 0;
 	}
 
+	g_mutex_lock (&plugin_loader->deferred_setup_mutex);
+	g_clear_handle_id (&plugin_loader->deferred_setup_id, g_source_remove);
+	g_mutex_unlock (&plugin_loader->deferred_setup_mutex);
+
+	g_mutex_lock (&plugin_loader->events_by_id_mutex);
+	g_clear_handle_id (&plugin_loader->event_rate_limits_flush_id, g_source_remove);
+	g_mutex_unlock (&plugin_loader->events_by_id_mutex);
+
 	/* Cancel any pending idle callbacks */
 	g_mutex_lock (&plugin_loader->idle_queue_mutex);
 	for (unsigned int i = plugin_loader->idle_queue->len; i > 0; i--) {
@@ -2226,12 +2699,15 @@ gs_plugin_loader_dispose (GObject *object)
 	g_clear_object (&plugin_loader->settings);
 	g_clear_object (&plugin_loader->pending_apps);
 	g_clear_object (&plugin_loader->job_manager);
+	g_clear_object (&plugin_loader->app_registry);
 	g_clear_object (&plugin_loader->category_manager);
 	g_clear_object (&plugin_loader->odrs_provider);
 	g_clear_object (&plugin_loader->icon_downloader);
 	g_clear_object (&plugin_loader->icon_downloader_soup_session);
 	g_clear_object (&plugin_loader->setup_complete_cancellable);
 	g_clear_object (&plugin_loader->pending_apps_cancellable);
+	g_clear_object (&plugin_loader->snapshot);
+	g_clear_object (&plugin_loader->snapshot_file);
 
 	g_clear_object (&plugin_loader->session_bus_connection);
 	g_clear_object (&plugin_loader->system_bus_connection);
@@ -2249,14 +2725,22 @@ gs_plugin_loader_finalize (GObject *object)
 	g_ptr_array_unref (plugin_loader->idle_queue);
 	g_mutex_unlock (&plugin_loader->idle_queue_mutex);
 	g_mutex_clear (&plugin_loader->idle_queue_mutex);
+	g_ptr_array_unref (plugin_loader->deferred_plugins);
+	g_mutex_clear (&plugin_loader->deferred_setup_mutex);
 
 	g_strfreev (plugin_loader->compatible_projects);
 	g_ptr_array_unref (plugin_loader->locations);
 	g_free (plugin_loader->language);
 	g_ptr_array_unref (plugin_loader->file_monitors);
 	g_hash_table_unref (plugin_loader->events_by_id);
+	g_hash_table_unref (plugin_loader->event_rate_limits);
 	g_hash_table_unref (plugin_loader->disallow_updates);
+	g_hash_table_unref (plugin_loader->inflight_refines);
+	g_assert (g_hash_table_size (plugin_loader->refine_batches) == 0);
+	g_hash_table_unref (plugin_loader->refine_batches);
 
+	g_mutex_clear (&plugin_loader->inflight_refines_mutex);
+	g_mutex_clear (&plugin_loader->refine_batches_mutex);
 	g_mutex_clear (&plugin_loader->pending_apps_mutex);
 	g_mutex_clear (&plugin_loader->events_by_id_mutex);
 
@@ -2366,6 +2850,21 @@ gs_plugin_loader_class_init (GsPluginLoaderClass *klass)
 				  INT_MIN, INT_MAX, G_PRIORITY_DEFAULT,
 				  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
 
+	/**
+	 * GsPluginLoader:refine-batch-window:
+	 *
+	 * Time to wait, in milliseconds, for more single-app refines to arrive
+	 * so they can all be passed to the plugins in one #GsAppList.
+	 *
+	 * Zero, the default, disables batching.
+	 *
+	 * Since: 51
+	 */
+	obj_props[PROP_REFINE_BATCH_WINDOW] =
+		g_param_spec_uint ("refine-batch-window", NULL, NULL,
+				   0, G_MAXUINT, 0,
+				   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
+
 	g_object_class_install_properties (object_class, G_N_ELEMENTS (obj_props), obj_props);
 
 	signals [SIGNAL_PENDING_APPS_CHANGED] =
@@ -2435,7 +2934,19 @@ gs_plugin_loader_init (GsPluginLoader *plugin_loader)
 	const guint odrs_review_n_results_max = 50;
 	const gchar *locale;
 
+	/* define the process-wide sysprof counters before anything updates them */
+	gs_profiler_init_counters ();
+
 	plugin_loader->setup_complete_cancellable = g_cancellable_new ();
+	plugin_loader->refine_generation = 1;
+
+	g_mutex_init (&plugin_loader->inflight_refines_mutex);
+	plugin_loader->inflight_refines = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+								 g_object_unref,
+								 (GDestroyNotify) inflight_refine_free);
+	g_mutex_init (&plugin_loader->refine_batches_mutex);
+	plugin_loader->refine_batches = g_hash_table_new_full (g_str_hash, g_str_equal,
+							       NULL, (GDestroyNotify) refine_batch_free);
 	plugin_loader->scale = 1;
 	plugin_loader->cpu_priority = G_PRIORITY_DEFAULT;
 	plugin_loader->plugins = g_ptr_array_new_with_free_func (g_object_unref);
@@ -2449,13 +2960,21 @@ gs_plugin_loader_init (GsPluginLoader *plugin_loader)
 							     (GEqualFunc) as_utils_data_id_equal,
 							     g_free,
 							     (GDestroyNotify) g_object_unref);
+	plugin_loader->event_rate_limits = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+								  (GDestroyNotify) event_rate_limit_free);
+	plugin_loader->event_rate_limit_window_ms = EVENT_RATE_LIMIT_WINDOW_MS;
 
 	g_mutex_init (&plugin_loader->idle_queue_mutex);
+	g_mutex_init (&plugin_loader->deferred_setup_mutex);
+	plugin_loader->deferred_plugins = g_ptr_array_new_with_free_func (g_object_unref);
 	plugin_loader->idle_queue = g_ptr_array_new_with_free_func ((GDestroyNotify) g_source_unref);
 
 	/* get the job manager */
 	plugin_loader->job_manager = gs_job_manager_new ();
 
+	/* live apps shared between plugins and jobs */
+	plugin_loader->app_registry = gs_app_registry_new ();
+
 	/* get the category manager */
 	plugin_loader->category_manager = gs_category_manager_new ();
 
@@ -2945,6 +3464,9 @@ run_job_cb (GObject      *source_object,
 		}
 	}
 
+	if (plugin_loader->snapshot != NULL)
+		gs_startup_snapshot_record_job (plugin_loader->snapshot, plugin_job);
+
 	g_task_return_boolean (task, TRUE);
 }
 
@@ -3039,9 +3561,22 @@ gs_plugin_loader_job_process_async (GsPluginLoader *plugin_loader,
 	 * Do this using a #GCancellable. While we’re not using the #GCancellable
 	 * to cancel anything, it is a reliable way to signal between threads
 	 * without polling, waking up all waiting #GMainContexts when it’s
-	 * ‘cancelled’. */
+	 * ‘cancelled’.
+	 *
+	 * Some jobs can be answered from the snapshot of the previous run
+	 * instead, which gets something on screen much sooner. */
 	if (plugin_loader->setup_complete) {
 		job_process_cb (task);
+	} else if (plugin_loader->snapshot != NULL &&
+		   gs_startup_snapshot_serve_job (plugin_loader->snapshot, plugin_job,
+						  plugin_loader->category_manager)) {
+		g_debug ("served %s from the startup snapshot after %" G_GINT64_FORMAT " ms",
+			 G_OBJECT_TYPE_NAME (plugin_job),
+			 (g_get_monotonic_time () - plugin_loader->setup_begin_time_usec) / G_TIME_SPAN_MILLISECOND);
+		if (plugin_loader->n_snapshot_jobs++ == 0)
+			gs_startup_timeline_mark ("startup-snapshot-served");
+		g_task_return_boolean (task, TRUE);
+		g_signal_emit_by_name (plugin_job, "completed");
 	} else {
 		g_autoptr(GSource) cancellable_source = g_cancellable_source_new (plugin_loader->setup_complete_cancellable);
 		g_task_attach_source (task, cancellable_source, G_SOURCE_FUNC (job_process_setup_complete_cb));
@@ -3058,7 +3593,7 @@ job_process_event_cb (GsPluginJob   *plugin_job,
 	GsPluginLoader *plugin_loader = g_task_get_source_object (task);
 
 	gs_plugin_event_set_job (event, plugin_job);
-	gs_plugin_loader_add_event (plugin_loader, event);
+	gs_plugin_loader_add_event_internal (plugin_loader, plugin, event);
 }
 
 static gboolean
@@ -3072,6 +3607,30 @@ job_process_setup_complete_cb (GCancellable *cancellable,
 	return G_SOURCE_REMOVE;
 }
 
+/* Whether @plugin_job has to wait for the plugins whose setup was deferred.
+ * Jobs which only enumerate or refine apps for display can do without them
+ * for now, and are reloaded once they are set up; anything else might act on
+ * apps which only those plugins know about. */
+static gboolean
+job_needs_deferred_plugins (GsPluginJob *plugin_job)
+{
+	g_autoptr(GsAppQuery) query = NULL;
+
+	if (GS_IS_PLUGIN_JOB_REFINE (plugin_job) ||
+	    GS_IS_PLUGIN_JOB_LIST_CATEGORIES (plugin_job))
+		return FALSE;
+
+	/* updates have to be complete, or they’d be notified in pieces */
+	if (GS_IS_PLUGIN_JOB_LIST_APPS (plugin_job)) {
+		g_object_get (plugin_job, "query", &query, NULL);
+		return (query != NULL &&
+			(gs_app_query_get_is_for_update (query) == GS_APP_QUERY_TRISTATE_TRUE ||
+			 gs_app_query_get_is_historical_update (query) == GS_APP_QUERY_TRISTATE_TRUE));
+	}
+
+	return TRUE;
+}
+
 static void
 job_process_cb (GTask *task)
 {
@@ -3079,6 +3638,25 @@ job_process_cb (GTask *task)
 	GsPluginJob *plugin_job = data->plugin_job;
 	GsPluginLoader *plugin_loader = g_task_get_source_object (task);
 	GCancellable *cancellable = g_task_get_cancellable (task);
+	gboolean wait_for_deferred = FALSE;
+
+	/* Wait for any deferred plugins to be set up, the same way as
+	 * gs_plugin_loader_job_process_async() waits for setup. */
+	g_mutex_lock (&plugin_loader->deferred_setup_mutex);
+	if (plugin_loader->deferred_setup_cancellable != NULL &&
+	    job_needs_deferred_plugins (plugin_job)) {
+		g_autoptr(GSource) cancellable_source = g_cancellable_source_new (plugin_loader->deferred_setup_cancellable);
+		g_task_attach_source (task, cancellable_source, G_SOURCE_FUNC (job_process_setup_complete_cb));
+		wait_for_deferred = TRUE;
+	}
+	g_mutex_unlock (&plugin_loader->deferred_setup_mutex);
+
+	if (wait_for_deferred) {
+		g_debug ("%s is waiting for deferred plugins to be set up",
+			 G_OBJECT_TYPE_NAME (plugin_job));
+		gs_plugin_loader_setup_deferred_plugins (plugin_loader);
+		return;
+	}
 
 #ifdef HAVE_SYSPROF
 	data->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
@@ -3195,8 +3773,9 @@ app_create_cb (GObject      *source_object,
 		return;
 	}
 
-	/* return the matching GsApp */
+	/* return the matching GsApp, preferring an instance already in use */
 	list = gs_plugin_job_refine_get_result_list (refine_job);
+	gs_plugin_loader_share_apps (plugin_loader, list);
 	for (guint i = 0; i < gs_app_list_length (list); i++) {
 		GsApp *app_tmp = gs_app_list_index (list, i);
 		if (g_strcmp0 (unique_id, gs_app_get_unique_id (app_tmp)) == 0) {
@@ -3360,6 +3939,8 @@ gs_plugin_loader_emit_updates_changed (GsPluginLoader *self)
 {
 	g_return_if_fail (GS_IS_PLUGIN_LOADER (self));
 
+	gs_plugin_loader_invalidate_refined (self);
+
 	if (self->updates_changed_id != 0)
 		g_source_remove (self->updates_changed_id);
 
@@ -3369,6 +3950,691 @@ gs_plugin_loader_emit_updates_changed (GsPluginLoader *self)
 				 g_object_ref (self), g_object_unref);
 }
 
+/**
+ * gs_plugin_loader_share_apps:
+ * @self: a #GsPluginLoader
+ * @list: a #GsAppList
+ *
+ * Swap each app in @list for the live instance already registered in the
+ * loader’s app registry for the same unique ID and management plugin, and
+ * register the others. Jobs which produce the same component, such as the
+ * list-apps jobs behind the overview, category and search pages, then return
+ * the same #GsApp, and what was refined on it for one job is not refined
+ * again for the next.
+ *
+ * Wildcard apps are left as they are.
+ *
+ * Since: 51
+ */
+void
+gs_plugin_loader_share_apps (GsPluginLoader *self,
+                             GsAppList      *list)
+{
+	g_autoptr(GsAppList) shared_list = NULL;
+	gboolean swapped = FALSE;
+
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (self));
+	g_return_if_fail (GS_IS_APP_LIST (list));
+
+	shared_list = gs_app_list_new ();
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		g_autoptr(GsApp) shared_app = gs_app_registry_share (self->app_registry, app);
+
+		if (shared_app != app)
+			swapped = TRUE;
+		gs_app_list_add (shared_list, shared_app);
+	}
+
+	if (!swapped)
+		return;
+
+	gs_app_list_remove_all (list);
+	gs_app_list_add_list (list, shared_list);
+}
+
+/* Any data refined so far may be out of date, for example because a plugin
+ * has new metadata or a repository has changed. Bumping the generation makes
+ * gs_app_get_refined_require_flags() forget what has been refined.
+ *
+ * Silos being invalidated, for example by their file monitors, is covered
+ * separately by gs_silo_wrapper_get_global_change_stamp(), as plugins don’t
+ * tell the loader about that. */
+static void
+gs_plugin_loader_invalidate_refined (GsPluginLoader *plugin_loader)
+{
+	g_atomic_int_inc (&plugin_loader->refine_generation);
+}
+
+/**
+ * gs_plugin_loader_get_refine_generation:
+ * @self: a #GsPluginLoader
+ *
+ * Gets the current refine generation. This changes whenever the data
+ * previously refined on apps may have become stale, and is used with
+ * gs_app_get_refined_require_flags() to skip redundant refine work. That
+ * record is kept per instance, and carries over to later jobs through the
+ * instances shared by gs_plugin_loader_share_apps().
+ *
+ * It changes on #GsPluginLoader::updates-changed and #GsPluginLoader::reload,
+ * when a repository changes, when the caches are cleared, and whenever any
+ * #GsSiloWrapper is invalidated.
+ *
+ * Returns: the refine generation
+ * Since: 51
+ */
+guint
+gs_plugin_loader_get_refine_generation (GsPluginLoader *self)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (self), 0);
+
+	/* both only ever increase, so the sum changes whenever either does */
+	return (guint) g_atomic_int_get (&self->refine_generation) +
+	       gs_silo_wrapper_get_global_change_stamp ();
+}
+
+/**
+ * gs_plugin_loader_begin_refine:
+ * @self: a #GsPluginLoader
+ * @list: apps which are about to be refined
+ * @refine_flags: the job flags which affect the result of the refine, such
+ *   as %GS_PLUGIN_REFINE_FLAGS_INTERACTIVE
+ * @require_flags: the data which is going to be refined
+ * @func: function to call when a pending refine which is being waited for
+ *   finishes
+ * @user_data: data to pass to @func
+ * @claimed: (element-type GsApp): return location for the apps which the
+ *   caller is now responsible for refining
+ *
+ * Coalesce a refine of @list with any refines of the same apps which are
+ * already in progress.
+ *
+ * If every app in @list is already being refined with the same
+ * @refine_flags and at least @require_flags, the caller should not refine them
+ * again. Instead @func is called in the thread-default main context once for
+ * each of those pending refines as it finishes, after which the apps will have
+ * been refined (see gs_app_get_refined_require_flags()), unless that refine
+ * failed. If the caller stops waiting before then, it must call
+ * gs_plugin_loader_cancel_refine_wait().
+ *
+ * Otherwise, the apps in @list which are not already being refined are added
+ * to @claimed and marked as being refined with @require_flags, and the caller
+ * must refine @list and then call gs_plugin_loader_end_refine() with
+ * @claimed.
+ *
+ * Wildcard apps are never coalesced.
+ *
+ * Returns: the number of times @func will be called; if zero, the caller
+ *   should refine @list now
+ * Since: 51
+ */
+guint
+gs_plugin_loader_begin_refine (GsPluginLoader             *self,
+                               GsAppList                  *list,
+                               GsPluginRefineFlags         refine_flags,
+                               GsPluginRefineRequireFlags  require_flags,
+                               GSourceFunc                 func,
+                               gpointer                    user_data,
+                               GPtrArray                  *claimed)
+{
+	g_autoptr(GPtrArray) to_wait_for = g_ptr_array_new ();
+	g_autoptr(GMutexLocker) locker = NULL;
+	guint n_apps = 0;
+
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (self), 0);
+	g_return_val_if_fail (GS_IS_APP_LIST (list), 0);
+	g_return_val_if_fail (func != NULL, 0);
+	g_return_val_if_fail (claimed != NULL, 0);
+
+	locker = g_mutex_locker_new (&self->inflight_refines_mutex);
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		InflightRefine *inflight;
+
+		if (gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD))
+			continue;
+
+		n_apps++;
+		inflight = g_hash_table_lookup (self->inflight_refines, app);
+		if (inflight == NULL ||
+		    inflight->refine_flags != refine_flags ||
+		    (inflight->require_flags & require_flags) != require_flags) {
+			g_ptr_array_set_size (to_wait_for, 0);
+			break;
+		}
+
+		if (!g_ptr_array_find (to_wait_for, inflight, NULL))
+			g_ptr_array_add (to_wait_for, inflight);
+	}
+
+	/* attach to the pending refines */
+	if (to_wait_for->len > 0) {
+		for (guint i = 0; i < to_wait_for->len; i++) {
+			InflightRefine *inflight = g_ptr_array_index (to_wait_for, i);
+			RefineWaiter waiter = {
+				.context = g_main_context_ref_thread_default (),
+				.func = func,
+				.user_data = user_data,
+			};
+
+			g_array_append_val (inflight->waiters, waiter);
+		}
+
+		g_atomic_int_add (&self->n_coalesced_refines, n_apps);
+
+		return to_wait_for->len;
+	}
+
+	/* otherwise, refine them here */
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		InflightRefine *inflight;
+
+		if (gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD) ||
+		    g_hash_table_contains (self->inflight_refines, app))
+			continue;
+
+		inflight = g_new0 (InflightRefine, 1);
+		inflight->refine_flags = refine_flags;
+		inflight->require_flags = require_flags;
+		inflight->waiters = g_array_new (FALSE, FALSE, sizeof (RefineWaiter));
+		g_hash_table_insert (self->inflight_refines, g_object_ref (app), inflight);
+		g_ptr_array_add (claimed, g_object_ref (app));
+	}
+
+	return 0;
+}
+
+/**
+ * gs_plugin_loader_cancel_refine_wait:
+ * @self: a #GsPluginLoader
+ * @func: the function passed to gs_plugin_loader_begin_refine()
+ * @user_data: the data passed to gs_plugin_loader_begin_refine()
+ *
+ * Stop waiting for the pending refines which gs_plugin_loader_begin_refine()
+ * attached @func and @user_data to. @func will not be called for the ones
+ * which have not finished yet.
+ *
+ * Calls of @func which have already been queued, because their refine has
+ * finished, still happen.
+ *
+ * Returns: the number of pending refines for which @func will no longer be
+ *   called
+ * Since: 51
+ */
+guint
+gs_plugin_loader_cancel_refine_wait (GsPluginLoader *self,
+                                     GSourceFunc     func,
+                                     gpointer        user_data)
+{
+	GHashTableIter iter;
+	gpointer value;
+	guint n_removed = 0;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (self), 0);
+	g_return_val_if_fail (func != NULL, 0);
+
+	locker = g_mutex_locker_new (&self->inflight_refines_mutex);
+
+	g_hash_table_iter_init (&iter, self->inflight_refines);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		InflightRefine *inflight = value;
+
+		for (guint i = inflight->waiters->len; i > 0; i--) {
+			RefineWaiter *waiter = &g_array_index (inflight->waiters, RefineWaiter, i - 1);
+
+			if (waiter->func != func || waiter->user_data != user_data)
+				continue;
+
+			g_main_context_unref (waiter->context);
+			g_array_remove_index (inflight->waiters, i - 1);
+			n_removed++;
+		}
+	}
+
+	return n_removed;
+}
+
+/**
+ * gs_plugin_loader_end_refine:
+ * @self: a #GsPluginLoader
+ * @claimed: (element-type GsApp): the apps claimed by
+ *   gs_plugin_loader_begin_refine()
+ *
+ * Mark the refine of the apps in @claimed as finished, successfully or not,
+ * and wake up any refines which were waiting for it.
+ *
+ * Since: 51
+ */
+void
+gs_plugin_loader_end_refine (GsPluginLoader *self,
+                             GPtrArray      *claimed)
+{
+	g_autoptr(GArray) waiters = g_array_new (FALSE, FALSE, sizeof (RefineWaiter));
+
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (self));
+	g_return_if_fail (claimed != NULL);
+
+	g_mutex_lock (&self->inflight_refines_mutex);
+	for (guint i = 0; i < claimed->len; i++) {
+		GsApp *app = g_ptr_array_index (claimed, i);
+		InflightRefine *inflight = g_hash_table_lookup (self->inflight_refines, app);
+
+		if (inflight == NULL)
+			continue;
+
+		g_array_append_vals (waiters, inflight->waiters->data, inflight->waiters->len);
+		g_array_set_size (inflight->waiters, 0);
+		g_hash_table_remove (self->inflight_refines, app);
+	}
+	g_mutex_unlock (&self->inflight_refines_mutex);
+
+	/* call the waiters without the lock held, as they may start refining */
+	for (guint i = 0; i < waiters->len; i++) {
+		RefineWaiter *waiter = &g_array_index (waiters, RefineWaiter, i);
+
+		g_main_context_invoke (waiter->context, waiter->func, waiter->user_data);
+		g_main_context_unref (waiter->context);
+	}
+}
+
+/**
+ * gs_plugin_loader_get_n_coalesced_refines:
+ * @self: a #GsPluginLoader
+ *
+ * Get the number of app refines which were not run because they could be
+ * coalesced with an identical refine already in progress.
+ *
+ * Returns: number of coalesced app refines
+ * Since: 51
+ */
+guint
+gs_plugin_loader_get_n_coalesced_refines (GsPluginLoader *self)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (self), 0);
+
+	return (guint) g_atomic_int_get (&self->n_coalesced_refines);
+}
+
+static gboolean
+refine_batch_timeout_cb (gpointer user_data)
+{
+	RefineBatch *batch = user_data;
+	GsPluginLoader *self = batch->plugin_loader;
+
+	/* close the batch, so later refines start a new one */
+	g_mutex_lock (&self->refine_batches_mutex);
+	g_hash_table_steal (self->refine_batches, batch->key);
+	g_mutex_unlock (&self->refine_batches_mutex);
+
+	batch->func (batch->tasks);
+	refine_batch_free (batch);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * gs_plugin_loader_add_to_refine_batch:
+ * @self: a #GsPluginLoader
+ * @key: identifies which refines can be batched together
+ * @task: the task for the refine to batch
+ * @func: function to call to run the batch
+ *
+ * Add a refine to the open batch of refines for @key, or open a new batch
+ * for it if there is none.
+ *
+ * A batch is closed once #GsPluginLoader:refine-batch-window has passed since
+ * it was opened, and @func is then called in the thread-default main context
+ * of the refine which opened it, with the tasks of all the refines added to
+ * it, in the order they were added. @func is responsible for refining all of
+ * them, typically all at once, and for completing the tasks.
+ *
+ * Refines must only be given the same @key if they can be run as one, for
+ * example if they have the same #GsPluginRefineFlags and
+ * #GsPluginRefineRequireFlags.
+ *
+ * Returns: %TRUE if @task was added to a batch, %FALSE if batching is disabled
+ *   and the caller should run the refine now
+ * Since: 51
+ */
+gboolean
+gs_plugin_loader_add_to_refine_batch (GsPluginLoader                *self,
+                                      const gchar                   *key,
+                                      GTask                         *task,
+                                      GsPluginLoaderRefineBatchFunc  func)
+{
+	RefineBatch *batch;
+	guint window_ms;
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GSource) source = NULL;
+	g_autoptr(GMainContext) context = NULL;
+
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (self), FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+	g_return_val_if_fail (G_IS_TASK (task), FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+
+	window_ms = gs_plugin_loader_get_refine_batch_window (self);
+	if (window_ms == 0)
+		return FALSE;
+
+	locker = g_mutex_locker_new (&self->refine_batches_mutex);
+
+	batch = g_hash_table_lookup (self->refine_batches, key);
+	if (batch != NULL) {
+		g_ptr_array_add (batch->tasks, g_object_ref (task));
+		g_atomic_int_inc (&self->n_batched_refines);
+		return TRUE;
+	}
+
+	batch = g_new0 (RefineBatch, 1);
+	batch->plugin_loader = g_object_ref (self);
+	batch->key = g_strdup (key);
+	batch->tasks = g_ptr_array_new_with_free_func (g_object_unref);
+	batch->func = func;
+	g_ptr_array_add (batch->tasks, g_object_ref (task));
+	g_hash_table_insert (self->refine_batches, batch->key, batch);
+
+	context = g_main_context_ref_thread_default ();
+	source = g_timeout_source_new (window_ms);
+	g_source_set_name (source, "[gnome-software] refine batch");
+	g_source_set_callback (source, refine_batch_timeout_cb, batch, NULL);
+	g_source_attach (source, context);
+
+	return TRUE;
+}
+
+/**
+ * gs_plugin_loader_get_n_batched_refines:
+ * @self: a #GsPluginLoader
+ *
+ * Get the number of refines which were added to a batch opened by another
+ * refine, and so were run along with it rather than on their own.
+ *
+ * Returns: number of batched refines
+ * Since: 51
+ */
+guint
+gs_plugin_loader_get_n_batched_refines (GsPluginLoader *self)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (self), 0);
+
+	return (guint) g_atomic_int_get (&self->n_batched_refines);
+}
+
+/**
+ * gs_plugin_loader_get_refine_batch_window:
+ * @self: a #GsPluginLoader
+ *
+ * Gets the value of #GsPluginLoader:refine-batch-window.
+ *
+ * Returns: the batching window, in milliseconds, or zero if disabled
+ * Since: 51
+ */
+guint
+gs_plugin_loader_get_refine_batch_window (GsPluginLoader *self)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (self), 0);
+
+	return (guint) g_atomic_int_get (&self->refine_batch_window_ms);
+}
+
+/**
+ * gs_plugin_loader_set_refine_batch_window:
+ * @self: a #GsPluginLoader
+ * @window_ms: time to wait for more refines, in milliseconds, or zero to
+ *   disable batching
+ *
+ * Sets the value of #GsPluginLoader:refine-batch-window.
+ *
+ * This only affects batches opened after the call.
+ *
+ * Since: 51
+ */
+void
+gs_plugin_loader_set_refine_batch_window (GsPluginLoader *self,
+                                          guint           window_ms)
+{
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (self));
+
+	if ((guint) g_atomic_int_get (&self->refine_batch_window_ms) == window_ms)
+		return;
+
+	g_atomic_int_set (&self->refine_batch_window_ms, window_ms);
+	g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_REFINE_BATCH_WINDOW]);
+}
+
+/**
+ * gs_plugin_loader_set_snapshot_file:
+ * @self: a #GsPluginLoader
+ * @file: (nullable): file to keep the startup snapshot in, or %NULL to
+ *   disable the snapshot
+ *
+ * Sets the file to keep the #GsStartupSnapshot in, and loads the snapshot
+ * from it if it exists.
+ *
+ * While the plugins are being set up, jobs which set
+ * %GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT or
+ * %GS_PLUGIN_REFINE_CATEGORIES_FLAGS_ALLOW_SNAPSHOT, and whose results are in
+ * the snapshot, are answered from it straight away rather than waiting for
+ * setup to complete. #GsPluginLoader::reload is emitted once setup is
+ * complete, so callers can replace those results with up to date ones. Use
+ * gs_plugin_loader_can_serve_snapshot() to check whether it is worth making
+ * those jobs before setup completes.
+ *
+ * Once setup is complete, the results of those jobs are recorded, and saved
+ * to @file by gs_plugin_loader_shutdown().
+ *
+ * This should be called before gs_plugin_loader_setup_async().
+ *
+ * Since: 51
+ */
+void
+gs_plugin_loader_set_snapshot_file (GsPluginLoader *self,
+                                    GFile          *file)
+{
+	g_autoptr(GError) local_error = NULL;
+
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (self));
+	g_return_if_fail (file == NULL || G_IS_FILE (file));
+
+	g_clear_object (&self->snapshot);
+	g_set_object (&self->snapshot_file, file);
+
+	if (file == NULL)
+		return;
+
+	self->snapshot = gs_startup_snapshot_new ();
+	if (!gs_startup_snapshot_load (self->snapshot, file, &local_error) &&
+	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+		g_debug ("Failed to load startup snapshot: %s", local_error->message);
+}
+
+/**
+ * gs_plugin_loader_can_serve_snapshot:
+ * @self: a #GsPluginLoader
+ *
+ * Check whether jobs can currently be answered from the startup snapshot:
+ * a snapshot with some results in it was loaded by
+ * gs_plugin_loader_set_snapshot_file(), and setup has not completed yet.
+ *
+ * The shell uses this to show its pages before the plugins are set up.
+ *
+ * Returns: %TRUE if jobs can be served from the snapshot, %FALSE otherwise
+ * Since: 51
+ */
+gboolean
+gs_plugin_loader_can_serve_snapshot (GsPluginLoader *self)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (self), FALSE);
+
+	return (!self->setup_complete &&
+		self->snapshot != NULL &&
+		!gs_startup_snapshot_is_empty (self->snapshot));
+}
+
+/**
+ * gs_plugin_loader_save_snapshot:
+ * @self: a #GsPluginLoader
+ * @error: return location for a #GError, or %NULL
+ *
+ * Save the startup snapshot to the file set with
+ * gs_plugin_loader_set_snapshot_file(). This is done automatically by
+ * gs_plugin_loader_shutdown().
+ *
+ * It is not an error to call this if no snapshot file is set.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ * Since: 51
+ */
+gboolean
+gs_plugin_loader_save_snapshot (GsPluginLoader  *self,
+                                GError         **error)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (self->snapshot == NULL)
+		return TRUE;
+
+	return gs_startup_snapshot_save (self->snapshot, self->snapshot_file, error);
+}
+
+/**
+ * gs_plugin_loader_set_defer_setup:
+ * @self: a #GsPluginLoader
+ * @defer_setup: %TRUE to defer setting up plugins which allow it
+ *
+ * Sets whether gs_plugin_loader_setup_async() skips setting up the plugins
+ * which have called gs_plugin_set_setup_deferrable(), so that setup completes
+ * sooner and those plugins use no resources until they are needed.
+ *
+ * Deferred plugins are set up once gs_plugin_loader_setup_deferred_plugins()
+ * is called, or when a job which needs them is run. Until then they are
+ * disabled. Once they are set up, refined data is invalidated and
+ * #GsPluginLoader::reload is emitted, so that callers can pick up the apps
+ * which those plugins provide.
+ *
+ * This should be called before gs_plugin_loader_setup_async(). It defaults
+ * to %FALSE.
+ *
+ * Since: 51
+ */
+void
+gs_plugin_loader_set_defer_setup (GsPluginLoader *self,
+                                  gboolean        defer_setup)
+{
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (self));
+
+	self->defer_setup = defer_setup;
+}
+
+static void deferred_plugin_setup_cb (GObject      *source_object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data);
+
+static gboolean
+setup_deferred_plugins_cb (gpointer user_data)
+{
+	GsPluginLoader *self = GS_PLUGIN_LOADER (user_data);
+	g_autoptr(GPtrArray) plugins = NULL;
+
+	g_mutex_lock (&self->deferred_setup_mutex);
+	self->deferred_setup_id = 0;
+	plugins = g_steal_pointer (&self->deferred_plugins);
+	self->deferred_plugins = g_ptr_array_new_with_free_func (g_object_unref);
+	g_mutex_unlock (&self->deferred_setup_mutex);
+
+	if (plugins->len == 0)
+		return G_SOURCE_REMOVE;
+
+	self->n_deferred_pending = plugins->len;
+	self->deferred_setup_begin_time_usec = g_get_monotonic_time ();
+
+	for (guint i = 0; i < plugins->len; i++) {
+		GsPlugin *plugin = GS_PLUGIN (plugins->pdata[i]);
+
+		g_debug ("setting up deferred plugin %s", gs_plugin_get_name (plugin));
+		GS_PLUGIN_GET_CLASS (plugin)->setup_async (plugin, NULL,
+							   deferred_plugin_setup_cb,
+							   g_object_ref (self));
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+deferred_plugin_setup_cb (GObject      *source_object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+	GsPlugin *plugin = GS_PLUGIN (source_object);
+	g_autoptr(GsPluginLoader) self = g_steal_pointer (&user_data);
+	g_autoptr(GCancellable) deferred_setup_cancellable = NULL;
+	g_autoptr(GError) local_error = NULL;
+	g_autofree gchar *timeline_name = NULL;
+
+	timeline_name = g_strdup_printf ("deferred-plugin-setup:%s", gs_plugin_get_name (plugin));
+	gs_startup_timeline_add_span (timeline_name, self->deferred_setup_begin_time_usec);
+
+	if (GS_PLUGIN_GET_CLASS (plugin)->setup_finish (plugin, result, &local_error))
+		gs_plugin_set_enabled (plugin, TRUE);
+	else
+		g_debug ("not enabling %s as deferred setup failed: %s",
+			 gs_plugin_get_name (plugin),
+			 local_error->message);
+
+	g_assert (self->n_deferred_pending > 0);
+	if (--self->n_deferred_pending > 0)
+		return;
+
+	g_debug ("deferred plugins set up after %" G_GINT64_FORMAT " ms",
+		 (g_get_monotonic_time () - self->deferred_setup_begin_time_usec) / G_TIME_SPAN_MILLISECOND);
+
+	/* plugins may have been deferred again meanwhile, by a shutdown and
+	 * new setup; in that case the waiting jobs wait for those too */
+	g_mutex_lock (&self->deferred_setup_mutex);
+	if (self->deferred_plugins->len == 0)
+		deferred_setup_cancellable = g_steal_pointer (&self->deferred_setup_cancellable);
+	g_mutex_unlock (&self->deferred_setup_mutex);
+
+	/* the new plugins can add to and change the apps already shown */
+	gs_plugin_loader_invalidate_refined (self);
+	if (self->reload_id == 0)
+		self->reload_id = g_idle_add (gs_plugin_loader_reload_delay_cb, self);
+
+	g_cancellable_cancel (deferred_setup_cancellable);
+}
+
+/**
+ * gs_plugin_loader_setup_deferred_plugins:
+ * @self: a #GsPluginLoader
+ *
+ * Start setting up the plugins whose setup was deferred by
+ * gs_plugin_loader_set_defer_setup(), if they haven’t been already. This
+ * happens in an idle callback in the global default #GMainContext. If the
+ * loader is still being set up, it happens once setup is complete.
+ *
+ * It is safe to call this from any thread, and more than once.
+ *
+ * Since: 51
+ */
+void
+gs_plugin_loader_setup_deferred_plugins (GsPluginLoader *self)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (self));
+
+	locker = g_mutex_locker_new (&self->deferred_setup_mutex);
+
+	self->deferred_setup_requested = TRUE;
+	if (self->deferred_plugins->len > 0 && self->deferred_setup_id == 0)
+		self->deferred_setup_id = g_idle_add (setup_deferred_plugins_cb, self);
+}
+
 /**
  * gs_plugin_loader_get_cpu_priority:
  * @self: a plugin loader
@@ -56,6 +56,8 @@ void		 gs_plugin_loader_shutdown		(GsPluginLoader	*plugin_loader,
 							 GCancellable	*cancellable);
 
 void		 gs_plugin_loader_dump_state		(GsPluginLoader	*plugin_loader);
+GVariant	*gs_plugin_loader_get_latency_stats	(GsPluginLoader	*plugin_loader);
+gchar		*gs_plugin_loader_latency_stats_to_string	(GsPluginLoader	*plugin_loader);
 gboolean	 gs_plugin_loader_get_enabled		(GsPluginLoader	*plugin_loader,
 							 const gchar	*plugin_name);
 void		 gs_plugin_loader_add_location		(GsPluginLoader	*plugin_loader,
@@ -77,6 +79,9 @@ void		 gs_plugin_loader_add_event		(GsPluginLoader *plugin_loader,
 GPtrArray	*gs_plugin_loader_get_events		(GsPluginLoader	*plugin_loader);
 GsPluginEvent	*gs_plugin_loader_get_event_default	(GsPluginLoader	*plugin_loader);
 void		 gs_plugin_loader_remove_events		(GsPluginLoader	*plugin_loader);
+void		 gs_plugin_loader_set_event_rate_limit_window
+							(GsPluginLoader	*plugin_loader,
+							 guint		 window_ms);
 
 void		 gs_plugin_loader_app_create_async	(GsPluginLoader	*plugin_loader,
 							 const gchar	*unique_id,
@@ -119,8 +124,61 @@ gboolean	 gs_plugin_loader_app_is_compatible	(GsPluginLoader *plugin_loader,
 
 void		 gs_plugin_loader_run_adopt		(GsPluginLoader *plugin_loader,
 							 GsAppList *list);
+gboolean	 gs_plugin_loader_run_adopt_full	(GsPluginLoader *plugin_loader,
+							 GsAppList *list,
+							 GCancellable *cancellable,
+							 GError **error);
 void		 gs_plugin_loader_emit_updates_changed	(GsPluginLoader *self);
 
+void		 gs_plugin_loader_share_apps		(GsPluginLoader *self,
+							 GsAppList *list);
+guint		 gs_plugin_loader_get_refine_generation	(GsPluginLoader *self);
+guint		 gs_plugin_loader_begin_refine		(GsPluginLoader *self,
+							 GsAppList *list,
+							 GsPluginRefineFlags refine_flags,
+							 GsPluginRefineRequireFlags require_flags,
+							 GSourceFunc func,
+							 gpointer user_data,
+							 GPtrArray *claimed);
+guint		 gs_plugin_loader_cancel_refine_wait	(GsPluginLoader *self,
+							 GSourceFunc func,
+							 gpointer user_data);
+void		 gs_plugin_loader_end_refine		(GsPluginLoader *self,
+							 GPtrArray *claimed);
+guint		 gs_plugin_loader_get_n_coalesced_refines
+							(GsPluginLoader *self);
+
+/**
+ * GsPluginLoaderRefineBatchFunc:
+ * @tasks: (element-type GTask): the tasks of the batched refines
+ *
+ * Runs a batch of refines collected by gs_plugin_loader_add_to_refine_batch().
+ *
+ * Since: 51
+ */
+typedef void (*GsPluginLoaderRefineBatchFunc) (GPtrArray *tasks);
+
+gboolean	 gs_plugin_loader_add_to_refine_batch	(GsPluginLoader *self,
+							 const gchar *key,
+							 GTask *task,
+							 GsPluginLoaderRefineBatchFunc func);
+guint		 gs_plugin_loader_get_n_batched_refines	(GsPluginLoader *self);
+guint		 gs_plugin_loader_get_refine_batch_window
+							(GsPluginLoader *self);
+void		 gs_plugin_loader_set_refine_batch_window
+							(GsPluginLoader *self,
+							 guint           window_ms);
+
+void		 gs_plugin_loader_set_snapshot_file	(GsPluginLoader *self,
+							 GFile          *file);
+gboolean	 gs_plugin_loader_can_serve_snapshot	(GsPluginLoader *self);
+gboolean	 gs_plugin_loader_save_snapshot		(GsPluginLoader *self,
+							 GError        **error);
+
+void		 gs_plugin_loader_set_defer_setup	(GsPluginLoader *self,
+							 gboolean        defer_setup);
+void		 gs_plugin_loader_setup_deferred_plugins	(GsPluginLoader *self);
+
 int		 gs_plugin_loader_get_cpu_priority	(GsPluginLoader *self);
 void		 gs_plugin_loader_set_cpu_priority	(GsPluginLoader *self,
 							 int             cpu_priority);
@@ -12,6 +12,7 @@
 #include <glib-object.h>
 #include <gmodule.h>
 
+#include "gs-app-registry.h"
 #include "gs-plugin.h"
 
 G_BEGIN_DECLS
@@ -37,9 +38,19 @@ void		 gs_plugin_set_language			(GsPlugin	*plugin,
 							 const gchar	*language);
 GPtrArray	*gs_plugin_get_rules			(GsPlugin	*plugin,
 							 GsPluginRule	 rule);
+gboolean	 gs_plugin_get_refine_dependencies	(GsPlugin	*plugin,
+							 GsPluginRefineRequireFlags *out_reads,
+							 GsPluginRefineRequireFlags *out_provides);
+gboolean	 gs_plugin_get_setup_deferrable		(GsPlugin	*plugin);
+void		 gs_plugin_add_latency			(GsPlugin	*plugin,
+							 const gchar	*action,
+							 gint64		 duration_usec);
+GVariant	*gs_plugin_get_latency_stats		(GsPlugin	*plugin);
 gchar		*gs_plugin_refine_flags_to_string	(GsPluginRefineFlags refine_flags);
 gchar		*gs_plugin_refine_require_flags_to_string	(GsPluginRefineRequireFlags require_flags);
 void		 gs_plugin_set_network_monitor		(GsPlugin		*plugin,
 							 GNetworkMonitor	*monitor);
+void		 gs_plugin_set_app_registry		(GsPlugin		*plugin,
+							 GsAppRegistry		*app_registry);
 
 G_END_DECLS
@@ -102,6 +102,7 @@ typedef enum {
  * @GS_PLUGIN_REFINE_REQUIRE_FLAGS_REVIEWS:		Require user-reviews
  * @GS_PLUGIN_REFINE_REQUIRE_FLAGS_REVIEW_RATINGS:	Require user-ratings
  * @GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON_METADATA:	Require the icon metadata (information about what icons are available, and their sizes) to be loaded (Since: 51)
+ * @GS_PLUGIN_REFINE_REQUIRE_FLAGS_CONTENT_RATING:	Require the content rating (Since: 51)
  * @GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON_CONTENT:	Require the icon content (pixel data) to be loaded (Since: 51)
  * @GS_PLUGIN_REFINE_REQUIRE_FLAGS_PERMISSIONS:		Require the needed permissions
  * @GS_PLUGIN_REFINE_REQUIRE_FLAGS_ORIGIN_HOSTNAME:	Require the origin hostname
@@ -154,6 +155,7 @@ typedef enum {
 	GS_PLUGIN_REFINE_REQUIRE_FLAGS_DEVELOPER_NAME	= 1U << 27,
 	GS_PLUGIN_REFINE_REQUIRE_FLAGS_KUDOS		= 1U << 28,
 	GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON_METADATA	= 1U << 29,
+	GS_PLUGIN_REFINE_REQUIRE_FLAGS_CONTENT_RATING	= 1U << 30,
 	GS_PLUGIN_REFINE_REQUIRE_FLAGS_MASK		= ~0U,
 } GsPluginRefineRequireFlags;
 
@@ -175,6 +177,11 @@ typedef enum {
  * GsPluginListAppsFlags:
  * @GS_PLUGIN_LIST_APPS_FLAGS_NONE: No flags set.
  * @GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE: User initiated the job.
+ * @GS_PLUGIN_LIST_APPS_FLAGS_STREAM_RESULTS: Emit the results from each plugin
+ *   with #GsPluginJobListApps::partial-results as they arrive (Since: 51)
+ * @GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT: The results may be served from
+ *   the previous run’s snapshot while the plugins are being set up; see
+ *   gs_plugin_loader_set_snapshot_file() (Since: 51)
  *
  * Flags for an operation to list apps matching a given query.
  *
@@ -183,6 +190,8 @@ typedef enum {
 typedef enum {
 	GS_PLUGIN_LIST_APPS_FLAGS_NONE = 0,
 	GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE = 1 << 0,
+	GS_PLUGIN_LIST_APPS_FLAGS_STREAM_RESULTS = 1 << 1,
+	GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT = 1 << 2,
 } GsPluginListAppsFlags;
 
 /**
@@ -190,6 +199,9 @@ typedef enum {
  * @GS_PLUGIN_REFINE_CATEGORIES_FLAGS_NONE: No flags set.
  * @GS_PLUGIN_REFINE_CATEGORIES_FLAGS_INTERACTIVE: User initiated the job.
  * @GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE: Work out the number of apps in each category.
+ * @GS_PLUGIN_REFINE_CATEGORIES_FLAGS_ALLOW_SNAPSHOT: The category sizes may be
+ *   served from the previous run’s snapshot while the plugins are being set
+ *   up; see gs_plugin_loader_set_snapshot_file() (Since: 51)
  *
  * Flags for an operation to refine categories.
  *
@@ -199,6 +211,7 @@ typedef enum {
 	GS_PLUGIN_REFINE_CATEGORIES_FLAGS_NONE = 0,
 	GS_PLUGIN_REFINE_CATEGORIES_FLAGS_INTERACTIVE = 1 << 0,
 	GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE = 1 << 1,
+	GS_PLUGIN_REFINE_CATEGORIES_FLAGS_ALLOW_SNAPSHOT = 1 << 2,
 } GsPluginRefineCategoriesFlags;
 
 /**
@@ -37,8 +37,10 @@
 #include <string.h>
 
 #include "gs-app-list-private.h"
+#include "gs-app-registry.h"
 #include "gs-download-utils.h"
 #include "gs-enums.h"
+#include "gs-latency-histogram.h"
 #include "gs-os-release.h"
 #include "gs-plugin-private.h"
 #include "gs-plugin.h"
@@ -48,10 +50,17 @@ typedef struct
 {
 	GHashTable		*cache;
 	GMutex			 cache_mutex;
+	GsAppRegistry		*app_registry;  /* (owned) (nullable) */
 	GModule			*module;
 	GPtrArray		*rules[GS_PLUGIN_RULE_LAST];
+	gboolean		 refine_dependencies_set;
+	GsPluginRefineRequireFlags refine_reads;
+	GsPluginRefineRequireFlags refine_provides;
+	gboolean		 setup_deferrable;
 	GHashTable		*vfuncs;		/* string:pointer */
 	GMutex			 vfuncs_mutex;
+	GHashTable		*latencies;  /* (owned) (mutex latencies_mutex) (element-type utf8 GsLatencyHistogram) */
+	GMutex			 latencies_mutex;
 	gboolean		 enabled;
 	gchar			*language;		/* allow-none */
 	gchar			*name;
@@ -207,8 +216,11 @@ gs_plugin_finalize (GObject *object)
 	g_free (priv->language);
 	if (priv->network_monitor != NULL)
 		g_object_unref (priv->network_monitor);
+	g_clear_object (&priv->app_registry);
 	g_hash_table_unref (priv->cache);
 	g_hash_table_unref (priv->vfuncs);
+	g_hash_table_unref (priv->latencies);
+	g_mutex_clear (&priv->latencies_mutex);
 	g_mutex_clear (&priv->cache_mutex);
 	g_mutex_clear (&priv->timer_mutex);
 	g_mutex_clear (&priv->vfuncs_mutex);
@@ -472,6 +484,25 @@ gs_plugin_set_network_monitor (GsPlugin *plugin, GNetworkMonitor *monitor)
 	g_set_object (&priv->network_monitor, monitor);
 }
 
+/**
+ * gs_plugin_set_app_registry:
+ * @plugin: a #GsPlugin
+ * @app_registry: (nullable): a #GsAppRegistry, or %NULL
+ *
+ * Sets the registry of live apps shared between all plugins of the loader.
+ * It is consulted by gs_plugin_cache_lookup() when the per-plugin cache
+ * misses.
+ *
+ * Since: 51
+ **/
+void
+gs_plugin_set_app_registry (GsPlugin *plugin, GsAppRegistry *app_registry)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->cache_mutex);
+	g_set_object (&priv->app_registry, app_registry);
+}
+
 /**
  * gs_plugin_get_network_available:
  * @plugin: a #GsPlugin
@@ -533,6 +564,211 @@ gs_plugin_get_rules (GsPlugin *plugin, GsPluginRule rule)
 	return priv->rules[rule];
 }
 
+/**
+ * gs_plugin_set_refine_dependencies:
+ * @plugin: a #GsPlugin
+ * @reads: the data which the plugin’s #GsPluginClass.refine_async reads from
+ *   the apps it refines
+ * @provides: the data which the plugin’s #GsPluginClass.refine_async sets on
+ *   the apps it refines
+ *
+ * Declare which data the plugin uses and sets when refining apps.
+ *
+ * Refine jobs run a plugin which has declared its dependencies in parallel
+ * with the other declared plugins it was ordered after using
+ * %GS_PLUGIN_RULE_RUN_AFTER or %GS_PLUGIN_RULE_RUN_BEFORE, as long as none of
+ * them provides data which the other reads or also provides. Plugins which
+ * have not declared their dependencies are always run after all the plugins
+ * ordered before them, and before all the plugins ordered after them.
+ *
+ * %GS_PLUGIN_REFINE_REQUIRE_FLAGS_ID stands for the app’s ID, kind and other
+ * basic metadata. Quirks are not tracked, as adding them is commutative.
+ * Neither are the app’s state or management plugin, so a plugin which changes
+ * those while refining must not declare its dependencies, and is then kept in
+ * order with all the others.
+ *
+ * This should be called in the plugin’s init function, like
+ * gs_plugin_add_rule().
+ *
+ * Since: 51
+ **/
+void
+gs_plugin_set_refine_dependencies (GsPlugin                   *plugin,
+                                   GsPluginRefineRequireFlags  reads,
+                                   GsPluginRefineRequireFlags  provides)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+
+	g_return_if_fail (GS_IS_PLUGIN (plugin));
+
+	priv->refine_dependencies_set = TRUE;
+	priv->refine_reads = reads;
+	priv->refine_provides = provides;
+}
+
+/**
+ * gs_plugin_get_refine_dependencies:
+ * @plugin: a #GsPlugin
+ * @out_reads: (out caller-allocates) (optional): return location for the
+ *   data the plugin reads when refining
+ * @out_provides: (out caller-allocates) (optional): return location for the
+ *   data the plugin sets when refining
+ *
+ * Gets the dependencies set with gs_plugin_set_refine_dependencies().
+ *
+ * Returns: %TRUE if the plugin has declared its refine dependencies, %FALSE
+ *   otherwise
+ *
+ * Since: 51
+ **/
+gboolean
+gs_plugin_get_refine_dependencies (GsPlugin                   *plugin,
+                                   GsPluginRefineRequireFlags *out_reads,
+                                   GsPluginRefineRequireFlags *out_provides)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+
+	g_return_val_if_fail (GS_IS_PLUGIN (plugin), FALSE);
+
+	if (out_reads != NULL)
+		*out_reads = priv->refine_reads;
+	if (out_provides != NULL)
+		*out_provides = priv->refine_provides;
+
+	return priv->refine_dependencies_set;
+}
+
+/**
+ * gs_plugin_set_setup_deferrable:
+ * @plugin: a #GsPlugin
+ * @deferrable: %TRUE if the plugin’s setup may be deferred
+ *
+ * Declare that the plugin is not needed to show the first screen, so its
+ * #GsPluginClass.setup_async may be run after the rest of the plugins are set
+ * up, if the #GsPluginLoader has been asked to defer plugin setup with
+ * gs_plugin_loader_set_defer_setup().
+ *
+ * Until a deferred plugin is set up it is treated as disabled. Read-only jobs
+ * which enumerate or refine apps skip it, and any other job waits for it to
+ * be set up first.
+ *
+ * This should be called in the plugin’s init function, like
+ * gs_plugin_add_rule().
+ *
+ * Since: 51
+ **/
+void
+gs_plugin_set_setup_deferrable (GsPlugin *plugin,
+                                gboolean  deferrable)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+
+	g_return_if_fail (GS_IS_PLUGIN (plugin));
+
+	priv->setup_deferrable = deferrable;
+}
+
+/**
+ * gs_plugin_add_latency:
+ * @plugin: a #GsPlugin
+ * @action: name of the action, such as `refine`
+ * @duration_usec: how long the plugin took, in microseconds
+ *
+ * Count how long one call of the plugin’s @action took, in the running
+ * statistics returned by gs_plugin_get_latency_stats().
+ *
+ * This is called by the jobs which run the plugin’s vfuncs. It is safe to
+ * call from any thread.
+ *
+ * Since: 51
+ **/
+void
+gs_plugin_add_latency (GsPlugin    *plugin,
+                       const gchar *action,
+                       gint64       duration_usec)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+	GsLatencyHistogram *histogram;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_PLUGIN (plugin));
+	g_return_if_fail (action != NULL);
+
+	locker = g_mutex_locker_new (&priv->latencies_mutex);
+
+	histogram = g_hash_table_lookup (priv->latencies, action);
+	if (histogram == NULL) {
+		histogram = gs_latency_histogram_new ();
+		g_hash_table_insert (priv->latencies, g_strdup (action), histogram);
+	}
+
+	gs_latency_histogram_add (histogram, duration_usec);
+}
+
+/**
+ * gs_plugin_get_latency_stats:
+ * @plugin: a #GsPlugin
+ *
+ * Get the running latency statistics for each action of the plugin which has
+ * been called, as added with gs_plugin_add_latency().
+ *
+ * The result maps each action name to a `(ttttt)` tuple of the number of
+ * calls, then the 50th, 95th and 99th percentiles and the maximum of how
+ * long they took, in microseconds. The percentiles are approximate.
+ *
+ * Returns: (transfer floating): an `a{s(ttttt)}` dictionary of statistics
+ *
+ * Since: 51
+ **/
+GVariant *
+gs_plugin_get_latency_stats (GsPlugin *plugin)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+	g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a{s(ttttt)}"));
+	g_autoptr(GList) actions = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (GS_IS_PLUGIN (plugin), NULL);
+
+	locker = g_mutex_locker_new (&priv->latencies_mutex);
+
+	/* sorted, so the output is stable */
+	actions = g_list_sort (g_hash_table_get_keys (priv->latencies), (GCompareFunc) g_strcmp0);
+
+	for (GList *l = actions; l != NULL; l = l->next) {
+		GsLatencyHistogram *histogram = g_hash_table_lookup (priv->latencies, l->data);
+
+		g_variant_builder_add (&builder, "{s(ttttt)}", (const gchar *) l->data,
+				       gs_latency_histogram_get_count (histogram),
+				       (guint64) gs_latency_histogram_get_percentile (histogram, 50),
+				       (guint64) gs_latency_histogram_get_percentile (histogram, 95),
+				       (guint64) gs_latency_histogram_get_percentile (histogram, 99),
+				       (guint64) gs_latency_histogram_get_max (histogram));
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * gs_plugin_get_setup_deferrable:
+ * @plugin: a #GsPlugin
+ *
+ * Gets the value set with gs_plugin_set_setup_deferrable().
+ *
+ * Returns: %TRUE if the plugin’s setup may be deferred
+ *
+ * Since: 51
+ **/
+gboolean
+gs_plugin_get_setup_deferrable (GsPlugin *plugin)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+
+	g_return_val_if_fail (GS_IS_PLUGIN (plugin), FALSE);
+
+	return priv->setup_deferrable;
+}
+
 /**
  * gs_plugin_adopt_app:
  * @plugin: a #GsPlugin
@@ -1167,6 +1403,14 @@ gs_plugin_reload (GsPlugin *plugin)
  *
  * Looks up an application object from the per-plugin cache
  *
+ * If @key is a unique ID and the per-plugin cache misses, the registry of
+ * apps shared between all plugins is checked too. An app found there is only
+ * returned if @plugin created it: it has to be managed by @plugin, or be
+ * unmanaged with its `GnomeSoftware::Creator` metadata set to the name of
+ * @plugin. Apps created by other plugins may lack metadata which @plugin
+ * would have set on its own apps, so they are never returned. A returned app
+ * is added to the per-plugin cache.
+ *
  * Returns: (transfer full) (nullable): the #GsApp, or %NULL
  *
  * Since: 3.22
@@ -1176,6 +1420,7 @@ gs_plugin_cache_lookup (GsPlugin *plugin, const gchar *key)
 {
 	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
 	GsApp *app;
+	g_autoptr(GsApp) shared_app = NULL;
 	g_autoptr(GMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (GS_IS_PLUGIN (plugin), NULL);
@@ -1183,9 +1428,24 @@ gs_plugin_cache_lookup (GsPlugin *plugin, const gchar *key)
 
 	locker = g_mutex_locker_new (&priv->cache_mutex);
 	app = g_hash_table_lookup (priv->cache, key);
-	if (app == NULL)
+	if (app != NULL)
+		return g_object_ref (app);
+
+	/* another plugin or job may already have created (and refined) it */
+	if (priv->app_registry == NULL || !as_utils_data_id_valid (key))
+		return NULL;
+	shared_app = gs_app_registry_lookup (priv->app_registry, key);
+	if (shared_app == NULL)
 		return NULL;
-	return g_object_ref (app);
+	if (!gs_app_has_management_plugin (shared_app, plugin) &&
+	    !(gs_app_has_management_plugin (shared_app, NULL) &&
+	      g_strcmp0 (gs_app_get_metadata_item (shared_app, "GnomeSoftware::Creator"), priv->name) == 0))
+		return NULL;
+
+	g_debug ("reusing shared app %s in plugin %s", key, priv->name);
+	g_hash_table_insert (priv->cache, g_strdup (key), g_object_ref (shared_app));
+
+	return g_steal_pointer (&shared_app);
 }
 
 /**
@@ -1245,6 +1505,11 @@ gs_plugin_cache_remove (GsPlugin *plugin, const gchar *key)
 	g_return_if_fail (key != NULL);
 
 	locker = g_mutex_locker_new (&priv->cache_mutex);
+	if (priv->app_registry != NULL) {
+		GsApp *app = g_hash_table_lookup (priv->cache, key);
+		if (app != NULL)
+			gs_app_registry_remove (priv->app_registry, app);
+	}
 	g_hash_table_remove (priv->cache, key);
 }
 
@@ -1285,6 +1550,10 @@ gs_plugin_cache_add (GsPlugin *plugin, const gchar *key, GsApp *app)
 	if (g_hash_table_lookup (priv->cache, key) == app)
 		return;
 	g_hash_table_insert (priv->cache, g_strdup (key), g_object_ref (app));
+
+	/* share it with other plugins and jobs */
+	if (priv->app_registry != NULL)
+		gs_app_registry_add (priv->app_registry, app);
 }
 
 /**
@@ -1310,6 +1579,17 @@ gs_plugin_cache_invalidate (GsPlugin *plugin)
 	g_return_if_fail (GS_IS_PLUGIN (plugin));
 
 	locker = g_mutex_locker_new (&priv->cache_mutex);
+
+	/* stop other plugins being handed the now-stale instances */
+	if (priv->app_registry != NULL) {
+		GHashTableIter iter;
+		gpointer value;
+
+		g_hash_table_iter_init (&iter, priv->cache);
+		while (g_hash_table_iter_next (&iter, NULL, &value))
+			gs_app_registry_remove (priv->app_registry, value);
+	}
+
 	g_hash_table_remove_all (priv->cache);
 }
 
@@ -1528,6 +1808,8 @@ gs_plugin_refine_require_flags_to_string (GsPluginRefineRequireFlags require_fla
 		g_ptr_array_add (cstrs, (gpointer) "require-developer-name");
 	if (require_flags & GS_PLUGIN_REFINE_REQUIRE_FLAGS_KUDOS)
 		g_ptr_array_add (cstrs, (gpointer) "require-kudos");
+	if (require_flags & GS_PLUGIN_REFINE_REQUIRE_FLAGS_CONTENT_RATING)
+		g_ptr_array_add (cstrs, (gpointer) "require-content-rating");
 	if (cstrs->len == 0)
 		return g_strdup ("none");
 	g_ptr_array_add (cstrs, NULL);
@@ -1766,6 +2048,9 @@ gs_plugin_init (GsPlugin *plugin)
 					     (GDestroyNotify) g_object_unref);
 	priv->vfuncs = g_hash_table_new_full (g_str_hash, g_str_equal,
 					      g_free, NULL);
+	priv->latencies = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 g_free, (GDestroyNotify) gs_latency_histogram_free);
+	g_mutex_init (&priv->latencies_mutex);
 	g_mutex_init (&priv->cache_mutex);
 	g_mutex_init (&priv->timer_mutex);
 	g_mutex_init (&priv->vfuncs_mutex);
@@ -436,6 +436,11 @@ const gchar	*gs_plugin_get_language			(GsPlugin	*plugin);
 void		 gs_plugin_add_rule			(GsPlugin	*plugin,
 							 GsPluginRule	 rule,
 							 const gchar	*name);
+void		 gs_plugin_set_refine_dependencies	(GsPlugin	*plugin,
+							 GsPluginRefineRequireFlags reads,
+							 GsPluginRefineRequireFlags provides);
+void		 gs_plugin_set_setup_deferrable		(GsPlugin	*plugin,
+							 gboolean	 deferrable);
 void		 gs_plugin_adopt_app			(GsPlugin	*plugin,
 							 GsApp		*app);
 
@@ -0,0 +1,83 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gs-profiler.h"
+
+#ifdef HAVE_SYSPROF
+typedef struct {
+	const gchar *category;
+	const gchar *name;
+	const gchar *description;
+} CounterInfo;
+
+static const CounterInfo counter_info[GS_PROFILER_N_COUNTERS] = {
+	[GS_PROFILER_COUNTER_APPS_ALIVE] = { "Memory", "apps-alive", "GsApp instances alive" },
+	[GS_PROFILER_COUNTER_SILO_BYTES] = { "Memory", "silo-bytes", "Size of the loaded appstream silos" },
+	[GS_PROFILER_COUNTER_JOBS_IN_FLIGHT] = { "Jobs", "in-flight", "Plugin jobs being run" },
+	[GS_PROFILER_COUNTER_ICONS_PENDING] = { "Icons", "pending-downloads", "Apps waiting for their icons to be downloaded" },
+	[GS_PROFILER_COUNTER_DOWNLOAD_THROUGHPUT] = { "Network", "download-throughput", "Bytes downloaded per second" },
+};
+
+/* Zero until gs_profiler_init_counters() has been called, or if the counter
+ * could not be defined. */
+static guint counter_ids[GS_PROFILER_N_COUNTERS] = { 0, };  /* (atomic) */
+#endif  /* HAVE_SYSPROF */
+
+/**
+ * gs_profiler_init_counters:
+ *
+ * Define all the #GsProfilerCounter counters with Sysprof, if it is recording.
+ *
+ * This is safe to call more than once, and from any thread; only the first
+ * call has an effect. Until it has been called, GS_PROFILER_SET_COUNTER() is
+ * a no-op.
+ *
+ * Since: 51
+ */
+void
+gs_profiler_init_counters (void)
+{
+#ifdef HAVE_SYSPROF
+	static gsize initialised = 0;
+
+	if (!g_once_init_enter (&initialised))
+		return;
+
+	for (gsize i = 0; i < G_N_ELEMENTS (counter_info); i++)
+		g_atomic_int_set (&counter_ids[i], gs_profiler_define_counter (counter_info[i].category,
+										  counter_info[i].name,
+										  counter_info[i].description));
+
+	g_once_init_leave (&initialised, 1);
+#endif  /* HAVE_SYSPROF */
+}
+
+/**
+ * gs_profiler_set_counter:
+ * @counter: the counter to update
+ * @value: the new value of the counter
+ *
+ * Update @counter to @value. Use GS_PROFILER_SET_COUNTER() rather than calling
+ * this directly, so that it compiles out without Sysprof support.
+ *
+ * Since: 51
+ */
+void
+gs_profiler_set_counter (GsProfilerCounter counter,
+                         gint64            value)
+{
+#ifdef HAVE_SYSPROF
+	g_return_if_fail (counter < GS_PROFILER_N_COUNTERS);
+
+	gs_profiler_update_counter (g_atomic_int_get (&counter_ids[counter]), value);
+#endif  /* HAVE_SYSPROF */
+}
@@ -76,9 +76,63 @@
  * GS_PROFILER_ADD_MARK(Foo, task->begin_time, "do-something", NULL);
  *```
  *
+ * Numeric time series, such as queue lengths or memory use, can be recorded as
+ * counters, which Sysprof draws as graphs next to the marks. Counters which
+ * only exist once per process are listed in #GsProfilerCounter and defined
+ * together by gs_profiler_init_counters(), which is called when the
+ * #GsPluginLoader is created. They are updated with GS_PROFILER_SET_COUNTER():
+ *
+ * ```
+ * GS_PROFILER_SET_COUNTER (GS_PROFILER_COUNTER_JOBS_IN_FLIGHT, n_jobs);
+ *```
+ *
+ * Counters which exist once per object have to be defined explicitly with
+ * GS_PROFILER_DEFINE_COUNTER(), keeping the returned ID around to pass to
+ * GS_PROFILER_UPDATE_COUNTER():
+ *
+ * ```
+ * self->queue_counter = GS_PROFILER_DEFINE_COUNTER ("Foo", self->name, "Items waiting in this queue");
+ * ...
+ * GS_PROFILER_UPDATE_COUNTER (self->queue_counter, n_items);
+ *```
+ *
+ * Counters can only be defined while Sysprof is recording, so per-object
+ * counters should be defined when the object is constructed. Updating a
+ * counter which could not be defined, or has not been defined yet, is a
+ * no-op. The counter functions and macros are safe to use from any thread.
+ *
  * Since: 44
  */
 
+/**
+ * GsProfilerCounter:
+ * @GS_PROFILER_COUNTER_APPS_ALIVE: Number of #GsApp instances alive
+ * @GS_PROFILER_COUNTER_SILO_BYTES: Total size of the loaded appstream silos
+ * @GS_PROFILER_COUNTER_JOBS_IN_FLIGHT: Number of plugin jobs being run
+ * @GS_PROFILER_COUNTER_ICONS_PENDING: Number of apps waiting for their icons
+ *   to be downloaded
+ * @GS_PROFILER_COUNTER_DOWNLOAD_THROUGHPUT: Bytes downloaded per second,
+ *   across all downloads
+ *
+ * Counters which exist once per process. They are all defined by
+ * gs_profiler_init_counters().
+ *
+ * Since: 51
+ */
+typedef enum {
+	GS_PROFILER_COUNTER_APPS_ALIVE,
+	GS_PROFILER_COUNTER_SILO_BYTES,
+	GS_PROFILER_COUNTER_JOBS_IN_FLIGHT,
+	GS_PROFILER_COUNTER_ICONS_PENDING,
+	GS_PROFILER_COUNTER_DOWNLOAD_THROUGHPUT,
+} GsProfilerCounter;
+
+#define GS_PROFILER_N_COUNTERS (GS_PROFILER_COUNTER_DOWNLOAD_THROUGHPUT + 1)
+
+void	gs_profiler_init_counters	(void);
+void	gs_profiler_set_counter		(GsProfilerCounter	 counter,
+					 gint64			 value);
+
 #ifdef HAVE_SYSPROF
 #include <sysprof-capture.h>
 
@@ -139,6 +193,56 @@ gs_profiler_auto_trace_end_helper (GsProfilerHead **head)
 #define GS_PROFILER_ADD_MARK(Name, begin_time, sysprof_name, sysprof_description) \
 	GS_PROFILER_ADD_MARK_TAKE (Name, begin_time, g_strdup (sysprof_name), g_strdup (sysprof_description))
 
+/* Returns 0 if the counter could not be defined, which is never a valid ID. */
+static inline guint
+gs_profiler_define_counter (const gchar *category,
+                            const gchar *name,
+                            const gchar *description)
+{
+	SysprofCaptureCounter counter = { 0, };
+	guint id;
+
+	if (!sysprof_collector_is_active ())
+		return 0;
+
+	id = sysprof_collector_request_counters (1);
+	if (id == 0)
+		return 0;
+
+	g_strlcpy (counter.category, category, sizeof (counter.category));
+	g_strlcpy (counter.name, name, sizeof (counter.name));
+	g_strlcpy (counter.description, (description != NULL) ? description : "", sizeof (counter.description));
+	counter.id = id;
+	counter.type = SYSPROF_CAPTURE_COUNTER_INT64;
+	counter.value.v64 = 0;
+
+	sysprof_collector_define_counters (&counter, 1);
+
+	return id;
+}
+
+static inline void
+gs_profiler_update_counter (guint  id,
+                            gint64 value)
+{
+	SysprofCaptureCounterValue counter_value;
+
+	if (id == 0)
+		return;
+
+	counter_value.v64 = value;
+	sysprof_collector_set_counters (&id, &counter_value, 1);
+}
+
+#define GS_PROFILER_DEFINE_COUNTER(sysprof_category, sysprof_name, sysprof_description) \
+	gs_profiler_define_counter (sysprof_category, sysprof_name, sysprof_description)
+
+#define GS_PROFILER_UPDATE_COUNTER(counter_id, value) \
+	gs_profiler_update_counter (counter_id, value)
+
+#define GS_PROFILER_SET_COUNTER(counter, value) \
+	gs_profiler_set_counter (counter, value)
+
 #else
 
 #define GS_PROFILER_BEGIN_SCOPED_TAKE(Name, sysprof_name, sysprof_description) \
@@ -149,5 +253,10 @@ gs_profiler_auto_trace_end_helper (GsProfilerHead **head)
 	} G_STMT_END
 #define GS_PROFILER_ADD_MARK_TAKE(Name, begin_time, sysprof_name, sysprof_description)
 #define GS_PROFILER_ADD_MARK(Name, begin_time, sysprof_name, sysprof_description)
+#define GS_PROFILER_DEFINE_COUNTER(sysprof_category, sysprof_name, sysprof_description) (0)
+#define GS_PROFILER_UPDATE_COUNTER(counter_id, value) \
+	G_STMT_START { (void) (value); } G_STMT_END
+#define GS_PROFILER_SET_COUNTER(counter, value) \
+	G_STMT_START { (void) (value); } G_STMT_END
 
 #endif
@@ -38,6 +38,7 @@
 #include <glib-object.h>
 #include <xmlb.h>
 
+#include "gs-profiler.h"
 #include "gs-silo-wrapper.h"
 
 struct _GsSiloWrapper
@@ -55,6 +56,8 @@ struct _GsSiloWrapper
 	gboolean building;
 
 	XbSilo *silo;  /* (owned) (nullable) */
+	gsize silo_bytes; /* size of the blob behind silo, counted in total_silo_bytes */
+	gboolean silo_counted; /* whether silo is counted in n_loaded_silos */
 	gchar *filename;  /* (owned) (nullable) */
 	GHashTable *installed_by_desktopid; /* (element-type utf8 GPtrArray (element-type XbNode)) (owned) (nullable) */
 	AsComponentScope scope;
@@ -68,6 +71,34 @@ struct _GsSiloWrapper
 
 G_DEFINE_TYPE (GsSiloWrapper, gs_silo_wrapper, G_TYPE_OBJECT)
 
+/* increased whenever any silo wrapper is invalidated; see
+   gs_silo_wrapper_get_global_change_stamp() */
+static gint global_change_stamp = 0;
+
+/* number and size of the blobs of all the silos currently loaded, for
+   profiling and the memory tests */
+static gint n_loaded_silos = 0;  /* (atomic) */
+static gssize total_silo_bytes = 0;  /* (atomic) */
+
+/* call whenever self->silo changes */
+static void
+gs_silo_wrapper_update_silo_stats (GsSiloWrapper *self)
+{
+	g_autoptr(GBytes) blob = (self->silo != NULL) ? xb_silo_get_bytes (self->silo) : NULL;
+	gsize silo_bytes = (blob != NULL) ? g_bytes_get_size (blob) : 0;
+	gssize delta = (gssize) silo_bytes - (gssize) self->silo_bytes;
+	gssize total = g_atomic_pointer_add (&total_silo_bytes, delta) + delta;
+
+	self->silo_bytes = silo_bytes;
+
+	if (self->silo_counted != (self->silo != NULL)) {
+		self->silo_counted = (self->silo != NULL);
+		g_atomic_int_add (&n_loaded_silos, self->silo_counted ? 1 : -1);
+	}
+
+	GS_PROFILER_SET_COUNTER (GS_PROFILER_COUNTER_SILO_BYTES, total);
+}
+
 static gboolean
 gs_silo_wrapper_build (GsSiloWrapper *self,
 		       gboolean interactive,
@@ -139,6 +170,8 @@ gs_silo_wrapper_build (GsSiloWrapper *self,
 		}
 	} while (self->silo != NULL && g_atomic_int_get (&self->change_stamp_current) != g_atomic_int_get (&self->change_stamp));
 
+	gs_silo_wrapper_update_silo_stats (self);
+
 	self->building = FALSE;
 
 	/* FIXME: https://gitlab.gnome.org/GNOME/gnome-software/-/issues/1422 */
@@ -162,6 +195,7 @@ gs_silo_wrapper_finalize (GObject *object)
 	g_clear_pointer (&self->filename, g_free);
 	g_clear_pointer (&self->installed_by_desktopid, g_hash_table_unref);
 	g_clear_object (&self->silo);
+	gs_silo_wrapper_update_silo_stats (self);
 
 	G_OBJECT_CLASS (gs_silo_wrapper_parent_class)->finalize (object);
 }
@@ -315,6 +349,44 @@ gs_silo_wrapper_acquire (GsSiloWrapper *self,
 	return success;
 }
 
+/**
+ * gs_silo_wrapper_try_acquire:
+ * @self: a #GsSiloWrapper
+ *
+ * Like gs_silo_wrapper_acquire(), but only acquires @self if its silo is
+ * already built and up to date, rather than rebuilding it or waiting for
+ * another thread to.
+ *
+ * This is for threads which must not rebuild the silo, such as those whose
+ * thread-default main context is never iterated, as the file monitors set up
+ * by the build function would never fire there.
+ *
+ * Call gs_silo_wrapper_release() when the silo or other members
+ * are not needed anymore.
+ *
+ * Returns: %TRUE if @self was acquired, %FALSE if it needs rebuilding first
+ *
+ * Since: 51
+ **/
+gboolean
+gs_silo_wrapper_try_acquire (GsSiloWrapper *self)
+{
+	gboolean success;
+
+	g_return_val_if_fail (GS_IS_SILO_WRAPPER (self), FALSE);
+
+	g_mutex_lock (&self->mutex);
+
+	success = (self->silo != NULL &&
+		   g_atomic_int_get (&self->change_stamp_current) == g_atomic_int_get (&self->change_stamp));
+	if (success)
+		self->n_acquired++;
+
+	g_mutex_unlock (&self->mutex);
+
+	return success;
+}
+
 /**
  * gs_silo_wrapper_release:
  * @self: a #GsSiloWrapper
@@ -362,6 +434,62 @@ gs_silo_wrapper_invalidate (GsSiloWrapper *self)
 	g_return_if_fail (GS_IS_SILO_WRAPPER (self));
 
 	g_atomic_int_inc (&self->change_stamp);
+	g_atomic_int_inc (&global_change_stamp);
+}
+
+/**
+ * gs_silo_wrapper_get_global_change_stamp:
+ *
+ * Gets a change stamp covering all the #GsSiloWrapper instances in the
+ * process. It is increased every time any of them is invalidated, so a change
+ * in it means that data previously read from some silo may be out of date.
+ *
+ * This can be called from any thread.
+ *
+ * Returns: the global silo change stamp
+ *
+ * Since: 51
+ **/
+guint
+gs_silo_wrapper_get_global_change_stamp (void)
+{
+	return (guint) g_atomic_int_get (&global_change_stamp);
+}
+
+/**
+ * gs_silo_wrapper_get_n_loaded_silos:
+ *
+ * Gets the number of #XbSilo instances currently loaded by all the
+ * #GsSiloWrapper instances in the process.
+ *
+ * This can be called from any thread.
+ *
+ * Returns: number of loaded silos
+ *
+ * Since: 51
+ **/
+guint
+gs_silo_wrapper_get_n_loaded_silos (void)
+{
+	return (guint) g_atomic_int_get (&n_loaded_silos);
+}
+
+/**
+ * gs_silo_wrapper_get_loaded_silos_size:
+ *
+ * Gets the total size of the blobs behind the #XbSilo instances currently
+ * loaded by all the #GsSiloWrapper instances in the process.
+ *
+ * This can be called from any thread.
+ *
+ * Returns: size of the loaded silos, in bytes
+ *
+ * Since: 51
+ **/
+gsize
+gs_silo_wrapper_get_loaded_silos_size (void)
+{
+	return (gsize) g_atomic_pointer_get (&total_silo_bytes);
 }
 
 /**
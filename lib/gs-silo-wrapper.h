@@ -47,8 +47,15 @@ gboolean	gs_silo_wrapper_acquire		(GsSiloWrapper *self,
 						 gboolean interactive,
 						 GCancellable *cancellable,
 						 GError **error);
+gboolean	gs_silo_wrapper_try_acquire	(GsSiloWrapper *self);
 void		gs_silo_wrapper_release		(GsSiloWrapper *self);
 void		gs_silo_wrapper_invalidate	(GsSiloWrapper *self);
+guint		gs_silo_wrapper_get_global_change_stamp
+						(void);
+guint		gs_silo_wrapper_get_n_loaded_silos
+						(void);
+gsize		gs_silo_wrapper_get_loaded_silos_size
+						(void);
 XbSilo *	gs_silo_wrapper_get_silo	(GsSiloWrapper *self);
 AsComponentScope
 		gs_silo_wrapper_get_scope	(GsSiloWrapper *self);
@@ -0,0 +1,638 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-startup-snapshot
+ * @short_description: The results of some jobs, kept from the previous run
+ *
+ * #GsStartupSnapshot stores the results of the jobs needed to first show the
+ * overview and installed pages: the featured, curated, deployment-featured
+ * and recently released apps, the installed apps, and the category sizes. It is saved to disk when
+ * the #GsPluginLoader shuts down and loaded again at the next startup, so that
+ * those jobs can be answered straight away while the plugins are still being
+ * set up.
+ *
+ * Only jobs which set %GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT or
+ * %GS_PLUGIN_REFINE_CATEGORIES_FLAGS_ALLOW_SNAPSHOT are recorded or served.
+ * List-apps jobs are keyed on their query, and only queries for exactly one
+ * of #GsAppQuery:is-installed, #GsAppQuery:is-featured, #GsAppQuery:is-curated,
+ * #GsAppQuery:deployment-featured or #GsAppQuery:released-since are supported.
+ * As the date of a #GsAppQuery:released-since query moves on with every run,
+ * it is keyed on how many days back the query goes.
+ *
+ * Apps are stored with only the data needed to show them in a list: their
+ * unique ID, kind, state, name, summary, developer name, categories,
+ * installed size and icons. Apps created from the snapshot are not marked as
+ * refined, so the next refine of them fetches everything afresh.
+ *
+ * #GsStartupSnapshot must only be used from the main thread.
+ *
+ * Since: 51
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "gs-app.h"
+#include "gs-app-list.h"
+#include "gs-app-query.h"
+#include "gs-category-private.h"
+#include "gs-icon.h"
+#include "gs-plugin-job-list-apps.h"
+#include "gs-plugin-job-list-categories.h"
+#include "gs-plugin-job-private.h"
+#include "gs-startup-snapshot.h"
+
+/* bump this whenever the format of the serialised apps changes */
+#define GS_STARTUP_SNAPSHOT_VERSION 1
+
+struct _GsStartupSnapshot
+{
+	GObject			 parent;
+
+	/* the lists loaded from disk, and those recorded since; recorded
+	 * lists are only serialised when saving, so they reflect any state
+	 * changes made to the apps in the meantime */
+	GHashTable		*loaded_lists;  /* (owned) (element-type utf8 GVariant) */
+	GHashTable		*recorded_lists;  /* (owned) (element-type utf8 GsAppList) */
+	GVariant		*category_sizes;  /* (owned) (nullable) */
+};
+
+G_DEFINE_TYPE (GsStartupSnapshot, gs_startup_snapshot, G_TYPE_OBJECT)
+
+static void
+gs_startup_snapshot_finalize (GObject *object)
+{
+	GsStartupSnapshot *self = GS_STARTUP_SNAPSHOT (object);
+
+	g_hash_table_unref (self->loaded_lists);
+	g_hash_table_unref (self->recorded_lists);
+	g_clear_pointer (&self->category_sizes, g_variant_unref);
+
+	G_OBJECT_CLASS (gs_startup_snapshot_parent_class)->finalize (object);
+}
+
+static void
+gs_startup_snapshot_class_init (GsStartupSnapshotClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gs_startup_snapshot_finalize;
+}
+
+static void
+gs_startup_snapshot_init (GsStartupSnapshot *self)
+{
+	self->loaded_lists = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, (GDestroyNotify) g_variant_unref);
+	self->recorded_lists = g_hash_table_new_full (g_str_hash, g_str_equal,
+						      g_free, g_object_unref);
+}
+
+/**
+ * gs_startup_snapshot_new:
+ *
+ * Create a new, empty #GsStartupSnapshot.
+ *
+ * Returns: (transfer full): a new #GsStartupSnapshot
+ * Since: 51
+ */
+GsStartupSnapshot *
+gs_startup_snapshot_new (void)
+{
+	return g_object_new (GS_TYPE_STARTUP_SNAPSHOT, NULL);
+}
+
+/* Returns the key to store the results of @plugin_job under, or %NULL if it
+ * can’t be stored in the snapshot. */
+static gchar *
+get_list_key (GsPluginJobListApps *plugin_job)
+{
+	g_autoptr(GsAppQuery) query = NULL;
+	GsPluginListAppsFlags flags;
+	const gchar * const *deployment_featured;
+	GDateTime *released_since;
+	g_autofree gchar *base_key = NULL;
+
+	g_object_get (plugin_job, "query", &query, "flags", &flags, NULL);
+
+	if (!(flags & GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT) ||
+	    query == NULL ||
+	    gs_app_query_get_n_properties_set (query) != 1)
+		return NULL;
+
+	deployment_featured = gs_app_query_get_deployment_featured (query);
+	released_since = gs_app_query_get_released_since (query);
+
+	if (gs_app_query_get_is_installed (query) == GS_APP_QUERY_TRISTATE_TRUE)
+		base_key = g_strdup ("installed");
+	else if (gs_app_query_get_is_featured (query) == GS_APP_QUERY_TRISTATE_TRUE)
+		base_key = g_strdup ("featured");
+	else if (gs_app_query_get_is_curated (query) == GS_APP_QUERY_TRISTATE_TRUE)
+		base_key = g_strdup ("curated");
+	else if (deployment_featured != NULL)
+		base_key = g_strjoinv (";", (gchar **) deployment_featured);
+	else if (released_since != NULL) {
+		g_autoptr(GDateTime) now = g_date_time_new_now_local ();
+		base_key = g_strdup_printf ("released-since-%" G_GINT64_FORMAT "-days",
+					    g_date_time_difference (now, released_since) / G_TIME_SPAN_DAY);
+	} else
+		return NULL;
+
+	/* these change the results, and may have been changed by the user
+	 * since the snapshot was taken */
+	return g_strdup_printf ("%s:%u:%u:%u",
+				base_key,
+				gs_app_query_get_max_results (query),
+				(guint) gs_app_query_get_license_type (query),
+				(guint) gs_app_query_get_developer_verified_type (query));
+}
+
+static gboolean
+categories_job_allows_snapshot (GsPluginJobListCategories *plugin_job)
+{
+	GsPluginRefineCategoriesFlags flags;
+
+	g_object_get (plugin_job, "flags", &flags, NULL);
+
+	return (flags & GS_PLUGIN_REFINE_CATEGORIES_FLAGS_ALLOW_SNAPSHOT) &&
+	       (flags & GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE);
+}
+
+static GsAppState
+get_persistent_state (GsApp *app)
+{
+	GsAppState state = gs_app_get_state (app);
+
+	/* don’t restore transient states, there will be nothing to finish
+	 * them after a restart */
+	switch (state) {
+	case GS_APP_STATE_INSTALLED:
+	case GS_APP_STATE_AVAILABLE:
+	case GS_APP_STATE_UPDATABLE:
+	case GS_APP_STATE_UPDATABLE_LIVE:
+		return state;
+	default:
+		return GS_APP_STATE_UNKNOWN;
+	}
+}
+
+static GVariant *
+app_to_variant (GsApp *app)
+{
+	g_auto(GVariantDict) dict = G_VARIANT_DICT_INIT (NULL);
+	g_auto(GVariantBuilder) icons_builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a(vuuu)"));
+	g_autoptr(GPtrArray) icons = NULL;
+	GPtrArray *categories;
+	guint64 size_installed;
+
+	g_variant_dict_insert (&dict, "unique-id", "s", gs_app_get_unique_id (app));
+	g_variant_dict_insert (&dict, "kind", "u", (guint32) gs_app_get_kind (app));
+	g_variant_dict_insert (&dict, "state", "u", (guint32) get_persistent_state (app));
+
+	if (gs_app_get_name (app) != NULL)
+		g_variant_dict_insert (&dict, "name", "s", gs_app_get_name (app));
+	if (gs_app_get_summary (app) != NULL)
+		g_variant_dict_insert (&dict, "summary", "s", gs_app_get_summary (app));
+	if (gs_app_get_developer_name (app) != NULL)
+		g_variant_dict_insert (&dict, "developer-name", "s", gs_app_get_developer_name (app));
+
+	categories = gs_app_get_categories (app);
+	if (categories->len > 0) {
+		g_auto(GVariantBuilder) categories_builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_STRING_ARRAY);
+
+		for (guint i = 0; i < categories->len; i++)
+			g_variant_builder_add (&categories_builder, "s", g_ptr_array_index (categories, i));
+		g_variant_dict_insert_value (&dict, "categories", g_variant_builder_end (&categories_builder));
+	}
+
+	if (gs_app_get_size_installed (app, &size_installed) == GS_SIZE_TYPE_VALID)
+		g_variant_dict_insert (&dict, "size-installed", "t", size_installed);
+
+	icons = gs_app_dup_icons (app);
+	for (guint i = 0; icons != NULL && i < icons->len; i++) {
+		GIcon *icon = g_ptr_array_index (icons, i);
+		g_autoptr(GVariant) serialized = g_icon_serialize (icon);
+
+		if (serialized == NULL)
+			continue;
+
+		g_variant_builder_add (&icons_builder, "(vuuu)",
+				       serialized,
+				       gs_icon_get_width (icon),
+				       gs_icon_get_height (icon),
+				       gs_icon_get_scale (icon));
+	}
+	g_variant_dict_insert_value (&dict, "icons", g_variant_builder_end (&icons_builder));
+
+	return g_variant_dict_end (&dict);
+}
+
+static GsApp *
+app_from_variant (GVariant *variant)
+{
+	g_autoptr(GVariantDict) dict = g_variant_dict_new (variant);
+	g_autoptr(GsApp) app = NULL;
+	g_autoptr(GVariantIter) icons_iter = NULL;
+	g_autofree const gchar **categories = NULL;
+	const gchar *unique_id;
+	const gchar *str;
+	guint32 kind, state;
+	guint64 size_installed;
+
+	if (!g_variant_dict_lookup (dict, "unique-id", "&s", &unique_id) ||
+	    !g_variant_dict_lookup (dict, "kind", "u", &kind) ||
+	    !g_variant_dict_lookup (dict, "state", "u", &state))
+		return NULL;
+
+	app = gs_app_new (NULL);
+	gs_app_set_from_unique_id (app, unique_id, (AsComponentKind) kind);
+	if (state != GS_APP_STATE_UNKNOWN)
+		gs_app_set_state (app, (GsAppState) state);
+
+	if (g_variant_dict_lookup (dict, "name", "&s", &str))
+		gs_app_set_name (app, GS_APP_QUALITY_LOWEST, str);
+	if (g_variant_dict_lookup (dict, "summary", "&s", &str))
+		gs_app_set_summary (app, GS_APP_QUALITY_LOWEST, str);
+	if (g_variant_dict_lookup (dict, "developer-name", "&s", &str))
+		gs_app_set_developer_name (app, str);
+
+	if (g_variant_dict_lookup (dict, "categories", "^a&s", &categories)) {
+		for (gsize i = 0; categories[i] != NULL; i++)
+			gs_app_add_category (app, categories[i]);
+	}
+
+	if (g_variant_dict_lookup (dict, "size-installed", "t", &size_installed))
+		gs_app_set_size_installed (app, GS_SIZE_TYPE_VALID, size_installed);
+
+	if (g_variant_dict_lookup (dict, "icons", "a(vuuu)", &icons_iter)) {
+		GVariant *serialized;
+		guint32 width, height, scale;
+
+		while (g_variant_iter_loop (icons_iter, "(vuuu)", &serialized, &width, &height, &scale)) {
+			g_autoptr(GIcon) icon = g_icon_deserialize (serialized);
+
+			if (icon == NULL)
+				continue;
+
+			gs_icon_set_width (icon, width);
+			gs_icon_set_height (icon, height);
+			gs_icon_set_scale (icon, scale);
+			gs_app_add_icon (app, icon);
+		}
+	}
+
+	return g_steal_pointer (&app);
+}
+
+static GVariant *
+list_to_variant (GsAppList *list)
+{
+	g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("aa{sv}"));
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+
+		if (gs_app_get_unique_id (app) == NULL ||
+		    gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD))
+			continue;
+
+		g_variant_builder_add_value (&builder, app_to_variant (app));
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+static GsAppList *
+list_from_variant (GVariant *variant)
+{
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	GVariantIter iter;
+	GVariant *child;
+
+	g_variant_iter_init (&iter, variant);
+	while ((child = g_variant_iter_next_value (&iter)) != NULL) {
+		g_autoptr(GVariant) child_owned = child;
+		g_autoptr(GsApp) app = app_from_variant (child);
+
+		if (app != NULL)
+			gs_app_list_add (list, app);
+	}
+
+	return g_steal_pointer (&list);
+}
+
+static GVariant *
+category_sizes_to_variant (GsCategory * const *categories,
+                           gsize               n_categories)
+{
+	g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a{su}"));
+
+	for (gsize i = 0; i < n_categories; i++) {
+		GsCategory *category = categories[i];
+		GPtrArray *children = gs_category_get_children (category);
+
+		g_variant_builder_add (&builder, "{su}",
+				       gs_category_get_id (category),
+				       gs_category_get_size (category));
+
+		for (guint j = 0; children != NULL && j < children->len; j++) {
+			GsCategory *child = g_ptr_array_index (children, j);
+			g_autofree gchar *key = g_strdup_printf ("%s/%s",
+								 gs_category_get_id (category),
+								 gs_category_get_id (child));
+
+			g_variant_builder_add (&builder, "{su}", key, gs_category_get_size (child));
+		}
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * gs_startup_snapshot_is_empty:
+ * @self: a #GsStartupSnapshot
+ *
+ * Check whether there are any results loaded from disk which jobs can be
+ * served from.
+ *
+ * Returns: %TRUE if no jobs can be served from @self, %FALSE otherwise
+ * Since: 51
+ */
+gboolean
+gs_startup_snapshot_is_empty (GsStartupSnapshot *self)
+{
+	g_return_val_if_fail (GS_IS_STARTUP_SNAPSHOT (self), TRUE);
+
+	return (g_hash_table_size (self->loaded_lists) == 0 &&
+		self->category_sizes == NULL);
+}
+
+/**
+ * gs_startup_snapshot_load:
+ * @self: a #GsStartupSnapshot
+ * @file: the file to load the snapshot from
+ * @error: return location for a #GError, or %NULL
+ *
+ * Load a snapshot previously saved with gs_startup_snapshot_save(), replacing
+ * anything loaded before.
+ *
+ * A snapshot saved by an incompatible version is ignored, and is not an error.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ * Since: 51
+ */
+gboolean
+gs_startup_snapshot_load (GsStartupSnapshot  *self,
+                          GFile              *file,
+                          GError            **error)
+{
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) variant = NULL;
+	g_autoptr(GVariantDict) dict = NULL;
+	g_autoptr(GVariant) lists = NULL;
+	g_autoptr(GVariant) category_sizes = NULL;
+	guint32 version = 0;
+
+	g_return_val_if_fail (GS_IS_STARTUP_SNAPSHOT (self), FALSE);
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	bytes = g_file_load_bytes (file, NULL, NULL, error);
+	if (bytes == NULL)
+		return FALSE;
+
+	variant = g_variant_new_from_bytes (G_VARIANT_TYPE_VARDICT, bytes, FALSE);
+	if (!g_variant_is_normal_form (variant)) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "Startup snapshot is corrupt");
+		return FALSE;
+	}
+
+	g_hash_table_remove_all (self->loaded_lists);
+	g_clear_pointer (&self->category_sizes, g_variant_unref);
+
+	dict = g_variant_dict_new (variant);
+	if (!g_variant_dict_lookup (dict, "version", "u", &version) ||
+	    version != GS_STARTUP_SNAPSHOT_VERSION) {
+		g_debug ("Ignoring startup snapshot with version %u", version);
+		return TRUE;
+	}
+
+	lists = g_variant_dict_lookup_value (dict, "lists", G_VARIANT_TYPE ("a{saa{sv}}"));
+	if (lists != NULL) {
+		GVariantIter iter;
+		const gchar *key;
+		GVariant *list;
+
+		g_variant_iter_init (&iter, lists);
+		while (g_variant_iter_next (&iter, "{&s@aa{sv}}", &key, &list))
+			g_hash_table_insert (self->loaded_lists, g_strdup (key), list);
+	}
+
+	category_sizes = g_variant_dict_lookup_value (dict, "category-sizes", G_VARIANT_TYPE ("a{su}"));
+	self->category_sizes = g_steal_pointer (&category_sizes);
+
+	return TRUE;
+}
+
+/**
+ * gs_startup_snapshot_save:
+ * @self: a #GsStartupSnapshot
+ * @file: the file to save the snapshot to
+ * @error: return location for a #GError, or %NULL
+ *
+ * Save the snapshot to @file. Lists recorded with
+ * gs_startup_snapshot_record_job() replace those loaded from disk for the
+ * same job; loaded lists which were not recorded again are kept.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ * Since: 51
+ */
+gboolean
+gs_startup_snapshot_save (GsStartupSnapshot  *self,
+                          GFile              *file,
+                          GError            **error)
+{
+	g_auto(GVariantBuilder) lists_builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a{saa{sv}}"));
+	g_auto(GVariantDict) dict = G_VARIANT_DICT_INIT (NULL);
+	g_autoptr(GVariant) variant = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GFile) parent = NULL;
+	g_autoptr(GError) local_error = NULL;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_return_val_if_fail (GS_IS_STARTUP_SNAPSHOT (self), FALSE);
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	g_hash_table_iter_init (&iter, self->recorded_lists);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_variant_builder_add (&lists_builder, "{s@aa{sv}}", key, list_to_variant (value));
+
+	g_hash_table_iter_init (&iter, self->loaded_lists);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (!g_hash_table_contains (self->recorded_lists, key))
+			g_variant_builder_add (&lists_builder, "{s@aa{sv}}", key, value);
+	}
+
+	g_variant_dict_insert (&dict, "version", "u", (guint32) GS_STARTUP_SNAPSHOT_VERSION);
+	g_variant_dict_insert_value (&dict, "lists", g_variant_builder_end (&lists_builder));
+	if (self->category_sizes != NULL)
+		g_variant_dict_insert_value (&dict, "category-sizes", self->category_sizes);
+
+	variant = g_variant_ref_sink (g_variant_dict_end (&dict));
+	bytes = g_variant_get_data_as_bytes (variant);
+
+	parent = g_file_get_parent (file);
+	if (parent != NULL &&
+	    !g_file_make_directory_with_parents (parent, NULL, &local_error) &&
+	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_EXISTS)) {
+		g_propagate_error (error, g_steal_pointer (&local_error));
+		return FALSE;
+	}
+
+	return g_file_replace_contents (file,
+					g_bytes_get_data (bytes, NULL),
+					g_bytes_get_size (bytes),
+					NULL, FALSE,
+					G_FILE_CREATE_PRIVATE | G_FILE_CREATE_REPLACE_DESTINATION,
+					NULL, NULL, error);
+}
+
+/**
+ * gs_startup_snapshot_record_job:
+ * @self: a #GsStartupSnapshot
+ * @plugin_job: a successfully completed #GsPluginJob
+ *
+ * Record the results of @plugin_job, if it is one which can be served from
+ * the snapshot. Other jobs are ignored.
+ *
+ * Since: 51
+ */
+void
+gs_startup_snapshot_record_job (GsStartupSnapshot *self,
+                                GsPluginJob       *plugin_job)
+{
+	g_return_if_fail (GS_IS_STARTUP_SNAPSHOT (self));
+	g_return_if_fail (GS_IS_PLUGIN_JOB (plugin_job));
+
+	if (GS_IS_PLUGIN_JOB_LIST_APPS (plugin_job)) {
+		GsPluginJobListApps *list_apps_job = GS_PLUGIN_JOB_LIST_APPS (plugin_job);
+		g_autofree gchar *key = get_list_key (list_apps_job);
+		GsAppList *list = gs_plugin_job_list_apps_get_result_list (list_apps_job);
+
+		if (key == NULL || list == NULL)
+			return;
+
+		g_hash_table_replace (self->recorded_lists, g_steal_pointer (&key), g_object_ref (list));
+	} else if (GS_IS_PLUGIN_JOB_LIST_CATEGORIES (plugin_job)) {
+		GsPluginJobListCategories *list_categories_job = GS_PLUGIN_JOB_LIST_CATEGORIES (plugin_job);
+		GPtrArray *categories = gs_plugin_job_list_categories_get_result_list (list_categories_job);
+
+		if (!categories_job_allows_snapshot (list_categories_job) || categories == NULL)
+			return;
+
+		/* the categories are shared and their sizes change with every
+		 * job, so take a copy of them now */
+		g_clear_pointer (&self->category_sizes, g_variant_unref);
+		self->category_sizes = g_variant_ref_sink (category_sizes_to_variant ((GsCategory * const *) categories->pdata,
+										    categories->len));
+	}
+}
+
+/**
+ * gs_startup_snapshot_serve_job:
+ * @self: a #GsStartupSnapshot
+ * @plugin_job: a #GsPluginJob which has not been run
+ * @category_manager: the category manager to set category sizes on
+ *
+ * Set the results of @plugin_job from the snapshot, if it is one which can be
+ * served from the snapshot and its results were loaded from disk.
+ *
+ * If %TRUE is returned, the caller must complete @plugin_job without running
+ * it.
+ *
+ * Like running a category job does, serving one sets the sizes of the shared
+ * categories from @category_manager. Running the job again once the plugins
+ * are set up resets and recounts them.
+ *
+ * Returns: %TRUE if the results of @plugin_job were set, %FALSE otherwise
+ * Since: 51
+ */
+gboolean
+gs_startup_snapshot_serve_job (GsStartupSnapshot *self,
+                               GsPluginJob       *plugin_job,
+                               GsCategoryManager *category_manager)
+{
+	g_return_val_if_fail (GS_IS_STARTUP_SNAPSHOT (self), FALSE);
+	g_return_val_if_fail (GS_IS_PLUGIN_JOB (plugin_job), FALSE);
+	g_return_val_if_fail (GS_IS_CATEGORY_MANAGER (category_manager), FALSE);
+
+	if (GS_IS_PLUGIN_JOB_LIST_APPS (plugin_job)) {
+		GsPluginJobListApps *list_apps_job = GS_PLUGIN_JOB_LIST_APPS (plugin_job);
+		g_autofree gchar *key = get_list_key (list_apps_job);
+		GVariant *variant;
+		g_autoptr(GsAppList) list = NULL;
+
+		if (key == NULL)
+			return FALSE;
+		variant = g_hash_table_lookup (self->loaded_lists, key);
+		if (variant == NULL)
+			return FALSE;
+
+		list = list_from_variant (variant);
+		gs_plugin_job_list_apps_set_result_list (list_apps_job, list);
+
+		return TRUE;
+	} else if (GS_IS_PLUGIN_JOB_LIST_CATEGORIES (plugin_job)) {
+		GsPluginJobListCategories *list_categories_job = GS_PLUGIN_JOB_LIST_CATEGORIES (plugin_job);
+		GsCategory * const *categories;
+		gsize n_categories;
+		g_autoptr(GPtrArray) category_list = NULL;
+
+		if (!categories_job_allows_snapshot (list_categories_job) ||
+		    self->category_sizes == NULL)
+			return FALSE;
+
+		categories = gs_category_manager_get_categories (category_manager, &n_categories);
+		category_list = g_ptr_array_new_full (n_categories, (GDestroyNotify) g_object_unref);
+
+		for (gsize i = 0; i < n_categories; i++) {
+			GsCategory *category = categories[i];
+			GPtrArray *children = gs_category_get_children (category);
+			guint32 size = 0;
+
+			g_variant_lookup (self->category_sizes, gs_category_get_id (category), "u", &size);
+			gs_category_set_size (category, size);
+
+			for (guint j = 0; children != NULL && j < children->len; j++) {
+				GsCategory *child = g_ptr_array_index (children, j);
+				g_autofree gchar *key = g_strdup_printf ("%s/%s",
+									 gs_category_get_id (category),
+									 gs_category_get_id (child));
+
+				size = 0;
+				g_variant_lookup (self->category_sizes, key, "u", &size);
+				gs_category_set_size (child, size);
+			}
+
+			g_ptr_array_add (category_list, g_object_ref (category));
+		}
+
+		gs_plugin_job_list_categories_set_result_list (list_categories_job, category_list);
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
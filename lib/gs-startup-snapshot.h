@@ -0,0 +1,41 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "gs-category-manager.h"
+#include "gs-plugin-job.h"
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_STARTUP_SNAPSHOT (gs_startup_snapshot_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsStartupSnapshot, gs_startup_snapshot, GS, STARTUP_SNAPSHOT, GObject)
+
+GsStartupSnapshot	*gs_startup_snapshot_new	(void);
+
+gboolean		 gs_startup_snapshot_is_empty	(GsStartupSnapshot	*self);
+
+gboolean		 gs_startup_snapshot_load	(GsStartupSnapshot	*self,
+							 GFile			*file,
+							 GError			**error);
+gboolean		 gs_startup_snapshot_save	(GsStartupSnapshot	*self,
+							 GFile			*file,
+							 GError			**error);
+
+void			 gs_startup_snapshot_record_job	(GsStartupSnapshot	*self,
+							 GsPluginJob		*plugin_job);
+gboolean		 gs_startup_snapshot_serve_job	(GsStartupSnapshot	*self,
+							 GsPluginJob		*plugin_job,
+							 GsCategoryManager	*category_manager);
+
+G_END_DECLS
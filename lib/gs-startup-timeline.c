@@ -0,0 +1,250 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-startup-timeline
+ * @short_description: Records where the time goes during startup
+ *
+ * The startup timeline is a process-wide list of monotonic timestamps for the
+ * milestones of a cold start: plugin setup, silo builds, the first overview
+ * query, the first frame, and so on. Each entry is either a point in time
+ * (gs_startup_timeline_mark()) or a span which ends when it is recorded
+ * (gs_startup_timeline_add_span()).
+ *
+ * Every entry is also printed as a debug message, so it shows up with
+ * `--verbose`, and added as a sysprof mark if sysprof support is enabled.
+ *
+ * Recording starts with gs_startup_timeline_begin(), or with the first entry
+ * if that is never called, and ends with gs_startup_timeline_stop(), after
+ * which new entries are ignored. This stops work done later, such as silo
+ * rebuilds after a metadata refresh, from being mistaken for startup work.
+ *
+ * All the functions are safe to call from any thread.
+ *
+ * Since: 51
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gs-profiler.h"
+#include "gs-startup-timeline.h"
+
+typedef struct {
+	gchar *name;  /* (owned) */
+	gint64 begin_time_usec;
+	gint64 end_time_usec;
+} Entry;
+
+G_LOCK_DEFINE_STATIC (timeline);
+static gint64 origin_usec = 0;  /* (lock timeline) */
+static gboolean stopped = FALSE;  /* (lock timeline) */
+static GArray *entries = NULL;  /* (lock timeline) (owned) (nullable) (element-type Entry) */
+
+static void
+entry_clear (Entry *entry)
+{
+	g_free (entry->name);
+}
+
+/**
+ * gs_startup_timeline_begin:
+ *
+ * Start recording the startup timeline, forgetting anything recorded so far.
+ * Times in the timeline are relative to when this was called.
+ *
+ * Since: 51
+ */
+void
+gs_startup_timeline_begin (void)
+{
+	G_LOCK (timeline);
+	origin_usec = g_get_monotonic_time ();
+	stopped = FALSE;
+	g_clear_pointer (&entries, g_array_unref);
+	G_UNLOCK (timeline);
+}
+
+static void
+add_entry (const gchar *name,
+           gint64       begin_time_usec,
+           gint64       end_time_usec)
+{
+	Entry entry;
+	gint64 origin;
+
+	G_LOCK (timeline);
+
+	if (stopped) {
+		G_UNLOCK (timeline);
+		return;
+	}
+
+	if (origin_usec == 0)
+		origin_usec = begin_time_usec;
+	if (entries == NULL) {
+		entries = g_array_new (FALSE, FALSE, sizeof (Entry));
+		g_array_set_clear_func (entries, (GDestroyNotify) entry_clear);
+	}
+
+	entry.name = g_strdup (name);
+	entry.begin_time_usec = begin_time_usec;
+	entry.end_time_usec = end_time_usec;
+	g_array_append_val (entries, entry);
+	origin = origin_usec;
+
+	G_UNLOCK (timeline);
+
+	if (end_time_usec > begin_time_usec)
+		g_debug ("startup timeline: %s at %.1f ms, took %.1f ms", name,
+			 (gdouble) (begin_time_usec - origin) / G_TIME_SPAN_MILLISECOND,
+			 (gdouble) (end_time_usec - begin_time_usec) / G_TIME_SPAN_MILLISECOND);
+	else
+		g_debug ("startup timeline: %s at %.1f ms", name,
+			 (gdouble) (begin_time_usec - origin) / G_TIME_SPAN_MILLISECOND);
+
+	/* both clocks are CLOCK_MONOTONIC; sysprof just counts in ns */
+	GS_PROFILER_ADD_MARK (StartupTimeline, begin_time_usec * 1000,
+			      name, "startup timeline");
+}
+
+/**
+ * gs_startup_timeline_mark:
+ * @name: name of the milestone
+ *
+ * Record that the milestone @name has been reached now.
+ *
+ * Since: 51
+ */
+void
+gs_startup_timeline_mark (const gchar *name)
+{
+	gint64 now = g_get_monotonic_time ();
+
+	g_return_if_fail (name != NULL);
+
+	add_entry (name, now, now);
+}
+
+/**
+ * gs_startup_timeline_add_span:
+ * @name: name of the span
+ * @begin_time_usec: when the span began, from g_get_monotonic_time()
+ *
+ * Record that the span @name ran from @begin_time_usec until now.
+ *
+ * Since: 51
+ */
+void
+gs_startup_timeline_add_span (const gchar *name,
+                              gint64       begin_time_usec)
+{
+	g_return_if_fail (name != NULL);
+
+	add_entry (name, begin_time_usec, g_get_monotonic_time ());
+}
+
+/**
+ * gs_startup_timeline_stop:
+ *
+ * Stop recording the startup timeline. Entries added after this are ignored,
+ * while the ones already recorded are kept for
+ * gs_startup_timeline_to_string().
+ *
+ * Since: 51
+ */
+void
+gs_startup_timeline_stop (void)
+{
+	G_LOCK (timeline);
+	stopped = TRUE;
+	G_UNLOCK (timeline);
+}
+
+/**
+ * gs_startup_timeline_is_recording:
+ *
+ * Get whether entries are still being recorded, which is the case until
+ * gs_startup_timeline_stop() is called.
+ *
+ * Returns: %TRUE if recording
+ *
+ * Since: 51
+ */
+gboolean
+gs_startup_timeline_is_recording (void)
+{
+	gboolean recording;
+
+	G_LOCK (timeline);
+	recording = !stopped;
+	G_UNLOCK (timeline);
+
+	return recording;
+}
+
+static gint
+entry_sort_cb (gconstpointer a,
+               gconstpointer b)
+{
+	const Entry *entry_a = a;
+	const Entry *entry_b = b;
+
+	if (entry_a->begin_time_usec != entry_b->begin_time_usec)
+		return (entry_a->begin_time_usec < entry_b->begin_time_usec) ? -1 : 1;
+	if (entry_a->end_time_usec != entry_b->end_time_usec)
+		return (entry_a->end_time_usec < entry_b->end_time_usec) ? -1 : 1;
+	return 0;
+}
+
+/**
+ * gs_startup_timeline_to_string:
+ *
+ * Format the timeline recorded so far as a table, one entry per line, in the
+ * order they began. Each line has the start time and, for spans, the
+ * duration, both in milliseconds, followed by the name.
+ *
+ * Returns: (transfer full): the formatted timeline
+ *
+ * Since: 51
+ */
+gchar *
+gs_startup_timeline_to_string (void)
+{
+	GString *str = g_string_new ("# start (ms)  duration (ms)  milestone\n");
+	g_autoptr(GArray) sorted = NULL;
+	gint64 origin;
+
+	G_LOCK (timeline);
+	origin = origin_usec;
+	sorted = g_array_sized_new (FALSE, FALSE, sizeof (Entry),
+				    (entries != NULL) ? entries->len : 0);
+	for (guint i = 0; entries != NULL && i < entries->len; i++) {
+		Entry entry = g_array_index (entries, Entry, i);
+		entry.name = g_strdup (entry.name);
+		g_array_append_val (sorted, entry);
+	}
+	g_array_set_clear_func (sorted, (GDestroyNotify) entry_clear);
+	G_UNLOCK (timeline);
+
+	g_array_sort (sorted, entry_sort_cb);
+
+	for (guint i = 0; i < sorted->len; i++) {
+		const Entry *entry = &g_array_index (sorted, Entry, i);
+
+		g_string_append_printf (str, "%12.1f", (gdouble) (entry->begin_time_usec - origin) / G_TIME_SPAN_MILLISECOND);
+		if (entry->end_time_usec > entry->begin_time_usec)
+			g_string_append_printf (str, "  %13.1f", (gdouble) (entry->end_time_usec - entry->begin_time_usec) / G_TIME_SPAN_MILLISECOND);
+		else
+			g_string_append_printf (str, "  %13s", "");
+		g_string_append_printf (str, "  %s\n", entry->name);
+	}
+
+	return g_string_free (str, FALSE);
+}
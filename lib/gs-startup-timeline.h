@@ -0,0 +1,23 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void		 gs_startup_timeline_begin	(void);
+void		 gs_startup_timeline_mark	(const gchar	*name);
+void		 gs_startup_timeline_add_span	(const gchar	*name,
+						 gint64		 begin_time_usec);
+void		 gs_startup_timeline_stop	(void);
+gboolean	 gs_startup_timeline_is_recording	(void);
+gchar		*gs_startup_timeline_to_string	(void);
+
+G_END_DECLS
@@ -172,3 +172,202 @@ gs_test_reinitialise_plugin_loader (GsPluginLoader      *plugin_loader,
 	}
 #endif  /* HAVE_SYSPROF */
 }
+
+static const gchar * const generated_adjectives[] = {
+	"Quick", "Bright", "Simple", "Tiny", "Open", "Smart", "Gentle", "Bold",
+	"Clever", "Silent", "Rapid", "Sharp", "Classic", "Modern", "Free", "Lucid",
+};
+
+static const gchar * const generated_nouns[] = {
+	"Editor", "Player", "Viewer", "Browser", "Terminal", "Calculator", "Notes", "Mail",
+	"Camera", "Maps", "Weather", "Clock", "Studio", "Reader", "Chess", "Scanner",
+};
+
+static const gchar * const generated_categories[] = {
+	"AudioVideo", "Development", "Education", "Game", "Graphics", "Network",
+	"Office", "Science", "System", "Utility",
+};
+
+static const gchar * const generated_locales[] = {
+	"de", "fr", "es", "it", "pt_BR", "ja", "zh_CN", "ru",
+	"pl", "nl", "sv", "cs", "ko", "tr", "uk", "fi",
+};
+
+#define PICK(rand, array) (array[g_rand_int_range ((rand), 0, G_N_ELEMENTS (array))])
+
+/**
+ * gs_test_generate_appstream_xml:
+ * @n_components: number of components to generate
+ * @n_locales: number of translations of each component, up to 16
+ * @seed: seed for the random choices
+ *
+ * Generate an AppStream catalog of @n_components desktop apps, each with a
+ * name, summary and description translated into @n_locales locales, some
+ * categories and keywords, three screenshots and five releases. This is
+ * meant for testing and benchmarking at the scale of a real repository.
+ *
+ * The same arguments always generate the same catalog. The components are
+ * called `org.example.Synthetic` followed by their index, and the summary of
+ * each one ends in one of sixteen nouns, like ‘editor’, which are also used as
+ * keywords, so each of them matches about one in sixteen components. Only the
+ * component halfway through the catalog has the keyword `needle`.
+ *
+ * Returns: (transfer full): the catalog as AppStream XML
+ *
+ * Since: 51
+ */
+gchar *
+gs_test_generate_appstream_xml (guint   n_components,
+                                guint   n_locales,
+                                guint32 seed)
+{
+	g_autoptr(GRand) rand = g_rand_new_with_seed (seed);
+	GString *xml = g_string_sized_new (n_components * (1500 + n_locales * 250));
+
+	n_locales = MIN (n_locales, G_N_ELEMENTS (generated_locales));
+
+	g_string_append (xml,
+			 "<?xml version=\"1.0\"?>\n"
+			 "<components origin=\"synthetic\" version=\"0.14\">\n");
+
+	for (guint i = 0; i < n_components; i++) {
+		const gchar *adjective = PICK (rand, generated_adjectives);
+		const gchar *noun = PICK (rand, generated_nouns);
+		g_autofree gchar *noun_lower = g_ascii_strdown (noun, -1);
+		gint64 timestamp = 1700000000 - g_rand_int_range (rand, 0, 1000000);
+		guint n_categories = g_rand_int_range (rand, 1, 3);
+
+		g_string_append_printf (xml,
+					"  <component type=\"desktop-application\">\n"
+					"    <id>org.example.Synthetic%u</id>\n"
+					"    <name>%s %s %u</name>\n",
+					i, adjective, noun, i);
+		for (guint j = 0; j < n_locales; j++)
+			g_string_append_printf (xml, "    <name xml:lang=\"%s\">%s %s %u (%s)</name>\n",
+						generated_locales[j], adjective, noun, i, generated_locales[j]);
+
+		g_string_append_printf (xml, "    <summary>A %s %s</summary>\n",
+					PICK (rand, generated_adjectives), noun_lower);
+		for (guint j = 0; j < n_locales; j++)
+			g_string_append_printf (xml, "    <summary xml:lang=\"%s\">A %s %s (%s)</summary>\n",
+						generated_locales[j], adjective, noun_lower, generated_locales[j]);
+
+		g_string_append_printf (xml,
+					"    <description>\n"
+					"      <p>%s %s is a synthetic app, generated for testing. "
+					"It does nothing, but it does it with a reasonably long description.</p>\n"
+					"      <p>It is number %u in its catalog.</p>\n"
+					"    </description>\n",
+					adjective, noun, i);
+		for (guint j = 0; j < n_locales; j++)
+			g_string_append_printf (xml,
+						"    <description xml:lang=\"%s\">\n"
+						"      <p>%s %s is a synthetic app (%s).</p>\n"
+						"    </description>\n",
+						generated_locales[j], adjective, noun, generated_locales[j]);
+
+		g_string_append (xml, "    <categories>\n");
+		for (guint j = 0; j < n_categories; j++)
+			g_string_append_printf (xml, "      <category>%s</category>\n",
+						PICK (rand, generated_categories));
+		g_string_append (xml, "    </categories>\n");
+
+		g_string_append_printf (xml,
+					"    <keywords>\n"
+					"      <keyword>%s</keyword>\n"
+					"      <keyword>%s</keyword>\n",
+					PICK (rand, generated_nouns), PICK (rand, generated_adjectives));
+		if (i == n_components / 2)
+			g_string_append (xml, "      <keyword>needle</keyword>\n");
+		g_string_append (xml, "    </keywords>\n");
+
+		g_string_append (xml, "    <screenshots>\n");
+		for (guint j = 0; j < 3; j++)
+			g_string_append_printf (xml,
+						"      <screenshot%s>\n"
+						"        <caption>Screenshot %u</caption>\n"
+						"        <image type=\"source\" width=\"1600\" height=\"900\">https://example.org/synthetic/%u/%u.png</image>\n"
+						"      </screenshot>\n",
+						(j == 0) ? " type=\"default\"" : "", j, i, j);
+		g_string_append (xml, "    </screenshots>\n");
+
+		g_string_append (xml, "    <releases>\n");
+		for (guint j = 0; j < 5; j++)
+			g_string_append_printf (xml,
+						"      <release version=\"1.%u.%u\" timestamp=\"%" G_GINT64_FORMAT "\">\n"
+						"        <description><p>Bug fixes and improvements.</p></description>\n"
+						"      </release>\n",
+						4 - j, i % 10, timestamp - (gint64) j * 2592000);
+		g_string_append (xml, "    </releases>\n");
+
+		g_string_append_printf (xml,
+					"    <launchable type=\"desktop-id\">org.example.Synthetic%u.desktop</launchable>\n"
+					"    <icon type=\"stock\">application-x-executable</icon>\n"
+					"    <url type=\"homepage\">https://example.org/synthetic/%u</url>\n"
+					"    <project_license>GPL-2.0-or-later</project_license>\n"
+					"    <developer><name>Example Developers</name></developer>\n"
+					"    <content_rating type=\"oars-1.1\"/>\n"
+					"    <pkgname>synthetic-%u</pkgname>\n"
+					"  </component>\n",
+					i, i, i);
+	}
+
+	g_string_append (xml,
+			 "  <info>\n"
+			 "    <scope>system</scope>\n"
+			 "  </info>\n"
+			 "</components>\n");
+
+	return g_string_free (xml, FALSE);
+}
+
+/**
+ * gs_test_get_env_uint:
+ * @name: name of the environment variable
+ * @min_value: smallest valid value
+ * @default_value: value to return if @name is unset or invalid
+ *
+ * Get a tunable, such as the size of a generated catalog or a budget, from an
+ * environment variable holding a decimal number of at least @min_value.
+ *
+ * Returns: the value of @name, or @default_value
+ *
+ * Since: 51
+ */
+guint
+gs_test_get_env_uint (const gchar *name,
+                      guint        min_value,
+                      guint        default_value)
+{
+	const gchar *value = g_getenv (name);
+	guint64 parsed;
+
+	if (value == NULL || !g_ascii_string_to_unsigned (value, 10, min_value, G_MAXUINT, &parsed, NULL))
+		return default_value;
+	return (guint) parsed;
+}
+
+/**
+ * gs_test_double_cmp:
+ * @a: pointer to a #gdouble
+ * @b: pointer to another #gdouble
+ *
+ * A #GCompareFunc to sort an array of #gdouble in ascending order, for example
+ * to find the median of some timings.
+ *
+ * Returns: negative, zero or positive if @a is less than, equal to or greater
+ *   than @b
+ *
+ * Since: 51
+ */
+gint
+gs_test_double_cmp (gconstpointer a,
+                    gconstpointer b)
+{
+	gdouble value_a = *((const gdouble *) a);
+	gdouble value_b = *((const gdouble *) b);
+
+	if (value_a != value_b)
+		return (value_a < value_b) ? -1 : 1;
+	return 0;
+}
@@ -24,4 +24,13 @@ void	 gs_test_reinitialise_plugin_loader	(GsPluginLoader		*plugin_loader,
 						 const gchar * const	*allowlist,
 						 const gchar * const	*blocklist);
 
+gchar	*gs_test_generate_appstream_xml		(guint		 n_components,
+						 guint		 n_locales,
+						 guint32	 seed);
+guint	 gs_test_get_env_uint			(const gchar	*name,
+						 guint		 min_value,
+						 guint		 default_value);
+gint	 gs_test_double_cmp			(gconstpointer	 a,
+						 gconstpointer	 b);
+
 G_END_DECLS
@@ -168,4 +168,49 @@ gint		 gs_utils_compare_versions	(const gchar		*ver1,
 GsAppList	*gs_utils_filter_apps_for_plugin(GsAppList		*list,
 						 GsPlugin		*plugin);
 
+/**
+ * GS_UTILS_CANCELLATION_CHECKPOINT_INTERVAL:
+ *
+ * How many loop iterations gs_utils_cancellation_checkpoint() lets pass
+ * between checks of the #GCancellable.
+ *
+ * Since: 51
+ */
+#define GS_UTILS_CANCELLATION_CHECKPOINT_INTERVAL 16
+
+/**
+ * gs_utils_cancellation_checkpoint:
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @iteration: index of the current iteration of the loop
+ * @error: return location for a #GError, or %NULL
+ *
+ * Cancellation checkpoint for loops which may run over a whole catalogue,
+ * so that cancelling a search or leaving a page stops the work within a
+ * few iterations, rather than once the loop is done.
+ *
+ * @cancellable is only checked every
+ * %GS_UTILS_CANCELLATION_CHECKPOINT_INTERVAL iterations, starting with the
+ * first, which keeps the cost negligible even in tight loops.
+ *
+ * |[<!-- language="C" -->
+ * for (guint i = 0; i < components->len; i++) {
+ * 	if (gs_utils_cancellation_checkpoint (cancellable, i, error))
+ * 		return FALSE;
+ * 	...
+ * }
+ * ]|
+ *
+ * Returns: %TRUE if @cancellable was cancelled and @error was set,
+ *   %FALSE to carry on
+ * Since: 51
+ */
+static inline gboolean
+gs_utils_cancellation_checkpoint (GCancellable	*cancellable,
+				  guint		 iteration,
+				  GError	**error)
+{
+	return (iteration % GS_UTILS_CANCELLATION_CHECKPOINT_INTERVAL) == 0 &&
+	       g_cancellable_set_error_if_cancelled (cancellable, error);
+}
+
 G_END_DECLS
@@ -20,9 +20,26 @@
  * them in (priority, queue order) order. Each #GTaskThreadFunc is responsible
  * for calling `g_task_return_*()` on its #GTask to complete that task.
  *
+ * Tasks which have been waiting for a long time are aged: their priority is
+ * raised a step for every %GS_WORKER_THREAD_AGING_INTERVAL_USEC they have been
+ * queued for, so a steady stream of high priority tasks can’t starve low
+ * priority ones forever.
+ *
+ * Tasks are not interrupted once they have started, so a long running low
+ * priority task can delay a high priority one queued behind it. Long running
+ * tasks should call gs_worker_thread_yield() between steps of their work, which
+ * runs any more urgent queued tasks before returning.
+ *
  * The priority passed to gs_worker_thread_queue() will be used to adjust the
  * worker thread’s I/O priority (using `ioprio_set()`) when executing that task.
  *
+ * Tasks which only read shared state, and which are safe to run concurrently
+ * with each other and with the tasks on the worker thread, can instead be
+ * queued with gs_worker_thread_queue_read_only(). These are run on a small
+ * thread pool shared by all #GsWorkerThreads in the process, so that, for
+ * example, two searches on the same plugin don’t have to wait for each other.
+ * The worker thread itself remains the only place where mutating tasks run.
+ *
  * It is intended that gs_worker_thread_queue() is an alternative to using
  * g_task_run_in_thread(). g_task_run_in_thread() queues tasks into a single
  * process-wide thread pool, so they are mixed in with other tasks, and it can
@@ -42,6 +59,7 @@
 #include <glib-object.h>
 
 #include "gs-ioprio.h"
+#include "gs-profiler.h"
 #include "gs-worker-thread.h"
 
 typedef enum {
@@ -65,9 +83,36 @@ struct _GsWorkerThread
 	GCond			 tid_cond;
 
 	GMutex			 queue_mutex;
-	GQueue			 queue;
+	GTree			*queues;  /* (mutex queue_mutex) (owned) (element-type gint GQueue<WorkData>); empty queues are removed */
+	guint			 n_queued;  /* (mutex queue_mutex) */
+	guint			 queue_depth_counter;  /* sysprof counter ID, or 0 if not profiling */
+
+	gint			 current_priority;  /* only accessed from the worker thread; G_MAXINT if no task is running */
+	gboolean		 in_yield;  /* only accessed from the worker thread */
+
+	GMutex			 read_only_mutex;
+	GCond			 read_only_cond;
+	guint			 n_read_only_pending;  /* (mutex read_only_mutex) */
 };
 
+/* The pool for gs_worker_thread_queue_read_only(), shared by all workers and
+ * never freed, like the pool behind g_task_run_in_thread(). */
+#define GS_WORKER_THREAD_MIN_READ_ONLY_THREADS 2
+#define GS_WORKER_THREAD_MAX_READ_ONLY_THREADS 4
+
+static GThreadPool *read_only_pool = NULL;
+static guint read_only_sequence = 0;  /* (atomic) */
+
+/* The #GsWorkerThread whose read-only task is running in the current pool
+ * thread, if any. */
+static GPrivate read_only_worker_key;
+
+/* How long a task has to wait in the queue for its priority to be raised by
+ * %GS_WORKER_THREAD_AGING_STEP, and how far it can be raised. */
+#define GS_WORKER_THREAD_AGING_INTERVAL_USEC (500 * G_TIME_SPAN_MILLISECOND)
+#define GS_WORKER_THREAD_AGING_STEP (G_PRIORITY_HIGH_IDLE - G_PRIORITY_DEFAULT)
+#define GS_WORKER_THREAD_AGING_LIMIT G_PRIORITY_HIGH
+
 typedef enum {
 	PROP_NAME = 1,
 } GsWorkerThreadProperty;
@@ -80,6 +125,11 @@ typedef struct {
 	GTaskThreadFunc work_func;
 	GTask *task;  /* (owned) */
 	gint priority;
+	gint64 queued_time_usec;
+
+	/* Only set for read-only tasks. */
+	GsWorkerThread *worker;  /* (unowned) (nullable) */
+	guint sequence;
 } WorkData;
 
 static void
@@ -141,7 +191,7 @@ gs_worker_thread_dispose (GObject *object)
 	g_clear_pointer (&self->worker_context, g_main_context_unref);
 
 	g_mutex_lock (&self->queue_mutex);
-	g_queue_clear_full (&self->queue, (GDestroyNotify) work_data_free);
+	g_clear_pointer (&self->queues, g_tree_unref);
 	g_mutex_unlock (&self->queue_mutex);
 
 	G_OBJECT_CLASS (gs_worker_thread_parent_class)->dispose (object);
@@ -153,6 +203,8 @@ gs_worker_thread_finalize (GObject *object)
 	GsWorkerThread *self = GS_WORKER_THREAD (object);
 
 	g_mutex_clear (&self->queue_mutex);
+	g_mutex_clear (&self->read_only_mutex);
+	g_cond_clear (&self->read_only_cond);
 	g_mutex_clear (&self->tid_mutex);
 	g_cond_clear (&self->tid_cond);
 
@@ -168,6 +220,10 @@ gs_worker_thread_constructed (GObject *object)
 
 	G_OBJECT_CLASS (gs_worker_thread_parent_class)->constructed (object);
 
+	self->queue_depth_counter = GS_PROFILER_DEFINE_COUNTER ("Worker queues",
+								(self->name != NULL) ? self->name : "unnamed",
+								"Tasks waiting on the worker thread");
+
 	/* Start up a worker thread and its #GMainContext. The worker will run
 	 * and process events on @worker_context until @worker_state changes
 	 * from %GS_WORKER_THREAD_STATE_RUNNING. */
@@ -205,32 +261,156 @@ gs_worker_thread_class_init (GsWorkerThreadClass *klass)
 }
 
 static void
-gs_worker_thread_run_queue (GsWorkerThread *self)
+queue_free (GQueue *queue)
+{
+	g_queue_free_full (queue, (GDestroyNotify) work_data_free);
+}
+
+static gint
+priority_cmp (gconstpointer a,
+              gconstpointer b,
+              gpointer      user_data)
+{
+	gint priority_a = GPOINTER_TO_INT (a);
+	gint priority_b = GPOINTER_TO_INT (b);
+
+	return (priority_a < priority_b) ? -1 : (priority_a > priority_b) ? 1 : 0;
+}
+
+/* The priority of @data once aging is taken into account. The shutdown task
+ * is never aged, so that it always runs last. */
+static gint
+get_effective_priority (const WorkData *data,
+                        gint64          now_usec)
+{
+	gint64 n_steps;
+	gint64 effective_priority;
+
+	if (data->priority == G_MAXINT ||
+	    data->priority <= GS_WORKER_THREAD_AGING_LIMIT)
+		return data->priority;
+
+	n_steps = (now_usec - data->queued_time_usec) / GS_WORKER_THREAD_AGING_INTERVAL_USEC;
+	effective_priority = (gint64) data->priority - n_steps * GS_WORKER_THREAD_AGING_STEP;
+
+	return (gint) MAX (effective_priority, GS_WORKER_THREAD_AGING_LIMIT);
+}
+
+typedef struct {
+	gint64 now_usec;
+	gboolean limit_priority;
+	gint below_priority;
+	GQueue *best_queue;  /* (unowned) (nullable) */
+	gint best_priority;
+	gint best_effective_priority;
+	gint64 best_queued_time_usec;
+} FindNextData;
+
+static gboolean
+find_next_cb (gpointer key,
+              gpointer value,
+              gpointer user_data)
+{
+	GQueue *queue = value;
+	FindNextData *find_data = user_data;
+	const WorkData *head = g_queue_peek_head (queue);
+	gint effective_priority = get_effective_priority (head, find_data->now_usec);
+
+	if (find_data->limit_priority && effective_priority >= find_data->below_priority)
+		return FALSE;
+
+	/* Only the head of each queue needs checking, as it’s the oldest task
+	 * at that priority and so has been aged the most. On a tie, the task
+	 * which has been waiting longest wins. */
+	if (find_data->best_queue == NULL ||
+	    effective_priority < find_data->best_effective_priority ||
+	    (effective_priority == find_data->best_effective_priority &&
+	     head->queued_time_usec < find_data->best_queued_time_usec)) {
+		find_data->best_queue = queue;
+		find_data->best_priority = GPOINTER_TO_INT (key);
+		find_data->best_effective_priority = effective_priority;
+		find_data->best_queued_time_usec = head->queued_time_usec;
+	}
+
+	return FALSE;
+}
+
+/* Pop the most urgent queued task, or return %NULL if there is none. If
+ * @limit_priority is set, only tasks whose effective priority is numerically
+ * lower than @below_priority are considered. queue_mutex must be held. */
+static WorkData *
+pop_next_unlocked (GsWorkerThread *self,
+                   gboolean        limit_priority,
+                   gint            below_priority)
+{
+	FindNextData find_data = { 0, };
+	WorkData *data;
+
+	if (self->queues == NULL)
+		return NULL;
+
+	find_data.now_usec = g_get_monotonic_time ();
+	find_data.limit_priority = limit_priority;
+	find_data.below_priority = below_priority;
+	g_tree_foreach (self->queues, find_next_cb, &find_data);
+
+	if (find_data.best_queue == NULL)
+		return NULL;
+
+	data = g_queue_pop_head (find_data.best_queue);
+	if (g_queue_is_empty (find_data.best_queue))
+		g_tree_remove (self->queues, GINT_TO_POINTER (find_data.best_priority));
+
+	self->n_queued--;
+	GS_PROFILER_UPDATE_COUNTER (self->queue_depth_counter, self->n_queued);
+
+	return data;
+}
+
+static void
+run_work_data (GsWorkerThread *self,
+               WorkData       *data)
 {
+	GTask *task = data->task;
+	gpointer source_object = g_task_get_source_object (task);
+	gpointer task_data = g_task_get_task_data (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+
+	self->current_priority = data->priority;
+
+	/* Set the I/O priority of the thread to match the priority of the task. */
+	gs_ioprio_set (data->priority);
+
+	data->work_func (task, source_object, task_data, cancellable);
+}
+
+/* Run queued tasks until there are none left, or, if @limit_priority is set,
+ * none more urgent than @below_priority. Returns the number of tasks run. */
+static guint
+gs_worker_thread_run_queue (GsWorkerThread *self,
+                            gboolean        limit_priority,
+                            gint            below_priority)
+{
+	guint n_run = 0;
+
 	g_mutex_lock (&self->queue_mutex);
-	while (!g_queue_is_empty (&self->queue)) {
-		g_autoptr(WorkData) data = g_queue_pop_head (&self->queue);
-		GTask *task;
-		gpointer source_object;
-		gpointer task_data;
-		GCancellable *cancellable;
+	while (TRUE) {
+		g_autoptr(WorkData) data = pop_next_unlocked (self, limit_priority, below_priority);
+
+		if (data == NULL)
+			break;
 
 		/* thus the other threads can queue more work */
 		g_mutex_unlock (&self->queue_mutex);
 
-		task = data->task;
-		source_object = g_task_get_source_object (task);
-		task_data = g_task_get_task_data (task);
-		cancellable = g_task_get_cancellable (task);
-
-		/* Set the I/O priority of the thread to match the priority of the task. */
-		gs_ioprio_set (data->priority);
-
-		data->work_func (task, source_object, task_data, cancellable);
+		run_work_data (self, data);
+		n_run++;
 
 		g_mutex_lock (&self->queue_mutex);
 	}
 	g_mutex_unlock (&self->queue_mutex);
+
+	return n_run;
 }
 
 static gpointer
@@ -249,7 +429,8 @@ thread_cb (gpointer data)
 	/* Run until shut down. */
 	while (g_atomic_int_get (&self->worker_state) != GS_WORKER_THREAD_STATE_SHUT_DOWN) {
 		g_main_context_iteration (self->worker_context, TRUE);
-		gs_worker_thread_run_queue (self);
+		gs_worker_thread_run_queue (self, FALSE, 0);
+		self->current_priority = G_MAXINT;
 	}
 
 	return NULL;
@@ -258,8 +439,11 @@ thread_cb (gpointer data)
 static void
 gs_worker_thread_init (GsWorkerThread *self)
 {
+	g_mutex_init (&self->read_only_mutex);
+	g_cond_init (&self->read_only_cond);
 	g_mutex_init (&self->queue_mutex);
-	g_queue_init (&self->queue);
+	self->queues = g_tree_new_full (priority_cmp, NULL, NULL, (GDestroyNotify) queue_free);
+	self->current_priority = G_MAXINT;
 	g_mutex_init (&self->tid_mutex);
 	g_cond_init (&self->tid_cond);
 }
@@ -337,16 +521,6 @@ gs_worker_thread_update_cpu_priority (GsWorkerThread  *self,
 	gs_set_thread_cpu_niceness (system_bus_connection, tid, new_niceness);
 }
 
-static gint
-gs_worker_thread_cmp (gconstpointer a,
-		      gconstpointer b,
-		      gpointer user_data)
-{
-	const WorkData *dta = a;
-	const WorkData *dtb = b;
-	return dta->priority - dtb->priority;
-}
-
 /**
  * gs_worker_thread_queue:
  * @self: a #GsWorkerThread
@@ -363,7 +537,9 @@ gs_worker_thread_cmp (gconstpointer a,
  * @priority sets the order of the task in the queue, and also affects the I/O
  * priority of the worker thread when the task is executed — high priorities
  * result in a high I/O priority, low priorities result in an idle I/O priority,
- * as per `ioprio_set()`.
+ * as per `ioprio_set()`. Tasks with the same priority are run in the order they
+ * were queued. The longer a task waits, the higher its priority in the queue
+ * becomes, though its I/O priority is not changed.
  *
  * When the task is run, @work_func will be executed and passed @task and the
  * source object, task data and cancellable set on @task.
@@ -376,7 +552,9 @@ gs_worker_thread_cmp (gconstpointer a,
  * for checking whether the #GCancellable has been cancelled.
  *
  * It is an error to call this function after gs_worker_thread_shutdown_async()
- * has called.
+ * has called, except from a task running on @self: a task may queue a
+ * follow-up task to continue its work, which is run before the worker shuts
+ * down.
  *
  * Since: 42
  */
@@ -388,24 +566,229 @@ gs_worker_thread_queue (GsWorkerThread  *self,
 {
 	g_autoptr(WorkData) data = NULL;
 	g_autoptr(GMutexLocker) locker = NULL;
+	GQueue *queue;
 
 	g_return_if_fail (GS_IS_WORKER_THREAD (self));
 	g_return_if_fail (work_func != NULL);
 	g_return_if_fail (G_IS_TASK (task));
 
 	g_assert (g_atomic_int_get (&self->worker_state) == GS_WORKER_THREAD_STATE_RUNNING ||
-		  g_task_get_source_tag (task) == gs_worker_thread_shutdown_async);
+		  g_task_get_source_tag (task) == gs_worker_thread_shutdown_async ||
+		  (g_atomic_int_get (&self->worker_state) == GS_WORKER_THREAD_STATE_SHUTTING_DOWN &&
+		   gs_worker_thread_is_in_worker_context (self)));
 
 	data = g_new0 (WorkData, 1);
 	data->work_func = work_func;
 	data->task = g_steal_pointer (&task);
 	data->priority = priority;
+	data->queued_time_usec = g_get_monotonic_time ();
 
 	locker = g_mutex_locker_new (&self->queue_mutex);
-	g_queue_insert_sorted (&self->queue, g_steal_pointer (&data), gs_worker_thread_cmp, NULL);
+
+	queue = g_tree_lookup (self->queues, GINT_TO_POINTER (priority));
+	if (queue == NULL) {
+		queue = g_queue_new ();
+		g_tree_insert (self->queues, GINT_TO_POINTER (priority), queue);
+	}
+	g_queue_push_tail (queue, g_steal_pointer (&data));
+
+	self->n_queued++;
+	GS_PROFILER_UPDATE_COUNTER (self->queue_depth_counter, self->n_queued);
+
 	g_main_context_wakeup (self->worker_context);
 }
 
+/**
+ * gs_worker_thread_yield:
+ * @self: a #GsWorkerThread
+ *
+ * Run any queued tasks which are more urgent than the task currently running,
+ * and then return so that it can carry on.
+ *
+ * This must only be called from within a #GTaskThreadFunc running on @self.
+ * Long running tasks should call it between steps of their work, at points
+ * where it’s safe for other tasks on the same worker to run (so not while
+ * holding locks those tasks might need), so that a high priority task queued
+ * behind them doesn’t have to wait for all of their work to finish.
+ *
+ * Tasks which are run by this function can’t yield themselves; calling it
+ * from them does nothing. Even so, any task may be run here, including another
+ * one of the same kind as the task which yielded, so tasks which must not be
+ * re-entered should split their work into a chain of tasks queued one after
+ * another instead.
+ *
+ * Returns: %TRUE if any other tasks were run, %FALSE otherwise
+ * Since: 51
+ */
+gboolean
+gs_worker_thread_yield (GsWorkerThread *self)
+{
+	gint priority;
+	guint n_run;
+
+	g_return_val_if_fail (GS_IS_WORKER_THREAD (self), FALSE);
+	g_return_val_if_fail (gs_worker_thread_is_in_worker_context (self), FALSE);
+
+	/* Only top-level tasks yield, so that tasks don’t nest any deeper and a
+	 * task run here can’t in turn run another task of the same kind in the
+	 * middle of it. */
+	if (self->in_yield)
+		return FALSE;
+
+	priority = self->current_priority;
+	self->in_yield = TRUE;
+	n_run = gs_worker_thread_run_queue (self, TRUE, priority);
+	self->in_yield = FALSE;
+
+	/* Restore the priority of the task which yielded. */
+	if (n_run > 0) {
+		self->current_priority = priority;
+		gs_ioprio_set (priority);
+	}
+
+	return (n_run > 0);
+}
+
+static gint
+read_only_work_cmp (gconstpointer a,
+                    gconstpointer b,
+                    gpointer      user_data)
+{
+	const WorkData *data_a = a;
+	const WorkData *data_b = b;
+
+	if (data_a->priority != data_b->priority)
+		return (data_a->priority < data_b->priority) ? -1 : 1;
+
+	/* queue order within a priority; the subtraction copes with wrapping */
+	return (gint) (data_a->sequence - data_b->sequence);
+}
+
+static void
+read_only_thread_cb (gpointer data,
+                     gpointer user_data)
+{
+	WorkData *work_data = data;
+	GsWorkerThread *self = work_data->worker;
+	GTask *task = work_data->task;
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GMainContextPusher) pusher = g_main_context_pusher_new (context);
+
+	/* Give each task a thread-default context of its own, rather than
+	 * leaving it on the global default one. Unlike the worker thread’s,
+	 * nothing iterates it once the task returns, so any sources the task
+	 * attaches to it (such as #GFileMonitors) never fire. */
+	g_private_set (&read_only_worker_key, self);
+	gs_ioprio_set (work_data->priority);
+
+	work_data->work_func (task,
+			      g_task_get_source_object (task),
+			      g_task_get_task_data (task),
+			      g_task_get_cancellable (task));
+
+	g_private_set (&read_only_worker_key, NULL);
+	work_data_free (work_data);
+
+	/* let a pending shutdown know once everything is done */
+	g_mutex_lock (&self->read_only_mutex);
+	g_assert (self->n_read_only_pending > 0);
+	self->n_read_only_pending--;
+	if (self->n_read_only_pending == 0)
+		g_cond_broadcast (&self->read_only_cond);
+	g_mutex_unlock (&self->read_only_mutex);
+}
+
+/**
+ * gs_worker_thread_queue_read_only:
+ * @self: a #GsWorkerThread
+ * @priority: (default G_PRIORITY_DEFAULT): priority to queue the task at,
+ *   typically #G_PRIORITY_DEFAULT
+ * @work_func: (not nullable) (scope async): function to run the task
+ * @task: (transfer full) (not nullable): the #GTask containing context data to
+ *   pass to @work_func
+ *
+ * Queue @task to be run on the shared read-only thread pool, rather than in
+ * the worker thread.
+ *
+ * This behaves like gs_worker_thread_queue(), except that @work_func may run
+ * at the same time as other read-only tasks from @self and from other
+ * #GsWorkerThreads, and at the same time as the task running in the worker
+ * thread. It must therefore only read state which is safe to share between
+ * threads, such as an #XbSilo acquired through a #GsSiloWrapper, and must not
+ * call gs_worker_thread_yield(). Use gs_worker_thread_is_in_read_only_context()
+ * to check it’s being run from the right place.
+ *
+ * The thread-default main context of @work_func is not iterated after it
+ * returns, so it must not set up anything which relies on it later, such as
+ * a #GFileMonitor; work which does, like rebuilding a silo, should be moved to
+ * the worker thread with gs_worker_thread_queue().
+ *
+ * Tasks are started in priority order, but are not aged.
+ *
+ * gs_worker_thread_shutdown_async() waits for all read-only tasks queued on
+ * @self to finish.
+ *
+ * Since: 51
+ */
+void
+gs_worker_thread_queue_read_only (GsWorkerThread  *self,
+                                  gint             priority,
+                                  GTaskThreadFunc  work_func,
+                                  GTask           *task)
+{
+	static gsize pool_initialised = 0;
+	WorkData *data;
+
+	g_return_if_fail (GS_IS_WORKER_THREAD (self));
+	g_return_if_fail (work_func != NULL);
+	g_return_if_fail (G_IS_TASK (task));
+
+	g_assert (g_atomic_int_get (&self->worker_state) == GS_WORKER_THREAD_STATE_RUNNING);
+
+	if (g_once_init_enter (&pool_initialised)) {
+		guint n_threads = CLAMP (g_get_num_processors (),
+					 GS_WORKER_THREAD_MIN_READ_ONLY_THREADS,
+					 GS_WORKER_THREAD_MAX_READ_ONLY_THREADS);
+
+		read_only_pool = g_thread_pool_new (read_only_thread_cb, NULL, n_threads, FALSE, NULL);
+		g_thread_pool_set_sort_function (read_only_pool, read_only_work_cmp, NULL);
+		g_once_init_leave (&pool_initialised, 1);
+	}
+
+	data = g_new0 (WorkData, 1);
+	data->work_func = work_func;
+	data->task = g_steal_pointer (&task);
+	data->priority = priority;
+	data->queued_time_usec = g_get_monotonic_time ();
+	data->worker = self;
+	data->sequence = (guint) g_atomic_int_add (&read_only_sequence, 1);
+
+	g_mutex_lock (&self->read_only_mutex);
+	self->n_read_only_pending++;
+	g_mutex_unlock (&self->read_only_mutex);
+
+	g_thread_pool_push (read_only_pool, data, NULL);
+}
+
+/**
+ * gs_worker_thread_is_in_read_only_context:
+ * @self: a #GsWorkerThread
+ *
+ * Returns whether the calling thread is running a task queued on @self with
+ * gs_worker_thread_queue_read_only().
+ *
+ * This is intended to be used as a precondition check, like
+ * gs_worker_thread_is_in_worker_context().
+ *
+ * Returns: %TRUE if running a read-only task for @self, %FALSE otherwise
+ * Since: 51
+ */
+gboolean
+gs_worker_thread_is_in_read_only_context (GsWorkerThread *self)
+{
+	return (g_private_get (&read_only_worker_key) == self);
+}
+
 /**
  * gs_worker_thread_is_in_worker_context:
  * @self: a #GsWorkerThread
@@ -450,7 +833,8 @@ static void shutdown_cb (GTask        *task,
  *
  * The thread will finish processing whatever task it’s currently processing
  * (if any), will return %G_IO_ERROR_CANCELLED for all remaining queued
- * tasks, and will then join the main process.
+ * tasks, will wait for any read-only tasks to finish, and will then join the
+ * main process.
  *
  * This is a no-op if called subsequently.
  *
@@ -491,6 +875,13 @@ shutdown_cb (GTask        *task,
 	GsWorkerThread *self = GS_WORKER_THREAD (source_object);
 	gboolean updated_state;
 
+	/* Wait for any read-only tasks to finish, as they may use the same
+	 * state as the worker. No more can be queued by now. */
+	g_mutex_lock (&self->read_only_mutex);
+	while (self->n_read_only_pending > 0)
+		g_cond_wait (&self->read_only_cond, &self->read_only_mutex);
+	g_mutex_unlock (&self->read_only_mutex);
+
 	updated_state = g_atomic_int_compare_and_exchange (&self->worker_state,
 							   GS_WORKER_THREAD_STATE_SHUTTING_DOWN,
 							   GS_WORKER_THREAD_STATE_SHUT_DOWN);
@@ -31,7 +31,16 @@ void		 gs_worker_thread_queue			(GsWorkerThread  *self,
 							 GTaskThreadFunc  work_func,
 							 GTask           *task);
 
+void		 gs_worker_thread_queue_read_only	(GsWorkerThread  *self,
+							 gint             priority,
+							 GTaskThreadFunc  work_func,
+							 GTask           *task);
+
+gboolean	 gs_worker_thread_yield			(GsWorkerThread *self);
+
 gboolean	 gs_worker_thread_is_in_worker_context	(GsWorkerThread *self);
+gboolean	 gs_worker_thread_is_in_read_only_context
+							(GsWorkerThread *self);
 
 void		 gs_worker_thread_shutdown_async	(GsWorkerThread      *self,
 							 GCancellable        *cancellable,
@@ -12,6 +12,7 @@
 #include "gnome-software-private.h"
 
 #include "gs-debug.h"
+#include "../gs-latency-histogram.h"
 #include "gs-test.h"
 
 static gboolean
@@ -606,6 +607,101 @@ gs_app_unique_id_func (void)
 	g_clear_pointer (&data_id, g_free);
 }
 
+static void
+gs_app_registry_func (void)
+{
+	g_autoptr(GsAppRegistry) registry = gs_app_registry_new ();
+	g_autoptr(GsApp) app = gs_app_new ("org.gnome.Software");
+	g_autoptr(GsApp) app_dup = gs_app_new ("org.gnome.Software");
+	g_autoptr(GsApp) wildcard = gs_app_new ("org.gnome.Builder");
+	g_autoptr(GsApp) lookup = NULL;
+	const gchar *unique_id = "system/flatpak/gnome/org.gnome.Software/master";
+
+	gs_app_set_unique_id (app, unique_id);
+	gs_app_set_unique_id (app_dup, unique_id);
+	gs_app_add_quirk (wildcard, GS_APP_QUIRK_IS_WILDCARD);
+
+	/* first instance wins */
+	gs_app_registry_add (registry, app);
+	gs_app_registry_add (registry, app_dup);
+	gs_app_registry_add (registry, wildcard);
+	g_assert_cmpuint (gs_app_registry_get_size (registry), ==, 1);
+
+	lookup = gs_app_registry_lookup (registry, unique_id);
+	g_assert_true (lookup == app);
+	g_assert_cmpuint (gs_app_registry_get_n_hits (registry), ==, 1);
+	g_clear_object (&lookup);
+
+	/* only weak references are held */
+	g_clear_object (&app);
+	g_assert_null (gs_app_registry_lookup (registry, unique_id));
+	g_assert_cmpuint (gs_app_registry_get_size (registry), ==, 0);
+
+	/* invalidating forgets everything */
+	gs_app_registry_add (registry, app_dup);
+	gs_app_registry_invalidate (registry);
+	g_assert_null (gs_app_registry_lookup (registry, unique_id));
+
+	/* sharing registers the first instance and hands it out for later ones */
+	app = gs_app_new ("org.gnome.Software");
+	gs_app_set_unique_id (app, unique_id);
+	lookup = gs_app_registry_share (registry, app);
+	g_assert_true (lookup == app);
+	g_clear_object (&lookup);
+	lookup = gs_app_registry_share (registry, app_dup);
+	g_assert_true (lookup == app);
+	g_clear_object (&lookup);
+	lookup = gs_app_registry_share (registry, wildcard);
+	g_assert_true (lookup == wildcard);
+	g_clear_object (&lookup);
+
+	/* an app whose unique ID changed is not returned for its old one */
+	gs_app_set_branch (app, "stable");
+	g_assert_null (gs_app_registry_lookup (registry, unique_id));
+	lookup = gs_app_registry_share (registry, app_dup);
+	g_assert_true (lookup == app_dup);
+	g_clear_object (&lookup);
+	gs_app_registry_add (registry, app);
+	lookup = gs_app_registry_lookup (registry, gs_app_get_unique_id (app));
+	g_assert_true (lookup == app);
+	g_clear_object (&lookup);
+}
+
+static void
+gs_app_refined_require_flags_func (void)
+{
+	g_autoptr(GsApp) app = gs_app_new ("org.gnome.Software");
+	const GsPluginRefineFlags none = GS_PLUGIN_REFINE_FLAGS_NONE;
+
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, none, 1), ==, GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
+
+	/* flags accumulate within a generation */
+	gs_app_add_refined_require_flags (app, GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON, none, 1);
+	gs_app_add_refined_require_flags (app, GS_PLUGIN_REFINE_REQUIRE_FLAGS_VERSION, none, 1);
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, none, 1), ==,
+			 GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON | GS_PLUGIN_REFINE_REQUIRE_FLAGS_VERSION);
+
+	/* and are not valid for other job flags */
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES, 1), ==,
+			 GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
+
+	/* or for any other generation */
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, none, 2), ==, GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
+	gs_app_add_refined_require_flags (app, GS_PLUGIN_REFINE_REQUIRE_FLAGS_ORIGIN, none, 2);
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, none, 2), ==, GS_PLUGIN_REFINE_REQUIRE_FLAGS_ORIGIN);
+
+	/* recording for other job flags replaces what was recorded */
+	gs_app_add_refined_require_flags (app, GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON, GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES, 2);
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES, 2), ==,
+			 GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON);
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, none, 2), ==, GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
+
+	/* changing state forgets them */
+	gs_app_set_state (app, GS_APP_STATE_AVAILABLE);
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES, 2), ==,
+			 GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
+}
+
 static void
 gs_app_addons_func (void)
 {
@@ -776,6 +872,73 @@ gs_app_list_performance_func (void)
 	g_test_minimized_result (elapsed_time_ms, "Adding apps to list took %.2fms", elapsed_time_ms);
 }
 
+typedef struct {
+	GsAppList *list;  /* (unowned) */
+	gboolean write;
+} ContentionThreadData;
+
+static gpointer
+gs_app_list_contention_thread_cb (gpointer user_data)
+{
+	ContentionThreadData *data = user_data;
+
+	for (guint n = 0; n < 200; n++) {
+		for (guint i = 0; i < gs_app_list_length (data->list); i++) {
+			GsApp *app = gs_app_list_index (data->list, i);
+			g_autoptr(GPtrArray) icons = NULL;
+
+			if (data->write) {
+				gs_app_set_url (app, AS_URL_KIND_HOMEPAGE,
+						(n % 2) ? "https://example.com/" : "https://example.org/");
+				continue;
+			}
+
+			g_assert_nonnull (gs_app_get_unique_id (app));
+			g_assert_cmpstr (gs_app_get_launchable (app, AS_LAUNCHABLE_KIND_DESKTOP_ID), ==, gs_app_get_id (app));
+			icons = gs_app_dup_icons (app);
+			g_assert_null (icons);
+			gs_app_get_url (app, AS_URL_KIND_HOMEPAGE);
+		}
+	}
+
+	return NULL;
+}
+
+static void
+gs_app_list_contention_func (gconstpointer user_data)
+{
+	GsDebug *debug = GS_DEBUG ((void *)user_data);
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GPtrArray) threads = g_ptr_array_new ();
+	ContentionThreadData readers = { list, FALSE };
+	ContentionThreadData writer = { list, TRUE };
+	g_autoptr(GTimer) timer = NULL;
+	double elapsed_time_ms;
+
+	/* a shared list, as refine worker threads and the UI see it */
+	for (guint i = 0; i < 200; i++) {
+		g_autofree gchar *id = g_strdup_printf ("%03u.desktop", i);
+		g_autoptr(GsApp) app = gs_app_new (id);
+		gs_app_set_origin (app, "test");
+		gs_app_set_launchable (app, AS_LAUNCHABLE_KIND_DESKTOP_ID, id);
+		gs_app_list_add (list, app);
+	}
+
+	/* several readers and one writer, like the main thread reading while
+	 * plugins refine */
+	gs_debug_set_verbose (debug, FALSE);
+	timer = g_timer_new ();
+	for (guint i = 0; i < 4; i++)
+		g_ptr_array_add (threads, g_thread_new ("reader", gs_app_list_contention_thread_cb, &readers));
+	g_ptr_array_add (threads, g_thread_new ("writer", gs_app_list_contention_thread_cb, &writer));
+	for (guint i = 0; i < threads->len; i++)
+		g_thread_join (g_ptr_array_index (threads, i));
+	elapsed_time_ms = g_timer_elapsed (timer, NULL) * 1000;
+	gs_debug_set_verbose (debug, TRUE);
+
+	g_test_minimized_result (elapsed_time_ms, "Contended access to shared list took %.2fms", elapsed_time_ms);
+}
+
 static void
 gs_app_list_related_func (void)
 {
@@ -796,6 +959,213 @@ gs_app_list_related_func (void)
 	g_assert_cmpint (gs_app_list_get_progress (list), ==, 50);
 }
 
+static void
+gs_startup_timeline_func (void)
+{
+	gint64 span_begin;
+	g_autofree gchar *str = NULL;
+	g_auto(GStrv) lines = NULL;
+
+	gs_startup_timeline_begin ();
+	span_begin = g_get_monotonic_time ();
+	g_usleep (G_TIME_SPAN_MILLISECOND);
+	gs_startup_timeline_mark ("first");
+	g_usleep (2 * G_TIME_SPAN_MILLISECOND);
+	gs_startup_timeline_mark ("second");
+	gs_startup_timeline_add_span ("span", span_begin);
+	g_assert_true (gs_startup_timeline_is_recording ());
+
+	/* nothing is recorded once stopped */
+	gs_startup_timeline_stop ();
+	g_assert_false (gs_startup_timeline_is_recording ());
+	gs_startup_timeline_mark ("ignored");
+
+	/* sorted by start time, with a header line */
+	str = gs_startup_timeline_to_string ();
+	lines = g_strsplit (str, "\n", -1);
+	g_assert_cmpuint (g_strv_length (lines), ==, 5);
+	g_assert_true (g_str_has_prefix (lines[0], "#"));
+	g_assert_true (g_str_has_suffix (lines[1], "  span"));
+	g_assert_true (g_str_has_suffix (lines[2], "  first"));
+	g_assert_true (g_str_has_suffix (lines[3], "  second"));
+	g_assert_cmpstr (lines[4], ==, "");
+	g_assert_null (strstr (str, "ignored"));
+
+	/* beginning again starts from scratch */
+	gs_startup_timeline_begin ();
+	g_clear_pointer (&str, g_free);
+	str = gs_startup_timeline_to_string ();
+	g_assert_null (strstr (str, "first"));
+}
+
+static void
+gs_latency_histogram_func (void)
+{
+	g_autoptr(GsLatencyHistogram) histogram = gs_latency_histogram_new ();
+
+	g_assert_cmpuint (gs_latency_histogram_get_count (histogram), ==, 0);
+	g_assert_cmpint (gs_latency_histogram_get_percentile (histogram, 50), ==, 0);
+
+	/* 1ms to 100ms in 1ms steps */
+	for (gint64 i = 1; i <= 100; i++)
+		gs_latency_histogram_add (histogram, i * G_TIME_SPAN_MILLISECOND);
+
+	g_assert_cmpuint (gs_latency_histogram_get_count (histogram), ==, 100);
+	g_assert_cmpint (gs_latency_histogram_get_max (histogram), ==, 100 * G_TIME_SPAN_MILLISECOND);
+
+	/* the percentiles are upper bounds, accurate to within a bucket */
+	g_assert_cmpint (gs_latency_histogram_get_percentile (histogram, 50), >=, 50 * G_TIME_SPAN_MILLISECOND);
+	g_assert_cmpint (gs_latency_histogram_get_percentile (histogram, 50), <=, 60 * G_TIME_SPAN_MILLISECOND);
+	g_assert_cmpint (gs_latency_histogram_get_percentile (histogram, 95), >=, 95 * G_TIME_SPAN_MILLISECOND);
+	g_assert_cmpint (gs_latency_histogram_get_percentile (histogram, 99), <=, 100 * G_TIME_SPAN_MILLISECOND);
+	g_assert_cmpint (gs_latency_histogram_get_percentile (histogram, 100), ==, 100 * G_TIME_SPAN_MILLISECOND);
+
+	/* very short and very long durations are clamped into the end buckets */
+	gs_latency_histogram_add (histogram, -1);
+	gs_latency_histogram_add (histogram, 3600 * G_USEC_PER_SEC);
+	g_assert_cmpint (gs_latency_histogram_get_percentile (histogram, 0), <=, 10);
+	g_assert_cmpint (gs_latency_histogram_get_max (histogram), ==, 3600 * G_USEC_PER_SEC);
+}
+
+static void
+job_manager_watch_added_cb (GsJobManager *job_manager,
+                            GsPluginJob  *job,
+                            gpointer      user_data)
+{
+	guint *n_added = user_data;
+
+	(*n_added)++;
+}
+
+static void
+gs_job_manager_func (void)
+{
+	g_autoptr(GsJobManager) job_manager = gs_job_manager_new ();
+	g_autoptr(GsApp) app_a = gs_app_new ("a.desktop");
+	g_autoptr(GsApp) app_b = gs_app_new ("b.desktop");
+	g_autoptr(GsApp) app_c = gs_app_new ("c.desktop");
+	g_autoptr(GsAppList) install_list = gs_app_list_new ();
+	g_autoptr(GsPluginJob) install_job = NULL;
+	g_autoptr(GsPluginJob) refine_job = NULL;
+	g_autoptr(GPtrArray) jobs = NULL;
+	guint n_added = 0;
+	guint watch_id;
+
+	gs_app_list_add (install_list, app_a);
+	gs_app_list_add (install_list, app_b);
+	install_job = gs_plugin_job_install_apps_new (install_list, GS_PLUGIN_INSTALL_APPS_FLAGS_NONE);
+	refine_job = gs_plugin_job_refine_new_for_app (app_c, GS_PLUGIN_REFINE_FLAGS_NONE, GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
+
+	watch_id = gs_job_manager_add_watch (job_manager, app_b, GS_TYPE_PLUGIN_JOB_INSTALL_APPS,
+					     job_manager_watch_added_cb, NULL, &n_added, NULL);
+
+	g_assert_true (gs_job_manager_add_job (job_manager, install_job));
+	g_assert_false (gs_job_manager_add_job (job_manager, install_job));
+	g_assert_true (gs_job_manager_add_job (job_manager, refine_job));
+
+	/* the watch only matches the install job */
+	while (n_added < 1)
+		g_main_context_iteration (NULL, TRUE);
+	gs_test_flush_main_context ();
+	g_assert_cmpuint (n_added, ==, 1);
+
+	jobs = gs_job_manager_get_pending_jobs_for_app (job_manager, app_a);
+	g_assert_cmpuint (jobs->len, ==, 1);
+	g_assert_true (g_ptr_array_index (jobs, 0) == install_job);
+	g_clear_pointer (&jobs, g_ptr_array_unref);
+
+	jobs = gs_job_manager_get_pending_jobs_for_app (job_manager, app_c);
+	g_assert_cmpuint (jobs->len, ==, 1);
+	g_assert_true (g_ptr_array_index (jobs, 0) == refine_job);
+	g_clear_pointer (&jobs, g_ptr_array_unref);
+
+	g_assert_true (gs_job_manager_app_has_pending_job_type (job_manager, app_b, GS_TYPE_PLUGIN_JOB_INSTALL_APPS));
+	g_assert_true (gs_job_manager_app_has_pending_job_type (job_manager, app_b, GS_TYPE_PLUGIN_JOB));
+	g_assert_false (gs_job_manager_app_has_pending_job_type (job_manager, app_c, GS_TYPE_PLUGIN_JOB_INSTALL_APPS));
+	g_assert_true (gs_job_manager_app_has_pending_job_type (job_manager, app_c, GS_TYPE_PLUGIN_JOB_REFINE));
+
+	g_assert_true (gs_job_manager_remove_job (job_manager, install_job));
+	g_assert_false (gs_job_manager_remove_job (job_manager, install_job));
+	g_assert_false (gs_job_manager_app_has_pending_job_type (job_manager, app_a, GS_TYPE_PLUGIN_JOB));
+	jobs = gs_job_manager_get_pending_jobs_for_app (job_manager, app_b);
+	g_assert_cmpuint (jobs->len, ==, 0);
+
+	g_assert_true (gs_job_manager_remove_job (job_manager, refine_job));
+	g_assert_false (gs_job_manager_app_has_pending_job_type (job_manager, app_c, GS_TYPE_PLUGIN_JOB));
+
+	gs_job_manager_remove_watch (job_manager, watch_id);
+	gs_test_flush_main_context ();
+}
+
+static void
+gs_job_manager_wildcard_func (void)
+{
+	g_autoptr(GsJobManager) job_manager = gs_job_manager_new ();
+	g_autoptr(GsApp) app_stable = gs_app_new ("d.desktop");
+	g_autoptr(GsApp) app_beta = gs_app_new ("d.desktop");
+	g_autoptr(GsApp) app_wildcard = gs_app_new ("d.desktop");
+	g_autoptr(GsAppList) stable_list = gs_app_list_new ();
+	g_autoptr(GsAppList) wildcard_list = gs_app_list_new ();
+	g_autoptr(GsPluginJob) stable_job = NULL;
+	g_autoptr(GsPluginJob) wildcard_job = NULL;
+	g_autoptr(GPtrArray) jobs = NULL;
+	guint n_added_wildcard = 0;
+	guint n_added_beta = 0;
+	guint wildcard_watch_id, beta_watch_id;
+
+	gs_app_set_unique_id (app_stable, "user/flatpak/flathub/d.desktop/stable");
+	gs_app_set_unique_id (app_beta, "user/flatpak/flathub/d.desktop/beta");
+	g_assert_cmpstr (gs_app_get_unique_id (app_wildcard), ==, "*/*/*/d.desktop/*");
+
+	gs_app_list_add (stable_list, app_stable);
+	stable_job = gs_plugin_job_install_apps_new (stable_list, GS_PLUGIN_INSTALL_APPS_FLAGS_NONE);
+	gs_app_list_add (wildcard_list, app_wildcard);
+	wildcard_job = gs_plugin_job_install_apps_new (wildcard_list, GS_PLUGIN_INSTALL_APPS_FLAGS_NONE);
+
+	/* a watch with wildcards matches jobs for any branch, and a watch for
+	 * one branch matches jobs with wildcards */
+	wildcard_watch_id = gs_job_manager_add_watch (job_manager, app_wildcard, G_TYPE_INVALID,
+						      job_manager_watch_added_cb, NULL, &n_added_wildcard, NULL);
+	beta_watch_id = gs_job_manager_add_watch (job_manager, app_beta, G_TYPE_INVALID,
+						  job_manager_watch_added_cb, NULL, &n_added_beta, NULL);
+
+	g_assert_true (gs_job_manager_add_job (job_manager, stable_job));
+	g_assert_true (gs_job_manager_add_job (job_manager, wildcard_job));
+
+	while (n_added_wildcard < 2 || n_added_beta < 1)
+		g_main_context_iteration (NULL, TRUE);
+	gs_test_flush_main_context ();
+	g_assert_cmpuint (n_added_wildcard, ==, 2);
+	g_assert_cmpuint (n_added_beta, ==, 1);
+
+	/* looking up with wildcards finds the jobs for any branch */
+	jobs = gs_job_manager_get_pending_jobs_for_app (job_manager, app_wildcard);
+	g_assert_cmpuint (jobs->len, ==, 2);
+	g_clear_pointer (&jobs, g_ptr_array_unref);
+
+	/* looking up one branch finds the jobs for it and those with wildcards,
+	 * but not those for another branch */
+	jobs = gs_job_manager_get_pending_jobs_for_app (job_manager, app_stable);
+	g_assert_cmpuint (jobs->len, ==, 2);
+	g_clear_pointer (&jobs, g_ptr_array_unref);
+
+	jobs = gs_job_manager_get_pending_jobs_for_app (job_manager, app_beta);
+	g_assert_cmpuint (jobs->len, ==, 1);
+	g_assert_true (g_ptr_array_index (jobs, 0) == wildcard_job);
+	g_clear_pointer (&jobs, g_ptr_array_unref);
+
+	g_assert_true (gs_job_manager_remove_job (job_manager, wildcard_job));
+	g_assert_false (gs_job_manager_app_has_pending_job_type (job_manager, app_beta, GS_TYPE_PLUGIN_JOB));
+	g_assert_true (gs_job_manager_app_has_pending_job_type (job_manager, app_wildcard, GS_TYPE_PLUGIN_JOB_INSTALL_APPS));
+
+	g_assert_true (gs_job_manager_remove_job (job_manager, stable_job));
+	g_assert_false (gs_job_manager_app_has_pending_job_type (job_manager, app_wildcard, GS_TYPE_PLUGIN_JOB));
+
+	gs_job_manager_remove_watch (job_manager, beta_watch_id);
+	gs_job_manager_remove_watch (job_manager, wildcard_watch_id);
+	gs_test_flush_main_context ();
+}
+
 int
 main (int argc, char **argv)
 {
@@ -814,13 +1184,20 @@ main (int argc, char **argv)
 	g_test_add_func ("/gnome-software/lib/app/progress-clamping", gs_app_progress_clamping_func);
 	g_test_add_func ("/gnome-software/lib/app{addons}", gs_app_addons_func);
 	g_test_add_func ("/gnome-software/lib/app{unique-id}", gs_app_unique_id_func);
+	g_test_add_func ("/gnome-software/lib/app{registry}", gs_app_registry_func);
+	g_test_add_func ("/gnome-software/lib/app{refined-require-flags}", gs_app_refined_require_flags_func);
 	g_test_add_data_func ("/gnome-software/lib/app{thread}", debug, gs_app_thread_func);
 	g_test_add_func ("/gnome-software/lib/app{list}", gs_app_list_func);
 	g_test_add_func ("/gnome-software/lib/app{list-wildcard-dedupe}", gs_app_list_wildcard_dedupe_func);
 	g_test_add_func ("/gnome-software/lib/app{list-performance}", gs_app_list_performance_func);
 	g_test_add_func ("/gnome-software/lib/app{list-related}", gs_app_list_related_func);
+	g_test_add_data_func ("/gnome-software/lib/app{list-contention}", debug, gs_app_list_contention_func);
 	g_test_add_func ("/gnome-software/lib/plugin", gs_plugin_func);
 	g_test_add_func ("/gnome-software/lib/plugin{download-rewrite}", gs_plugin_download_rewrite_func);
+	g_test_add_func ("/gnome-software/lib/startup-timeline", gs_startup_timeline_func);
+	g_test_add_func ("/gnome-software/lib/latency-histogram", gs_latency_histogram_func);
+	g_test_add_func ("/gnome-software/lib/job-manager", gs_job_manager_func);
+	g_test_add_func ("/gnome-software/lib/job-manager/wildcard", gs_job_manager_wildcard_func);
 
 	return g_test_run ();
 }
@@ -0,0 +1,385 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "gnome-software-private.h"
+
+#include "gs-test.h"
+
+typedef struct {
+	GsWorkerThread *worker;  /* (owned) */
+
+	/* Used to hold the worker until all the test tasks are queued. */
+	GMutex gate_mutex;
+	GCond gate_cond;
+	gboolean gate_open;  /* (mutex gate_mutex) */
+
+	GString *order;  /* (owned); only accessed from the worker thread until all tasks are complete */
+	guint n_completed;
+
+	gint background_started;  /* (atomic) */
+	gint interactive_started;  /* (atomic) */
+	gint64 interactive_queued_time;
+	gint64 interactive_start_time;
+	gboolean nested_yield_ran;  /* only accessed from the worker thread until all tasks are complete */
+
+	gint n_readers_running;  /* (atomic) */
+	gint max_readers_running;  /* (atomic) */
+} Fixture;
+
+static void
+setup (Fixture       *fixture,
+       gconstpointer  test_data)
+{
+	fixture->worker = gs_worker_thread_new ("test-worker");
+	g_mutex_init (&fixture->gate_mutex);
+	g_cond_init (&fixture->gate_cond);
+	fixture->order = g_string_new ("");
+}
+
+static void
+async_result_cb (GObject      *source_object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+	GAsyncResult **result_out = user_data;
+
+	g_assert (*result_out == NULL);
+	*result_out = g_object_ref (result);
+	g_main_context_wakeup (NULL);
+}
+
+static void
+teardown (Fixture       *fixture,
+          gconstpointer  test_data)
+{
+	g_autoptr(GAsyncResult) result = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	gs_worker_thread_shutdown_async (fixture->worker, NULL, async_result_cb, &result);
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+	gs_worker_thread_shutdown_finish (fixture->worker, result, &local_error);
+	g_assert_no_error (local_error);
+
+	g_clear_object (&fixture->worker);
+	g_mutex_clear (&fixture->gate_mutex);
+	g_cond_clear (&fixture->gate_cond);
+	g_string_free (fixture->order, TRUE);
+}
+
+static void
+task_done_cb (GObject      *source_object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+	Fixture *fixture = user_data;
+
+	g_assert_true (g_task_propagate_boolean (G_TASK (result), NULL));
+	fixture->n_completed++;
+	g_main_context_wakeup (NULL);
+}
+
+static void
+gate_thread_cb (GTask        *task,
+                gpointer      source_object,
+                gpointer      task_data,
+                GCancellable *cancellable)
+{
+	Fixture *fixture = task_data;
+
+	g_mutex_lock (&fixture->gate_mutex);
+	while (!fixture->gate_open)
+		g_cond_wait (&fixture->gate_cond, &fixture->gate_mutex);
+	g_mutex_unlock (&fixture->gate_mutex);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+record_thread_cb (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+	Fixture *fixture = g_object_get_data (G_OBJECT (task), "fixture");
+
+	g_string_append (fixture->order, task_data);
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+queue_gate (Fixture *fixture)
+{
+	g_autoptr(GTask) task = g_task_new (NULL, NULL, task_done_cb, fixture);
+
+	fixture->gate_open = FALSE;
+	g_task_set_task_data (task, fixture, NULL);
+	gs_worker_thread_queue (fixture->worker, G_PRIORITY_HIGH, gate_thread_cb, g_steal_pointer (&task));
+}
+
+static void
+open_gate (Fixture *fixture)
+{
+	g_mutex_lock (&fixture->gate_mutex);
+	fixture->gate_open = TRUE;
+	g_cond_broadcast (&fixture->gate_cond);
+	g_mutex_unlock (&fixture->gate_mutex);
+}
+
+static void
+queue_record (Fixture     *fixture,
+              gint         priority,
+              const gchar *name)
+{
+	g_autoptr(GTask) task = g_task_new (NULL, NULL, task_done_cb, fixture);
+
+	g_task_set_task_data (task, (gpointer) name, NULL);
+	g_object_set_data (G_OBJECT (task), "fixture", fixture);
+	gs_worker_thread_queue (fixture->worker, priority, record_thread_cb, g_steal_pointer (&task));
+}
+
+static void
+wait_for_completed (Fixture *fixture,
+                    guint    n_completed)
+{
+	while (fixture->n_completed < n_completed)
+		g_main_context_iteration (NULL, TRUE);
+}
+
+/* Tasks run in priority order, and in queue order within a priority. */
+static void
+test_worker_thread_priority_order (Fixture       *fixture,
+                                   gconstpointer  test_data)
+{
+	queue_gate (fixture);
+	queue_record (fixture, G_PRIORITY_LOW, "a");
+	queue_record (fixture, G_PRIORITY_DEFAULT, "b");
+	queue_record (fixture, G_PRIORITY_LOW, "c");
+	queue_record (fixture, G_PRIORITY_HIGH, "d");
+	queue_record (fixture, G_PRIORITY_DEFAULT, "e");
+	open_gate (fixture);
+
+	wait_for_completed (fixture, 6);
+
+	g_assert_cmpstr (fixture->order->str, ==, "dbeac");
+}
+
+/* A low priority task which has waited long enough runs before a newer
+ * default priority one. */
+static void
+test_worker_thread_aging (Fixture       *fixture,
+                          gconstpointer  test_data)
+{
+	queue_gate (fixture);
+	queue_record (fixture, G_PRIORITY_LOW, "a");
+	g_usleep (2 * G_USEC_PER_SEC);
+	queue_record (fixture, G_PRIORITY_DEFAULT, "b");
+	open_gate (fixture);
+
+	wait_for_completed (fixture, 3);
+
+	g_assert_cmpstr (fixture->order->str, ==, "ab");
+}
+
+static void
+background_thread_cb (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+	Fixture *fixture = task_data;
+	gint64 end_time = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+
+	g_atomic_int_set (&fixture->background_started, TRUE);
+
+	/* do some long running work in steps, until the interactive task has
+	 * had a chance to run */
+	while (!g_atomic_int_get (&fixture->interactive_started) &&
+	       g_get_monotonic_time () < end_time) {
+		g_usleep (10 * G_TIME_SPAN_MILLISECOND);
+		gs_worker_thread_yield (fixture->worker);
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+interactive_thread_cb (GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable)
+{
+	Fixture *fixture = task_data;
+
+	fixture->interactive_start_time = g_get_monotonic_time ();
+	g_atomic_int_set (&fixture->interactive_started, TRUE);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+/* An interactive task queued behind a running background one starts within a
+ * bounded time, rather than once the background task is finished. */
+static void
+test_worker_thread_yield_latency (Fixture       *fixture,
+                                  gconstpointer  test_data)
+{
+	g_autoptr(GTask) background_task = NULL;
+	g_autoptr(GTask) interactive_task = NULL;
+
+	background_task = g_task_new (NULL, NULL, task_done_cb, fixture);
+	g_task_set_task_data (background_task, fixture, NULL);
+	gs_worker_thread_queue (fixture->worker, G_PRIORITY_LOW, background_thread_cb, g_steal_pointer (&background_task));
+
+	while (!g_atomic_int_get (&fixture->background_started))
+		g_usleep (G_TIME_SPAN_MILLISECOND);
+
+	interactive_task = g_task_new (NULL, NULL, task_done_cb, fixture);
+	g_task_set_task_data (interactive_task, fixture, NULL);
+	fixture->interactive_queued_time = g_get_monotonic_time ();
+	gs_worker_thread_queue (fixture->worker, G_PRIORITY_DEFAULT, interactive_thread_cb, g_steal_pointer (&interactive_task));
+
+	wait_for_completed (fixture, 2);
+
+	g_assert_true (g_atomic_int_get (&fixture->interactive_started));
+	g_assert_cmpint (fixture->interactive_start_time - fixture->interactive_queued_time, <, 500 * G_TIME_SPAN_MILLISECOND);
+}
+
+static void
+urgent_thread_cb (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+	Fixture *fixture = task_data;
+
+	g_string_append_c (fixture->order, 'u');
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+nested_yield_thread_cb (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable)
+{
+	Fixture *fixture = task_data;
+	g_autoptr(GTask) urgent_task = NULL;
+
+	/* no callback, as it would be called on the worker thread */
+	urgent_task = g_task_new (NULL, NULL, NULL, NULL);
+	g_task_set_task_data (urgent_task, fixture, NULL);
+	gs_worker_thread_queue (fixture->worker, G_PRIORITY_HIGH, urgent_thread_cb, g_steal_pointer (&urgent_task));
+
+	/* this was run from the background task’s yield, so can’t yield */
+	fixture->nested_yield_ran = gs_worker_thread_yield (fixture->worker);
+	g_string_append_c (fixture->order, 'i');
+
+	g_atomic_int_set (&fixture->interactive_started, TRUE);
+	g_task_return_boolean (task, TRUE);
+}
+
+/* A task run from another task’s gs_worker_thread_yield() can’t yield in turn,
+ * so tasks never nest more than one deep. */
+static void
+test_worker_thread_yield_nested (Fixture       *fixture,
+                                 gconstpointer  test_data)
+{
+	g_autoptr(GTask) background_task = NULL;
+	g_autoptr(GTask) interactive_task = NULL;
+
+	background_task = g_task_new (NULL, NULL, task_done_cb, fixture);
+	g_task_set_task_data (background_task, fixture, NULL);
+	gs_worker_thread_queue (fixture->worker, G_PRIORITY_LOW, background_thread_cb, g_steal_pointer (&background_task));
+
+	while (!g_atomic_int_get (&fixture->background_started))
+		g_usleep (G_TIME_SPAN_MILLISECOND);
+
+	interactive_task = g_task_new (NULL, NULL, task_done_cb, fixture);
+	g_task_set_task_data (interactive_task, fixture, NULL);
+	gs_worker_thread_queue (fixture->worker, G_PRIORITY_DEFAULT, nested_yield_thread_cb, g_steal_pointer (&interactive_task));
+
+	/* the urgent task runs from the background task’s yield too, so has
+	 * finished by the time that does */
+	wait_for_completed (fixture, 2);
+
+	g_assert_false (fixture->nested_yield_ran);
+	g_assert_cmpstr (fixture->order->str, ==, "iu");
+}
+
+static void
+reader_thread_cb (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+	Fixture *fixture = task_data;
+	gint n_running;
+	gint64 end_time = g_get_monotonic_time () + 5 * G_USEC_PER_SEC;
+
+	g_assert_true (gs_worker_thread_is_in_read_only_context (fixture->worker));
+	g_assert_false (gs_worker_thread_is_in_worker_context (fixture->worker));
+
+	n_running = g_atomic_int_add (&fixture->n_readers_running, 1) + 1;
+	if (n_running > g_atomic_int_get (&fixture->max_readers_running))
+		g_atomic_int_set (&fixture->max_readers_running, n_running);
+
+	/* wait for the other reader to start, which it only can if the two
+	 * are run in parallel */
+	while (g_atomic_int_get (&fixture->max_readers_running) < 2 &&
+	       g_get_monotonic_time () < end_time)
+		g_usleep (G_TIME_SPAN_MILLISECOND);
+
+	g_atomic_int_add (&fixture->n_readers_running, -1);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+/* Read-only tasks run in parallel with each other, and alongside whatever
+ * the worker thread is busy with. */
+static void
+test_worker_thread_read_only (Fixture       *fixture,
+                              gconstpointer  test_data)
+{
+	queue_gate (fixture);
+
+	for (guint i = 0; i < 2; i++) {
+		g_autoptr(GTask) task = g_task_new (NULL, NULL, task_done_cb, fixture);
+
+		g_task_set_task_data (task, fixture, NULL);
+		gs_worker_thread_queue_read_only (fixture->worker, G_PRIORITY_DEFAULT, reader_thread_cb, g_steal_pointer (&task));
+	}
+
+	/* the readers don’t wait for the worker */
+	wait_for_completed (fixture, 2);
+	g_assert_cmpint (g_atomic_int_get (&fixture->max_readers_running), ==, 2);
+
+	open_gate (fixture);
+	wait_for_completed (fixture, 3);
+}
+
+int
+main (int argc, char **argv)
+{
+	gs_test_init (&argc, &argv);
+
+	g_test_add ("/gnome-software/lib/worker-thread/priority-order", Fixture, NULL,
+		    setup, test_worker_thread_priority_order, teardown);
+	g_test_add ("/gnome-software/lib/worker-thread/aging", Fixture, NULL,
+		    setup, test_worker_thread_aging, teardown);
+	g_test_add ("/gnome-software/lib/worker-thread/yield-latency", Fixture, NULL,
+		    setup, test_worker_thread_yield_latency, teardown);
+	g_test_add ("/gnome-software/lib/worker-thread/yield-nested", Fixture, NULL,
+		    setup, test_worker_thread_yield_nested, teardown);
+
+	g_test_add ("/gnome-software/lib/worker-thread/read-only", Fixture, NULL,
+		    setup, test_worker_thread_read_only, teardown);
+
+	return g_test_run ();
+}
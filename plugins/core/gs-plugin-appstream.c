@@ -56,6 +56,12 @@ G_DEFINE_TYPE (GsPluginAppstream, gs_plugin_appstream, GS_TYPE_PLUGIN)
 #define assert_in_worker(self) \
 	g_assert (gs_worker_thread_is_in_worker_context (self->worker))
 
+/* Operations which only read the silo are run on the shared read-only pool,
+ * as the silo wrapper lets any number of readers use it at once. */
+#define assert_in_reader(self) \
+	g_assert (gs_worker_thread_is_in_worker_context (self->worker) || \
+		  gs_worker_thread_is_in_read_only_context (self->worker))
+
 static void notify_cpu_priority_cb (GObject    *obj,
                                     GParamSpec *pspec,
                                     void       *user_data);
@@ -546,6 +552,8 @@ gs_plugin_appstream_build_silo (GsSiloWrapper *silo_wrapper,
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_autoptr(GPtrArray) parent_appdata = g_ptr_array_new_with_free_func (g_free);
 	g_autoptr(GPtrArray) parent_appstream = NULL;
+	gint64 begin_time_usec = g_get_monotonic_time ();
+	gint64 phase_begin_time_usec = begin_time_usec;
 
 	g_clear_pointer (&self->silo_installed_by_id, g_hash_table_unref);
 
@@ -625,6 +633,8 @@ gs_plugin_appstream_build_silo (GsSiloWrapper *silo_wrapper,
 		gs_appstream_add_data_merge_fixup (builder, parent_appstream, parent_desktop, cancellable);
 	}
 
+	gs_startup_timeline_add_span ("appstream-build-silo:load-sources", phase_begin_time_usec);
+
 	/* regenerate with each minor release */
 	xb_builder_append_guid (builder, PACKAGE_VERSION);
 
@@ -638,12 +648,14 @@ gs_plugin_appstream_build_silo (GsSiloWrapper *silo_wrapper,
 	file = g_file_new_for_path (blobfn);
 	g_debug ("ensuring %s", blobfn);
 
+	phase_begin_time_usec = g_get_monotonic_time ();
 	silo = xb_builder_ensure (builder, file,
 				  XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
 				  XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
 				  NULL, error);
 	if (silo == NULL)
 		return NULL;
+	gs_startup_timeline_add_span ("appstream-build-silo:ensure", phase_begin_time_usec);
 
 #ifdef __GLIBC__
 	/* https://gitlab.gnome.org/GNOME/gnome-software/-/issues/941 
@@ -665,6 +677,7 @@ gs_plugin_appstream_build_silo (GsSiloWrapper *silo_wrapper,
 
 	g_clear_object (&n);
 
+	phase_begin_time_usec = g_get_monotonic_time ();
 	self->silo_installed_by_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
 	installed = xb_silo_query (silo, "/component/id", 0, NULL);
@@ -674,6 +687,8 @@ gs_plugin_appstream_build_silo (GsSiloWrapper *silo_wrapper,
 		if (id != NULL && *id != '\0')
 			g_hash_table_add (self->silo_installed_by_id, g_strdup (id));
 	}
+	gs_startup_timeline_add_span ("appstream-build-silo:index-installed", phase_begin_time_usec);
+	gs_startup_timeline_add_span ("appstream-build-silo", begin_time_usec);
 
 	/* success */
 	return g_steal_pointer (&silo);
@@ -692,6 +707,40 @@ gs_plugin_appstream_acquire_silo_wrapper (GsPluginAppstream *self,
 	return self->silo_wrapper;
 }
 
+/* Like gs_plugin_appstream_acquire_silo_wrapper(), for tasks which may be run
+ * in the read-only pool. The silo is only rebuilt on @worker: the build adds
+ * file monitors, which are attached to the thread-default main context of the
+ * thread building it, and that of a pool thread is never iterated. So if the
+ * silo needs rebuilding, @task is moved to @worker to be run with @work_func
+ * there instead.
+ *
+ * Returns %NULL if @task was moved or has been returned an error, in which case
+ * the caller must not touch it any more. */
+static GsSiloWrapper * /* (transfer none) */
+gs_plugin_appstream_acquire_silo_wrapper_for_task (GsPluginAppstream *self,
+						   GTask             *task,
+						   GTaskThreadFunc    work_func,
+						   gint               priority)
+{
+	g_autoptr(GError) local_error = NULL;
+
+	if (gs_worker_thread_is_in_read_only_context (self->worker)) {
+		if (gs_silo_wrapper_try_acquire (self->silo_wrapper))
+			return self->silo_wrapper;
+
+		g_debug ("moving task to the worker to rebuild the silo");
+		gs_worker_thread_queue (self->worker, priority, work_func, g_object_ref (task));
+		return NULL;
+	}
+
+	if (!gs_silo_wrapper_acquire (self->silo_wrapper, FALSE, g_task_get_cancellable (task), &local_error)) {
+		g_task_return_error (task, g_steal_pointer (&local_error));
+		return NULL;
+	}
+
+	return self->silo_wrapper;
+}
+
 static void
 gs_plugin_appstream_reload (GsPlugin *plugin)
 {
@@ -1073,8 +1122,8 @@ gs_plugin_appstream_refine_async (GsPlugin                   *plugin,
 	g_task_set_source_tag (task, gs_plugin_appstream_refine_async);
 
 	/* Queue a job for the refine. */
-	gs_worker_thread_queue (self->worker, get_priority_for_interactivity (interactive),
-				refine_thread_cb, g_steal_pointer (&task));
+	gs_worker_thread_queue_read_only (self->worker, get_priority_for_interactivity (interactive),
+					  refine_thread_cb, g_steal_pointer (&task));
 }
 
 static gboolean refine_wildcard (GsPluginAppstream           *self,
@@ -1090,7 +1139,7 @@ static gboolean refine_wildcard (GsPluginAppstream           *self,
                                  GCancellable                *cancellable,
                                  GError                     **error);
 
-/* Run in @worker. */
+/* Run in the read-only pool. */
 static void
 refine_thread_cb (GTask        *task,
                   gpointer      source_object,
@@ -1113,14 +1162,13 @@ refine_thread_cb (GTask        *task,
 	AsComponentScope default_scope;
 	g_autoptr(GError) local_error = NULL;
 
-	assert_in_worker (self);
+	assert_in_reader (self);
 
 	/* check silo is valid */
-	silo_handle = gs_plugin_appstream_acquire_silo_wrapper (self, cancellable, &local_error);
-	if (silo_handle == NULL) {
-		g_task_return_error (task, g_steal_pointer (&local_error));
+	silo_handle = gs_plugin_appstream_acquire_silo_wrapper_for_task (self, task, refine_thread_cb,
+									 get_priority_for_interactivity ((data->job_flags & GS_PLUGIN_REFINE_FLAGS_INTERACTIVE) != 0));
+	if (silo_handle == NULL)
 		return;
-	}
 
 	silo = gs_silo_wrapper_get_silo (silo_handle);
 	silo_filename = gs_silo_wrapper_get_filename (silo_handle);
@@ -1338,11 +1386,11 @@ gs_plugin_appstream_refine_categories_async (GsPlugin                      *plug
 	}
 
 	/* Queue a job to get the apps. */
-	gs_worker_thread_queue (self->worker, get_priority_for_interactivity (interactive),
-				refine_categories_thread_cb, g_steal_pointer (&task));
+	gs_worker_thread_queue_read_only (self->worker, get_priority_for_interactivity (interactive),
+					  refine_categories_thread_cb, g_steal_pointer (&task));
 }
 
-/* Run in @worker. */
+/* Run in the read-only pool. */
 static void
 refine_categories_thread_cb (GTask        *task,
                              gpointer      source_object,
@@ -1354,14 +1402,13 @@ refine_categories_thread_cb (GTask        *task,
 	g_autoptr(GsSiloHandle) silo_handle = NULL;
 	g_autoptr(GError) local_error = NULL;
 
-	assert_in_worker (self);
+	assert_in_reader (self);
 
 	/* check silo is valid */
-	silo_handle = gs_plugin_appstream_acquire_silo_wrapper (self, cancellable, &local_error);
-	if (silo_handle == NULL) {
-		g_task_return_error (task, g_steal_pointer (&local_error));
+	silo_handle = gs_plugin_appstream_acquire_silo_wrapper_for_task (self, task, refine_categories_thread_cb,
+									 get_priority_for_interactivity ((data->flags & GS_PLUGIN_REFINE_CATEGORIES_FLAGS_INTERACTIVE) != 0));
+	if (silo_handle == NULL)
 		return;
-	}
 
 	if (!gs_appstream_refine_category_sizes (gs_silo_wrapper_get_silo (silo_handle), data->list, cancellable, &local_error)) {
 		g_task_return_error (task, g_steal_pointer (&local_error));
@@ -1404,11 +1451,11 @@ gs_plugin_appstream_list_apps_async (GsPlugin              *plugin,
 	g_task_set_source_tag (task, gs_plugin_appstream_list_apps_async);
 
 	/* Queue a job to get the apps. */
-	gs_worker_thread_queue (self->worker, get_priority_for_interactivity (interactive),
-				list_apps_thread_cb, g_steal_pointer (&task));
+	gs_worker_thread_queue_read_only (self->worker, get_priority_for_interactivity (interactive),
+					  list_apps_thread_cb, g_steal_pointer (&task));
 }
 
-/* Run in @worker. */
+/* Run in the read-only pool. */
 static void
 list_apps_thread_cb (GTask        *task,
                      gpointer      source_object,
@@ -1432,7 +1479,7 @@ list_apps_thread_cb (GTask        *task,
 	GsApp *alternate_of = NULL;
 	g_autoptr(GError) local_error = NULL;
 
-	assert_in_worker (self);
+	assert_in_reader (self);
 
 	if (data->query != NULL) {
 		released_since = gs_app_query_get_released_since (data->query);
@@ -1471,11 +1518,10 @@ list_apps_thread_cb (GTask        *task,
 	}
 
 	/* check silo is valid */
-	silo_handle = gs_plugin_appstream_acquire_silo_wrapper (self, cancellable, &local_error);
-	if (silo_handle == NULL) {
-		g_task_return_error (task, g_steal_pointer (&local_error));
+	silo_handle = gs_plugin_appstream_acquire_silo_wrapper_for_task (self, task, list_apps_thread_cb,
+									 get_priority_for_interactivity ((data->flags & GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE) != 0));
+	if (silo_handle == NULL)
 		return;
-	}
 
 	silo = gs_silo_wrapper_get_silo (silo_handle);
 
@@ -32,6 +32,11 @@ gs_plugin_hardcoded_blocklist_init (GsPluginHardcodedBlocklist *self)
 {
 	/* need ID */
 	gs_plugin_add_rule (GS_PLUGIN (self), GS_PLUGIN_RULE_RUN_AFTER, "appstream");
+
+	/* only quirks are added */
+	gs_plugin_set_refine_dependencies (GS_PLUGIN (self),
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_ID,
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
 }
 
 static gboolean
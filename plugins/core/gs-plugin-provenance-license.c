@@ -91,6 +91,11 @@ gs_plugin_provenance_license_init (GsPluginProvenanceLicense *self)
 
 	/* need this set */
 	gs_plugin_add_rule (GS_PLUGIN (self), GS_PLUGIN_RULE_RUN_AFTER, "provenance");
+
+	gs_plugin_set_refine_dependencies (GS_PLUGIN (self),
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_ORIGIN |
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_PROVENANCE,
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE);
 }
 
 static void
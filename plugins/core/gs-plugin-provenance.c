@@ -135,6 +135,11 @@ gs_plugin_provenance_init (GsPluginProvenance *self)
 	gs_plugin_add_rule (GS_PLUGIN (self), GS_PLUGIN_RULE_RUN_AFTER, "dummy");
 	gs_plugin_add_rule (GS_PLUGIN (self), GS_PLUGIN_RULE_RUN_AFTER, "packagekit");
 	gs_plugin_add_rule (GS_PLUGIN (self), GS_PLUGIN_RULE_RUN_AFTER, "rpm-ostree");
+
+	gs_plugin_set_refine_dependencies (GS_PLUGIN (self),
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_ID |
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_ORIGIN,
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_PROVENANCE);
 }
 
 static void
@@ -0,0 +1,290 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/* Benchmarks for the appstream plugin against a generated catalog of the size
+ * of a real repository. These are run with `meson test --benchmark`, which
+ * passes `-m perf`; without it, a small catalog is used so that they are
+ * quick enough to run as a smoke test.
+ *
+ * The catalog can be changed with these environment variables:
+ *  - `GS_BENCHMARK_N_COMPONENTS`: number of components (default 20000)
+ *  - `GS_BENCHMARK_N_LOCALES`: number of translations of each one (default 8)
+ *  - `GS_BENCHMARK_N_ITERATIONS`: times to repeat each measurement (default 5)
+ *  - `GS_BENCHMARK_DUMP_CATALOG`: a file to also write the catalog to, so it
+ *    can be used with `GS_TEST_APPSTREAM_XML` elsewhere
+ */
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+
+#include "gnome-software-private.h"
+
+#include "gs-test.h"
+
+static const gchar * const allowlist[] = {
+	"appstream",
+	NULL
+};
+
+typedef struct {
+	GsPluginLoader *plugin_loader;  /* (owned) */
+	gchar *cache_dir;  /* (owned) */
+	guint n_components;
+	guint n_iterations;
+} Fixture;
+
+/* Reports the median of @times_ms, and returns it. */
+static gdouble
+report_times (GArray      *times_ms,
+              const gchar *what)
+{
+	gdouble median_ms;
+
+	g_array_sort (times_ms, gs_test_double_cmp);
+	median_ms = g_array_index (times_ms, gdouble, times_ms->len / 2);
+
+	g_test_minimized_result (median_ms, "%s: min %.2f ms, median %.2f ms, max %.2f ms",
+				 what,
+				 g_array_index (times_ms, gdouble, 0),
+				 median_ms,
+				 g_array_index (times_ms, gdouble, times_ms->len - 1));
+
+	return median_ms;
+}
+
+/* Rebuilding the silo from scratch, as after a metadata refresh. */
+static void
+benchmark_silo_build (gconstpointer test_data)
+{
+	const Fixture *fixture = test_data;
+	g_autoptr(GArray) times_ms = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+	for (guint i = 0; i < fixture->n_iterations; i++) {
+		g_autoptr(GTimer) timer = NULL;
+		gdouble elapsed_ms;
+
+		/* throw away the cached silo, so it has to be rebuilt */
+		gs_utils_rmtree (fixture->cache_dir, NULL);
+		g_mkdir_with_parents (fixture->cache_dir, 0700);
+
+		timer = g_timer_new ();
+		gs_test_reinitialise_plugin_loader (fixture->plugin_loader, allowlist, NULL);
+		elapsed_ms = g_timer_elapsed (timer, NULL) * 1000;
+		g_array_append_val (times_ms, elapsed_ms);
+	}
+
+	report_times (times_ms, "Building the silo");
+}
+
+static void
+run_search (const Fixture *fixture,
+            const gchar   *keyword,
+            const gchar   *what)
+{
+	g_autoptr(GArray) times_ms = g_array_new (FALSE, FALSE, sizeof (gdouble));
+	guint n_results = 0;
+
+	for (guint i = 0; i < fixture->n_iterations; i++) {
+		const gchar * const keywords[] = { keyword, NULL };
+		g_autoptr(GsAppQuery) query = NULL;
+		g_autoptr(GsPluginJob) plugin_job = NULL;
+		g_autoptr(GTimer) timer = NULL;
+		g_autoptr(GError) error = NULL;
+		gdouble elapsed_ms;
+		gboolean ret;
+
+		query = gs_app_query_new ("keywords", keywords,
+					  "refine-require-flags", GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON,
+					  "dedupe-flags", GS_APP_QUERY_DEDUPE_FLAGS_DEFAULT,
+					  "sort-func", gs_utils_app_sort_match_value,
+					  NULL);
+		plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_NONE);
+
+		timer = g_timer_new ();
+		ret = gs_plugin_loader_job_process (fixture->plugin_loader, plugin_job, NULL, &error);
+		elapsed_ms = g_timer_elapsed (timer, NULL) * 1000;
+
+		g_assert_no_error (error);
+		g_assert_true (ret);
+		g_array_append_val (times_ms, elapsed_ms);
+
+		n_results = gs_app_list_length (gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (plugin_job)));
+	}
+
+	g_assert_cmpuint (n_results, >, 0);
+	g_test_message ("Searching for ‘%s’ found %u apps", keyword, n_results);
+	report_times (times_ms, what);
+}
+
+/* A term which matches a large fraction of the catalog. */
+static void
+benchmark_search_common (gconstpointer test_data)
+{
+	run_search (test_data, "editor", "Searching for a common term");
+}
+
+/* A term which matches a single component. */
+static void
+benchmark_search_rare (gconstpointer test_data)
+{
+	run_search (test_data, "needle", "Searching for a rare term");
+}
+
+/* Counting the apps in each category, as done for the overview page. */
+static void
+benchmark_categories (gconstpointer test_data)
+{
+	const Fixture *fixture = test_data;
+	g_autoptr(GArray) times_ms = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+	for (guint i = 0; i < fixture->n_iterations; i++) {
+		g_autoptr(GsPluginJob) plugin_job = NULL;
+		g_autoptr(GTimer) timer = NULL;
+		g_autoptr(GError) error = NULL;
+		gdouble elapsed_ms;
+		gboolean ret;
+
+		plugin_job = gs_plugin_job_list_categories_new (GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE);
+
+		timer = g_timer_new ();
+		ret = gs_plugin_loader_job_process (fixture->plugin_loader, plugin_job, NULL, &error);
+		elapsed_ms = g_timer_elapsed (timer, NULL) * 1000;
+
+		g_assert_no_error (error);
+		g_assert_true (ret);
+		g_array_append_val (times_ms, elapsed_ms);
+	}
+
+	report_times (times_ms, "Counting apps in categories");
+}
+
+/* Refining a page worth of apps, with the details shown on the app page. */
+static void
+benchmark_refine (gconstpointer test_data)
+{
+	const Fixture *fixture = test_data;
+	const guint n_apps = MIN (fixture->n_components, 1000);
+	g_autoptr(GArray) times_ms = g_array_new (FALSE, FALSE, sizeof (gdouble));
+	gdouble median_ms;
+
+	for (guint i = 0; i < fixture->n_iterations; i++) {
+		g_autoptr(GsAppList) list = gs_app_list_new ();
+		g_autoptr(GsPluginJob) plugin_job = NULL;
+		g_autoptr(GTimer) timer = NULL;
+		g_autoptr(GError) error = NULL;
+		gdouble elapsed_ms;
+		gboolean ret;
+
+		/* new apps each time, spread over the catalog, so nothing is
+		 * already refined */
+		for (guint j = 0; j < n_apps; j++) {
+			g_autofree gchar *id = g_strdup_printf ("org.example.Synthetic%u",
+								(guint) (((guint64) j * fixture->n_components) / n_apps));
+			g_autoptr(GsApp) app = gs_app_new (id);
+			gs_app_list_add (list, app);
+		}
+
+		plugin_job = gs_plugin_job_refine_new (list,
+						       GS_PLUGIN_REFINE_FLAGS_NONE,
+						       GS_PLUGIN_REFINE_REQUIRE_FLAGS_DESCRIPTION |
+						       GS_PLUGIN_REFINE_REQUIRE_FLAGS_VERSION |
+						       GS_PLUGIN_REFINE_REQUIRE_FLAGS_URL |
+						       GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE |
+						       GS_PLUGIN_REFINE_REQUIRE_FLAGS_CATEGORIES |
+						       GS_PLUGIN_REFINE_REQUIRE_FLAGS_SCREENSHOTS |
+						       GS_PLUGIN_REFINE_REQUIRE_FLAGS_DEVELOPER_NAME);
+
+		timer = g_timer_new ();
+		ret = gs_plugin_loader_job_process (fixture->plugin_loader, plugin_job, NULL, &error);
+		elapsed_ms = g_timer_elapsed (timer, NULL) * 1000;
+
+		g_assert_no_error (error);
+		g_assert_true (ret);
+		g_array_append_val (times_ms, elapsed_ms);
+
+		/* don’t let the refined apps be reused by the next iteration */
+		gs_plugin_loader_clear_caches (fixture->plugin_loader);
+	}
+
+	median_ms = report_times (times_ms, "Refining apps");
+	g_test_maximized_result (n_apps / (median_ms / 1000), "Refined %.0f apps per second",
+				 n_apps / (median_ms / 1000));
+}
+
+int
+main (int argc, char **argv)
+{
+	Fixture fixture = { 0, };
+	g_autofree gchar *tmp_root = NULL;
+	g_autofree gchar *xml = NULL;
+	const gchar *dump_filename;
+	g_autoptr(GTimer) timer = NULL;
+	g_autoptr(GError) error = NULL;
+	gboolean ret;
+	int retval;
+
+	gs_test_init (&argc, &argv);
+
+	fixture.n_components = gs_test_get_env_uint ("GS_BENCHMARK_N_COMPONENTS", 1, g_test_perf () ? 20000 : 500);
+	fixture.n_iterations = gs_test_get_env_uint ("GS_BENCHMARK_N_ITERATIONS", 1, g_test_perf () ? 5 : 1);
+
+	/* Use a cache directory which can be emptied to force a silo rebuild. */
+	tmp_root = g_dir_make_tmp ("gnome-software-appstream-benchmark-XXXXXX", NULL);
+	g_assert_nonnull (tmp_root);
+	fixture.cache_dir = g_build_filename (tmp_root, "cache", NULL);
+	g_setenv ("GS_TEST_CACHEDIR", fixture.cache_dir, TRUE);
+
+	timer = g_timer_new ();
+	xml = gs_test_generate_appstream_xml (fixture.n_components,
+					      gs_test_get_env_uint ("GS_BENCHMARK_N_LOCALES", 1, 8),
+					      1);
+	g_test_message ("Generated %u components (%.1f MiB of XML) in %.2f ms",
+			fixture.n_components,
+			strlen (xml) / (1024.0 * 1024.0),
+			g_timer_elapsed (timer, NULL) * 1000);
+
+	dump_filename = g_getenv ("GS_BENCHMARK_DUMP_CATALOG");
+	if (dump_filename != NULL) {
+		g_file_set_contents (dump_filename, xml, -1, &error);
+		g_assert_no_error (error);
+	}
+
+	g_setenv ("GS_TEST_APPSTREAM_XML", xml, TRUE);
+
+	fixture.plugin_loader = gs_plugin_loader_new (NULL, NULL);
+	gs_plugin_loader_add_location (fixture.plugin_loader, LOCALPLUGINDIR);
+	g_timer_start (timer);
+	ret = gs_plugin_loader_setup (fixture.plugin_loader,
+				      allowlist,
+				      NULL,
+				      NULL,
+				      &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_test_message ("Initial setup took %.2f ms", g_timer_elapsed (timer, NULL) * 1000);
+
+	g_test_add_data_func ("/gnome-software/plugins/core/benchmark/silo-build",
+			      &fixture, benchmark_silo_build);
+	g_test_add_data_func ("/gnome-software/plugins/core/benchmark/search-common",
+			      &fixture, benchmark_search_common);
+	g_test_add_data_func ("/gnome-software/plugins/core/benchmark/search-rare",
+			      &fixture, benchmark_search_rare);
+	g_test_add_data_func ("/gnome-software/plugins/core/benchmark/categories",
+			      &fixture, benchmark_categories);
+	g_test_add_data_func ("/gnome-software/plugins/core/benchmark/refine",
+			      &fixture, benchmark_refine);
+	retval = g_test_run ();
+
+	/* Clean up. */
+	g_clear_object (&fixture.plugin_loader);
+	g_free (fixture.cache_dir);
+	gs_utils_rmtree (tmp_root, NULL);
+
+	return retval;
+}
@@ -195,6 +195,115 @@ gs_plugins_core_generic_updates_func (GsPluginLoader *plugin_loader)
 	}
 }
 
+typedef struct {
+	GsPlugin *plugin;  /* (unowned) */
+	XbSilo *silo;  /* (unowned) */
+	gint started;  /* (atomic) */
+} CancelSearchData;
+
+static void
+cancel_search_thread_cb (GTask        *task,
+                         gpointer      source_object,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
+{
+	CancelSearchData *data = task_data;
+	const gchar * const keywords[] = { "synthetic", NULL };
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GError) local_error = NULL;
+
+	g_atomic_int_set (&data->started, TRUE);
+
+	if (!gs_appstream_search (data->plugin, data->silo, keywords, list, cancellable, &local_error))
+		g_task_return_error (task, g_steal_pointer (&local_error));
+	else
+		g_task_return_boolean (task, TRUE);
+}
+
+static void
+cancel_search_done_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+	GAsyncResult **result_out = user_data;
+
+	*result_out = g_object_ref (result);
+	g_main_context_wakeup (NULL);
+}
+
+/* Cancelling a search over a large catalogue returns promptly, rather than
+ * once every component has been matched. */
+static void
+gs_plugins_core_search_cancellation_func (GsPluginLoader *plugin_loader)
+{
+	const guint n_components = 20000;
+	GsPlugin *plugin;
+	CancelSearchData data = { 0, };
+	g_autoptr(GString) xml = g_string_new ("<?xml version=\"1.0\"?>\n<components origin=\"synthetic\" version=\"0.9\">\n");
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(GAsyncResult) result = NULL;
+	g_autoptr(GError) error = NULL;
+	gint64 cancel_time_usec, done_time_usec;
+
+	plugin = gs_plugin_loader_find_plugin (plugin_loader, "appstream");
+	g_assert_nonnull (plugin);
+
+	/* every component matches, so each one creates an app */
+	for (guint i = 0; i < n_components; i++) {
+		g_string_append_printf (xml,
+					"  <component type=\"desktop\">\n"
+					"    <id>org.example.Synthetic%u.desktop</id>\n"
+					"    <name>synthetic app %u</name>\n"
+					"    <summary>A synthetic app for testing</summary>\n"
+					"    <pkgname>synthetic-%u</pkgname>\n"
+					"  </component>\n",
+					i, i, i);
+	}
+	g_string_append (xml, "</components>\n");
+
+	xb_builder_source_load_xml (source, xml->str, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	xb_builder_import_source (builder, source);
+	silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+
+	data.plugin = plugin;
+	data.silo = silo;
+
+	task = g_task_new (NULL, cancellable, cancel_search_done_cb, &result);
+	g_task_set_task_data (task, &data, NULL);
+	g_task_run_in_thread (task, cancel_search_thread_cb);
+
+	/* let the search get going before cancelling it */
+	while (!g_atomic_int_get (&data.started))
+		g_usleep (G_TIME_SPAN_MILLISECOND);
+	g_usleep (50 * G_TIME_SPAN_MILLISECOND);
+
+	cancel_time_usec = g_get_monotonic_time ();
+	g_cancellable_cancel (cancellable);
+
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+	done_time_usec = g_get_monotonic_time ();
+
+	if (g_task_propagate_boolean (G_TASK (result), &error)) {
+		g_test_skip ("Search finished before it could be cancelled");
+	} else {
+		g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+		g_test_message ("Search finished %.1f ms after being cancelled",
+				(gdouble) (done_time_usec - cancel_time_usec) / G_TIME_SPAN_MILLISECOND);
+		g_assert_cmpint (done_time_usec - cancel_time_usec, <, 250 * G_TIME_SPAN_MILLISECOND);
+	}
+
+	/* don’t leave the synthetic apps around for other tests */
+	gs_plugin_cache_invalidate (plugin);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -270,6 +379,9 @@ main (int argc, char **argv)
 	g_test_add_data_func ("/gnome-software/plugins/core/generic-updates",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_core_generic_updates_func);
+	g_test_add_data_func ("/gnome-software/plugins/core/search-cancellation",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_core_search_cancellation_func);
 	retval = g_test_run ();
 
 	/* Clean up. */
@@ -0,0 +1,195 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/* Microbenchmarks for gs_appstream_refine_app(), which is called for every
+ * app shown from AppStream data. Unlike appstream-benchmark.c, this calls it
+ * directly on the components of a generated catalog, without a plugin loader,
+ * so the numbers are the cost of refining one component and nothing else. It
+ * is passed an appstream plugin which isn’t set up, so that the parts which
+ * need a plugin, like looking up addons, are included.
+ *
+ * These are run with `meson test --benchmark`, which passes `-m perf`; without
+ * it, a small catalog is used so that they are quick enough to run as a smoke
+ * test. The catalog can be changed with these environment variables:
+ *  - `GS_BENCHMARK_N_COMPONENTS`: number of components (default 5000)
+ *  - `GS_BENCHMARK_N_LOCALES`: number of translations of each one (default 8)
+ *  - `GS_BENCHMARK_N_ITERATIONS`: times to repeat each measurement (default 5)
+ */
+
+#include "config.h"
+
+#include <xmlb.h>
+
+#include "gnome-software-private.h"
+
+#include "gs-appstream.h"
+#include "gs-test.h"
+
+typedef struct {
+	GsPlugin *plugin;  /* (owned) */
+	XbSilo *silo;  /* (owned) */
+	GPtrArray *components;  /* (owned) (element-type XbNode) */
+	GHashTable *installed_by_desktopid;  /* (owned) */
+	guint n_iterations;
+} Fixture;
+
+/* Refines a new app for each component in the catalog, @n_iterations times,
+ * and reports the median time per component. */
+static void
+run_refine (const Fixture              *fixture,
+            GsPluginRefineRequireFlags  require_flags,
+            GsAppState                  state,
+            const gchar                *what)
+{
+	g_autoptr(GArray) times_us = g_array_new (FALSE, FALSE, sizeof (gdouble));
+	gdouble median_us;
+
+	for (guint i = 0; i < fixture->n_iterations; i++) {
+		g_autoptr(GPtrArray) apps = g_ptr_array_new_with_free_func (g_object_unref);
+		g_autoptr(GTimer) timer = NULL;
+		gdouble elapsed_us;
+
+		/* new apps each time, so nothing is already refined or cached */
+		gs_plugin_cache_invalidate (fixture->plugin);
+		for (guint j = 0; j < fixture->components->len; j++) {
+			XbNode *component = g_ptr_array_index (fixture->components, j);
+			GsApp *app = gs_app_new (xb_node_query_text (component, "id", NULL));
+
+			if (state != GS_APP_STATE_UNKNOWN) {
+				gs_app_set_state (app, state);
+				gs_app_set_version (app, "1.1.0");
+			}
+			g_ptr_array_add (apps, app);
+		}
+
+		timer = g_timer_new ();
+		for (guint j = 0; j < fixture->components->len; j++) {
+			g_autoptr(GError) error = NULL;
+			gboolean ret;
+
+			ret = gs_appstream_refine_app (fixture->plugin,
+						       g_ptr_array_index (apps, j),
+						       fixture->silo,
+						       g_ptr_array_index (fixture->components, j),
+						       require_flags,
+						       fixture->installed_by_desktopid,
+						       "",
+						       AS_COMPONENT_SCOPE_SYSTEM,
+						       &error);
+			g_assert_no_error (error);
+			g_assert_true (ret);
+		}
+		elapsed_us = g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC / fixture->components->len;
+		g_array_append_val (times_us, elapsed_us);
+	}
+
+	g_array_sort (times_us, gs_test_double_cmp);
+	median_us = g_array_index (times_us, gdouble, times_us->len / 2);
+
+	g_test_minimized_result (median_us, "%s: min %.2f µs, median %.2f µs, max %.2f µs per component",
+				 what,
+				 g_array_index (times_us, gdouble, 0),
+				 median_us,
+				 g_array_index (times_us, gdouble, times_us->len - 1));
+	g_test_maximized_result (G_USEC_PER_SEC / median_us, "Refined %.0f components per second",
+				 G_USEC_PER_SEC / median_us);
+}
+
+/* The least which is refined for an app, as when listing search results. */
+static void
+benchmark_refine_minimal (gconstpointer test_data)
+{
+	run_refine (test_data,
+		    GS_PLUGIN_REFINE_REQUIRE_FLAGS_ID |
+		    GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON,
+		    GS_APP_STATE_UNKNOWN,
+		    "Minimal refine");
+}
+
+/* Everything, as for the app details page. */
+static void
+benchmark_refine_full (gconstpointer test_data)
+{
+	run_refine (test_data,
+		    GS_PLUGIN_REFINE_REQUIRE_FLAGS_MASK,
+		    GS_APP_STATE_UNKNOWN,
+		    "Full refine");
+}
+
+/* The update details of updatable apps, as for the updates page. */
+static void
+benchmark_refine_updates (gconstpointer test_data)
+{
+	run_refine (test_data,
+		    GS_PLUGIN_REFINE_REQUIRE_FLAGS_UPDATE_DETAILS |
+		    GS_PLUGIN_REFINE_REQUIRE_FLAGS_UPDATE_SEVERITY,
+		    GS_APP_STATE_UPDATABLE,
+		    "Refining update details");
+}
+
+int
+main (int argc, char **argv)
+{
+	Fixture fixture = { 0, };
+	g_autofree gchar *xml = NULL;
+	g_autoptr(XbBuilder) builder = NULL;
+	g_autoptr(XbBuilderSource) source = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *plugin_filename = NULL;
+	guint n_components;
+	int retval;
+
+	gs_test_init (&argc, &argv);
+
+	n_components = gs_test_get_env_uint ("GS_BENCHMARK_N_COMPONENTS", 1, g_test_perf () ? 5000 : 200);
+	fixture.n_iterations = gs_test_get_env_uint ("GS_BENCHMARK_N_ITERATIONS", 1, g_test_perf () ? 5 : 1);
+
+	xml = gs_test_generate_appstream_xml (n_components,
+					      gs_test_get_env_uint ("GS_BENCHMARK_N_LOCALES", 1, 8),
+					      1);
+
+	/* the plugin is only used for its app cache, so isn’t set up */
+	plugin_filename = g_build_filename (LOCALPLUGINDIR, "libgs_plugin_appstream." G_MODULE_SUFFIX, NULL);
+	fixture.plugin = gs_plugin_create (plugin_filename, G_PRIORITY_DEFAULT, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (fixture.plugin);
+
+	/* build the silo the way the appstream plugin does */
+	builder = xb_builder_new ();
+	gs_appstream_add_current_locales (builder);
+	source = xb_builder_source_new ();
+	xb_builder_source_load_xml (source, xml, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	xb_builder_import_source (builder, source);
+	fixture.silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_SINGLE_LANG, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (fixture.silo);
+
+	fixture.components = xb_silo_query (fixture.silo, "components/component", 0, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (fixture.components->len, ==, n_components);
+
+	/* nothing is installed, so no icons are inherited from .desktop files */
+	fixture.installed_by_desktopid = g_hash_table_new (g_str_hash, g_str_equal);
+
+	g_test_add_data_func ("/gnome-software/plugins/core/benchmark/refine-app/minimal",
+			      &fixture, benchmark_refine_minimal);
+	g_test_add_data_func ("/gnome-software/plugins/core/benchmark/refine-app/full",
+			      &fixture, benchmark_refine_full);
+	g_test_add_data_func ("/gnome-software/plugins/core/benchmark/refine-app/updates",
+			      &fixture, benchmark_refine_updates);
+	retval = g_test_run ();
+
+	/* Clean up. */
+	g_clear_pointer (&fixture.installed_by_desktopid, g_hash_table_unref);
+	g_clear_pointer (&fixture.components, g_ptr_array_unref);
+	g_clear_object (&fixture.silo);
+	g_clear_object (&fixture.plugin);
+
+	return retval;
+}
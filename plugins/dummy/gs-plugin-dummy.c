@@ -18,6 +18,13 @@
  * Provides some dummy data that is useful in test programs.
  *
  * This plugin runs entirely in the main thread and requires no locking.
+ *
+ * If `GS_TEST_DUMMY_N_APPS` is set, the category, installed, search and
+ * updates results also include that many generated apps, to exercise the UI
+ * at scale.
+ *
+ * If `GS_TEST_DUMMY_SETUP_DELAY_MS` is set, setting the plugin up takes that
+ * long, like a plugin which has to build a large appstream silo first.
  */
 
 struct _GsPluginDummy {
@@ -29,6 +36,8 @@ struct _GsPluginDummy {
 	GsApp			*cached_origin;
 	GHashTable		*installed_apps;	/* id:1 */
 	GHashTable		*available_apps;	/* id:1 */
+	guint			 n_synthetic_apps;
+	guint			 setup_delay_ms;
 };
 
 G_DEFINE_TYPE (GsPluginDummy, gs_plugin_dummy, GS_TYPE_PLUGIN)
@@ -64,6 +73,11 @@ gs_plugin_dummy_init (GsPluginDummy *self)
 	/* need help from appstream */
 	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_AFTER, "appstream");
 	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_AFTER, "os-release");
+
+	if (g_getenv ("GS_TEST_DUMMY_N_APPS") != NULL)
+		self->n_synthetic_apps = g_ascii_strtoull (g_getenv ("GS_TEST_DUMMY_N_APPS"), NULL, 10);
+	if (g_getenv ("GS_TEST_DUMMY_SETUP_DELAY_MS") != NULL)
+		self->setup_delay_ms = g_ascii_strtoull (g_getenv ("GS_TEST_DUMMY_SETUP_DELAY_MS"), NULL, 10);
 }
 
 static void
@@ -79,6 +93,16 @@ gs_plugin_dummy_dispose (GObject *object)
 	G_OBJECT_CLASS (gs_plugin_dummy_parent_class)->dispose (object);
 }
 
+static gboolean
+setup_delay_cb (gpointer user_data)
+{
+	GTask *task = G_TASK (user_data);
+
+	g_task_return_boolean (task, TRUE);
+
+	return G_SOURCE_REMOVE;
+}
+
 static void
 gs_plugin_dummy_setup_async (GsPlugin            *plugin,
                              GCancellable        *cancellable,
@@ -123,6 +147,12 @@ gs_plugin_dummy_setup_async (GsPlugin            *plugin,
 			     g_strdup ("com.hughski.ColorHug2.driver"),
 			     GUINT_TO_POINTER (1));
 
+	if (self->setup_delay_ms > 0) {
+		g_autoptr(GSource) delay_source = g_timeout_source_new (self->setup_delay_ms);
+		g_task_attach_source (task, delay_source, setup_delay_cb);
+		return;
+	}
+
 	g_task_return_boolean (task, TRUE);
 }
 
@@ -835,6 +865,45 @@ refine_app (GsPluginDummy               *self,
 	return TRUE;
 }
 
+typedef struct {
+	GsAppList *list;  /* (owned) */
+	GsPluginRefineRequireFlags require_flags;
+} RefineData;
+
+static void
+refine_data_free (RefineData *data)
+{
+	g_object_unref (data->list);
+	g_free (data);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RefineData, refine_data_free)
+
+static void
+refine_apps (GsPluginDummy              *self,
+             GTask                      *task,
+             GsAppList                  *list,
+             GsPluginRefineRequireFlags  require_flags)
+{
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	g_autoptr(GError) local_error = NULL;
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+
+		if (!refine_app (self, app, require_flags, cancellable, &local_error)) {
+			g_task_return_error (task, g_steal_pointer (&local_error));
+			return;
+		}
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void refine_timeout_cb (GObject      *object,
+                               GAsyncResult *result,
+                               gpointer      user_data);
+
 static void
 gs_plugin_dummy_refine_async (GsPlugin                   *plugin,
                               GsAppList                  *list,
@@ -848,7 +917,6 @@ gs_plugin_dummy_refine_async (GsPlugin                   *plugin,
 {
 	GsPluginDummy *self = GS_PLUGIN_DUMMY (plugin);
 	g_autoptr(GTask) task = NULL;
-	g_autoptr(GError) local_error = NULL;
 
 	task = g_task_new (plugin, cancellable, callback, user_data);
 	g_task_set_source_tag (task, gs_plugin_dummy_refine_async);
@@ -856,13 +924,38 @@ gs_plugin_dummy_refine_async (GsPlugin                   *plugin,
 	for (guint i = 0; i < gs_app_list_length (list); i++) {
 		GsApp *app = gs_app_list_index (list, i);
 
-		if (!refine_app (self, app, require_flags, cancellable, &local_error)) {
-			g_task_return_error (task, g_steal_pointer (&local_error));
+		if (g_strcmp0 (gs_app_get_id (app), "hang.desktop") == 0) {
+			g_autoptr(RefineData) data = g_new0 (RefineData, 1);
+
+			data->list = g_object_ref (list);
+			data->require_flags = require_flags;
+			g_task_set_task_data (task, g_steal_pointer (&data), (GDestroyNotify) refine_data_free);
+
+			/* hang the plugin for 5 seconds */
+			gs_plugin_dummy_timeout_async (self, 5000, cancellable,
+						       refine_timeout_cb, g_steal_pointer (&task));
 			return;
 		}
 	}
 
-	g_task_return_boolean (task, TRUE);
+	refine_apps (self, task, list, require_flags);
+}
+
+static void
+refine_timeout_cb (GObject      *object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+	GsPluginDummy *self = GS_PLUGIN_DUMMY (object);
+	g_autoptr(GTask) task = g_steal_pointer (&user_data);
+	RefineData *data = g_task_get_task_data (task);
+	g_autoptr(GError) local_error = NULL;
+
+	/* Return a cancelled error, or refine the apps after hanging. */
+	if (gs_plugin_dummy_timeout_finish (self, result, &local_error))
+		refine_apps (self, task, data->list, data->require_flags);
+	else
+		g_task_return_error (task, g_steal_pointer (&local_error));
 }
 
 static gboolean
@@ -873,6 +966,39 @@ gs_plugin_dummy_refine_finish (GsPlugin      *plugin,
 	return g_task_propagate_boolean (G_TASK (result), error);
 }
 
+/* add the apps requested with GS_TEST_DUMMY_N_APPS */
+static void
+add_synthetic_apps (GsPluginDummy *self,
+                    GsAppList     *list,
+                    GsAppState     state)
+{
+	GsPlugin *plugin = GS_PLUGIN (self);
+	g_autoptr(GIcon) icon = NULL;
+
+	if (self->n_synthetic_apps == 0)
+		return;
+
+	icon = g_themed_icon_new ("org.gnome.Software.Dummy");
+
+	for (guint i = 0; i < self->n_synthetic_apps; i++) {
+		g_autofree gchar *id = g_strdup_printf ("org.example.Dummy%u.desktop", i);
+		g_autofree gchar *name = g_strdup_printf ("Dummy App %u", i);
+		g_autoptr(GsApp) app = gs_app_new (id);
+
+		gs_app_set_name (app, GS_APP_QUALITY_NORMAL, name);
+		gs_app_set_summary (app, GS_APP_QUALITY_NORMAL, "A generated app for testing");
+		gs_app_add_icon (app, icon);
+		gs_app_set_size_installed (app, GS_SIZE_TYPE_VALID, (1 + i % 100) * 1024 * 1024);
+		gs_app_set_size_download (app, GS_SIZE_TYPE_VALID, (1 + i % 50) * 1024 * 1024);
+		gs_app_set_kind (app, AS_COMPONENT_KIND_DESKTOP_APP);
+		gs_app_set_state (app, state);
+		if (state == GS_APP_STATE_UPDATABLE_LIVE)
+			gs_app_set_update_details_text (app, "Bug fixes and performance improvements.");
+		gs_app_set_management_plugin (app, plugin);
+		gs_app_list_add (list, app);
+	}
+}
+
 static void list_apps_timeout_cb (GObject      *object,
                                   GAsyncResult *result,
                                   gpointer      user_data);
@@ -979,6 +1105,8 @@ gs_plugin_dummy_list_apps_async (GsPlugin              *plugin,
 		gs_app_set_kind (app, AS_COMPONENT_KIND_DESKTOP_APP);
 		gs_app_set_management_plugin (app, plugin);
 		gs_app_list_add (list, app);
+
+		add_synthetic_apps (self, list, GS_APP_STATE_AVAILABLE);
 	}
 
 	if (is_installed != GS_APP_QUERY_TRISTATE_UNSET) {
@@ -1004,6 +1132,8 @@ gs_plugin_dummy_list_apps_async (GsPlugin              *plugin,
 			gs_app_set_management_plugin (app, plugin);
 			gs_app_list_add (list, app);
 		}
+
+		add_synthetic_apps (self, list, GS_APP_STATE_INSTALLED);
 	}
 
 	if (keywords != NULL) {
@@ -1048,7 +1178,7 @@ gs_plugin_dummy_list_apps_async (GsPlugin              *plugin,
 				gs_plugin_cache_add (plugin, NULL, app);
 			}
 		} else {
-			/* Don’t do anything */
+			add_synthetic_apps (self, list, GS_APP_STATE_AVAILABLE);
 		}
 	}
 
@@ -1163,6 +1293,8 @@ list_apps_finish (GsPluginDummy *self,
 		gs_app_set_management_plugin (app, plugin);
 		gs_app_add_related (proxy, app);
 		g_object_unref (app);
+
+		add_synthetic_apps (self, list, GS_APP_STATE_UPDATABLE_LIVE);
 	}
 
 	return g_steal_pointer (&list);
@@ -111,6 +111,113 @@ gs_plugins_dummy_error_func (GsPluginLoader *plugin_loader)
 			GS_PLUGIN_ERROR_DOWNLOAD_FAILED);
 }
 
+/* A burst of alike background events only lets the first one through, while
+ * interactive events and different errors are still added. Once the window is
+ * over, a summary event replaces the first one. */
+static GsPluginEvent *
+create_mirror_event (GsApp        *origin,
+                     guint         app_number,
+                     const GError *error)
+{
+	g_autofree gchar *id = g_strdup_printf ("org.example.App%u.desktop", app_number);
+	g_autoptr(GsApp) app = gs_app_new (id);
+
+	gs_app_set_origin (app, "flaky-mirror");
+
+	return gs_plugin_event_new ("app", app,
+				    "origin", origin,
+				    "error", error,
+				    NULL);
+}
+
+static void
+gs_plugins_dummy_event_rate_limit_func (GsPluginLoader *plugin_loader)
+{
+	g_autoptr(GPtrArray) events = NULL;
+	g_autoptr(GsApp) origin = NULL;
+	g_autoptr(GsPluginEvent) interactive_event = NULL;
+	g_autoptr(GsPluginEvent) network_event = NULL;
+	g_autoptr(GsPluginEvent) late_event = NULL;
+	g_autoptr(GsPluginEvent) other_app_event1 = NULL;
+	g_autoptr(GsPluginEvent) other_app_event2 = NULL;
+	g_autoptr(GError) download_error = NULL;
+	g_autoptr(GError) network_error = NULL;
+	GsPluginEvent *summary_event = NULL;
+	const GError *summary_error;
+
+	gs_test_reinitialise_plugin_loader (plugin_loader, allowlist, NULL);
+	gs_plugin_loader_set_event_rate_limit_window (plugin_loader, 1000);
+
+	g_set_error_literal (&download_error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_DOWNLOAD_FAILED, "Download failed");
+	g_set_error_literal (&network_error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_NO_NETWORK, "No network");
+
+	origin = gs_app_new ("flaky-mirror");
+	gs_app_set_kind (origin, AS_COMPONENT_KIND_REPOSITORY);
+
+	/* a refresh against a failing mirror */
+	for (guint i = 0; i < 50; i++) {
+		g_autoptr(GsPluginEvent) event = create_mirror_event (origin, i, download_error);
+		gs_plugin_loader_add_event (plugin_loader, event);
+	}
+
+	events = gs_plugin_loader_get_events (plugin_loader);
+	g_assert_cmpuint (events->len, ==, 1);
+	g_clear_pointer (&events, g_ptr_array_unref);
+
+	/* the user asked for this one */
+	interactive_event = create_mirror_event (NULL, 50, download_error);
+	gs_plugin_event_add_flag (interactive_event, GS_PLUGIN_EVENT_FLAG_INTERACTIVE);
+	gs_plugin_loader_add_event (plugin_loader, interactive_event);
+
+	/* a different error */
+	network_event = create_mirror_event (origin, 51, network_error);
+	gs_plugin_loader_add_event (plugin_loader, network_event);
+
+	/* still within the window */
+	late_event = create_mirror_event (origin, 52, download_error);
+	gs_plugin_loader_add_event (plugin_loader, late_event);
+
+	/* without an origin, errors for different apps are not alike */
+	other_app_event1 = create_mirror_event (NULL, 53, download_error);
+	gs_plugin_loader_add_event (plugin_loader, other_app_event1);
+	other_app_event2 = create_mirror_event (NULL, 54, download_error);
+	gs_plugin_loader_add_event (plugin_loader, other_app_event2);
+
+	events = gs_plugin_loader_get_events (plugin_loader);
+	g_assert_cmpuint (events->len, ==, 4);
+	g_assert_true (g_ptr_array_find (events, interactive_event, NULL));
+	g_assert_true (g_ptr_array_find (events, network_event, NULL));
+	g_assert_true (g_ptr_array_find (events, other_app_event1, NULL));
+	g_assert_true (g_ptr_array_find (events, other_app_event2, NULL));
+	g_assert_false (g_ptr_array_find (events, late_event, NULL));
+	g_clear_pointer (&events, g_ptr_array_unref);
+
+	/* the network error replaced the first download error, as events are
+	 * stored by origin; wait for the summary of the suppressed ones */
+	while (summary_event == NULL) {
+		g_main_context_iteration (NULL, TRUE);
+
+		g_clear_pointer (&events, g_ptr_array_unref);
+		events = gs_plugin_loader_get_events (plugin_loader);
+		for (guint i = 0; i < events->len; i++) {
+			GsPluginEvent *event = g_ptr_array_index (events, i);
+
+			if (gs_plugin_event_get_origin (event) == origin &&
+			    g_error_matches (gs_plugin_event_get_error (event),
+					     GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_DOWNLOAD_FAILED))
+				summary_event = event;
+		}
+	}
+
+	summary_error = gs_plugin_event_get_error (summary_event);
+	g_assert_cmpstr (summary_error->message, ==, "Download failed (suppressed 50 similar events)");
+	g_assert_false (gs_plugin_event_has_flag (summary_event, GS_PLUGIN_EVENT_FLAG_INTERACTIVE));
+
+	gs_test_flush_main_context ();
+	gs_plugin_loader_set_event_rate_limit_window (plugin_loader, 10000);
+	gs_plugin_loader_remove_events (plugin_loader);
+}
+
 static void
 gs_plugins_dummy_refine_func (GsPluginLoader *plugin_loader)
 {
@@ -439,6 +546,96 @@ gs_plugins_dummy_search_func (GsPluginLoader *plugin_loader)
 	g_assert_cmpint (gs_app_get_kind (app), ==, AS_COMPONENT_KIND_DESKTOP_APP);
 }
 
+static void
+gs_plugins_dummy_search_two_phase_func (GsPluginLoader *plugin_loader)
+{
+	GsApp *app;
+	g_autoptr(GError) error = NULL;
+	GsAppList *list;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GsAppQuery) query = NULL;
+	const gchar *keywords[2] = { NULL, };
+
+	/* only the top result should be refined with the expensive flags */
+	keywords[0] = "zeus";
+	query = gs_app_query_new ("keywords", keywords,
+				  "refine-require-flags", GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON |
+							  GS_PLUGIN_REFINE_REQUIRE_FLAGS_DESCRIPTION,
+				  "ranking-refine-require-flags", GS_PLUGIN_REFINE_REQUIRE_FLAGS_RATING,
+				  "dedupe-flags", GS_APP_QUERY_DEDUPE_FLAGS_DEFAULT,
+				  "sort-func", gs_utils_app_sort_match_value,
+				  "max-results", 1,
+				  NULL);
+	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_NONE);
+	gs_plugin_loader_job_process (plugin_loader, plugin_job, NULL, &error);
+	list = gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (plugin_job));
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_nonnull (list);
+
+	/* the ranking is the same as when refining everything up front */
+	g_assert_cmpint (gs_app_list_length (list), ==, 1);
+	app = gs_app_list_index (list, 0);
+	g_assert_cmpstr (gs_app_get_id (app), ==, "zeus.desktop");
+	g_assert_cmpint (gs_app_get_kind (app), ==, AS_COMPONENT_KIND_DESKTOP_APP);
+}
+
+static void
+search_stream_partial_results_cb (GsPluginJobListApps *plugin_job,
+                                  GsAppList           *list,
+                                  gpointer             user_data)
+{
+	guint *n_partial_results = user_data;
+
+	/* partial results all come before the final ones */
+	g_assert_null (gs_plugin_job_list_apps_get_result_list (plugin_job));
+	g_assert_cmpint (gs_app_list_length (list), >, 0);
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		g_assert_false (gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD));
+		g_assert_nonnull (gs_app_get_id (app));
+	}
+
+	(*n_partial_results)++;
+}
+
+static void
+gs_plugins_dummy_search_stream_func (GsPluginLoader *plugin_loader)
+{
+	GsApp *app;
+	g_autoptr(GError) error = NULL;
+	GsAppList *list;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GsAppQuery) query = NULL;
+	const gchar *keywords[2] = { NULL, };
+	guint n_partial_results = 0;
+
+	/* streaming doesn’t change the final results */
+	keywords[0] = "zeus";
+	query = gs_app_query_new ("keywords", keywords,
+				  "refine-require-flags", GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON,
+				  "dedupe-flags", GS_APP_QUERY_DEDUPE_FLAGS_DEFAULT,
+				  "sort-func", gs_utils_app_sort_match_value,
+				  NULL);
+	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_STREAM_RESULTS);
+	g_signal_connect (plugin_job, "partial-results",
+			  G_CALLBACK (search_stream_partial_results_cb), &n_partial_results);
+	gs_plugin_loader_job_process (plugin_loader, plugin_job, NULL, &error);
+	list = gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (plugin_job));
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_nonnull (list);
+
+	g_assert_cmpint (gs_app_list_length (list), ==, 1);
+	app = gs_app_list_index (list, 0);
+	g_assert_cmpstr (gs_app_get_id (app), ==, "zeus.desktop");
+	g_assert_cmpint (gs_app_get_kind (app), ==, AS_COMPONENT_KIND_DESKTOP_APP);
+
+	/* only the plugins which weren’t last to return can stream results */
+	g_debug ("%u partial results", n_partial_results);
+}
+
 static void
 gs_plugins_dummy_search_alternate_func (GsPluginLoader *plugin_loader)
 {
@@ -690,6 +887,535 @@ gs_plugins_dummy_limit_parallel_ops_func (GsPluginLoader *plugin_loader)
 	g_assert_cmpint (gs_app_get_state (app3), ==, GS_APP_STATE_INSTALLED);
 }
 
+static void
+gs_plugins_dummy_refine_coalesce_func (GsPluginLoader *plugin_loader)
+{
+	g_autoptr(GsApp) app = NULL;
+	g_autoptr(GsPluginJob) plugin_job1 = NULL;
+	g_autoptr(GsPluginJob) plugin_job2 = NULL;
+	g_autoptr(GMainContext) context = NULL;
+	g_autoptr(GAsyncResult) result1 = NULL;
+	g_autoptr(GAsyncResult) result2 = NULL;
+	g_autoptr(GError) local_error = NULL;
+	guint n_coalesced;
+	GsPlugin *plugin;
+
+	app = gs_app_new ("chiron.desktop");
+	plugin = gs_plugin_loader_find_plugin (plugin_loader, "dummy");
+	gs_app_set_management_plugin (app, plugin);
+
+	context = g_main_context_new ();
+	g_main_context_push_thread_default (context);
+
+	n_coalesced = gs_plugin_loader_get_n_coalesced_refines (plugin_loader);
+
+	/* refine the same app twice at the "same time" */
+	plugin_job1 = gs_plugin_job_refine_new_for_app (app, GS_PLUGIN_REFINE_FLAGS_NONE,
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job1, NULL,
+					    async_result_cb, &result1);
+	plugin_job2 = gs_plugin_job_refine_new_for_app (app, GS_PLUGIN_REFINE_FLAGS_NONE,
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job2, NULL,
+					    async_result_cb, &result2);
+
+	while (result1 == NULL || result2 == NULL)
+		g_main_context_iteration (context, TRUE);
+
+	g_main_context_pop_thread_default (context);
+
+	gs_test_flush_main_context ();
+
+	gs_plugin_loader_job_process_finish (plugin_loader, result1, NULL, &local_error);
+	g_assert_no_error (local_error);
+	gs_plugin_loader_job_process_finish (plugin_loader, result2, NULL, &local_error);
+	g_assert_no_error (local_error);
+
+	/* the second refine waited for the first rather than running again */
+	g_assert_cmpuint (gs_plugin_loader_get_n_coalesced_refines (plugin_loader), ==, n_coalesced + 1);
+	g_assert_cmpstr (gs_app_get_license (app), ==, "GPL-2.0-or-later");
+}
+
+static void
+gs_plugins_dummy_refine_coalesce_flags_func (GsPluginLoader *plugin_loader)
+{
+	g_autoptr(GsApp) app = NULL;
+	g_autoptr(GsPluginJob) plugin_job1 = NULL;
+	g_autoptr(GsPluginJob) plugin_job2 = NULL;
+	g_autoptr(GsPluginJob) plugin_job3 = NULL;
+	g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+	g_autoptr(GMainContext) context = NULL;
+	g_autoptr(GAsyncResult) result1 = NULL;
+	g_autoptr(GAsyncResult) result2 = NULL;
+	g_autoptr(GAsyncResult) result3 = NULL;
+	g_autoptr(GError) local_error = NULL;
+	guint n_coalesced;
+	GsPlugin *plugin;
+
+	app = gs_app_new ("chiron.desktop");
+	plugin = gs_plugin_loader_find_plugin (plugin_loader, "dummy");
+	gs_app_set_management_plugin (app, plugin);
+
+	context = g_main_context_new ();
+	g_main_context_push_thread_default (context);
+
+	n_coalesced = gs_plugin_loader_get_n_coalesced_refines (plugin_loader);
+
+	/* an interactive refine isn’t coalesced with a non-interactive one */
+	plugin_job1 = gs_plugin_job_refine_new_for_app (app, GS_PLUGIN_REFINE_FLAGS_NONE,
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_URL);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job1, NULL,
+					    async_result_cb, &result1);
+	plugin_job2 = gs_plugin_job_refine_new_for_app (app, GS_PLUGIN_REFINE_FLAGS_INTERACTIVE,
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_URL);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job2, NULL,
+					    async_result_cb, &result2);
+
+	/* a coalesced refine stops waiting when it’s cancelled */
+	plugin_job3 = gs_plugin_job_refine_new_for_app (app, GS_PLUGIN_REFINE_FLAGS_NONE,
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_URL);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job3, cancellable,
+					    async_result_cb, &result3);
+	g_cancellable_cancel (cancellable);
+
+	while (result1 == NULL || result2 == NULL || result3 == NULL)
+		g_main_context_iteration (context, TRUE);
+
+	g_main_context_pop_thread_default (context);
+
+	gs_test_flush_main_context ();
+
+	gs_plugin_loader_job_process_finish (plugin_loader, result1, NULL, &local_error);
+	g_assert_no_error (local_error);
+	gs_plugin_loader_job_process_finish (plugin_loader, result2, NULL, &local_error);
+	g_assert_no_error (local_error);
+	g_assert_false (gs_plugin_loader_job_process_finish (plugin_loader, result3, NULL, &local_error));
+	g_assert_true (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED) ||
+		       g_error_matches (local_error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED));
+
+	/* only the third refine was coalesced, with the first */
+	g_assert_cmpuint (gs_plugin_loader_get_n_coalesced_refines (plugin_loader), ==, n_coalesced + 1);
+}
+
+static void
+gs_plugins_dummy_refine_batch_func (GsPluginLoader *plugin_loader)
+{
+	g_autoptr(GsApp) app1 = NULL;
+	g_autoptr(GsApp) app2 = NULL;
+	g_autoptr(GsPluginJob) plugin_job1 = NULL;
+	g_autoptr(GsPluginJob) plugin_job2 = NULL;
+	g_autoptr(GMainContext) context = NULL;
+	g_autoptr(GAsyncResult) result1 = NULL;
+	g_autoptr(GAsyncResult) result2 = NULL;
+	g_autoptr(GError) local_error = NULL;
+	guint n_batched;
+	GsPlugin *plugin;
+
+	plugin = gs_plugin_loader_find_plugin (plugin_loader, "dummy");
+	app1 = gs_app_new ("chiron.desktop");
+	gs_app_set_management_plugin (app1, plugin);
+	app2 = gs_app_new ("zeus.desktop");
+	gs_app_set_management_plugin (app2, plugin);
+
+	context = g_main_context_new ();
+	g_main_context_push_thread_default (context);
+
+	gs_plugin_loader_set_refine_batch_window (plugin_loader, 10);
+	n_batched = gs_plugin_loader_get_n_batched_refines (plugin_loader);
+
+	/* refine two different apps within the batching window */
+	plugin_job1 = gs_plugin_job_refine_new_for_app (app1, GS_PLUGIN_REFINE_FLAGS_NONE,
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE |
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_URL);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job1, NULL,
+					    async_result_cb, &result1);
+	plugin_job2 = gs_plugin_job_refine_new_for_app (app2, GS_PLUGIN_REFINE_FLAGS_NONE,
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE |
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_URL);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job2, NULL,
+					    async_result_cb, &result2);
+
+	while (result1 == NULL || result2 == NULL)
+		g_main_context_iteration (context, TRUE);
+
+	gs_plugin_loader_set_refine_batch_window (plugin_loader, 0);
+	g_main_context_pop_thread_default (context);
+
+	gs_test_flush_main_context ();
+
+	gs_plugin_loader_job_process_finish (plugin_loader, result1, NULL, &local_error);
+	g_assert_no_error (local_error);
+	gs_plugin_loader_job_process_finish (plugin_loader, result2, NULL, &local_error);
+	g_assert_no_error (local_error);
+
+	/* the second refine was run along with the first, and both got their data */
+	g_assert_cmpuint (gs_plugin_loader_get_n_batched_refines (plugin_loader), ==, n_batched + 1);
+	g_assert_cmpstr (gs_app_get_license (app1), ==, "GPL-2.0-or-later");
+	g_assert_cmpstr (gs_app_get_url (app1, AS_URL_KIND_HOMEPAGE), ==, "http://www.test.org/");
+	g_assert_cmpstr (gs_app_get_license (app2), ==, "GPL-2.0-or-later");
+}
+
+/* Two batched refines of different instances of apps with the same unique ID
+ * must each get their own instance refined. */
+static void
+gs_plugins_dummy_refine_batch_duplicate_ids_func (GsPluginLoader *plugin_loader)
+{
+	g_autoptr(GsApp) app1 = NULL;
+	g_autoptr(GsApp) app2 = NULL;
+	g_autoptr(GsPluginJob) plugin_job1 = NULL;
+	g_autoptr(GsPluginJob) plugin_job2 = NULL;
+	g_autoptr(GMainContext) context = NULL;
+	g_autoptr(GAsyncResult) result1 = NULL;
+	g_autoptr(GAsyncResult) result2 = NULL;
+	g_autoptr(GError) local_error = NULL;
+	guint n_batched;
+	GsPlugin *plugin;
+
+	plugin = gs_plugin_loader_find_plugin (plugin_loader, "dummy");
+	app1 = gs_app_new ("chiron.desktop");
+	gs_app_set_management_plugin (app1, plugin);
+	app2 = gs_app_new ("chiron.desktop");
+	gs_app_set_management_plugin (app2, plugin);
+	g_assert_true (app1 != app2);
+	g_assert_cmpstr (gs_app_get_unique_id (app1), ==, gs_app_get_unique_id (app2));
+
+	context = g_main_context_new ();
+	g_main_context_push_thread_default (context);
+
+	gs_plugin_loader_set_refine_batch_window (plugin_loader, 10);
+	n_batched = gs_plugin_loader_get_n_batched_refines (plugin_loader);
+
+	plugin_job1 = gs_plugin_job_refine_new_for_app (app1, GS_PLUGIN_REFINE_FLAGS_NONE,
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job1, NULL,
+					    async_result_cb, &result1);
+	plugin_job2 = gs_plugin_job_refine_new_for_app (app2, GS_PLUGIN_REFINE_FLAGS_NONE,
+							GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job2, NULL,
+					    async_result_cb, &result2);
+
+	while (result1 == NULL || result2 == NULL)
+		g_main_context_iteration (context, TRUE);
+
+	gs_plugin_loader_set_refine_batch_window (plugin_loader, 0);
+	g_main_context_pop_thread_default (context);
+
+	gs_test_flush_main_context ();
+
+	gs_plugin_loader_job_process_finish (plugin_loader, result1, NULL, &local_error);
+	g_assert_no_error (local_error);
+	gs_plugin_loader_job_process_finish (plugin_loader, result2, NULL, &local_error);
+	g_assert_no_error (local_error);
+
+	/* the refines were batched, and neither instance was dropped */
+	g_assert_cmpuint (gs_plugin_loader_get_n_batched_refines (plugin_loader), ==, n_batched + 1);
+	g_assert_cmpstr (gs_app_get_license (app1), ==, "GPL-2.0-or-later");
+	g_assert_cmpstr (gs_app_get_license (app2), ==, "GPL-2.0-or-later");
+}
+
+static XbSilo *
+refine_memo_build_silo_cb (GsSiloWrapper  *silo_wrapper,
+                           gboolean        interactive,
+                           gpointer        user_data,
+                           GCancellable   *cancellable,
+                           GError        **error)
+{
+	g_assert_not_reached ();
+	return NULL;
+}
+
+static void
+gs_plugins_dummy_refine_memo_func (GsPluginLoader *plugin_loader)
+{
+	gboolean ret;
+	g_autoptr(GsApp) app = NULL;
+	g_autoptr(GsApp) app2 = NULL;
+	g_autoptr(GsApp) shared_app = NULL;
+	g_autoptr(GsApp) fresh_app = NULL;
+	g_autoptr(GsAppList) list = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GsSiloWrapper) silo_wrapper = NULL;
+	GsPlugin *plugin;
+	guint generation;
+
+	/* refine an app, which records what was refined */
+	app = gs_app_new ("chiron.desktop");
+	plugin = gs_plugin_loader_find_plugin (plugin_loader, "dummy");
+	gs_app_set_management_plugin (app, plugin);
+	plugin_job = gs_plugin_job_refine_new_for_app (app,
+						       GS_PLUGIN_REFINE_FLAGS_NONE,
+						       GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE);
+	ret = gs_plugin_loader_job_process (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	generation = gs_plugin_loader_get_refine_generation (plugin_loader);
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, GS_PLUGIN_REFINE_FLAGS_NONE, generation) &
+			 GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE, !=, 0);
+
+	/* refining it again alongside an unrefined app only passes the
+	 * unrefined app to the plugins, so the license set here stays */
+	gs_app_set_license (app, GS_APP_QUALITY_HIGHEST, "LicenseRef-test");
+	app2 = gs_app_new ("zeus.desktop");
+	gs_app_set_management_plugin (app2, plugin);
+	list = gs_app_list_new ();
+	gs_app_list_add (list, app);
+	gs_app_list_add (list, app2);
+	g_clear_object (&plugin_job);
+	plugin_job = gs_plugin_job_refine_new (list,
+					       GS_PLUGIN_REFINE_FLAGS_NONE,
+					       GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE);
+	ret = gs_plugin_loader_job_process (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpstr (gs_app_get_license (app), ==, "LicenseRef-test");
+	g_assert_cmpstr (gs_app_get_license (app2), ==, "GPL-2.0-or-later");
+
+	/* different job flags can produce different results, so the app is
+	 * refined again for them */
+	g_clear_object (&plugin_job);
+	plugin_job = gs_plugin_job_refine_new_for_app (app,
+						       GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES,
+						       GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE);
+	ret = gs_plugin_loader_job_process (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpstr (gs_app_get_license (app), ==, "GPL-2.0-or-later");
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES, generation) &
+			 GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE, !=, 0);
+
+	/* the record lives on the instance, so a job which creates its own
+	 * instance of an already-refined app has it swapped for the shared
+	 * one, and doesn’t refine it again */
+	shared_app = gs_app_new ("memo.desktop");
+	gs_app_set_scope (shared_app, AS_COMPONENT_SCOPE_USER);
+	gs_app_set_bundle_kind (shared_app, AS_BUNDLE_KIND_FLATPAK);
+	gs_app_set_origin (shared_app, "dummy");
+	gs_app_set_branch (shared_app, "stable");
+	gs_app_set_management_plugin (shared_app, plugin);
+	gs_app_set_license (shared_app, GS_APP_QUALITY_HIGHEST, "LicenseRef-test");
+	gs_app_add_refined_require_flags (shared_app, GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE,
+					  GS_PLUGIN_REFINE_FLAGS_NONE, generation);
+	g_clear_object (&list);
+	list = gs_app_list_new ();
+	gs_app_list_add (list, shared_app);
+	gs_plugin_loader_share_apps (plugin_loader, list);
+	g_assert_true (gs_app_list_index (list, 0) == shared_app);
+
+	fresh_app = gs_app_new ("memo.desktop");
+	gs_app_set_unique_id (fresh_app, gs_app_get_unique_id (shared_app));
+	gs_app_set_management_plugin (fresh_app, plugin);
+	g_clear_object (&list);
+	list = gs_app_list_new ();
+	gs_app_list_add (list, fresh_app);
+	gs_plugin_loader_share_apps (plugin_loader, list);
+	g_assert_true (gs_app_list_index (list, 0) == shared_app);
+
+	g_clear_object (&plugin_job);
+	plugin_job = gs_plugin_job_refine_new (list,
+					       GS_PLUGIN_REFINE_FLAGS_NONE,
+					       GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE);
+	ret = gs_plugin_loader_job_process (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpstr (gs_app_get_license (shared_app), ==, "LicenseRef-test");
+
+	/* invalidating any silo makes the refined data stale */
+	silo_wrapper = gs_silo_wrapper_new (refine_memo_build_silo_cb, NULL, NULL);
+	gs_silo_wrapper_invalidate (silo_wrapper);
+
+	g_assert_cmpuint (gs_plugin_loader_get_refine_generation (plugin_loader), !=, generation);
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES,
+							   gs_plugin_loader_get_refine_generation (plugin_loader)),
+			 ==, GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
+}
+
+static void
+gs_plugins_dummy_refine_deadline_func (GsPluginLoader *plugin_loader)
+{
+	g_autoptr(GsApp) app = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GAsyncResult) result = NULL;
+	GsPlugin *plugin;
+	gint64 begin_time;
+
+	/* the dummy plugin hangs for 5 seconds when refining this app, unless
+	 * cancelled */
+	app = gs_app_new ("hang.desktop");
+	plugin = gs_plugin_loader_find_plugin (plugin_loader, "dummy");
+	gs_app_set_management_plugin (app, plugin);
+	plugin_job = gs_plugin_job_refine_new_for_app (app,
+						       GS_PLUGIN_REFINE_FLAGS_NONE,
+						       GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE);
+	gs_plugin_job_set_plugin_timeout (plugin_job, 100);
+
+	/* run in the global default main context, which carries on being
+	 * iterated after the job has returned, so the late plugin call can
+	 * finish and trigger the retry */
+	begin_time = g_get_monotonic_time ();
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job, NULL,
+					    async_result_cb, &result);
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+	g_assert_true (gs_plugin_loader_job_process_finish (plugin_loader, result, NULL, &error));
+	g_assert_no_error (error);
+
+	/* the refine carried on without the plugin, and didn’t record the
+	 * license as refined, so it will be tried again next time */
+	g_assert_cmpint (g_get_monotonic_time () - begin_time, <, 4 * G_USEC_PER_SEC);
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, GS_PLUGIN_REFINE_FLAGS_NONE,
+							   gs_plugin_loader_get_refine_generation (plugin_loader)) &
+			 GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE, ==, 0);
+
+	/* the plugin call was cancelled at its deadline, and once it returned
+	 * the app was refined again in the background, without a timeout */
+	while ((gs_app_get_refined_require_flags (app, GS_PLUGIN_REFINE_FLAGS_NONE,
+						  gs_plugin_loader_get_refine_generation (plugin_loader)) &
+		GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE) == 0)
+		g_main_context_iteration (NULL, TRUE);
+	gs_test_flush_main_context ();
+}
+
+static void
+gs_plugins_dummy_search_deadline_func (GsPluginLoader *plugin_loader)
+{
+	g_autoptr(GError) error = NULL;
+	GsAppList *list;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GsAppQuery) query = NULL;
+	const gchar *keywords[2] = { NULL, };
+	gint64 begin_time;
+
+	/* the dummy plugin hangs for 5 seconds when searching for this */
+	keywords[0] = "hang";
+	query = gs_app_query_new ("keywords", keywords,
+				  "refine-require-flags", GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON,
+				  "dedupe-flags", GS_APP_QUERY_DEDUPE_FLAGS_DEFAULT,
+				  NULL);
+	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_NONE);
+	gs_plugin_job_set_plugin_timeout (plugin_job, 100);
+
+	begin_time = g_get_monotonic_time ();
+	gs_plugin_loader_job_process (plugin_loader, plugin_job, NULL, &error);
+	list = gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (plugin_job));
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_nonnull (list);
+
+	/* the results from the other plugins came back without waiting */
+	g_assert_cmpint (g_get_monotonic_time () - begin_time, <, 4 * G_USEC_PER_SEC);
+}
+
+static void
+gs_plugins_dummy_startup_snapshot_func (GsPluginLoader *plugin_loader)
+{
+	gboolean ret;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autofree gchar *snapshot_path = NULL;
+	g_autoptr(GFile) snapshot_file = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsAppQuery) query = NULL;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GsPluginJob) categories_job = NULL;
+	g_autoptr(GsPluginJob) startup_job = NULL;
+	g_autoptr(GsPluginJob) startup_categories_job = NULL;
+	g_autoptr(GsPluginLoader) startup_loader = NULL;
+	g_autoptr(GIcon) icon = NULL;
+	GsAppList *list;
+	GsAppList *startup_list;
+	GPtrArray *categories;
+	GPtrArray *startup_categories;
+	GsApp *app;
+
+	tmp_dir = g_dir_make_tmp ("gnome-software-snapshot-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	snapshot_path = g_build_filename (tmp_dir, "snapshot.gvariant", NULL);
+	snapshot_file = g_file_new_for_path (snapshot_path);
+
+	/* record the installed apps and category sizes; the loader has been
+	 * set up, so it records results rather than serving them */
+	gs_plugin_loader_set_snapshot_file (plugin_loader, snapshot_file);
+	g_assert_false (gs_plugin_loader_can_serve_snapshot (plugin_loader));
+
+	query = gs_app_query_new ("is-installed", GS_APP_QUERY_TRISTATE_TRUE,
+				  "refine-require-flags", GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON,
+				  "filter-func", filter_valid_cb,
+				  NULL);
+	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT);
+	ret = gs_plugin_loader_job_process (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	list = gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (plugin_job));
+	g_assert_cmpint (gs_app_list_length (list), ==, 1);
+
+	categories_job = gs_plugin_job_list_categories_new (GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE |
+							    GS_PLUGIN_REFINE_CATEGORIES_FLAGS_ALLOW_SNAPSHOT);
+	ret = gs_plugin_loader_job_process (plugin_loader, categories_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	categories = gs_plugin_job_list_categories_get_result_list (GS_PLUGIN_JOB_LIST_CATEGORIES (categories_job));
+	g_assert_nonnull (categories);
+
+	ret = gs_plugin_loader_save_snapshot (plugin_loader, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	gs_plugin_loader_set_snapshot_file (plugin_loader, NULL);
+
+	/* a loader which has not been set up answers the same jobs from the
+	 * snapshot, rather than waiting for setup */
+	startup_loader = gs_plugin_loader_new (NULL, NULL);
+	gs_plugin_loader_set_snapshot_file (startup_loader, snapshot_file);
+	g_assert_true (gs_plugin_loader_can_serve_snapshot (startup_loader));
+
+	startup_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT);
+	ret = gs_plugin_loader_job_process (startup_loader, startup_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	startup_list = gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (startup_job));
+	g_assert_cmpint (gs_app_list_length (startup_list), ==, 1);
+
+	app = gs_app_list_index (startup_list, 0);
+	g_assert_cmpstr (gs_app_get_unique_id (app), ==, gs_app_get_unique_id (gs_app_list_index (list, 0)));
+	g_assert_cmpstr (gs_app_get_name (app), ==, "Zeus");
+	g_assert_cmpint (gs_app_get_state (app), ==, GS_APP_STATE_INSTALLED);
+	icon = gs_app_get_icon_for_size (app, 48, 1, NULL);
+	g_assert_nonnull (icon);
+	g_assert_true (G_IS_THEMED_ICON (icon));
+
+	/* the app still needs refining properly */
+	g_assert_cmpint (gs_app_get_refined_require_flags (app, GS_PLUGIN_REFINE_FLAGS_NONE,
+							   gs_plugin_loader_get_refine_generation (startup_loader)),
+			 ==, GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
+
+	startup_categories_job = gs_plugin_job_list_categories_new (GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE |
+								    GS_PLUGIN_REFINE_CATEGORIES_FLAGS_ALLOW_SNAPSHOT);
+	ret = gs_plugin_loader_job_process (startup_loader, startup_categories_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	startup_categories = gs_plugin_job_list_categories_get_result_list (GS_PLUGIN_JOB_LIST_CATEGORIES (startup_categories_job));
+	g_assert_cmpuint (startup_categories->len, ==, categories->len);
+
+	for (guint i = 0; i < categories->len; i++) {
+		GsCategory *category = g_ptr_array_index (categories, i);
+		GsCategory *startup_category = g_ptr_array_index (startup_categories, i);
+
+		g_assert_cmpstr (gs_category_get_id (startup_category), ==, gs_category_get_id (category));
+		g_assert_cmpuint (gs_category_get_size (startup_category), ==, gs_category_get_size (category));
+	}
+
+	gs_utils_rmtree (tmp_dir, NULL);
+}
+
 static void
 gs_plugins_dummy_app_size_calc_func (GsPluginLoader *loader)
 {
@@ -898,6 +1624,12 @@ main (int argc, char **argv)
 	g_test_add_data_func ("/gnome-software/plugins/dummy/search",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_dummy_search_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/search-two-phase",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_search_two_phase_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/search-stream",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_search_stream_func);
 	g_test_add_data_func ("/gnome-software/plugins/dummy/search-alternate",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_dummy_search_alternate_func);
@@ -910,6 +1642,9 @@ main (int argc, char **argv)
 	g_test_add_data_func ("/gnome-software/plugins/dummy/error",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_dummy_error_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/event-rate-limit",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_event_rate_limit_func);
 	g_test_add_data_func ("/gnome-software/plugins/dummy/installed",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_dummy_installed_func);
@@ -928,6 +1663,30 @@ main (int argc, char **argv)
 	g_test_add_data_func ("/gnome-software/plugins/dummy/limit-parallel-ops",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_dummy_limit_parallel_ops_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/refine-coalesce",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_refine_coalesce_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/refine-coalesce-flags",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_refine_coalesce_flags_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/refine-batch",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_refine_batch_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/refine-batch-duplicate-ids",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_refine_batch_duplicate_ids_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/refine-memo",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_refine_memo_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/refine-deadline",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_refine_deadline_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/search-deadline",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_search_deadline_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/startup-snapshot",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_startup_snapshot_func);
 	g_test_add_data_func ("/gnome-software/plugins/dummy/app-size-calc",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_dummy_app_size_calc_func);
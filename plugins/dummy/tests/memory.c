@@ -0,0 +1,273 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/* Memory regression tests. Each one runs a scenario and checks the peak
+ * resident memory while it runs, and the resident memory and the number of
+ * live #GsApp and #XbSilo instances once its results are dropped and the
+ * caches cleared, against a budget.
+ *
+ * The budgets can be changed with these environment variables:
+ *  - `GS_TEST_MEMORY_MAX_PEAK_RSS_MB` (default 256)
+ *  - `GS_TEST_MEMORY_MAX_STEADY_RSS_MB` (default 160)
+ *  - `GS_TEST_MEMORY_MAX_LEAKED_APPS`: more #GsApp instances alive after a
+ *    scenario than before it (default 16)
+ *  - `GS_TEST_MEMORY_MAX_SILOS` (default 2)
+ * and the size of the catalog with `GS_TEST_MEMORY_N_COMPONENTS` (default
+ * 5000).
+ */
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+#include <locale.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "gnome-software-private.h"
+
+#include "gs-test.h"
+
+static const gchar * const allowlist[] = {
+	"appstream",
+	"dummy",
+	"generic-updates",
+	NULL
+};
+
+typedef struct {
+	GsPluginLoader *plugin_loader;  /* (owned) */
+	gchar *cache_dir;  /* (owned) */
+} Fixture;
+
+typedef void (*ScenarioFunc) (Fixture *fixture);
+
+/* Reads a value in kB, like `VmRSS`, from /proc/self/status. */
+static gboolean
+get_status_kb (const gchar *key,
+               guint64     *value_out)
+{
+	g_autofree gchar *status = NULL;
+	g_auto(GStrv) lines = NULL;
+	gsize key_len = strlen (key);
+
+	if (!g_file_get_contents ("/proc/self/status", &status, NULL, NULL))
+		return FALSE;
+
+	lines = g_strsplit (status, "\n", -1);
+	for (gsize i = 0; lines[i] != NULL; i++) {
+		if (strncmp (lines[i], key, key_len) == 0 && lines[i][key_len] == ':') {
+			*value_out = g_ascii_strtoull (lines[i] + key_len + 1, NULL, 10);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* Resets the peak RSS reported as `VmHWM` to the current RSS. */
+static gboolean
+reset_peak_rss (void)
+{
+	return g_file_set_contents ("/proc/self/clear_refs", "5", -1, NULL);
+}
+
+/* Drops everything which is only cached, so what is left is what a
+ * long-running process would keep around. */
+static void
+drop_caches (Fixture *fixture)
+{
+	gs_plugin_loader_clear_caches (fixture->plugin_loader);
+	gs_test_flush_main_context ();
+#ifdef __GLIBC__
+	malloc_trim (0);
+#endif
+}
+
+static void
+run_scenario (Fixture      *fixture,
+              ScenarioFunc  func)
+{
+	guint64 rss_before_kb, peak_kb, steady_kb;
+	guint n_apps_before, n_apps_after, n_silos;
+
+	drop_caches (fixture);
+
+	if (!get_status_kb ("VmRSS", &rss_before_kb) || !reset_peak_rss ()) {
+		g_test_skip ("Resident memory can’t be measured on this system");
+		return;
+	}
+	n_apps_before = gs_app_get_n_alive ();
+
+	func (fixture);
+
+	g_assert_true (get_status_kb ("VmHWM", &peak_kb));
+
+	drop_caches (fixture);
+
+	g_assert_true (get_status_kb ("VmRSS", &steady_kb));
+	n_apps_after = gs_app_get_n_alive ();
+	n_silos = gs_silo_wrapper_get_n_loaded_silos ();
+
+	g_test_message ("RSS before: %" G_GUINT64_FORMAT " kB, peak: %" G_GUINT64_FORMAT " kB, "
+			"steady: %" G_GUINT64_FORMAT " kB; GsApps before: %u, after: %u; "
+			"silos: %u (%" G_GSIZE_FORMAT " kB)",
+			rss_before_kb, peak_kb, steady_kb,
+			n_apps_before, n_apps_after,
+			n_silos, gs_silo_wrapper_get_loaded_silos_size () / 1024);
+
+	g_assert_cmpuint (peak_kb, <=, gs_test_get_env_uint ("GS_TEST_MEMORY_MAX_PEAK_RSS_MB", 0, 256) * 1024);
+	g_assert_cmpuint (steady_kb, <=, gs_test_get_env_uint ("GS_TEST_MEMORY_MAX_STEADY_RSS_MB", 0, 160) * 1024);
+	g_assert_cmpuint (n_apps_after, <=, n_apps_before + gs_test_get_env_uint ("GS_TEST_MEMORY_MAX_LEAKED_APPS", 0, 16));
+	g_assert_cmpuint (n_silos, <=, gs_test_get_env_uint ("GS_TEST_MEMORY_MAX_SILOS", 0, 2));
+}
+
+/* Rebuilds the appstream silo from scratch and uses it, as after a
+ * metadata refresh. */
+static void
+scenario_load_catalog (Fixture *fixture)
+{
+	const gchar * const keywords[] = { "editor", NULL };
+	g_autoptr(GsAppQuery) query = NULL;
+	g_autoptr(GsPluginJob) search_job = NULL;
+	g_autoptr(GsPluginJob) categories_job = NULL;
+	g_autoptr(GError) error = NULL;
+
+	gs_utils_rmtree (fixture->cache_dir, NULL);
+	g_mkdir_with_parents (fixture->cache_dir, 0700);
+	gs_test_reinitialise_plugin_loader (fixture->plugin_loader, allowlist, NULL);
+
+	categories_job = gs_plugin_job_list_categories_new (GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE);
+	gs_plugin_loader_job_process (fixture->plugin_loader, categories_job, NULL, &error);
+	g_assert_no_error (error);
+
+	query = gs_app_query_new ("keywords", keywords,
+				  "refine-require-flags", GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON,
+				  "dedupe-flags", GS_APP_QUERY_DEDUPE_FLAGS_DEFAULT,
+				  NULL);
+	search_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_NONE);
+	gs_plugin_loader_job_process (fixture->plugin_loader, search_job, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (gs_app_list_length (gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (search_job))), >, 0);
+}
+
+static void
+scenario_installed (Fixture *fixture)
+{
+	g_autoptr(GsAppQuery) query = NULL;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GError) error = NULL;
+
+	query = gs_app_query_new ("is-installed", GS_APP_QUERY_TRISTATE_TRUE,
+				  "refine-require-flags", GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON |
+							  GS_PLUGIN_REFINE_REQUIRE_FLAGS_SIZE |
+							  GS_PLUGIN_REFINE_REQUIRE_FLAGS_ORIGIN,
+				  "dedupe-flags", GS_APP_QUERY_DEDUPE_FLAGS_DEFAULT,
+				  NULL);
+	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_NONE);
+	gs_plugin_loader_job_process (fixture->plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+}
+
+/* Lists the updates, as the updates page does after a refresh. The refresh
+ * itself is left out, as the dummy plugin only sleeps for it. */
+static void
+scenario_updates (Fixture *fixture)
+{
+	g_autoptr(GsAppQuery) query = NULL;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GError) error = NULL;
+
+	query = gs_app_query_new ("is-for-update", GS_APP_QUERY_TRISTATE_TRUE,
+				  "refine-require-flags", GS_PLUGIN_REFINE_REQUIRE_FLAGS_ICON |
+							  GS_PLUGIN_REFINE_REQUIRE_FLAGS_UPDATE_DETAILS,
+				  NULL);
+	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_NONE);
+	gs_plugin_loader_job_process (fixture->plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_cmpuint (gs_app_list_length (gs_plugin_job_list_apps_get_result_list (GS_PLUGIN_JOB_LIST_APPS (plugin_job))), >, 0);
+}
+
+static void
+gs_plugins_dummy_memory_load_catalog_func (gconstpointer test_data)
+{
+	run_scenario ((Fixture *) test_data, scenario_load_catalog);
+}
+
+static void
+gs_plugins_dummy_memory_installed_func (gconstpointer test_data)
+{
+	run_scenario ((Fixture *) test_data, scenario_installed);
+}
+
+static void
+gs_plugins_dummy_memory_updates_func (gconstpointer test_data)
+{
+	run_scenario ((Fixture *) test_data, scenario_updates);
+}
+
+int
+main (int argc, char **argv)
+{
+	Fixture fixture = { 0, };
+	g_autofree gchar *tmp_root = NULL;
+	g_autofree gchar *xml = NULL;
+	g_autoptr(GError) error = NULL;
+	gboolean ret;
+	int retval;
+
+	/* While we use %G_TEST_OPTION_ISOLATE_DIRS to create temporary directories
+	 * for each of the tests, we want to use the system MIME registry, assuming
+	 * that it exists and correctly has shared-mime-info installed. */
+	g_content_type_set_mime_dirs (NULL);
+
+	gs_test_init (&argc, &argv);
+
+	/* set all the things required as a dummy test harness */
+	setlocale (LC_MESSAGES, "en_GB.UTF-8");
+	g_setenv ("GS_TEST_DUMMY_ENABLE", "1", TRUE);
+
+	/* Use a cache directory which can be emptied to force a silo rebuild. */
+	tmp_root = g_dir_make_tmp ("gnome-software-memory-test-XXXXXX", NULL);
+	g_assert_nonnull (tmp_root);
+	fixture.cache_dir = g_build_filename (tmp_root, "cache", NULL);
+	g_setenv ("GS_TEST_CACHEDIR", fixture.cache_dir, TRUE);
+
+	xml = gs_test_generate_appstream_xml (gs_test_get_env_uint ("GS_TEST_MEMORY_N_COMPONENTS", 1, 5000), 4, 1);
+	g_setenv ("GS_TEST_APPSTREAM_XML", xml, TRUE);
+
+	fixture.plugin_loader = gs_plugin_loader_new (NULL, NULL);
+	gs_plugin_loader_add_location (fixture.plugin_loader, LOCALPLUGINDIR);
+	gs_plugin_loader_add_location (fixture.plugin_loader, LOCALPLUGINDIR_CORE);
+	ret = gs_plugin_loader_setup (fixture.plugin_loader,
+				      allowlist,
+				      NULL,
+				      NULL,
+				      &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (gs_plugin_loader_get_enabled (fixture.plugin_loader, "appstream"));
+	g_assert_true (gs_plugin_loader_get_enabled (fixture.plugin_loader, "dummy"));
+
+	g_test_add_data_func ("/gnome-software/plugins/dummy/memory/load-catalog",
+			      &fixture, gs_plugins_dummy_memory_load_catalog_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/memory/installed",
+			      &fixture, gs_plugins_dummy_memory_installed_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/memory/updates",
+			      &fixture, gs_plugins_dummy_memory_updates_func);
+	retval = g_test_run ();
+
+	/* Clean up. */
+	g_clear_object (&fixture.plugin_loader);
+	g_free (fixture.cache_dir);
+	gs_utils_rmtree (tmp_root, NULL);
+
+	return retval;
+}
@@ -296,6 +296,9 @@ gs_plugin_epiphany_init (GsPluginEpiphany *self)
 
 	/* prioritize over packages */
 	gs_plugin_add_rule (GS_PLUGIN (self), GS_PLUGIN_RULE_BETTER_THAN, "packagekit");
+
+	/* web apps aren’t on the overview, so talking to epiphany can wait */
+	gs_plugin_set_setup_deferrable (GS_PLUGIN (self), TRUE);
 }
 
 static void
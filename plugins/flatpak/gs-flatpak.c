@@ -3441,9 +3441,16 @@ gs_flatpak_refine_wildcards (GsFlatpak *self,
 
 	for (guint i = 0; i < components_with_id->len; i++) {
 		XbNode *node = g_ptr_array_index (components_with_id, i);
-		XbNode *comp_node = xb_node_get_parent (node);
-		const gchar *comp_id = xb_node_get_text (node);
-		GPtrArray *comps = g_hash_table_lookup (components_by_id, comp_id);
+		XbNode *comp_node;
+		const gchar *comp_id;
+		GPtrArray *comps;
+
+		if (gs_utils_cancellation_checkpoint (cancellable, i, error))
+			return FALSE;
+
+		comp_node = xb_node_get_parent (node);
+		comp_id = xb_node_get_text (node);
+		comps = g_hash_table_lookup (components_by_id, comp_id);
 		if (comps == NULL) {
 			comps = g_ptr_array_new_with_free_func (g_object_unref);
 			g_hash_table_insert (components_by_id, g_strdup (comp_id), comps);
@@ -3455,9 +3462,16 @@ gs_flatpak_refine_wildcards (GsFlatpak *self,
 	bundles = xb_silo_query (silo, "/components/component/bundle[@type='flatpak']", 0, NULL);
 	for (guint b = 0; bundles != NULL && b < bundles->len; b++) {
 		XbNode *bundle_node = g_ptr_array_index (bundles, b);
-		g_autoptr(XbNode) component_node = xb_node_get_parent (bundle_node);
-		g_autoptr(XbNode) components_node = xb_node_get_parent (component_node);
-		const gchar *origin = xb_node_get_attr (components_node, "origin");
+		g_autoptr(XbNode) component_node = NULL;
+		g_autoptr(XbNode) components_node = NULL;
+		const gchar *origin;
+
+		if (gs_utils_cancellation_checkpoint (cancellable, b, error))
+			return FALSE;
+
+		component_node = xb_node_get_parent (bundle_node);
+		components_node = xb_node_get_parent (component_node);
+		origin = xb_node_get_attr (components_node, "origin");
 		if (origin != NULL) {
 			const gchar *bundle = xb_node_get_text (bundle_node);
 			if (bundle != NULL) {
@@ -3476,6 +3490,9 @@ gs_flatpak_refine_wildcards (GsFlatpak *self,
 		GPtrArray *components = NULL;
 		const gchar *id;
 
+		if (gs_utils_cancellation_checkpoint (cancellable, j, error))
+			return FALSE;
+
 		/* not enough info to find */
 		id = gs_app_get_id (app);
 		if (id == NULL)
@@ -150,7 +150,7 @@ notify_cpu_priority_cb (GObject    *obj,
 		gs_worker_thread_update_cpu_priority (self->long_running_worker, connection, cpu_priority);
 }
 
-/* Run in @worker. */
+/* Run in @long_running_worker. */
 static void
 gs_plugin_flatpak_purge_thread_cb (GTask        *task,
 				   gpointer      source_object,
@@ -171,6 +171,9 @@ gs_plugin_flatpak_purge_thread_cb (GTask        *task,
 			g_debug ("Failed to purge unused refs at '%s': %s",
 				 gs_flatpak_get_id (flatpak), local_error->message);
 		}
+
+		/* let any interactive installs jump ahead between installations */
+		gs_worker_thread_yield (self->long_running_worker);
 	}
 
 	g_task_return_boolean (task, TRUE);
@@ -558,6 +561,18 @@ event_callback_invoke_take (GsPluginFlatpak       *plugin,
 				    event_callback_idle_cb, g_steal_pointer (&event_data), (GDestroyNotify) event_callback_data_free);
 }
 
+typedef struct {
+	GsPluginRefreshMetadataData *data;  /* (owned) */
+	guint installation_index;  /* next installation to refresh */
+} RefreshMetadataData;
+
+static void
+refresh_metadata_data_free (RefreshMetadataData *data)
+{
+	gs_plugin_refresh_metadata_data_free (data->data);
+	g_free (data);
+}
+
 static void refresh_metadata_thread_cb (GTask        *task,
                                         gpointer      source_object,
                                         gpointer      task_data,
@@ -577,16 +592,27 @@ gs_plugin_flatpak_refresh_metadata_async (GsPlugin                     *plugin,
 	g_autoptr(GTask) task = NULL;
 	gboolean interactive = (flags & GS_PLUGIN_REFRESH_METADATA_FLAGS_INTERACTIVE);
 
+	RefreshMetadataData *data;
+
 	task = g_task_new (plugin, cancellable, callback, user_data);
 	g_task_set_source_tag (task, gs_plugin_flatpak_refresh_metadata_async);
-	g_task_set_task_data (task, gs_plugin_refresh_metadata_data_new (cache_age_secs, flags, event_callback, event_user_data), (GDestroyNotify) gs_plugin_refresh_metadata_data_free);
 
-	/* Queue a job to get the installed apps. */
+	data = g_new0 (RefreshMetadataData, 1);
+	data->data = gs_plugin_refresh_metadata_data_new (cache_age_secs, flags, event_callback, event_user_data);
+	g_task_set_task_data (task, data, (GDestroyNotify) refresh_metadata_data_free);
+
+	/* Queue a job to refresh the first installation. */
 	gs_worker_thread_queue (self->worker, get_priority_for_interactivity (interactive),
 				refresh_metadata_thread_cb, g_steal_pointer (&task));
 }
 
-/* Run in @worker. */
+/* Run in @worker.
+ *
+ * Each installation is refreshed by a separate task, which queues the task for
+ * the next one, so that any more urgent refines or searches queued meanwhile
+ * run between installations rather than behind the whole refresh. Unlike
+ * calling gs_worker_thread_yield() here, this can’t start another refresh
+ * while this one is part way through. */
 static void
 refresh_metadata_thread_cb (GTask        *task,
                             gpointer      source_object,
@@ -594,23 +620,27 @@ refresh_metadata_thread_cb (GTask        *task,
                             GCancellable *cancellable)
 {
 	GsPluginFlatpak *self = GS_PLUGIN_FLATPAK (source_object);
-	GsPluginRefreshMetadataData *data = task_data;
-	gboolean interactive = (data->flags & GS_PLUGIN_REFRESH_METADATA_FLAGS_INTERACTIVE);
+	RefreshMetadataData *data = task_data;
+	gboolean interactive = (data->data->flags & GS_PLUGIN_REFRESH_METADATA_FLAGS_INTERACTIVE);
+	g_autoptr(GError) local_error = NULL;
+	GsFlatpak *flatpak;
 
 	assert_in_worker (self);
 
-	for (guint i = 0; i < self->installations->len; i++) {
-		g_autoptr(GError) local_error = NULL;
-		GsFlatpak *flatpak = g_ptr_array_index (self->installations, i);
+	if (data->installation_index >= self->installations->len) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
 
-		if (!self->has_system_helper && gs_flatpak_get_scope (flatpak) == AS_COMPONENT_SCOPE_SYSTEM)
-			continue;
+	flatpak = g_ptr_array_index (self->installations, data->installation_index);
+	data->installation_index++;
 
-		if (!gs_flatpak_refresh (flatpak, data->cache_age_secs, interactive, data->event_callback, data->event_user_data, cancellable, &local_error))
-			g_debug ("Failed to refresh metadata for '%s': %s", gs_flatpak_get_id (flatpak), local_error->message);
-	}
+	if ((self->has_system_helper || gs_flatpak_get_scope (flatpak) != AS_COMPONENT_SCOPE_SYSTEM) &&
+	    !gs_flatpak_refresh (flatpak, data->data->cache_age_secs, interactive, data->data->event_callback, data->data->event_user_data, cancellable, &local_error))
+		g_debug ("Failed to refresh metadata for '%s': %s", gs_flatpak_get_id (flatpak), local_error->message);
 
-	g_task_return_boolean (task, TRUE);
+	gs_worker_thread_queue (self->worker, get_priority_for_interactivity (interactive),
+				refresh_metadata_thread_cb, g_object_ref (task));
 }
 
 static gboolean
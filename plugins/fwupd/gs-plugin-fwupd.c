@@ -127,6 +127,10 @@ static void
 gs_plugin_fwupd_init (GsPluginFwupd *self)
 {
 	self->client = fwupd_client_new ();
+
+	/* firmware isn’t shown until the updates page is, so connecting to
+	 * fwupd can wait */
+	gs_plugin_set_setup_deferrable (GS_PLUGIN (self), TRUE);
 }
 
 static void
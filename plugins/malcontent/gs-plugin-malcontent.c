@@ -274,6 +274,13 @@ gs_plugin_malcontent_init (GsPluginMalcontent *self)
 	/* need application IDs and content ratings */
 	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_AFTER, "appstream");
 	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_AFTER, "flatpak");
+
+	/* the app ID, kind and content rating are read, and only quirks are
+	 * added */
+	gs_plugin_set_refine_dependencies (plugin,
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_ID |
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_CONTENT_RATING,
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_NONE);
 }
 
 static void get_app_filter_cb (GObject      *source_object,
@@ -212,6 +212,10 @@ gs_plugin_packagekit_init (GsPluginPackagekit *self)
 
 	/* generic updates happen after PackageKit offline updates */
 	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_BEFORE, "generic-updates");
+
+	/* refine dependencies are deliberately not declared: resolving packages
+	 * sets the state and management plugin of apps, which the declarations
+	 * can’t express, so this has to stay in order with the other plugins */
 }
 
 static void
@@ -75,6 +75,12 @@ gs_plugin_repos_init (GsPluginRepos *self)
 
 	/* need pkgname */
 	gs_plugin_add_rule (GS_PLUGIN (self), GS_PLUGIN_RULE_RUN_AFTER, "appstream");
+
+	gs_plugin_set_refine_dependencies (GS_PLUGIN (self),
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_ID |
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_ORIGIN,
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_ORIGIN_HOSTNAME |
+					   GS_PLUGIN_REFINE_REQUIRE_FLAGS_URL);
 }
 
 static void
@@ -1159,6 +1159,9 @@ gs_plugin_systemd_sysupdate_init (GsPluginSystemdSysupdate *self)
 	self->job_task_map = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_object_unref);
 	self->job_to_remove_status_map = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify)NULL);
 	self->job_to_cancel_task_map = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_object_unref);
+
+	/* only needed for updates, so don’t hold up startup */
+	gs_plugin_set_setup_deferrable (GS_PLUGIN (self), TRUE);
 }
 
 static void
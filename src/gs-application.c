@@ -24,6 +24,7 @@
 #include "gs-common.h"
 #include "gs-debug.h"
 #include "gs-ioprio.h"
+#include "gs-page-benchmark.h"
 #include "gs-shell.h"
 #include "gs-update-monitor.h"
 #include "gs-shell-search-provider.h"
@@ -53,6 +54,11 @@ struct _GsApplication {
 	gulong		 plugin_loader_notify_system_bus_connection_handler_id;
 	GsDebug		*debug;  /* (owned) (not nullable) */
 	gboolean	 restart_requested;
+	gboolean	 dump_startup_timeline;
+	gboolean	 benchmark_pages;
+	GsPageBenchmark	*page_benchmark;  /* (owned) (nullable) */
+	gboolean	 first_frame_marked;
+	guint		 debug_registration_id;
 
 	/* Created/freed on demand */
 	GHashTable *withdraw_notifications; /* gchar *notification_id ~> GUINT_TO_POINTER (timeout_id) */
@@ -162,12 +168,63 @@ gs_application_init (GsApplication *application)
 		  _("Prefer local file sources to AppStream"), NULL },
 		{ "version", 0, 0, G_OPTION_ARG_NONE, NULL,
 		  _("Show version number"), NULL },
+		{ "dump-startup-timeline", 0, 0, G_OPTION_ARG_NONE, NULL,
+		  _("Print where the startup time went once the window is shown, then quit"), NULL },
+		{ "benchmark-pages", 0, 0, G_OPTION_ARG_NONE, NULL,
+		  _("Measure frame times while loading each page, print them, then quit"), NULL },
 		{ NULL }
 	};
 
 	g_application_add_main_option_entries (G_APPLICATION (application), options);
 }
 
+/* A small interface for inspecting the running instance, for example with
+ * `gdbus call --session --dest org.gnome.Software --object-path
+ * /org/gnome/Software --method org.gnome.Software.Debug.GetLatencyStats` */
+static const gchar debug_introspection_xml[] =
+	"<node>"
+	"  <interface name='org.gnome.Software.Debug'>"
+	"    <method name='GetLatencyStats'>"
+	"      <arg type='a(ssttttt)' name='stats' direction='out'/>"
+	"    </method>"
+	"  </interface>"
+	"</node>";
+
+static void
+gs_application_debug_method_call_cb (GDBusConnection       *connection,
+                                     const gchar           *sender,
+                                     const gchar           *object_path,
+                                     const gchar           *interface_name,
+                                     const gchar           *method_name,
+                                     GVariant              *parameters,
+                                     GDBusMethodInvocation *invocation,
+                                     gpointer               user_data)
+{
+	GsApplication *app = GS_APPLICATION (user_data);
+
+	if (g_strcmp0 (method_name, "GetLatencyStats") == 0) {
+		if (app->plugin_loader == NULL) {
+			g_dbus_method_invocation_return_error_literal (invocation, G_DBUS_ERROR,
+								       G_DBUS_ERROR_FAILED,
+								       "Plugins not loaded yet");
+			return;
+		}
+
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(@a(ssttttt))",
+								      gs_plugin_loader_get_latency_stats (app->plugin_loader)));
+		return;
+	}
+
+	g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+					       G_DBUS_ERROR_UNKNOWN_METHOD,
+					       "Unknown method %s", method_name);
+}
+
+static const GDBusInterfaceVTable debug_vtable = {
+	.method_call = gs_application_debug_method_call_cb,
+};
+
 static gboolean
 gs_application_dbus_register (GApplication    *application,
                               GDBusConnection *connection,
@@ -175,8 +232,21 @@ gs_application_dbus_register (GApplication    *application,
                               GError         **error)
 {
 	GsApplication *app = GS_APPLICATION (application);
+	g_autoptr(GDBusNodeInfo) debug_info = NULL;
+
 	app->search_provider = gs_shell_search_provider_new ();
 	app->offline_updates_provider = gs_software_offline_updates_provider_new ();
+
+	debug_info = g_dbus_node_info_new_for_xml (debug_introspection_xml, error);
+	if (debug_info == NULL)
+		return FALSE;
+	app->debug_registration_id = g_dbus_connection_register_object (connection, object_path,
+									debug_info->interfaces[0],
+									&debug_vtable, app, NULL,
+									error);
+	if (app->debug_registration_id == 0)
+		return FALSE;
+
 	return gs_shell_search_provider_register (app->search_provider, connection, error) &&
 	       gs_software_offline_updates_provider_register (app->offline_updates_provider, connection, error);
 }
@@ -188,6 +258,10 @@ gs_application_dbus_unregister (GApplication    *application,
 {
 	GsApplication *app = GS_APPLICATION (application);
 
+	if (app->debug_registration_id != 0) {
+		g_dbus_connection_unregister_object (connection, app->debug_registration_id);
+		app->debug_registration_id = 0;
+	}
 	if (app->search_provider != NULL)
 		gs_shell_search_provider_unregister (app->search_provider);
 	if (app->offline_updates_provider != NULL)
@@ -202,6 +276,8 @@ gs_application_shutdown (GApplication *application)
 	g_cancellable_cancel (app->cancellable);
 	g_clear_object (&app->cancellable);
 
+	g_clear_object (&app->page_benchmark);
+
 	g_clear_signal_handler (&app->shell_notify_visible_handler_id, app->shell);
 	g_clear_object (&app->shell);
 
@@ -214,6 +290,12 @@ gs_application_shell_loaded_cb (GsShell *shell, GsApplication *app)
 	g_signal_handler_disconnect (app->shell, app->shell_loaded_handler_id);
 	app->shell_loaded_handler_id = 0;
 
+	gs_startup_timeline_mark ("shell-loaded");
+
+	/* make sure there’s a frame to end the startup timeline with */
+	if (app->first_frame_marked && gs_startup_timeline_is_recording ())
+		gtk_widget_queue_draw (GTK_WIDGET (app->shell));
+
 	/* Check if we need to restore the window after a restart */
 	if (gs_shell_get_and_clear_restore_after_restart (app->shell))
 		g_application_activate (G_APPLICATION (app));
@@ -316,6 +398,72 @@ gs_application_window_removed (GtkApplication *application,
 	gs_application_update_priority (GS_APPLICATION (application));
 }
 
+static void
+gs_application_page_benchmark_cb (GObject      *source_object,
+                                  GAsyncResult *result,
+                                  gpointer      user_data)
+{
+	GsApplication *self = GS_APPLICATION (user_data);
+	g_autofree gchar *report = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	report = gs_page_benchmark_run_finish (GS_PAGE_BENCHMARK (source_object), result, &local_error);
+	if (report == NULL)
+		g_printerr ("%s\n", local_error->message);
+	else
+		g_print ("%s", report);
+
+	g_application_quit (G_APPLICATION (self));
+}
+
+/* Runs after each frame is painted, until the first one after the shell has
+ * loaded, which is where the startup timeline ends. */
+static void
+gs_application_after_paint_cb (GdkFrameClock *frame_clock,
+                               void          *user_data)
+{
+	GsApplication *self = GS_APPLICATION (user_data);
+	g_autofree gchar *timeline = NULL;
+
+	if (!self->first_frame_marked) {
+		gs_startup_timeline_mark ("first-frame");
+		self->first_frame_marked = TRUE;
+	}
+
+	if (!gs_application_is_shell_loaded (self))
+		return;
+
+	g_signal_handlers_disconnect_by_func (frame_clock, gs_application_after_paint_cb, self);
+
+	gs_startup_timeline_mark ("first-loaded-frame");
+	gs_startup_timeline_stop ();
+
+	timeline = gs_startup_timeline_to_string ();
+	g_debug ("startup timeline:\n%s", timeline);
+
+	if (self->dump_startup_timeline) {
+		g_print ("%s", timeline);
+		g_application_quit (G_APPLICATION (self));
+	} else if (self->benchmark_pages && self->page_benchmark == NULL) {
+		self->page_benchmark = gs_page_benchmark_new (self->shell, self->plugin_loader);
+		gs_page_benchmark_run_async (self->page_benchmark, self->cancellable,
+					     gs_application_page_benchmark_cb, self);
+	}
+}
+
+static gboolean
+gs_application_first_tick_cb (GtkWidget     *widget,
+                              GdkFrameClock *frame_clock,
+                              void          *user_data)
+{
+	GsApplication *self = GS_APPLICATION (user_data);
+
+	g_signal_connect_object (frame_clock, "after-paint",
+				 G_CALLBACK (gs_application_after_paint_cb), self, 0);
+
+	return G_SOURCE_REMOVE;
+}
+
 static void
 gs_application_shell_notify_visible_cb (GObject    *object,
                                         GParamSpec *pspec,
@@ -324,6 +472,18 @@ gs_application_shell_notify_visible_cb (GObject    *object,
 	GsApplication *self = GS_APPLICATION (user_data);
 
 	gs_application_update_priority (self);
+
+	if (!gtk_widget_get_visible (GTK_WIDGET (object)))
+		return;
+
+	/* the plugins deferred at startup are needed once the window is up */
+	gs_plugin_loader_setup_deferred_plugins (self->plugin_loader);
+
+	/* the timeline runs until the window is first painted */
+	if (gs_startup_timeline_is_recording () && !self->first_frame_marked) {
+		gs_startup_timeline_mark ("window-shown");
+		gtk_widget_add_tick_callback (GTK_WIDGET (object), gs_application_first_tick_cb, self, NULL);
+	}
 }
 
 static void
@@ -1232,8 +1392,12 @@ gs_application_startup (GApplication *application)
 	GsApplication *app = GS_APPLICATION (application);
 	g_auto(GStrv) plugin_blocklist = NULL;
 	g_auto(GStrv) plugin_allowlist = NULL;
+	g_autofree gchar *snapshot_filename = NULL;
+	g_autoptr(GError) local_error = NULL;
 	const gchar *tmp;
 
+	gs_startup_timeline_mark ("application-startup");
+
 	G_APPLICATION_CLASS (gs_application_parent_class)->startup (application);
 
 	gs_application_add_wrapper_actions (application);
@@ -1254,6 +1418,27 @@ gs_application_startup (GApplication *application)
 	if (g_file_test (LOCALPLUGINDIR, G_FILE_TEST_EXISTS))
 		gs_plugin_loader_add_location (app->plugin_loader, LOCALPLUGINDIR);
 
+	/* pages refine their apps one at a time as their widgets are created,
+	 * so let the plugin loader pass those to the plugins together */
+	gs_plugin_loader_set_refine_batch_window (app->plugin_loader, 5);
+
+	/* plugins which aren’t needed for the first screen, or by the search
+	 * provider, are set up once the window is shown or a job needs them */
+	gs_plugin_loader_set_defer_setup (app->plugin_loader, TRUE);
+
+	/* answer the first overview and installed page jobs with the results
+	 * from the previous run while the plugins are set up */
+	snapshot_filename = gs_utils_get_cache_filename ("startup", "snapshot.gvariant",
+							 GS_UTILS_CACHE_FLAG_WRITEABLE |
+							 GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+							 &local_error);
+	if (snapshot_filename != NULL) {
+		g_autoptr(GFile) snapshot_file = g_file_new_for_path (snapshot_filename);
+		gs_plugin_loader_set_snapshot_file (app->plugin_loader, snapshot_file);
+	} else {
+		g_debug ("Not using a startup snapshot: %s", local_error->message);
+	}
+
 	gs_shell_search_provider_setup (app->search_provider, app->plugin_loader);
 	gs_software_offline_updates_provider_setup (app->offline_updates_provider, app->plugin_loader);
 
@@ -1306,6 +1491,11 @@ gs_application_startup (GApplication *application)
 				      NULL,
 				      startup_cb,
 				      app);
+
+	/* With a startup snapshot, the overview can be shown before the
+	 * plugins are set up, so don’t wait for them to set up the shell. */
+	if (gs_plugin_loader_can_serve_snapshot (app->plugin_loader))
+		gs_shell_setup (app->shell, app->plugin_loader, app->cancellable);
 }
 
 static void
@@ -1330,8 +1520,10 @@ startup_cb (GObject      *source_object,
 	app->update_monitor = gs_update_monitor_new (app, app->plugin_loader);
 
 	/* Setup the shell only after the plugin loader finished its setup,
-	   thus all plugins are loaded and ready for the jobs. */
-	gs_shell_setup (app->shell, app->plugin_loader, app->cancellable);
+	   thus all plugins are loaded and ready for the jobs, unless it was
+	   already set up to show the startup snapshot. */
+	if (!gs_shell_is_running (app->shell))
+		gs_shell_setup (app->shell, app->plugin_loader, app->cancellable);
 }
 
 static void
@@ -1463,6 +1655,24 @@ gs_application_handle_local_options (GApplication *app, GVariantDict *options)
 						NULL);
 	}
 
+	if (g_variant_dict_contains (options, "dump-startup-timeline")) {
+		/* the timeline is only meaningful for a cold start */
+		if (g_application_get_is_remote (app)) {
+			g_printerr ("%s\n", _("The startup timeline can only be dumped if Software is not already running"));
+			return 1;
+		}
+		GS_APPLICATION (app)->dump_startup_timeline = TRUE;
+	}
+
+	if (g_variant_dict_contains (options, "benchmark-pages")) {
+		/* the pages have to be loaded from scratch by this instance */
+		if (g_application_get_is_remote (app)) {
+			g_printerr ("%s\n", _("The pages can only be benchmarked if Software is not already running"));
+			return 1;
+		}
+		GS_APPLICATION (app)->benchmark_pages = TRUE;
+	}
+
 	if (g_variant_dict_contains (options, "autoupdate")) {
 		g_action_group_activate_action (G_ACTION_GROUP (app),
 						"autoupdate",
@@ -711,6 +711,7 @@ gs_category_page_load_category (GsCategoryPage *self)
 						   NULL);
 		featured_plugin_job = gs_plugin_job_list_apps_new (featured_query,
 								   GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE);
+		gs_plugin_job_set_plugin_timeout (featured_plugin_job, GS_PAGE_PLUGIN_TIMEOUT_MS);
 		gs_plugin_loader_job_process_async (self->plugin_loader,
 						    featured_plugin_job,
 						    self->cancellable,
@@ -732,6 +733,7 @@ gs_category_page_load_category (GsCategoryPage *self)
 				       NULL);
 	main_plugin_job = gs_plugin_job_list_apps_new (main_query,
 						       GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE);
+	gs_plugin_job_set_plugin_timeout (main_plugin_job, GS_PAGE_PLUGIN_TIMEOUT_MS);
 	gs_plugin_loader_job_process_async (self->plugin_loader,
 					    main_plugin_job,
 					    self->cancellable,
@@ -2169,6 +2169,7 @@ gs_details_page_load_stage1 (GsDetailsPage *self)
 
 	/* get extra details about the app */
 	plugin_job = gs_plugin_job_refine_new_for_app (self->app, GS_PLUGIN_REFINE_FLAGS_INTERACTIVE, GS_DETAILS_PAGE_REFINE_REQUIRE_FLAGS);
+	gs_plugin_job_set_plugin_timeout (plugin_job, GS_PAGE_PLUGIN_TIMEOUT_MS);
 	gs_plugin_loader_job_process_async (self->plugin_loader, plugin_job,
 					    self->cancellable,
 					    gs_details_page_load_stage1_cb,
@@ -518,7 +518,8 @@ gs_installed_page_load (GsInstalledPage *self)
 				  "refine-require-flags", gs_installed_page_get_refine_require_flags (self),
 				  "filter-func", filter_app_kinds_cb,
 				  NULL);
-	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE);
+	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE |
+						  GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT);
 	gs_plugin_loader_job_process_async (self->plugin_loader,
 					    plugin_job,
 					    self->cancellable,
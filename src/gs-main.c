@@ -28,6 +28,8 @@ main (int argc, char **argv)
 	g_autoptr(GsApplication) application = NULL;
 	g_autoptr(GsDebug) debug = NULL;
 
+	gs_startup_timeline_begin ();
+
 	setlocale (LC_ALL, "");
 
 	bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
@@ -45,6 +45,7 @@ struct _GsOverviewPage
 	gboolean		 loading_deployment_featured;
 	gboolean		 loading_recent;
 	gboolean		 loading_categories;
+	gboolean		 reload_pending;
 	gboolean		 empty;
 	gboolean		 featured_overwritten;
 	GHashTable		*category_hash;		/* id : GsCategory */
@@ -130,12 +131,18 @@ gs_overview_page_decrement_action_cnt (GsOverviewPage *self)
 
 	/* all done */
 	self->cache_valid = TRUE;
+	gs_startup_timeline_mark ("overview-loaded");
 	g_signal_emit (self, signals[SIGNAL_REFRESHED], 0);
 	self->loading_categories = FALSE;
 	self->loading_deployment_featured = FALSE;
 	self->loading_featured = FALSE;
 	self->loading_curated = FALSE;
 	self->loading_recent = FALSE;
+
+	if (self->reload_pending) {
+		self->reload_pending = FALSE;
+		gs_page_reload (GS_PAGE (self));
+	}
 }
 
 static void
@@ -325,6 +332,7 @@ gs_overview_page_get_featured_cb (GObject *source_object,
 
 	gtk_widget_set_visible (self->featured_carousel, gs_app_list_length (list) > 0);
 	gs_featured_carousel_set_apps (GS_FEATURED_CAROUSEL (self->featured_carousel), list);
+	gs_startup_timeline_mark ("overview-featured-apps");
 
 	self->empty = self->empty && (gs_app_list_length (list) == 0);
 
@@ -579,6 +587,7 @@ finish_verify_category_op (GetCategoriesData *op_data)
 						  NULL);
 
 			plugin_job = gs_plugin_job_list_apps_new (query, flags);
+			gs_plugin_job_set_plugin_timeout (plugin_job, GS_PAGE_PLUGIN_TIMEOUT_MS);
 
 			g_atomic_int_inc (&gather_apps_data->n_pending);
 
@@ -980,7 +989,8 @@ gs_overview_page_load (GsOverviewPage *self)
 	if (!self->loading_featured) {
 		g_autoptr(GsPluginJob) plugin_job = NULL;
 		g_autoptr(GsAppQuery) query = NULL;
-		GsPluginListAppsFlags flags = GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE;
+		GsPluginListAppsFlags flags = GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE |
+		                              GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT;
 
 		query = gs_app_query_new ("is-featured", GS_APP_QUERY_TRISTATE_TRUE,
 					  "max-results", 5,
@@ -994,6 +1004,7 @@ gs_overview_page_load (GsOverviewPage *self)
 					  NULL);
 
 		plugin_job = gs_plugin_job_list_apps_new (query, flags);
+		gs_plugin_job_set_plugin_timeout (plugin_job, GS_PAGE_PLUGIN_TIMEOUT_MS);
 
 		self->loading_featured = TRUE;
 		gs_plugin_loader_job_process_async (self->plugin_loader,
@@ -1007,7 +1018,8 @@ gs_overview_page_load (GsOverviewPage *self)
 	if (!self->loading_deployment_featured && self->deployment_featured != NULL) {
 		g_autoptr(GsPluginJob) plugin_job = NULL;
 		g_autoptr(GsAppQuery) query = NULL;
-		GsPluginListAppsFlags flags = GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE;
+		GsPluginListAppsFlags flags = GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE |
+		                              GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT;
 
 		self->loading_deployment_featured = TRUE;
 
@@ -1023,6 +1035,7 @@ gs_overview_page_load (GsOverviewPage *self)
 					  NULL);
 
 		plugin_job = gs_plugin_job_list_apps_new (query, flags);
+		gs_plugin_job_set_plugin_timeout (plugin_job, GS_PAGE_PLUGIN_TIMEOUT_MS);
 
 		gs_plugin_loader_job_process_async (self->plugin_loader,
 						    plugin_job,
@@ -1035,7 +1048,8 @@ gs_overview_page_load (GsOverviewPage *self)
 	if (!self->loading_curated) {
 		g_autoptr(GsPluginJob) plugin_job = NULL;
 		g_autoptr(GsAppQuery) query = NULL;
-		GsPluginListAppsFlags flags = GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE;
+		GsPluginListAppsFlags flags = GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE |
+		                              GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT;
 
 		query = gs_app_query_new ("is-curated", GS_APP_QUERY_TRISTATE_TRUE,
 					  "max-results", N_TILES,
@@ -1049,6 +1063,7 @@ gs_overview_page_load (GsOverviewPage *self)
 					  NULL);
 
 		plugin_job = gs_plugin_job_list_apps_new (query, flags);
+		gs_plugin_job_set_plugin_timeout (plugin_job, GS_PAGE_PLUGIN_TIMEOUT_MS);
 
 		self->loading_curated = TRUE;
 		gs_plugin_loader_job_process_async (self->plugin_loader,
@@ -1064,7 +1079,8 @@ gs_overview_page_load (GsOverviewPage *self)
 		g_autoptr(GDateTime) now = NULL;
 		g_autoptr(GDateTime) released_since = NULL;
 		g_autoptr(GsAppQuery) query = NULL;
-		GsPluginListAppsFlags flags = GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE;
+		GsPluginListAppsFlags flags = GS_PLUGIN_LIST_APPS_FLAGS_INTERACTIVE |
+		                              GS_PLUGIN_LIST_APPS_FLAGS_ALLOW_SNAPSHOT;
 
 		now = g_date_time_new_now_local ();
 		released_since = g_date_time_add_seconds (now, -(60 * 60 * 24 * 30));
@@ -1082,6 +1098,7 @@ gs_overview_page_load (GsOverviewPage *self)
 					  NULL);
 
 		plugin_job = gs_plugin_job_list_apps_new (query, flags);
+		gs_plugin_job_set_plugin_timeout (plugin_job, GS_PAGE_PLUGIN_TIMEOUT_MS);
 
 		self->loading_recent = TRUE;
 		gs_plugin_loader_job_process_async (self->plugin_loader,
@@ -1095,7 +1112,8 @@ gs_overview_page_load (GsOverviewPage *self)
 	if (!self->loading_categories) {
 		g_autoptr(GsPluginJob) plugin_job = NULL;
 		GsPluginRefineCategoriesFlags flags = GS_PLUGIN_REFINE_CATEGORIES_FLAGS_INTERACTIVE |
-		                                      GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE;
+		                                      GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE |
+		                                      GS_PLUGIN_REFINE_CATEGORIES_FLAGS_ALLOW_SNAPSHOT;
 		g_autoptr(GetCategoriesData) data = NULL;
 
 		self->loading_categories = TRUE;
@@ -1118,6 +1136,15 @@ static void
 gs_overview_page_reload (GsPage *page)
 {
 	GsOverviewPage *self = GS_OVERVIEW_PAGE (page);
+
+	/* loading again now would skip the jobs still running, whose results
+	 * may be out of date too, such as those served from the startup
+	 * snapshot; so wait for them and then load everything */
+	if (self->action_cnt > 0) {
+		self->reload_pending = TRUE;
+		return;
+	}
+
 	self->featured_overwritten = FALSE;
 	gs_overview_page_invalidate (self);
 	gs_overview_page_load (self);
@@ -0,0 +1,403 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-page-benchmark
+ * @short_description: Measures frame times while the pages are populated
+ *
+ * The page benchmark switches the shell to the overview, category, installed,
+ * updates and search pages in turn, and reloads each one. While a page is
+ * being populated, it records how long each frame took to lay out and paint,
+ * and the longest stall of the main thread, which is measured as the longest
+ * delay of a high priority heartbeat timeout. A page is done once no frame
+ * has been painted for a while, or after a time limit.
+ *
+ * It is run with `gnome-software --benchmark-pages`. To run it headless and
+ * with thousands of apps, on the broadway backend and with only the dummy
+ * plugin, use `meson test --benchmark page-benchmark` once the plugins are
+ * installed, or run `src/run-page-benchmark.sh` directly.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gtk/gtk.h>
+
+#include "gs-page-benchmark.h"
+
+/* how often the heartbeat runs to detect main thread stalls */
+#define HEARTBEAT_INTERVAL_MS 10
+
+/* a page is populated once no frame has been painted for this long */
+#define SETTLE_QUIET_MS 1000
+
+/* or, if it keeps animating, after this long */
+#define SETTLE_MAX_MS 30000
+
+/* frames which take longer than this are janky at 60 Hz */
+#define JANKY_FRAME_USEC 16667
+
+typedef enum {
+	STEP_OVERVIEW,
+	STEP_CATEGORY,
+	STEP_INSTALLED,
+	STEP_UPDATES,
+	STEP_SEARCH,
+	N_STEPS
+} Step;
+
+static const gchar * const step_names[N_STEPS] = {
+	"overview",
+	"category",
+	"installed",
+	"updates",
+	"search",
+};
+
+typedef struct {
+	GArray *frame_times_usec;  /* (owned) (element-type gint64) */
+	gint64 longest_stall_usec;
+	gint64 start_time_usec;
+	gint64 settled_time_usec;
+} PageStats;
+
+struct _GsPageBenchmark
+{
+	GObject			 parent_instance;
+
+	GsShell			*shell;  /* (owned) */
+	GsPluginLoader		*plugin_loader;  /* (owned) */
+
+	GTask			*task;  /* (owned) (nullable); set while running */
+	GdkFrameClock		*frame_clock;  /* (owned) (nullable) */
+	gulong			 after_paint_id;
+	guint			 heartbeat_id;
+	guint			 settle_id;
+	gint64			 last_heartbeat_usec;
+	gint64			 last_frame_usec;
+
+	Step			 step;
+	PageStats		 pages[N_STEPS];
+};
+
+G_DEFINE_TYPE (GsPageBenchmark, gs_page_benchmark, G_TYPE_OBJECT)
+
+static void start_step (GsPageBenchmark *self);
+
+static gint
+frame_time_cmp_cb (gconstpointer a,
+                   gconstpointer b)
+{
+	gint64 time_a = *((const gint64 *) a);
+	gint64 time_b = *((const gint64 *) b);
+
+	if (time_a != time_b)
+		return (time_a < time_b) ? -1 : 1;
+	return 0;
+}
+
+static void
+gs_page_benchmark_stop (GsPageBenchmark *self)
+{
+	g_clear_handle_id (&self->heartbeat_id, g_source_remove);
+	g_clear_handle_id (&self->settle_id, g_source_remove);
+	if (self->frame_clock != NULL)
+		g_clear_signal_handler (&self->after_paint_id, self->frame_clock);
+	g_clear_object (&self->frame_clock);
+}
+
+static void
+after_paint_cb (GdkFrameClock *frame_clock,
+                gpointer       user_data)
+{
+	GsPageBenchmark *self = GS_PAGE_BENCHMARK (user_data);
+	gint64 now = g_get_monotonic_time ();
+	gint64 frame_time_usec;
+
+	/* the frame time is when the frame clock started this frame */
+	frame_time_usec = now - gdk_frame_clock_get_frame_time (frame_clock);
+	g_array_append_val (self->pages[self->step].frame_times_usec, frame_time_usec);
+	self->last_frame_usec = now;
+}
+
+static gboolean
+heartbeat_cb (gpointer user_data)
+{
+	GsPageBenchmark *self = GS_PAGE_BENCHMARK (user_data);
+	PageStats *stats = &self->pages[self->step];
+	gint64 now = g_get_monotonic_time ();
+	gint64 stall_usec = now - self->last_heartbeat_usec - HEARTBEAT_INTERVAL_MS * G_TIME_SPAN_MILLISECOND;
+
+	stats->longest_stall_usec = MAX (stats->longest_stall_usec, stall_usec);
+	self->last_heartbeat_usec = now;
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gchar *
+format_report (GsPageBenchmark *self)
+{
+	GString *str = g_string_new ("# page       frames  p95 frame (ms)  max frame (ms)  janky frames  longest stall (ms)  settled (ms)\n");
+
+	for (guint i = 0; i < N_STEPS; i++) {
+		PageStats *stats = &self->pages[i];
+		GArray *times = stats->frame_times_usec;
+		gint64 p95_usec = 0, max_usec = 0;
+		guint n_janky = 0;
+
+		g_array_sort (times, frame_time_cmp_cb);
+		if (times->len > 0) {
+			p95_usec = g_array_index (times, gint64, (times->len * 95 + 99) / 100 - 1);
+			max_usec = g_array_index (times, gint64, times->len - 1);
+		}
+		for (guint j = 0; j < times->len; j++) {
+			if (g_array_index (times, gint64, j) > JANKY_FRAME_USEC)
+				n_janky++;
+		}
+
+		g_string_append_printf (str, "%-11s  %6u  %14.1f  %14.1f  %12u  %18.1f  %12.1f\n",
+					step_names[i], times->len,
+					(gdouble) p95_usec / G_TIME_SPAN_MILLISECOND,
+					(gdouble) max_usec / G_TIME_SPAN_MILLISECOND,
+					n_janky,
+					(gdouble) stats->longest_stall_usec / G_TIME_SPAN_MILLISECOND,
+					(gdouble) (stats->settled_time_usec - stats->start_time_usec) / G_TIME_SPAN_MILLISECOND);
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static gboolean
+settle_cb (gpointer user_data)
+{
+	GsPageBenchmark *self = GS_PAGE_BENCHMARK (user_data);
+	PageStats *stats = &self->pages[self->step];
+	gint64 now = g_get_monotonic_time ();
+	g_autoptr(GTask) task = NULL;
+
+	if (g_cancellable_is_cancelled (g_task_get_cancellable (self->task))) {
+		self->settle_id = 0;
+		gs_page_benchmark_stop (self);
+		task = g_steal_pointer (&self->task);
+		g_task_return_error_if_cancelled (task);
+		return G_SOURCE_REMOVE;
+	}
+
+	if (now - self->last_frame_usec < SETTLE_QUIET_MS * G_TIME_SPAN_MILLISECOND &&
+	    now - stats->start_time_usec < SETTLE_MAX_MS * G_TIME_SPAN_MILLISECOND)
+		return G_SOURCE_CONTINUE;
+
+	stats->settled_time_usec = MIN (now, self->last_frame_usec);
+	if (stats->settled_time_usec < stats->start_time_usec)
+		stats->settled_time_usec = stats->start_time_usec;
+	g_debug ("page benchmark: %s settled", step_names[self->step]);
+
+	if (self->step + 1 < N_STEPS) {
+		self->step++;
+		start_step (self);
+		return G_SOURCE_CONTINUE;
+	}
+
+	self->settle_id = 0;
+	gs_page_benchmark_stop (self);
+
+	task = g_steal_pointer (&self->task);
+	g_task_return_pointer (task, format_report (self), g_free);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Reload the page for @mode, and then show it. Switching to a page loads it
+ * only if it isn’t already loaded or loading, so reloading it first means it
+ * is loaded afresh exactly once, whether or not it was shown before. */
+static void
+show_reloaded_page (GsPageBenchmark *self,
+                    GsShellMode      mode)
+{
+	gs_shell_reload_page (self->shell, mode);
+	gs_shell_change_mode (self->shell, mode, NULL, TRUE);
+}
+
+static void
+start_step (GsPageBenchmark *self)
+{
+	PageStats *stats = &self->pages[self->step];
+
+	g_debug ("page benchmark: loading %s", step_names[self->step]);
+
+	stats->start_time_usec = g_get_monotonic_time ();
+	self->last_frame_usec = stats->start_time_usec;
+	self->last_heartbeat_usec = stats->start_time_usec;
+
+	switch (self->step) {
+	case STEP_OVERVIEW:
+		show_reloaded_page (self, GS_SHELL_MODE_OVERVIEW);
+		break;
+	case STEP_CATEGORY: {
+		GsCategoryManager *manager = gs_plugin_loader_get_category_manager (self->plugin_loader);
+		gsize n_categories = 0;
+		GsCategory * const *categories = gs_category_manager_get_categories (manager, &n_categories);
+
+		if (n_categories > 0)
+			gs_shell_show_category (self->shell, categories[0]);
+		break;
+	}
+	case STEP_INSTALLED:
+		show_reloaded_page (self, GS_SHELL_MODE_INSTALLED);
+		break;
+	case STEP_UPDATES:
+		show_reloaded_page (self, GS_SHELL_MODE_UPDATES);
+		break;
+	case STEP_SEARCH:
+		gs_shell_show_search (self->shell, "app");
+		break;
+	case N_STEPS:
+	default:
+		g_assert_not_reached ();
+	}
+}
+
+/**
+ * gs_page_benchmark_run_async:
+ * @self: a #GsPageBenchmark
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @callback: callback for when the benchmark is finished
+ * @user_data: data to pass to @callback
+ *
+ * Run the benchmark over each page in turn. The shell must already be
+ * loaded and shown.
+ *
+ * Since: 51
+ */
+void
+gs_page_benchmark_run_async (GsPageBenchmark     *self,
+                             GCancellable        *cancellable,
+                             GAsyncReadyCallback  callback,
+                             gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (GS_IS_PAGE_BENCHMARK (self));
+	g_return_if_fail (self->task == NULL);
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gs_page_benchmark_run_async);
+
+	self->frame_clock = gtk_widget_get_frame_clock (GTK_WIDGET (self->shell));
+	if (self->frame_clock == NULL) {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_INITIALIZED,
+					 "The window must be shown to benchmark the pages");
+		return;
+	}
+	g_object_ref (self->frame_clock);
+
+	for (guint i = 0; i < N_STEPS; i++) {
+		g_clear_pointer (&self->pages[i].frame_times_usec, g_array_unref);
+		memset (&self->pages[i], 0, sizeof (self->pages[i]));
+		self->pages[i].frame_times_usec = g_array_new (FALSE, FALSE, sizeof (gint64));
+	}
+
+	self->task = g_steal_pointer (&task);
+	self->step = STEP_OVERVIEW;
+	start_step (self);
+
+	self->after_paint_id = g_signal_connect (self->frame_clock, "after-paint",
+						 G_CALLBACK (after_paint_cb), self);
+	self->heartbeat_id = g_timeout_add_full (G_PRIORITY_HIGH, HEARTBEAT_INTERVAL_MS,
+						 heartbeat_cb, self, NULL);
+	self->settle_id = g_timeout_add (100, settle_cb, self);
+}
+
+/**
+ * gs_page_benchmark_run_finish:
+ * @self: a #GsPageBenchmark
+ * @result: result of the operation
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finish an operation started with gs_page_benchmark_run_async().
+ *
+ * Returns: (transfer full): the results, formatted as a table with one line
+ *   per page, or %NULL on error
+ *
+ * Since: 51
+ */
+gchar *
+gs_page_benchmark_run_finish (GsPageBenchmark  *self,
+                              GAsyncResult     *result,
+                              GError          **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+	g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gs_page_benchmark_run_async, NULL);
+
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+gs_page_benchmark_dispose (GObject *object)
+{
+	GsPageBenchmark *self = GS_PAGE_BENCHMARK (object);
+
+	gs_page_benchmark_stop (self);
+	g_clear_object (&self->task);
+	g_clear_object (&self->shell);
+	g_clear_object (&self->plugin_loader);
+
+	G_OBJECT_CLASS (gs_page_benchmark_parent_class)->dispose (object);
+}
+
+static void
+gs_page_benchmark_finalize (GObject *object)
+{
+	GsPageBenchmark *self = GS_PAGE_BENCHMARK (object);
+
+	for (guint i = 0; i < N_STEPS; i++)
+		g_clear_pointer (&self->pages[i].frame_times_usec, g_array_unref);
+
+	G_OBJECT_CLASS (gs_page_benchmark_parent_class)->finalize (object);
+}
+
+static void
+gs_page_benchmark_class_init (GsPageBenchmarkClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gs_page_benchmark_dispose;
+	object_class->finalize = gs_page_benchmark_finalize;
+}
+
+static void
+gs_page_benchmark_init (GsPageBenchmark *self)
+{
+}
+
+/**
+ * gs_page_benchmark_new:
+ * @shell: the #GsShell to benchmark
+ * @plugin_loader: the #GsPluginLoader used by @shell
+ *
+ * Create a new page benchmark.
+ *
+ * Returns: (transfer full): a new #GsPageBenchmark
+ *
+ * Since: 51
+ */
+GsPageBenchmark *
+gs_page_benchmark_new (GsShell        *shell,
+                       GsPluginLoader *plugin_loader)
+{
+	GsPageBenchmark *self;
+
+	g_return_val_if_fail (GS_IS_SHELL (shell), NULL);
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
+
+	self = g_object_new (GS_TYPE_PAGE_BENCHMARK, NULL);
+	self->shell = g_object_ref (shell);
+	self->plugin_loader = g_object_ref (plugin_loader);
+
+	return self;
+}
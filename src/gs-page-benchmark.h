@@ -0,0 +1,32 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Foundation, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <glib-object.h>
+
+#include "gs-shell.h"
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_PAGE_BENCHMARK (gs_page_benchmark_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsPageBenchmark, gs_page_benchmark, GS, PAGE_BENCHMARK, GObject)
+
+GsPageBenchmark	*gs_page_benchmark_new		(GsShell		*shell,
+						 GsPluginLoader		*plugin_loader);
+void		 gs_page_benchmark_run_async	(GsPageBenchmark	*self,
+						 GCancellable		*cancellable,
+						 GAsyncReadyCallback	 callback,
+						 gpointer		 user_data);
+gchar		*gs_page_benchmark_run_finish	(GsPageBenchmark	*self,
+						 GAsyncResult		*result,
+						 GError			**error);
+
+G_END_DECLS
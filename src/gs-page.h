@@ -15,6 +15,11 @@ G_BEGIN_DECLS
 
 #define GS_TYPE_PAGE (gs_page_get_type ())
 
+/* How long a page waits for each plugin when loading apps to show, before
+ * showing what it has; apps which a plugin timed out on are refined again in
+ * the background. See gs_plugin_job_set_plugin_timeout(). */
+#define GS_PAGE_PLUGIN_TIMEOUT_MS 5000
+
 G_DECLARE_DERIVABLE_TYPE (GsPage, gs_page, GS, PAGE, GtkWidget)
 
 struct _GsPageClass
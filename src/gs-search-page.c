@@ -35,6 +35,7 @@ struct _GsSearchPage
 	guint			 waiting_id;
 	guint			 max_results;
 	guint			 stamp;
+	guint			 partial_results_stamp;  /* stamp of the search whose partial results are shown */
 	gboolean		 changed;
 
 	GtkWidget		*list_box_search;
@@ -101,6 +102,70 @@ typedef struct {
 	guint stamp;
 } GetSearchData;
 
+static void
+gs_search_page_add_app_row (GsSearchPage *self,
+                            GsApp        *app)
+{
+	GtkWidget *app_row;
+
+	app_row = gs_app_row_new (app);
+	gs_app_row_set_show_rating (GS_APP_ROW (app_row), TRUE);
+	g_signal_connect (app_row, "button-clicked",
+			  G_CALLBACK (gs_search_page_app_row_clicked_cb),
+			  self);
+	gtk_list_box_append (GTK_LIST_BOX (self->list_box_search), app_row);
+	gs_app_row_set_size_groups (GS_APP_ROW (app_row),
+				    self->sizegroup_name,
+				    self->sizegroup_button_label,
+				    self->sizegroup_button_image);
+	gtk_widget_set_visible (app_row, TRUE);
+}
+
+static gboolean
+gs_search_page_has_app_row (GsSearchPage *self,
+                            GsApp        *app)
+{
+	for (GtkWidget *child = gtk_widget_get_first_child (self->list_box_search);
+	     child != NULL;
+	     child = gtk_widget_get_next_sibling (child)) {
+		if (GS_IS_APP_ROW (child) &&
+		    gs_app_row_get_app (GS_APP_ROW (child)) == app)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+gs_search_page_partial_results_cb (GsPluginJobListApps *list_apps_job,
+                                   GsAppList           *list,
+                                   gpointer             user_data)
+{
+	GetSearchData *search_data = user_data;
+	GsSearchPage *self = search_data->self;
+
+	/* different stamps means another search had been started since */
+	if (search_data->stamp != self->stamp)
+		return;
+
+	/* Show the results from the fastest plugins straight away, replacing
+	 * those from the previous search. They’re all replaced by the sorted
+	 * results once the search finishes. */
+	if (self->partial_results_stamp != self->stamp) {
+		self->partial_results_stamp = self->stamp;
+		gs_search_page_waiting_cancel (self);
+		gs_widget_remove_all (self->list_box_search, (GsRemoveFunc) gtk_list_box_remove);
+		gtk_stack_set_visible_child_name (GTK_STACK (self->stack_search), "results");
+	}
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+
+		if (!gs_search_page_has_app_row (self, app))
+			gs_search_page_add_app_row (self, app);
+	}
+}
+
 static void
 gs_search_page_get_search_cb (GObject *source_object,
                               GAsyncResult *res,
@@ -111,7 +176,6 @@ gs_search_page_get_search_cb (GObject *source_object,
 	GsApp *app;
 	GsSearchPage *self = search_data->self;
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
-	GtkWidget *app_row;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GsPluginJobListApps) list_apps_job = NULL;
 	GsAppList *list;
@@ -155,17 +219,7 @@ gs_search_page_get_search_cb (GObject *source_object,
 	gtk_stack_set_visible_child_name (GTK_STACK (self->stack_search), "results");
 	for (i = 0; i < gs_app_list_length (list); i++) {
 		app = gs_app_list_index (list, i);
-		app_row = gs_app_row_new (app);
-		gs_app_row_set_show_rating (GS_APP_ROW (app_row), TRUE);
-		g_signal_connect (app_row, "button-clicked",
-				  G_CALLBACK (gs_search_page_app_row_clicked_cb),
-				  self);
-		gtk_list_box_append (GTK_LIST_BOX (self->list_box_search), app_row);
-		gs_app_row_set_size_groups (GS_APP_ROW (app_row),
-					    self->sizegroup_name,
-					    self->sizegroup_button_label,
-					    self->sizegroup_button_image);
-		gtk_widget_set_visible (app_row, TRUE);
+		gs_search_page_add_app_row (self, app);
 	}
 
 	/* too many results */
@@ -273,6 +327,7 @@ gs_search_page_load (GsSearchPage *self)
 	g_autoptr(GsAppQuery) query = NULL;
 	const gchar *keywords[2] = { NULL, };
 	g_autofree GetSearchData *search_data = NULL;
+	GetSearchData *partial_results_data;
 
 	self->changed = FALSE;
 
@@ -308,6 +363,8 @@ gs_search_page_load (GsSearchPage *self)
 							  GS_PLUGIN_REFINE_REQUIRE_FLAGS_LICENSE |
 							  GS_PLUGIN_REFINE_REQUIRE_FLAGS_PERMISSIONS |
 							  GS_PLUGIN_REFINE_REQUIRE_FLAGS_RATING,
+				  "ranking-refine-require-flags", GS_PLUGIN_REFINE_REQUIRE_FLAGS_RATING |
+								  GS_PLUGIN_REFINE_REQUIRE_FLAGS_KUDOS,
 				  "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
 						  GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
 				  "max-results", self->max_results,
@@ -316,7 +373,14 @@ gs_search_page_load (GsSearchPage *self)
 				  "license-type", gs_page_get_query_license_type (GS_PAGE (self)),
 				  "developer-verified-type", gs_page_get_query_developer_verified_type (GS_PAGE (self)),
 				  NULL);
-	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_NONE);
+	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_STREAM_RESULTS);
+	gs_plugin_job_set_plugin_timeout (plugin_job, GS_PAGE_PLUGIN_TIMEOUT_MS);
+
+	partial_results_data = g_memdup2 (search_data, sizeof (*search_data));
+	g_signal_connect_data (plugin_job, "partial-results",
+			       G_CALLBACK (gs_search_page_partial_results_cb),
+			       partial_results_data, (GClosureNotify) g_free, 0);
+
 	gs_plugin_loader_job_process_async (self->plugin_loader, plugin_job,
 					    self->search_cancellable,
 					    gs_search_page_get_search_cb,
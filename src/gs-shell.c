@@ -1010,6 +1010,17 @@ change_mode_idle (gpointer user_data)
 	return G_SOURCE_REMOVE;
 }
 
+static void
+connect_reload (GsShell *shell)
+{
+	if (shell->plugin_loader_reload_id != 0)
+		return;
+
+	shell->plugin_loader_reload_id =
+		g_signal_connect (shell->plugin_loader, "reload",
+			          G_CALLBACK (gs_shell_reload_cb), shell);
+}
+
 static void
 overview_page_refresh_done (GsOverviewPage *overview_page, gpointer data)
 {
@@ -1018,9 +1029,7 @@ overview_page_refresh_done (GsOverviewPage *overview_page, gpointer data)
 	g_clear_signal_handler (&shell->overview_page_refreshed_id, overview_page);
 
 	/* now that we're finished with the loading page, connect the reload signal handler */
-	shell->plugin_loader_reload_id =
-		g_signal_connect (shell->plugin_loader, "reload",
-			          G_CALLBACK (gs_shell_reload_cb), shell);
+	connect_reload (shell);
 
 	/* schedule to change the mode in an idle callback, since it can take a
 	 * while and this callback handler is typically called at the end of a
@@ -1051,9 +1060,7 @@ initial_refresh_done (GsLoadingPage *loading_page, gpointer data)
 	}
 
 	/* now that we're finished with the loading page, connect the reload signal handler */
-	shell->plugin_loader_reload_id =
-		g_signal_connect (shell->plugin_loader, "reload",
-			          G_CALLBACK (gs_shell_reload_cb), shell);
+	connect_reload (shell);
 }
 
 static gboolean
@@ -2389,7 +2396,17 @@ gs_shell_setup (GsShell *shell, GsPluginLoader *plugin_loader, GCancellable *can
 	/* coldplug */
 	gs_shell_rescan_events (shell);
 
-	if (g_settings_get_boolean (shell->settings, "download-updates")) {
+	if (gs_plugin_loader_can_serve_snapshot (shell->plugin_loader)) {
+		/* The plugins are still being set up, and the overview can be
+		 * shown from the previous run’s snapshot until they are. Skip
+		 * the initial refresh: apart from on the first run, which has
+		 * no snapshot, it only fetches metadata if there is none at
+		 * all. ::reload is emitted once setup completes, to replace the
+		 * snapshot results, so listen for it straight away. */
+		g_debug ("Skipped the initial refresh to show the startup snapshot");
+		connect_reload (shell);
+		initial_refresh_done (GS_LOADING_PAGE (shell->pages[GS_SHELL_MODE_LOADING]), shell);
+	} else if (g_settings_get_boolean (shell->settings, "download-updates")) {
 		/* show loading page, which triggers the initial refresh */
 		gs_shell_change_mode (shell, GS_SHELL_MODE_LOADING, NULL, TRUE);
 	} else {
@@ -2455,6 +2472,26 @@ gs_shell_get_mode_string (GsShell *shell)
 	return page_name[mode];
 }
 
+/**
+ * gs_shell_reload_page:
+ * @shell: a #GsShell
+ * @mode: the mode of the page to reload
+ *
+ * Reload the page for @mode, as is done for all pages when the plugin loader
+ * asks for a reload.
+ *
+ * Since: 51
+ */
+void
+gs_shell_reload_page (GsShell *shell, GsShellMode mode)
+{
+	g_return_if_fail (GS_IS_SHELL (shell));
+	g_return_if_fail (mode < GS_SHELL_MODE_LAST);
+
+	if (shell->pages[mode] != NULL)
+		gs_page_reload (shell->pages[mode]);
+}
+
 void
 gs_shell_install (GsShell *shell, GsApp *app, GsShellInteraction interaction)
 {
@@ -51,6 +51,8 @@ void		 gs_shell_set_mode		(GsShell	*shell,
 						 GsShellMode	 mode);
 GsShellMode	 gs_shell_get_mode		(GsShell	*shell);
 const gchar	*gs_shell_get_mode_string	(GsShell	*shell);
+void		 gs_shell_reload_page		(GsShell	*shell,
+						 GsShellMode	 mode);
 void		 gs_shell_install		(GsShell		*shell,
 						 GsApp			*app,
 						 GsShellInteraction	interaction);
@@ -0,0 +1,68 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Measures how much sooner the first content is shown when gnome-software
+# starts from the snapshot of its previous run.
+#
+# Runs `gnome-software --dump-startup-timeline` twice, headless as in
+# run-page-benchmark.sh, with only the dummy plugin, which takes
+# GS_TEST_DUMMY_SETUP_DELAY_MS to set up. The first run has no snapshot, so
+# shows the overview only once the plugins are set up, and saves the snapshot
+# as it quits. The second run shows the overview from that snapshot straight
+# away. Compare the `first-loaded-frame` milestone of the two timelines.
+#
+# gnome-software loads its plugins from the plugin directory it was built
+# for, so they have to be installed there first.
+#
+# Usage: run-startup-benchmark.sh GNOME_SOFTWARE [GTK4_BROADWAYD]
+
+set -eu
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 GNOME_SOFTWARE [GTK4_BROADWAYD]" >&2
+	exit 2
+fi
+
+gnome_software="$1"
+broadwayd="${2:-gtk4-broadwayd}"
+display=":${GS_BENCHMARK_BROADWAY_DISPLAY:-42}"
+
+tmpdir="$(mktemp -d -t gnome-software-startup-benchmark-XXXXXX)"
+broadwayd_pid=""
+
+cleanup () {
+	if [ -n "$broadwayd_pid" ]; then
+		kill "$broadwayd_pid" 2>/dev/null || true
+		wait "$broadwayd_pid" 2>/dev/null || true
+	fi
+	rm -rf "$tmpdir"
+}
+trap cleanup EXIT INT TERM
+
+"$broadwayd" "$display" &
+broadwayd_pid=$!
+
+# give broadwayd a moment to start listening, and check it did
+sleep 1
+if ! kill -0 "$broadwayd_pid" 2>/dev/null; then
+	echo "$broadwayd failed to start on display $display" >&2
+	exit 1
+fi
+
+export GDK_BACKEND=broadway
+export BROADWAY_DISPLAY="$display"
+export HOME="$tmpdir"
+export XDG_CONFIG_HOME="$tmpdir/config"
+export XDG_CACHE_HOME="$tmpdir/cache"
+export XDG_DATA_HOME="$tmpdir/data"
+export GSETTINGS_BACKEND=memory
+export GS_TEST_DUMMY_ENABLE=1
+export GS_TEST_DUMMY_N_APPS="${GS_TEST_DUMMY_N_APPS:-5000}"
+export GS_TEST_DUMMY_SETUP_DELAY_MS="${GS_TEST_DUMMY_SETUP_DELAY_MS:-2000}"
+export GNOME_SOFTWARE_PLUGINS_ALLOWLIST="${GNOME_SOFTWARE_PLUGINS_ALLOWLIST:-dummy}"
+
+echo "# without a startup snapshot"
+dbus-run-session -- "$gnome_software" --dump-startup-timeline
+
+echo "# from the startup snapshot"
+dbus-run-session -- "$gnome_software" --dump-startup-timeline